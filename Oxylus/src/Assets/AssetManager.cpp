@@ -4,6 +4,7 @@
 #include "Audio/AudioSource.hpp"
 #include "Core/App.hpp"
 #include "Render/Mesh.hpp"
+#include "Render/Vulkan/VkContext.hpp"
 
 #include "Utils/Log.hpp"
 #include "Utils/Profiler.hpp"
@@ -11,70 +12,300 @@
 namespace ox {
 AssetManager* AssetManager::_instance = nullptr;
 
-void AssetManager::set_instance() {
-  if (_instance == nullptr)
-    _instance = App::get_system<AssetManager>();
+namespace {
+template <typename Entry, typename T>
+Entry* get_entry(std::vector<Entry>& entries, const AssetHandle<T> handle) {
+  if (handle.index >= entries.size() || entries[handle.index].generation != handle.generation || !entries[handle.index].asset.valid())
+    return nullptr;
+  return &entries[handle.index];
 }
 
-Shared<Texture> AssetManager::get_texture_asset(const TextureLoadInfo& info) {
-  if (_instance->_state.texture_assets.contains(info.path)) {
-    return _instance->_state.texture_assets[info.path];
+// failed loads hold an exception, they resolve to nothing
+template <typename T>
+Shared<T> get_asset(const std::shared_future<Shared<T>>& future) {
+  try {
+    return future.get();
+  } catch (...) {
+    return nullptr;
   }
+}
+} // namespace
 
-  return load_texture_asset(info.path, info);
+template <>
+AssetManager::AssetPool<Texture>& AssetManager::get_pool<Texture>() {
+  return _instance->_state.texture_assets;
 }
 
-// TODO: Doesn't respect virtual dirs
-Shared<Texture> AssetManager::get_texture_asset(const std::string& name, const TextureLoadInfo& info) {
-  if (_instance->_state.texture_assets.contains(name)) {
-    return _instance->_state.texture_assets[name];
+template <>
+AssetManager::AssetPool<Mesh>& AssetManager::get_pool<Mesh>() {
+  return _instance->_state.mesh_assets;
+}
+
+template <>
+AssetManager::AssetPool<AudioSource>& AssetManager::get_pool<AudioSource>() {
+  return _instance->_state.audio_assets;
+}
+
+template <typename T, typename Load>
+AssetHandle<T> AssetManager::acquire_or_load(const AssetID& id, Load load) {
+  auto& pool = get_pool<T>();
+  std::promise<Shared<T>> promise = {};
+  AssetHandle<T> handle = {};
+  {
+    std::lock_guard lock(_instance->_state.mutex);
+    if (const auto it = pool.index.find(id); it != pool.index.end()) {
+      // someone else got here first, the asset is either loaded or in-flight. Waiting for it is up to the caller,
+      // on a worker the load might be further down this same stack
+      auto& entry = pool.entries[it->second];
+      entry.ref_count++;
+      return {it->second, entry.generation};
+    } else {
+      if (pool.free_list.empty()) {
+        handle.index = (uint32_t)pool.entries.size();
+        pool.entries.emplace_back();
+      } else {
+        handle.index = pool.free_list.back();
+        pool.free_list.pop_back();
+      }
+
+      auto& entry = pool.entries[handle.index];
+      entry.id = id;
+      entry.asset = promise.get_future().share();
+      entry.ref_count = 1;
+      handle.generation = entry.generation;
+      pool.index.emplace(id, handle.index);
+    }
   }
 
-  return load_texture_asset(name, info);
+  try {
+    promise.set_value(load(handle));
+  } catch (...) {
+    OX_LOG_ERROR("Couldn't load asset {}", id);
+    // later requests try again instead of getting the failed entry, the entry itself goes away with its last reference
+    {
+      std::lock_guard lock(_instance->_state.mutex);
+      if (const auto it = pool.index.find(id); it != pool.index.end() && it->second == handle.index)
+        pool.index.erase(it);
+    }
+    promise.set_exception(std::current_exception());
+  }
+  return handle;
 }
 
-// TODO: Doesn't respect virtual dirs
-AssetTask<Texture>* AssetManager::get_texture_asset_future(const TextureLoadInfo& info) {
-  const auto* t = &_instance->_state.texture_tasks.emplace_back(create_unique<AssetTask<Texture>>([info] {
-    if (_instance->_state.texture_assets.contains(info.path)) {
-      return _instance->_state.texture_assets[info.path];
+template <typename T>
+Shared<T> AssetManager::make_reference(const AssetHandle<T> handle) {
+  auto asset = get(handle);
+  if (!asset) {
+    release(handle);
+    return nullptr;
+  }
+
+  // the deleter keeps the asset alive too, references can outlive the manager at shutdown
+  return Shared<T>(asset.get(), [owner = asset, handle](T*) { release(handle); });
+}
+
+template <typename T>
+Shared<T> AssetManager::get(const AssetHandle<T> handle) {
+  std::shared_future<Shared<T>> future = {};
+  {
+    std::lock_guard lock(_instance->_state.mutex);
+    if (const auto* entry = get_entry(get_pool<T>().entries, handle))
+      future = entry->asset;
+  }
+
+  // waiting never happens under the lock, an in-flight load would stall every other request
+  return future.valid() ? get_asset(future) : nullptr;
+}
+
+template <typename T>
+void AssetManager::acquire(const AssetHandle<T> handle) {
+  std::lock_guard lock(_instance->_state.mutex);
+  if (auto* entry = get_entry(get_pool<T>().entries, handle))
+    entry->ref_count++;
+}
+
+template <typename T>
+void AssetManager::release(const AssetHandle<T> handle) {
+  if (_instance == nullptr)
+    return;
+
+  std::lock_guard lock(_instance->_state.mutex);
+  auto& pool = get_pool<T>();
+  auto* entry = get_entry(pool.entries, handle);
+  if (!entry || entry->ref_count == 0)
+    return;
+
+  if (--entry->ref_count == 0) {
+    entry->release_frame = _instance->_state.frame;
+    pool.free_queue.emplace_back(handle, entry->release_frame);
+  }
+}
+
+template Shared<Texture> AssetManager::get(AssetHandle<Texture>);
+template Shared<Mesh> AssetManager::get(AssetHandle<Mesh>);
+template Shared<AudioSource> AssetManager::get(AssetHandle<AudioSource>);
+template void AssetManager::acquire(AssetHandle<Texture>);
+template void AssetManager::acquire(AssetHandle<Mesh>);
+template void AssetManager::acquire(AssetHandle<AudioSource>);
+template void AssetManager::release(AssetHandle<Texture>);
+template void AssetManager::release(AssetHandle<Mesh>);
+template void AssetManager::release(AssetHandle<AudioSource>);
+
+template <typename T>
+void AssetManager::process_free_queue(const uint64_t latency, std::vector<std::shared_future<Shared<T>>>& freed) {
+  auto& pool = get_pool<T>();
+  const auto frame = _instance->_state.frame;
+
+  while (!pool.free_queue.empty() && pool.free_queue.front().frame + latency <= frame) {
+    const auto [handle, release_frame] = pool.free_queue.front();
+    pool.free_queue.pop_front();
+
+    // it was requested again while it was queued, or released again later in which case only the newer
+    // queue entry may free it, frames in flight since that release could still be using it
+    auto* entry = get_entry(pool.entries, handle);
+    if (!entry || entry->ref_count != 0 || entry->release_frame != release_frame)
+      continue;
+
+    if (const auto it = pool.index.find(entry->id); it != pool.index.end() && it->second == handle.index)
+      pool.index.erase(it);
+
+    // slot goes back to the free list once the in-flight frames that might still sample it are retired
+    // nothing references it anymore, so it's not in-flight and doesn't block
+    if constexpr (std::is_same_v<T, Texture>) {
+      if (const auto texture = get_asset(entry->asset))
+        _instance->_state.texture_slots.release(texture->_bindless_slot, frame);
+    }
+
+    freed.emplace_back(std::move(entry->asset));
+    entry->id.clear();
+    entry->generation++;
+    pool.free_list.emplace_back(handle.index);
+  }
+}
+
+template <typename T>
+void AssetManager::complete_tasks(std::vector<Shared<AssetTask<T>>>& tasks) {
+  std::vector<Shared<AssetTask<T>>> completed = {};
+  {
+    std::lock_guard lock(_instance->_state.mutex);
+    for (auto it = tasks.begin(); it != tasks.end();) {
+      // the task only acquired the asset, it might still be loading on another thread
+      const auto* entry = (*it)->GetIsComplete() ? get_entry(get_pool<T>().entries, (*it)->_handle) : nullptr;
+      const bool loaded = entry && entry->asset.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+      if ((*it)->GetIsComplete() && (!entry || loaded)) {
+        completed.emplace_back(std::move(*it));
+        it = tasks.erase(it);
+      } else {
+        ++it;
+      }
     }
+  }
+
+  // outside of the lock, the functions are free to request more assets
+  for (const auto& task : completed) {
+    // takes over the count the task acquired, doesn't block since the load is done
+    task->_asset = make_reference(task->_handle);
+    task->_ready = true;
+    if (task->_on_complete && task->_asset)
+      task->_on_complete(task->_asset);
+  }
+}
 
-    return load_texture_asset(info.path, info);
-  }));
+void AssetManager::init() {
+  _state.texture_slots.init(MAX_TEXTURE_SLOTS, App::get_vkcontext().num_inflight_frames);
+}
 
-  return t->get();
+void AssetManager::deinit() {
+  // references that outlive the manager keep their asset alive on their own
+  if (_instance == this)
+    _instance = nullptr;
 }
 
-Shared<Mesh> AssetManager::get_mesh_asset(const std::string& path, const uint32_t loadingFlags) {
+void AssetManager::update() {
   OX_SCOPED_ZONE;
-  if (_instance->_state.mesh_assets.contains(path)) {
-    return _instance->_state.mesh_assets[path];
+  const auto& vk_context = App::get_vkcontext();
+
+  // meshes first, freeing them releases the textures of their materials
+  std::vector<std::shared_future<Shared<Mesh>>> freed_meshes = {};
+  std::vector<std::shared_future<Shared<AudioSource>>> freed_audio = {};
+  std::vector<std::shared_future<Shared<Texture>>> freed_textures = {};
+  {
+    std::lock_guard lock(_state.mutex);
+    _state.frame = vk_context.num_frames;
+    _state.texture_slots.retire(_state.frame);
+
+    process_free_queue(vk_context.num_inflight_frames, freed_meshes);
+    process_free_queue(vk_context.num_inflight_frames, freed_audio);
+    process_free_queue(vk_context.num_inflight_frames, freed_textures);
   }
 
-  return load_mesh_asset(path, loadingFlags);
+  complete_tasks(_state.mesh_tasks);
+  complete_tasks(_state.texture_tasks);
+  complete_tasks(_state.audio_tasks);
 }
 
+void AssetManager::set_instance() {
+  if (_instance == nullptr)
+    _instance = App::get_system<AssetManager>();
+}
+
+Shared<Texture> AssetManager::get_texture_asset(const TextureLoadInfo& info) { return make_reference(acquire_texture_asset(info.path, info)); }
+
 // TODO: Doesn't respect virtual dirs
-AssetTask<Mesh>* AssetManager::get_mesh_asset_future(const std::string& path, uint32_t loadingFlags) {
-  const auto* t = &_instance->_state.mesh_tasks.emplace_back(create_unique<AssetTask<Mesh>>([path, loadingFlags] {
-    if (_instance->_state.mesh_assets.contains(path)) {
-      return _instance->_state.mesh_assets[path];
-    }
+Shared<Texture> AssetManager::get_texture_asset(const std::string& name, const TextureLoadInfo& info) {
+  return make_reference(acquire_texture_asset(name, info));
+}
 
-    return load_mesh_asset(path, loadingFlags);
-  }));
+// TODO: Doesn't respect virtual dirs
+Shared<AssetTask<Texture>> AssetManager::get_texture_asset_future(const TextureLoadInfo& info) {
+  Shared<AssetTask<Texture>> task = nullptr;
+  {
+    std::lock_guard lock(_instance->_state.mutex);
+    task = _instance->_state.texture_tasks.emplace_back(
+      create_shared<AssetTask<Texture>>([info] { return acquire_texture_asset(info.path, info); }));
+  }
+  App::get_system<TaskScheduler>()->schedule_task(task.get());
 
-  return t->get();
+  return task;
 }
 
-Shared<AudioSource> AssetManager::get_audio_asset(const std::string& path) {
+Shared<Mesh> AssetManager::get_mesh_asset(const std::string& path, const uint32_t loadingFlags) {
   OX_SCOPED_ZONE;
-  if (_instance->_state.audio_assets.contains(path)) {
-    return _instance->_state.audio_assets[path];
+  return make_reference(acquire_mesh_asset(path, loadingFlags));
+}
+
+// TODO: Doesn't respect virtual dirs
+Shared<AssetTask<Mesh>> AssetManager::get_mesh_asset_future(const std::string& path, uint32_t loadingFlags) {
+  Shared<AssetTask<Mesh>> task = nullptr;
+  {
+    std::lock_guard lock(_instance->_state.mutex);
+    task = _instance->_state.mesh_tasks.emplace_back(
+      create_shared<AssetTask<Mesh>>([path, loadingFlags] { return acquire_mesh_asset(path, loadingFlags); }));
   }
+  App::get_system<TaskScheduler>()->schedule_task(task.get());
+
+  return task;
+}
+
+Shared<AudioSource> AssetManager::get_audio_asset(const std::string& path) {
+  OX_SCOPED_ZONE;
+  return make_reference(acquire_audio_asset(path));
+}
+
+AssetHandle<Texture> AssetManager::acquire_texture_asset(const std::string& name, const TextureLoadInfo& info) {
+  return acquire_or_load<Texture>(name, [&name, &info](AssetHandle<Texture>) { return load_texture_asset(name, info); });
+}
+
+AssetHandle<Mesh> AssetManager::acquire_mesh_asset(const std::string& path, const uint32_t loadingFlags) {
+  return acquire_or_load<Mesh>(path, [&path, loadingFlags](const AssetHandle<Mesh> handle) {
+    auto mesh = load_mesh_asset(path, loadingFlags);
+    mesh->asset_id = handle.index;
+    return mesh;
+  });
+}
 
-  return load_audio_asset(path);
+AssetHandle<AudioSource> AssetManager::acquire_audio_asset(const std::string& path) {
+  return acquire_or_load<AudioSource>(path, [&path](AssetHandle<AudioSource>) { return load_audio_asset(path); });
 }
 
 Shared<Texture> AssetManager::load_texture_asset(const std::string& path, const TextureLoadInfo& info) {
@@ -85,18 +316,24 @@ Shared<Texture> AssetManager::load_texture_asset(const std::string& path, const
   new_info.path = resolved_path;
 
   Shared<Texture> texture = create_shared<Texture>(new_info);
-  texture->asset_id = (uint32_t)_instance->_state.texture_assets.size();
+  {
+    std::lock_guard lock(_instance->_state.mutex);
+    texture->_bindless_slot = _instance->_state.texture_slots.allocate();
+  }
+  if (texture->_bindless_slot.is_valid())
+    texture->asset_id = texture->_bindless_slot.index;
+  else
+    OX_LOG_ERROR("Ran out of bindless texture slots ({}), {} won't be visible to shaders.", MAX_TEXTURE_SLOTS, path);
   texture->asset_path = path;
-  return _instance->_state.texture_assets.emplace(path, texture).first->second;
+  return texture;
 }
 
 Shared<Mesh> AssetManager::load_mesh_asset(const std::string& path, uint32_t loadingFlags) {
   OX_SCOPED_ZONE;
   const auto resolved_path = App::get_system<VFS>()->resolve_physical_dir(path);
   Shared<Mesh> asset = create_shared<Mesh>(resolved_path);
-  asset->asset_id = (uint32_t)_instance->_state.mesh_assets.size();
   asset->asset_path = path;
-  return _instance->_state.mesh_assets.emplace(path, asset).first->second;
+  return asset;
 }
 
 Shared<AudioSource> AssetManager::load_audio_asset(const std::string& path) {
@@ -104,21 +341,41 @@ Shared<AudioSource> AssetManager::load_audio_asset(const std::string& path) {
   const auto resolved_path = App::get_system<VFS>()->resolve_physical_dir(path);
   Shared<AudioSource> source = create_shared<AudioSource>(resolved_path);
   source->asset_path = path;
-  return _instance->_state.audio_assets.emplace(path, source).first->second;
+  return source;
 }
 
 void AssetManager::free_unused_assets() {
   OX_SCOPED_ZONE;
-  const auto m_count = std::erase_if(_instance->_state.mesh_assets,
-                                     [](const std::pair<std::string, Shared<Mesh>>& pair) { return pair.second.use_count() <= 1; });
 
-  if (m_count > 0)
-    OX_LOG_INFO("Cleaned up {} mesh assets.", m_count);
+  std::vector<std::shared_future<Shared<Mesh>>> freed_meshes = {};
+  {
+    std::lock_guard lock(_instance->_state.mutex);
+    process_free_queue(0, freed_meshes);
+  }
+  if (!freed_meshes.empty())
+    OX_LOG_INFO("Cleaned up {} mesh assets.", freed_meshes.size());
+
+  // destroying the meshes queued the textures only they were using
+  freed_meshes.clear();
 
-  const auto t_count = std::erase_if(_instance->_state.texture_assets,
-                                     [](const std::pair<std::string, Shared<Texture>>& pair) { return pair.second.use_count() <= 1; });
+  std::vector<std::shared_future<Shared<AudioSource>>> freed_audio = {};
+  std::vector<std::shared_future<Shared<Texture>>> freed_textures = {};
+  {
+    std::lock_guard lock(_instance->_state.mutex);
+    process_free_queue(0, freed_audio);
+    process_free_queue(0, freed_textures);
+  }
+  if (!freed_textures.empty())
+    OX_LOG_INFO("Cleaned up {} texture assets.", freed_textures.size());
+}
+
+void AssetManager::free_texture_asset(const AssetID& id) {
+  std::lock_guard lock(_instance->_state.mutex);
+  _instance->_state.texture_assets.index.erase(id);
+}
 
-  if (t_count > 0)
-    OX_LOG_INFO("Cleaned up {} texture assets.", t_count);
+bool AssetManager::is_texture_slot_alive(const SlotAllocator::Handle& handle) {
+  std::lock_guard lock(_instance->_state.mutex);
+  return _instance->_state.texture_slots.is_alive(handle);
 }
 } // namespace ox
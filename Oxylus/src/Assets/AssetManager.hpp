@@ -1,10 +1,15 @@
 #pragma once
 
 #include <ankerl/unordered_dense.h>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <mutex>
 #include <plf_colony.h>
 
 #include "Core/Base.hpp"
 #include "Core/ESystem.hpp"
+#include "Render/Utils/SlotAllocator.hpp"
 #include "Thread/TaskScheduler.hpp"
 
 namespace ox {
@@ -15,60 +20,159 @@ class AudioSource;
 
 using AssetID = std::string;
 
+// Typed reference to an asset of the AssetManager, resolving it is an array lookup.
+//	The generation is bumped when the asset is freed, so handles that outlived it resolve to nothing.
+template <typename T>
+struct AssetHandle {
+  static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+  uint32_t index = INVALID_INDEX;
+  uint32_t generation = 0;
+
+  bool is_valid() const { return index != INVALID_INDEX; }
+  bool operator==(const AssetHandle& other) const = default;
+};
+
+// Loads an asset on the TaskScheduler. It's scheduled by the AssetManager when it's handed out,
+//	the on complete function is called on the main thread from `AssetManager::update` once the asset is loaded.
+//	The task never waits for a load that another request started, it only acquires the asset and `update` picks it up
+//	when it's ready. Workers waiting on a load could be running on the stack of that same load.
 template <typename T>
 class AssetTask : public ITaskSet {
 public:
-  typedef std::function<Shared<T>()> TaskSetFunction;
+  typedef std::function<AssetHandle<T>()> TaskSetFunction;
   typedef std::function<void(const Shared<T>&)> OnCompleteFunction;
 
   AssetTask(TaskSetFunction func) : _func(std::move(func)) {}
 
+  /// True once the asset is loaded (or failed to) and the on complete function ran.
+  bool is_ready() const { return _ready; }
+  /// Only set once the task is ready, nullptr if the asset failed to load.
   Shared<T> get_asset() { return _asset; }
 
+  /// Must be set from the main thread.
   void on_complete(OnCompleteFunction func) { _on_complete = std::move(func); }
 
-  void ExecuteRange(TaskSetPartition range_, uint32_t threadnum_) override {
-    _asset = _func();
-    _on_complete(_asset);
-  }
+  void ExecuteRange(TaskSetPartition range_, uint32_t threadnum_) override { _handle = _func(); }
 
 private:
+  AssetHandle<T> _handle = {};
   Shared<T> _asset = nullptr;
+  std::atomic<bool> _ready = false;
   TaskSetFunction _func = nullptr;
   OnCompleteFunction _on_complete = nullptr;
-  EventDispatcher* dispatcher = nullptr;
+
+  friend class AssetManager;
 };
 
+// Asset tables are safe to use from any thread. The first request for an id creates an in-flight entry and loads it
+//	on the requesting thread, requests for the same id that come in meanwhile share that load instead of starting another one.
+//	Acquiring doesn't wait for it, `get` and the get_*_asset functions do. Tasks use the *_future functions instead.
+//	Assets are refcounted per handle. Owners that live as long as their asset (meshes, sprite atlas pages) acquire a handle
+//	and release it when they're done, `get` resolves it without touching the id index. The get_*_asset functions are for
+//	holders that only keep a `Shared`, every call costs an id lookup and a reference allocation and holds one count.
+//	When the last count is released the asset goes to a free queue that's processed at frame boundaries in `update`,
+//	once the frames in flight that might still use it are done. Ids are only looked up when an asset is requested.
 class AssetManager : public ESystem {
 public:
-  void init() override {};
-  void deinit() override {};
+  /// Must match the sampled image binding count of the bindless set.
+  static constexpr uint32_t MAX_TEXTURE_SLOTS = 1024;
+
+  void init() override;
+  void deinit() override;
+  void update() override;
   void set_instance();
 
+  /// Blocks until the asset is loaded, also when another thread is loading it. Not to be called from tasks.
   static Shared<Texture> get_texture_asset(const TextureLoadInfo& info);
   static Shared<Texture> get_texture_asset(const std::string& name, const TextureLoadInfo& info);
-  static AssetTask<Texture>* get_texture_asset_future(const TextureLoadInfo& info);
+  /// The task is already scheduled. The manager drops its reference after the on complete function ran,
+  /// callers that keep polling the task have to hold on to theirs.
+  static Shared<AssetTask<Texture>> get_texture_asset_future(const TextureLoadInfo& info);
 
   static Shared<Mesh> get_mesh_asset(const std::string& path, uint32_t loadingFlags = 0);
-  static AssetTask<Mesh>* get_mesh_asset_future(const std::string& path, uint32_t loadingFlags = 0);
+  static Shared<AssetTask<Mesh>> get_mesh_asset_future(const std::string& path, uint32_t loadingFlags = 0);
 
   static Shared<AudioSource> get_audio_asset(const std::string& path);
 
+  /// Same as the get functions but they hand out a counted handle instead of a reference, it has to be given back with `release`.
+  /// They don't wait for an in-flight load of the same id.
+  /// `Shared`s resolved from it with `get` don't hold a count, they must not outlive the handle's release.
+  static AssetHandle<Texture> acquire_texture_asset(const std::string& name, const TextureLoadInfo& info);
+  static AssetHandle<Mesh> acquire_mesh_asset(const std::string& path, uint32_t loadingFlags = 0);
+  static AssetHandle<AudioSource> acquire_audio_asset(const std::string& path);
+
+  /// Blocks until the asset is loaded.
+  /// @return nullptr if the asset failed to load or was freed since the handle was handed out.
+  template <typename T>
+  static Shared<T> get(AssetHandle<T> handle);
+  template <typename T>
+  static void acquire(AssetHandle<T> handle);
+  template <typename T>
+  static void release(AssetHandle<T> handle);
+
+  /// Frees everything in the free queues right away instead of waiting for the frames in flight.
   static void free_unused_assets();
+  /// Makes the id available for a new texture, the current one is freed once its last reference is released.
+  static void free_texture_asset(const AssetID& id);
+
+  /// False if the texture's bindless slot was released or reused since it was handed out.
+  static bool is_texture_slot_alive(const SlotAllocator::Handle& handle);
+  static const SlotAllocator& get_texture_slots() { return _instance->_state.texture_slots; }
 
 private:
   static AssetManager* _instance;
 
+  template <typename T>
+  struct AssetPool {
+    struct Entry {
+      AssetID id = {};
+      std::shared_future<Shared<T>> asset = {}; // in-flight until it's ready
+      uint32_t generation = 0;
+      uint32_t ref_count = 0;
+      uint64_t release_frame = 0; // frame of the latest release that dropped `ref_count` to 0
+    };
+
+    struct PendingFree {
+      AssetHandle<T> handle;
+      uint64_t frame;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<uint32_t> free_list;
+    std::deque<PendingFree> free_queue;                    // entries whose last reference was released
+    ankerl::unordered_dense::map<AssetID, uint32_t> index; // id -> entry, only used when an asset is requested
+  };
+
   struct State {
-    std::vector<Unique<AssetTask<Mesh>>> mesh_tasks;
-    std::vector<Unique<AssetTask<Texture>>> texture_tasks;
-    std::vector<Unique<AssetTask<AudioSource>>> audio_tasks;
+    // guards everything below, it's never held while an asset is loading or destroyed
+    std::mutex mutex;
+    uint64_t frame = 0;
 
-    ankerl::unordered_dense::map<AssetID, Shared<Texture>> texture_assets;
-    ankerl::unordered_dense::map<AssetID, Shared<Mesh>> mesh_assets;
-    ankerl::unordered_dense::map<AssetID, Shared<AudioSource>> audio_assets;
+    std::vector<Shared<AssetTask<Mesh>>> mesh_tasks;
+    std::vector<Shared<AssetTask<Texture>>> texture_tasks;
+    std::vector<Shared<AssetTask<AudioSource>>> audio_tasks;
+
+    AssetPool<Texture> texture_assets;
+    AssetPool<Mesh> mesh_assets;
+    AssetPool<AudioSource> audio_assets;
+
+    SlotAllocator texture_slots = {};
   } _state;
 
+  template <typename T>
+  static AssetPool<T>& get_pool();
+  template <typename T, typename Load>
+  static AssetHandle<T> acquire_or_load(const AssetID& id, Load load);
+  /// A `Shared` that releases `handle` once its last copy is gone.
+  template <typename T>
+  static Shared<T> make_reference(AssetHandle<T> handle);
+  /// Freed assets are moved to `freed`, so they're destroyed by the caller after the lock is released.
+  template <typename T>
+  static void process_free_queue(uint64_t latency, std::vector<std::shared_future<Shared<T>>>& freed);
+  template <typename T>
+  static void complete_tasks(std::vector<Shared<AssetTask<T>>>& tasks);
+
   static Shared<Texture> load_texture_asset(const std::string& path, const TextureLoadInfo& info);
   static Shared<Mesh> load_mesh_asset(const std::string& path, uint32_t loadingFlags);
   static Shared<AudioSource> load_audio_asset(const std::string& path);
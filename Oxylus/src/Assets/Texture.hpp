@@ -6,6 +6,7 @@
 #include "Asset.hpp"
 
 #include "Core/Base.hpp"
+#include "Render/Utils/SlotAllocator.hpp"
 
 using Preset = vuk::ImageAttachment::Preset;
 
@@ -44,6 +45,9 @@ public:
 
   void set_name(std::string_view name, const std::source_location& loc = std::source_location::current());
 
+  /// Bindless slot handed out by the AssetManager. `get_id()` is the index of this slot.
+  const SlotAllocator::Handle& get_bindless_slot() const { return _bindless_slot; }
+
   explicit operator uint64_t() { return _view->id; }
 
   static uint32_t get_mip_count(vuk::Extent3D extent) {
@@ -75,7 +79,10 @@ private:
   vuk::ImageAttachment _attachment;
   vuk::Unique<vuk::Image> _image;
   vuk::Unique<vuk::ImageView> _view;
+  SlotAllocator::Handle _bindless_slot = {};
 
   static Shared<Texture> _white_texture;
+
+  friend AssetManager;
 };
 } // namespace ox
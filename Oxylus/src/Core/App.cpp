@@ -14,6 +14,7 @@
 #include "Modules/ModuleRegistry.hpp"
 
 #include "Render/Renderer.hpp"
+#include "Render/ShaderCache.hpp"
 #include "Render/Window.hpp"
 
 #include "Scripting/LuaManager.hpp"
@@ -56,6 +57,7 @@ App::App(AppSpec spec) : app_spec(std::move(spec)) {
   register_system<LuaManager>();
   register_system<ModuleRegistry>();
   register_system<RendererConfig>();
+  register_system<ShaderCache>();
   register_system<SystemManager>();
   register_system<AssetManager>();
   register_system<Physics>();
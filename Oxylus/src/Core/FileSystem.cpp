@@ -9,9 +9,15 @@
   #include <ShlObj_core.h>
   #include <comdef.h>
   #include <shellapi.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
 #endif
 
 #include <filesystem>
+#include <utility>
 
 #include "App.hpp"
 #include "Utils/Log.hpp"
@@ -165,4 +171,94 @@ bool fs::binary_to_header(std::string_view file_path, std::string_view data_name
   ss += "\n};\n";
   return write_file(file_path, ss, "// Oxylus generated header file");
 }
+
+fs::MappedFile::MappedFile(const std::string_view file_path) { open(file_path); }
+
+fs::MappedFile::~MappedFile() { close(); }
+
+fs::MappedFile::MappedFile(MappedFile&& other) noexcept
+    : _data(std::exchange(other._data, nullptr)),
+      _size(std::exchange(other._size, 0)),
+      _mapping(std::exchange(other._mapping, nullptr)) {}
+
+fs::MappedFile& fs::MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    close();
+    _data = std::exchange(other._data, nullptr);
+    _size = std::exchange(other._size, 0);
+    _mapping = std::exchange(other._mapping, nullptr);
+  }
+  return *this;
+}
+
+bool fs::MappedFile::open(const std::string_view file_path) {
+  OX_SCOPED_ZONE;
+  close();
+
+  const std::string path(file_path);
+#ifdef OX_PLATFORM_WINDOWS
+  const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER file_size = {};
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+
+  // the mapping keeps the file open
+  const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping)
+    return false;
+
+  const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!view) {
+    CloseHandle(mapping);
+    return false;
+  }
+
+  _data = (const uint8_t*)view;
+  _size = (size_t)file_size.QuadPart;
+  _mapping = mapping;
+#else
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat file_stat = {};
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+
+  // the mapping stays valid after the descriptor is closed
+  void* view = mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (view == MAP_FAILED)
+    return false;
+
+  _data = (const uint8_t*)view;
+  _size = (size_t)file_stat.st_size;
+#endif
+
+  return true;
+}
+
+void fs::MappedFile::close() {
+  if (!_data)
+    return;
+
+#ifdef OX_PLATFORM_WINDOWS
+  UnmapViewOfFile(_data);
+  CloseHandle((HANDLE)_mapping);
+#else
+  munmap((void*)_data, _size);
+#endif
+
+  _data = nullptr;
+  _size = 0;
+  _mapping = nullptr;
+}
 } // namespace ox
@@ -54,5 +54,31 @@ bool write_file(const std::string_view file_path, const T& data, const std::stri
 bool write_file_binary(std::string_view file_path, const std::vector<uint8_t>& data);
 
 bool binary_to_header(std::string_view file_path, std::string_view data_name, const std::vector<uint8_t>& data);
+
+/// @brief Read only memory mapping of a whole file, pages are loaded by the OS on first access
+class MappedFile {
+public:
+  MappedFile() = default;
+  explicit MappedFile(std::string_view file_path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  /// @return false if the file doesn't exist, is empty or couldn't be mapped
+  bool open(std::string_view file_path);
+  void close();
+
+  bool is_open() const { return _data != nullptr; }
+  const uint8_t* data() const { return _data; }
+  size_t size() const { return _size; }
+
+private:
+  const uint8_t* _data = nullptr;
+  size_t _size = 0;
+  void* _mapping = nullptr; // windows file mapping handle
+};
 }; // namespace FileSystem
 } // namespace ox
@@ -1,8 +1,12 @@
 ﻿#include "DebugRenderer.hpp"
 
+#include <atomic>
+#include <glm/gtc/packing.hpp>
 #include <vuk/vsl/Core.hpp>
 
 #include "Core/App.hpp"
+#include "Render/RendererConfig.hpp"
+#include "Render/Utils/VukCommon.hpp"
 
 #include "Utils/OxMath.hpp"
 #include "Utils/Profiler.hpp"
@@ -10,29 +14,124 @@
 namespace ox {
 DebugRenderer* DebugRenderer::instance = nullptr;
 
+namespace {
+constexpr uint32 SHAPE_CIRCLE_SEGMENTS = 32;
+
+// bumped on init so threads don't keep using lists of a released renderer
+std::atomic<uint32> instance_generation = 0;
+
+// unit shape vertices are line lists, xyz is scaled by the instance size and w by the instance length along local Y
+void append_circle(std::vector<float4>& vertices, uint32 axis_a, uint32 axis_b, float w, float arc = glm::two_pi<float>()) {
+  const uint32 segments = arc < glm::two_pi<float>() ? SHAPE_CIRCLE_SEGMENTS / 2 : SHAPE_CIRCLE_SEGMENTS;
+  const float step = arc / float(segments);
+  for (uint32 i = 0; i < segments; i++) {
+    float4 current = float4(0.0f, 0.0f, 0.0f, w);
+    current[axis_a] = glm::cos(step * float(i));
+    current[axis_b] = glm::sin(step * float(i));
+
+    float4 next = float4(0.0f, 0.0f, 0.0f, w);
+    next[axis_a] = glm::cos(step * float(i + 1));
+    next[axis_b] = glm::sin(step * float(i + 1));
+
+    vertices.emplace_back(current);
+    vertices.emplace_back(next);
+  }
+}
+
+DebugRenderer::ShapeRange append_shape(std::vector<float4>& vertices, DebugRenderer::Shape shape) {
+  const auto first_vertex = (uint32)vertices.size();
+
+  switch (shape) {
+    case DebugRenderer::Shape::Box: {
+      for (uint32 axis = 0; axis < 3; axis++) {
+        const uint32 a = (axis + 1) % 3;
+        const uint32 b = (axis + 2) % 3;
+        for (uint32 corner = 0; corner < 4; corner++) {
+          float4 start = float4(0.0f);
+          start[a] = corner & 1 ? 1.0f : -1.0f;
+          start[b] = corner & 2 ? 1.0f : -1.0f;
+          float4 end = start;
+          start[axis] = -1.0f;
+          end[axis] = 1.0f;
+          vertices.emplace_back(start);
+          vertices.emplace_back(end);
+        }
+      }
+      break;
+    }
+    case DebugRenderer::Shape::Sphere: {
+      append_circle(vertices, 0, 1, 0.0f);
+      append_circle(vertices, 1, 2, 0.0f);
+      append_circle(vertices, 0, 2, 0.0f);
+      break;
+    }
+    case DebugRenderer::Shape::Capsule: {
+      append_circle(vertices, 0, 2, 1.0f);
+      append_circle(vertices, 0, 2, -1.0f);
+      // hemispheres, the bottom one is the top one mirrored through the y axis
+      append_circle(vertices, 0, 1, 1.0f, glm::pi<float>());
+      append_circle(vertices, 2, 1, 1.0f, glm::pi<float>());
+      const auto hemisphere_end = (uint32)vertices.size();
+      for (uint32 i = first_vertex + SHAPE_CIRCLE_SEGMENTS * 4; i < hemisphere_end; i++) {
+        const float4 top = vertices[i];
+        vertices.emplace_back(top.x, -top.y, top.z, -1.0f);
+      }
+      // sides
+      static const float3 sides[4] = {{1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}};
+      for (const auto& side : sides) {
+        vertices.emplace_back(side, -1.0f);
+        vertices.emplace_back(side, 1.0f);
+      }
+      break;
+    }
+    case DebugRenderer::Shape::Arrow: {
+      vertices.emplace_back(0.0f, 0.0f, 0.0f, 0.0f);
+      vertices.emplace_back(0.0f, 0.0f, 0.0f, 1.0f);
+      static const float3 head[4] = {{0.5f, -1.0f, 0.0f}, {-0.5f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.5f}, {0.0f, -1.0f, -0.5f}};
+      for (const auto& point : head) {
+        vertices.emplace_back(0.0f, 0.0f, 0.0f, 1.0f);
+        vertices.emplace_back(point, 1.0f);
+      }
+      break;
+    }
+    case DebugRenderer::Shape::Count: break;
+  }
+
+  return {first_vertex, (uint32)vertices.size() - first_vertex};
+}
+
+template <typename T>
+uint32 append_budgeted(std::vector<T>& dst, std::vector<T>& src, uint32& budget) {
+  const auto count = (uint32)std::min<size_t>(src.size(), budget);
+  dst.insert(dst.end(), src.begin(), src.begin() + count);
+  budget -= count;
+  const auto dropped = (uint32)src.size() - count;
+  src.clear();
+  return dropped;
+}
+} // namespace
+
 void DebugRenderer::init() {
   OX_SCOPED_ZONE;
   if (instance)
     return;
 
   instance = new DebugRenderer();
+  instance_generation.fetch_add(1);
 
-  std::vector<uint32_t> indices = {};
-  indices.resize(MAX_LINE_INDICES);
-
-  for (uint32_t i = 0; i < MAX_LINE_INDICES; i++) {
-    indices[i] = i;
-  }
+  std::vector<float4> shape_vertices = {};
+  for (uint32 shape = 0; shape < (uint32)Shape::Count; shape++)
+    instance->debug_renderer_context.shape_ranges[shape] = append_shape(shape_vertices, (Shape)shape);
 
-  auto [i_buff, i_buff_fut] = create_buffer(*App::get_vkcontext().superframe_allocator,
+  auto [v_buff, v_buff_fut] = create_buffer(*App::get_vkcontext().superframe_allocator,
                                             vuk::MemoryUsage::eCPUtoGPU,
                                             vuk::DomainFlagBits::eTransferOnGraphics,
-                                            std::span(indices));
+                                            std::span(shape_vertices));
 
   auto compiler = vuk::Compiler{};
-  i_buff_fut.wait(*App::get_vkcontext().superframe_allocator, compiler);
+  v_buff_fut.wait(*App::get_vkcontext().superframe_allocator, compiler);
 
-  instance->debug_renderer_context.index_buffer = std::move(i_buff);
+  instance->debug_renderer_context.shape_vertex_buffer = std::move(v_buff);
 }
 
 void DebugRenderer::release() {
@@ -40,39 +139,85 @@ void DebugRenderer::release() {
   instance = nullptr;
 }
 
+void DebugRenderer::DebugDrawList::clear() {
+  debug_lines.clear();
+  debug_points.clear();
+  debug_triangles.clear();
+  for (auto& list : shapes)
+    list.clear();
+}
+
 void DebugRenderer::reset(bool clear_depth_tested) {
   OX_SCOPED_ZONE;
-  instance->draw_list.debug_lines.clear();
-  instance->draw_list.debug_points.clear();
+  instance->draw_list.clear();
+
+  if (clear_depth_tested)
+    instance->draw_list_depth_tested.clear();
+}
+
+void DebugRenderer::gather() {
+  OX_SCOPED_ZONE;
+  const int32 budget_cvar = RendererCVar::cvar_debug_renderer_budget.get();
+  uint32 budget = budget_cvar > 0 ? (uint32)budget_cvar : ~0u;
+
+  const auto merge = [&budget](DebugDrawList& dst, DebugDrawList& src) {
+    uint32 dropped = 0;
+    dropped += append_budgeted(dst.debug_lines, src.debug_lines, budget);
+    dropped += append_budgeted(dst.debug_points, src.debug_points, budget);
+    dropped += append_budgeted(dst.debug_triangles, src.debug_triangles, budget);
+    for (size_t shape = 0; shape < dst.shapes.size(); shape++)
+      dropped += append_budgeted(dst.shapes[shape], src.shapes[shape], budget);
+    return dropped;
+  };
+
+  std::lock_guard lock(instance->thread_lists_mutex);
+  const bool was_dropping = instance->dropped_count > 0;
+  instance->dropped_count = 0;
+  for (auto& lists : instance->thread_lists) {
+    instance->dropped_count += merge(instance->draw_list, lists->draw_list);
+    instance->dropped_count += merge(instance->draw_list_depth_tested, lists->draw_list_depth_tested);
+  }
+
+  // only warn when it starts dropping, the per frame count is reported through the renderer statistics
+  if (!was_dropping && instance->dropped_count > 0)
+    OX_LOG_WARN("DebugRenderer: dropped {} primitives over rr.debug_renderer_budget", instance->dropped_count);
+}
+
+DebugRenderer::DebugDrawList& DebugRenderer::get_thread_list(bool depth_tested) {
+  thread_local ThreadDrawLists* thread_lists = nullptr;
+  thread_local uint32 generation = 0;
 
-  if (clear_depth_tested) {
-    instance->draw_list_depth_tested.debug_lines.clear();
-    instance->draw_list_depth_tested.debug_points.clear();
+  // registered once per thread and renderer instance
+  if (generation != instance_generation.load(std::memory_order_relaxed)) {
+    std::lock_guard lock(instance->thread_lists_mutex);
+    thread_lists = instance->thread_lists.emplace_back(std::make_unique<ThreadDrawLists>()).get();
+    generation = instance_generation.load(std::memory_order_relaxed);
   }
+
+  return depth_tested ? thread_lists->draw_list_depth_tested : thread_lists->draw_list;
+}
+
+uint32 DebugRenderer::get_shape_count() const {
+  uint32 count = 0;
+  for (size_t shape = 0; shape < (size_t)Shape::Count; shape++)
+    count += (uint32)(draw_list.shapes[shape].size() + draw_list_depth_tested.shapes[shape].size());
+  return count;
+}
+
+void DebugRenderer::push_shape(Shape shape, const ShapeInstance& shape_instance, bool depth_tested) {
+  get_thread_list(depth_tested).shapes[(size_t)shape].emplace_back(shape_instance);
 }
 
 void DebugRenderer::draw_point(const float3& pos, float point_radius, const float4& color, bool depth_tested) {
-  OX_SCOPED_ZONE;
-  if (depth_tested)
-    instance->draw_list_depth_tested.debug_points.emplace_back(Point{pos, color, point_radius});
-  else
-    instance->draw_list.debug_points.emplace_back(Point{pos, color, point_radius});
+  get_thread_list(depth_tested).debug_points.emplace_back(Point{pos, color, point_radius});
 }
 
 void DebugRenderer::draw_line(const float3& start, const float3& end, float line_width, const float4& color, bool depth_tested) {
-  OX_SCOPED_ZONE;
-  if (depth_tested)
-    instance->draw_list_depth_tested.debug_lines.emplace_back(Line{start, end, color});
-  else
-    instance->draw_list.debug_lines.emplace_back(Line{start, end, color});
+  get_thread_list(depth_tested).debug_lines.emplace_back(Line{start, end, color});
 }
 
 void DebugRenderer::draw_triangle(const float3& v0, const float3& v1, const float3& v2, const float4& color, bool depth_tested) {
-  OX_SCOPED_ZONE;
-  if (depth_tested)
-    instance->draw_list_depth_tested.debug_triangles.emplace_back(Triangle{v0, v1, v2, color});
-  else
-    instance->draw_list.debug_triangles.emplace_back(Triangle{v0, v1, v2, color});
+  get_thread_list(depth_tested).debug_triangles.emplace_back(Triangle{v0, v1, v2, color});
 }
 
 void DebugRenderer::draw_circle(int num_verts,
@@ -97,34 +242,9 @@ void DebugRenderer::draw_circle(int num_verts,
 }
 
 void DebugRenderer::draw_sphere(float radius, const float3& position, const float4& color, bool depth_tested) {
-  draw_circle(20, radius, position, glm::quat(float3(0.0f, 0.0f, 0.0f)), color, depth_tested);
-  draw_circle(20, radius, position, glm::quat(float3(90.0f, 0.0f, 0.0f)), color, depth_tested);
-  draw_circle(20, radius, position, glm::quat(float3(0.0f, 90.0f, 90.0f)), color, depth_tested);
-}
-
-void draw_arc(int num_verts,
-              float radius,
-              const float3& start,
-              const float3& end,
-              const glm::quat& rotation,
-              const float4& color,
-              bool depth_tested) {
-  float step = 180.0f / num_verts;
-  glm::quat rot = glm::lookAt(rotation * start, rotation * end, float3(0.0f, 1.0f, 0.0f));
-  rot = rotation * rot;
-
-  float3 arcCentre = (start + end) * 0.5f;
-  for (int i = 0; i < num_verts; i++) {
-    float cx = glm::cos(step * i) * radius;
-    float cy = glm::sin(step * i) * radius;
-    float3 current = float3(cx, cy, 0.0f);
-
-    float nx = glm::cos(step * (i + 1)) * radius;
-    float ny = glm::sin(step * (i + 1)) * radius;
-    float3 next = float3(nx, ny, 0.0f);
-
-    DebugRenderer::draw_line(arcCentre + (rot * current), arcCentre + (rot * next), 1.0f, color, depth_tested);
-  }
+  push_shape(Shape::Sphere,
+             {.position = position, .size = float3(radius), .color = glm::packUnorm4x8(color)},
+             depth_tested);
 }
 
 void DebugRenderer::draw_capsule(const float3& position,
@@ -133,41 +253,38 @@ void DebugRenderer::draw_capsule(const float3& position,
                                  float radius,
                                  const float4& color,
                                  bool depth_tested) {
-  float3 up = (rotation * float3(0.0f, 1.0f, 0.0f));
-
-  float3 top_sphere_Centre = position + up * (height * 0.5f);
-  float3 bottom_sphere_centre = position - up * (height * 0.5f);
-
-  draw_circle(20, radius, top_sphere_Centre, rotation * glm::quat(float3(glm::radians(90.0f), 0.0f, 0.0f)), color, depth_tested);
-  draw_circle(20, radius, bottom_sphere_centre, rotation * glm::quat(float3(glm::radians(90.0f), 0.0f, 0.0f)), color, depth_tested);
-
-  // Draw 10 arcs
-  // Sides
-  float step = 360.0f / float(20);
-  for (int i = 0; i < 20; i++) {
-    float z = glm::cos(step * i) * radius;
-    float x = glm::sin(step * i) * radius;
-
-    float3 offset = rotation * float4(x, 0.0f, z, 0.0f);
-    draw_line(bottom_sphere_centre + offset, top_sphere_Centre + offset, 1.0f, color, depth_tested);
-
-    if (i < 10) {
-      float z2 = glm::cos(step * (i + 10)) * radius;
-      float x2 = glm::sin(step * (i + 10)) * radius;
-
-      float3 offset2 = rotation * float4(x2, 0.0f, z2, 0.0f);
-      // Top Hemishpere
-      draw_arc(20, radius, top_sphere_Centre + offset, top_sphere_Centre + offset2, rotation, color, depth_tested);
-      // Bottom Hemisphere
-      draw_arc(20,
-               radius,
-               bottom_sphere_centre + offset,
-               bottom_sphere_centre + offset2,
-               rotation * glm::quat(float3(glm::radians(180.0f), 0.0f, 0.0f)),
-               color,
-               depth_tested);
-    }
-  }
+  push_shape(Shape::Capsule,
+             {.rotation = float4(rotation.x, rotation.y, rotation.z, rotation.w),
+              .position = position,
+              .size = float3(radius),
+              .length = height * 0.5f,
+              .color = glm::packUnorm4x8(color)},
+             depth_tested);
+}
+
+void DebugRenderer::draw_box(const float3& position, const glm::quat& rotation, const float3& half_extents, const float4& color, bool depth_tested) {
+  push_shape(Shape::Box,
+             {.rotation = float4(rotation.x, rotation.y, rotation.z, rotation.w),
+              .position = position,
+              .size = half_extents,
+              .color = glm::packUnorm4x8(color)},
+             depth_tested);
+}
+
+void DebugRenderer::draw_arrow(const float3& start, const float3& end, float head_size, const float4& color, bool depth_tested) {
+  const float3 direction = end - start;
+  const float length = glm::length(direction);
+  if (length <= 0.0f)
+    return;
+
+  const glm::quat rotation = glm::rotation(float3(0.0f, 1.0f, 0.0f), direction / length);
+  push_shape(Shape::Arrow,
+             {.rotation = float4(rotation.x, rotation.y, rotation.z, rotation.w),
+              .position = start,
+              .size = float3(head_size),
+              .length = length,
+              .color = glm::packUnorm4x8(color)},
+             depth_tested);
 }
 
 void DebugRenderer::draw_cone(int num_circle_verts,
@@ -205,20 +322,9 @@ void DebugRenderer::draw_aabb(const AABB& aabb, const float4& color, bool corner
 
   // Draw edges
   if (!corners_only) {
-    draw_line(luu, uuu, width, color, depth_tested);
-    draw_line(lul, uul, width, color, depth_tested);
-    draw_line(llu, ulu, width, color, depth_tested);
-    draw_line(lll, ull, width, color, depth_tested);
-
-    draw_line(lul, lll, width, color, depth_tested);
-    draw_line(uul, ull, width, color, depth_tested);
-    draw_line(luu, llu, width, color, depth_tested);
-    draw_line(uuu, ulu, width, color, depth_tested);
-
-    draw_line(lll, llu, width, color, depth_tested);
-    draw_line(ull, ulu, width, color, depth_tested);
-    draw_line(lul, luu, width, color, depth_tested);
-    draw_line(uul, uuu, width, color, depth_tested);
+    push_shape(Shape::Box,
+               {.position = aabb.get_center(), .size = aabb.get_extents() * 0.5f, .color = glm::packUnorm4x8(color)},
+               depth_tested);
   } else {
     draw_line(luu, luu + (uuu - luu) * 0.25f, width, color, depth_tested);
     draw_line(luu + (uuu - luu) * 0.75f, uuu, width, color, depth_tested);
@@ -293,37 +399,31 @@ void DebugRenderer::draw_ray(const RayCast& ray, const float4& color, const floa
   draw_line(ray.get_origin(), ray.get_origin() + ray.get_direction() * distance, 1.0f, color, depth_tested);
 }
 
-std::pair<std::vector<Vertex>, uint32_t> DebugRenderer::get_vertices_from_lines(const std::vector<Line>& lines) {
-  std::vector<Vertex> vertices = {};
-  vertices.reserve(lines.size() * 2);
-  uint32_t indices = 0;
+uint32 DebugRenderer::get_vertices_from_lines(const std::vector<Line>& lines, std::vector<Vertex>& vertices) {
+  vertices.reserve(vertices.size() + lines.size() * 2);
 
   for (const auto& line : lines) {
     // store color in normals for simplicity
-    vertices.emplace_back(Vertex{.position = line.p1, .normal = glm::packSnorm2x16(math::float32x3_to_oct(line.col))});
-    vertices.emplace_back(Vertex{.position = line.p2, .normal = glm::packSnorm2x16(math::float32x3_to_oct(line.col))});
-
-    indices += 2;
+    const uint32 color = glm::packSnorm2x16(math::float32x3_to_oct(line.col));
+    vertices.emplace_back(Vertex{.position = line.p1, .normal = color});
+    vertices.emplace_back(Vertex{.position = line.p2, .normal = color});
   }
 
-  return {vertices, indices};
+  return (uint32)lines.size() * 2;
 }
 
-std::pair<std::vector<Vertex>, uint32_t> DebugRenderer::get_vertices_from_triangles(const std::vector<Triangle>& triangles) {
-  std::vector<Vertex> vertices = {};
-  vertices.reserve(triangles.size() * 3);
-  uint32_t indices = 0;
+uint32 DebugRenderer::get_vertices_from_triangles(const std::vector<Triangle>& triangles, std::vector<Vertex>& vertices) {
+  vertices.reserve(vertices.size() + triangles.size() * 3);
 
   for (const auto& tri : triangles) {
     // store color in normals for simplicity
-    vertices.emplace_back(Vertex{.position = tri.p1, .normal = glm::packSnorm2x16(math::float32x3_to_oct(tri.col))});
-    vertices.emplace_back(Vertex{.position = tri.p2, .normal = glm::packSnorm2x16(math::float32x3_to_oct(tri.col))});
-    vertices.emplace_back(Vertex{.position = tri.p3, .normal = glm::packSnorm2x16(math::float32x3_to_oct(tri.col))});
-
-    indices += 3;
+    const uint32 color = glm::packSnorm2x16(math::float32x3_to_oct(tri.col));
+    vertices.emplace_back(Vertex{.position = tri.p1, .normal = color});
+    vertices.emplace_back(Vertex{.position = tri.p2, .normal = color});
+    vertices.emplace_back(Vertex{.position = tri.p3, .normal = color});
   }
 
-  return {vertices, indices};
+  return (uint32)triangles.size() * 3;
 }
 
 // ----------------------
@@ -343,43 +443,48 @@ void PhysicsDebugRenderer::DrawTriangle(JPH::RVec3Arg inV1, JPH::RVec3Arg inV2,
                                    draw_depth_tested);
 }
 
+JPH::DebugRenderer::Batch PhysicsDebugRenderer::create_batch(std::vector<ox::Vertex>& vertices) {
+  OX_SCOPED_ZONE;
+  TriangleBatch* batch = new TriangleBatch;
+  batch->vertex_count = (uint32)vertices.size();
+
+  if (!vertices.empty()) {
+    // host visible, so the data is written right away and no transfer has to be waited on
+    auto [v_buff, v_buff_fut] = create_cpu_buffer(*App::get_vkcontext().superframe_allocator, std::span(vertices));
+    batch->vertex_buffer = std::move(v_buff);
+  }
+
+  return batch;
+}
+
 JPH::DebugRenderer::Batch PhysicsDebugRenderer::CreateTriangleBatch(const Triangle* inTriangles, int inTriangleCount) {
-  TriangleBatch* pBatch = new TriangleBatch;
-  pBatch->triangles.reserve(inTriangleCount);
+  std::vector<ox::Vertex> vertices = {};
+  vertices.reserve(inTriangleCount * 3);
 
   for (int i = 0; i < inTriangleCount; ++i) {
-    auto& t = pBatch->triangles.emplace_back();
-    t.p1 = math::from_jolt(JPH::Vec3{inTriangles[i].mV[0].mPosition});
-    t.p2 = math::from_jolt(JPH::Vec3{inTriangles[i].mV[1].mPosition});
-    t.p3 = math::from_jolt(JPH::Vec3{inTriangles[i].mV[2].mPosition});
-    t.col = math::from_jolt(inTriangles[i].mV[0].mColor.ToVec4());
+    for (const auto& v : inTriangles[i].mV) {
+      vertices.emplace_back(ox::Vertex{.position = math::from_jolt(JPH::Vec3{v.mPosition}),
+                                       .normal = glm::packUnorm4x8(math::from_jolt(v.mColor.ToVec4()))});
+    }
   }
 
-  return pBatch;
+  return create_batch(vertices);
 }
 
 JPH::DebugRenderer::Batch PhysicsDebugRenderer::CreateTriangleBatch(const Vertex* inVertices,
                                                                     int inVertexCount,
                                                                     const uint32* inIndices,
                                                                     int inIndexCount) {
-  const uint32 numTris = inIndexCount / 3;
-
-  TriangleBatch* pBatch = new TriangleBatch;
-  pBatch->triangles.reserve(numTris);
-
-  uint32 index = 0;
+  std::vector<ox::Vertex> vertices = {};
+  vertices.reserve(inIndexCount);
 
-  for (uint32 i = 0; i < numTris; ++i) {
-    auto& t = pBatch->triangles.emplace_back();
-    t.p1 = math::from_jolt(JPH::Vec3{inVertices[inIndices[index + 0]].mPosition});
-    t.p2 = math::from_jolt(JPH::Vec3{inVertices[inIndices[index + 1]].mPosition});
-    t.p3 = math::from_jolt(JPH::Vec3{inVertices[inIndices[index + 2]].mPosition});
-    t.col = math::from_jolt(inVertices[inIndices[index + 0]].mColor.ToVec4());
-
-    index += 3;
+  for (int i = 0; i < inIndexCount; ++i) {
+    const auto& v = inVertices[inIndices[i]];
+    vertices.emplace_back(ox::Vertex{.position = math::from_jolt(JPH::Vec3{v.mPosition}),
+                                     .normal = glm::packUnorm4x8(math::from_jolt(v.mColor.ToVec4()))});
   }
 
-  return pBatch;
+  return create_batch(vertices);
 }
 
 void PhysicsDebugRenderer::DrawGeometry(JPH::RMat44Arg inModelMatrix,
@@ -399,48 +504,55 @@ void PhysicsDebugRenderer::DrawGeometry(JPH::RMat44Arg inModelMatrix,
   if (geometry->mLODs.size() > 2)
     uiLod = 2;
 
-  const TriangleBatch* pBatch = static_cast<const TriangleBatch*>(geometry->mLODs[uiLod].mTriangleBatch.GetPtr());
-
-  const float4x4 trans = reinterpret_cast<const float4x4&>(inModelMatrix);
-  const float4 color = math::from_jolt(inModelColor.ToVec4());
-
-  // TODO: currently only renders into not depth tested list...
-  auto debug_renderer = ox::DebugRenderer::get_instance();
+  auto* batch = static_cast<TriangleBatch*>(geometry->mLODs[uiLod].mTriangleBatch.GetPtr());
+  if (batch->vertex_count == 0)
+    return;
 
+  DrawMode mode = Wireframe;
   if (inDrawMode == JPH::DebugRenderer::EDrawMode::Solid) {
-    if (inCullMode == JPH::DebugRenderer::ECullMode::CullBackFace || inCullMode == JPH::DebugRenderer::ECullMode::Off) {
-      for (uint32 t = 0; t < pBatch->triangles.size(); ++t) {
-        auto& tri = debug_renderer->draw_list.debug_triangles.emplace_back();
-        tri.col = pBatch->triangles[t].col * color;
-        tri.p1 = trans * float4(pBatch->triangles[t].p1, 1.f);
-        tri.p2 = trans * float4(pBatch->triangles[t].p2, 1.f);
-        tri.p3 = trans * float4(pBatch->triangles[t].p3, 1.f);
-      }
+    switch (inCullMode) {
+      case JPH::DebugRenderer::ECullMode::CullBackFace : mode = SolidCullBack; break;
+      case JPH::DebugRenderer::ECullMode::CullFrontFace: mode = SolidCullFront; break;
+      case JPH::DebugRenderer::ECullMode::Off          : mode = SolidCullOff; break;
     }
+  }
 
-    if (inCullMode == JPH::DebugRenderer::ECullMode::CullFrontFace || inCullMode == JPH::DebugRenderer::ECullMode::Off) {
-      for (uint32 t = 0; t < pBatch->triangles.size(); ++t) {
-        auto& tri = debug_renderer->draw_list.debug_triangles.emplace_back();
-        tri.col = pBatch->triangles[t].col * color;
-        tri.p1 = trans * float4(pBatch->triangles[t].p1, 1.f);
-        tri.p2 = trans * float4(pBatch->triangles[t].p3, 1.f);
-        tri.p3 = trans * float4(pBatch->triangles[t].p2, 1.f);
-      }
-    }
-  } else {
-    for (uint32 t = 0; t < pBatch->triangles.size(); ++t) {
-      const auto& tri = pBatch->triangles[t];
-      const auto col = pBatch->triangles[t].col * color;
+  // TODO: currently only renders into not depth tested list...
+  if (!batch->queued) {
+    batch->queued = true;
+    queued_batches.emplace_back(batch);
+  }
 
-      const float3 v0 = trans * float4(tri.p1, 1.0f);
-      const float3 v1 = trans * float4(tri.p2, 1.0f);
-      const float3 v2 = trans * float4(tri.p3, 1.0f);
+  batch->instances[mode].emplace_back(MeshInstance{
+    .transform = reinterpret_cast<const float4x4&>(inModelMatrix),
+    .color = glm::packUnorm4x8(math::from_jolt(inModelColor.ToVec4())),
+  });
+}
 
-      debug_renderer->draw_list.debug_lines.emplace_back(ox::DebugRenderer::Line{v0, v1, col});
-      debug_renderer->draw_list.debug_lines.emplace_back(ox::DebugRenderer::Line{v1, v2, col});
-      debug_renderer->draw_list.debug_lines.emplace_back(ox::DebugRenderer::Line{v2, v0, col});
+void PhysicsDebugRenderer::gather(std::vector<MeshInstance>& instances, std::vector<InstancedDraw>& draws) {
+  OX_SCOPED_ZONE;
+  for (auto& batch : queued_batches) {
+    for (uint32 mode = 0; mode < DrawModeCount; mode++) {
+      auto& batch_instances = batch->instances[mode];
+      if (batch_instances.empty())
+        continue;
+
+      draws.emplace_back(InstancedDraw{
+        .vertex_buffer = *batch->vertex_buffer,
+        .vertex_count = batch->vertex_count,
+        .first_instance = (uint32)instances.size(),
+        .instance_count = (uint32)batch_instances.size(),
+        .mode = (DrawMode)mode,
+      });
+      instances.insert(instances.end(), batch_instances.begin(), batch_instances.end());
+      batch_instances.clear();
     }
+
+    batch->queued = false;
   }
+
+  // releases batches Jolt has dropped in the meantime, their buffers are only freed once the frames using them are done
+  queued_batches.clear();
 }
 
 void PhysicsDebugRenderer::DrawText3D(JPH::RVec3Arg inPosition, const std::string_view& inString, JPH::ColorArg inColor, float inHeight) {}
@@ -1,5 +1,9 @@
 ﻿#pragma once
 
+#include <array>
+#include <memory>
+#include <mutex>
+
 #include "Core/Types.hpp"
 #include "Physics/RayCast.hpp"
 #include "Render/BoundingVolume.hpp"
@@ -11,11 +15,38 @@
 namespace ox {
 class PhysicsDebugRenderer;
 
+// Immediate mode debug drawing.
+//	Every thread records into its own draw lists, `gather()` merges them on the render thread once per frame.
+//	Recording threads have to be done with the frame before it is gathered.
+//	Boxes, spheres, capsules and arrows are stored as typed instances and expanded from unit line meshes by instancing.
 class DebugRenderer {
 public:
-  static constexpr uint32_t MAX_LINES = 10'000;
-  static constexpr uint32_t MAX_LINE_VERTICES = MAX_LINES * 2;
-  static constexpr uint32_t MAX_LINE_INDICES = MAX_LINES * 6;
+  enum class Shape : uint32 {
+    Box = 0,
+    Sphere,
+    Capsule,
+    Arrow,
+
+    Count
+  };
+
+  // box: size is half extents
+  // sphere: size is radius
+  // capsule: size is radius, length is half height of the cylinder along local Y
+  // arrow: size is head size, length is shaft length along local Y
+  struct ShapeInstance {
+    float4 rotation = {0, 0, 0, 1}; // quaternion xyzw
+    float3 position = {};
+    float3 size = {};
+    float length = 0;
+    uint32 color = 0; // unorm4x8
+  };
+
+  // vertices of a unit shape in the shared shape vertex buffer
+  struct ShapeRange {
+    uint32 first_vertex = 0;
+    uint32 vertex_count = 0;
+  };
 
   struct Line {
     float3 p1 = {};
@@ -42,6 +73,8 @@ public:
   static void init();
   static void release();
   static void reset(bool clear_depth_tested = true);
+  /// Merges the per thread draw lists into the frame's lists, primitives over `rr.debug_renderer_budget` are dropped.
+  static void gather();
 
   /// Draw Point (circle)
   static void draw_point(const float3& pos, float point_radius, const float4& color = float4(1.0f, 1.0f, 1.0f, 1.0f), bool depth_tested = false);
@@ -76,6 +109,12 @@ public:
                         bool corners_only = false,
                         float width = 1.0f,
                         bool depth_tested = false);
+  static void draw_box(const float3& position,
+                       const glm::quat& rotation,
+                       const float3& half_extents,
+                       const float4& color = float4(1.0f),
+                       bool depth_tested = false);
+  static void draw_arrow(const float3& start, const float3& end, float head_size, const float4& color = float4(1.0f), bool depth_tested = false);
   static void draw_frustum(const Mat4& frustum, const float4& color, float near, float far);
   static void draw_ray(const RayCast& ray, const float4& color, const float distance, const bool depth_tested = false);
 
@@ -90,10 +129,18 @@ public:
     return !depth_tested ? draw_list.debug_points : draw_list_depth_tested.debug_points;
   }
 
-  const vuk::Unique<vuk::Buffer>& get_global_index_buffer() const { return debug_renderer_context.index_buffer; }
+  const std::vector<ShapeInstance>& get_shapes(Shape shape, bool depth_tested = true) const {
+    return !depth_tested ? draw_list.shapes[(size_t)shape] : draw_list_depth_tested.shapes[(size_t)shape];
+  }
+  uint32 get_shape_count() const;
+  uint32 get_dropped_count() const { return dropped_count; }
+
+  const vuk::Unique<vuk::Buffer>& get_shape_vertex_buffer() const { return debug_renderer_context.shape_vertex_buffer; }
+  ShapeRange get_shape_range(Shape shape) const { return debug_renderer_context.shape_ranges[(size_t)shape]; }
 
-  static std::pair<std::vector<Vertex>, uint32_t> get_vertices_from_lines(const std::vector<Line>& lines);
-  static std::pair<std::vector<Vertex>, uint32_t> get_vertices_from_triangles(const std::vector<Triangle>& triangles);
+  /// Appends two vertices per line to `vertices`, returns the amount of vertices appended.
+  static uint32 get_vertices_from_lines(const std::vector<Line>& lines, std::vector<Vertex>& vertices);
+  static uint32 get_vertices_from_triangles(const std::vector<Triangle>& triangles, std::vector<Vertex>& vertices);
 
 private:
   static DebugRenderer* instance;
@@ -104,22 +151,61 @@ private:
     std::vector<Line> debug_lines = {};
     std::vector<Point> debug_points = {};
     std::vector<Triangle> debug_triangles = {};
+    std::array<std::vector<ShapeInstance>, (size_t)Shape::Count> shapes = {};
+
+    void clear();
+  };
+
+  struct ThreadDrawLists {
+    DebugDrawList draw_list;
+    DebugDrawList draw_list_depth_tested;
   };
 
   struct DebugRendererContext {
-    vuk::Unique<vuk::Buffer> index_buffer;
+    vuk::Unique<vuk::Buffer> shape_vertex_buffer;
+    std::array<ShapeRange, (size_t)Shape::Count> shape_ranges = {};
   } debug_renderer_context;
 
   DebugDrawList draw_list;
   DebugDrawList draw_list_depth_tested;
+
+  std::mutex thread_lists_mutex;
+  std::vector<std::unique_ptr<ThreadDrawLists>> thread_lists = {};
+  uint32 dropped_count = 0;
+
+  static DebugDrawList& get_thread_list(bool depth_tested);
+  static void push_shape(Shape shape, const ShapeInstance& instance, bool depth_tested);
 };
 
+// Jolt debug output.
+//	Shape geometry arrives as triangle batches which are uploaded once when Jolt creates them,
+//	DrawGeometry then only records a transform per body and every batch is drawn instanced.
 class PhysicsDebugRenderer final : public JPH::DebugRenderer {
 public:
   bool draw_depth_tested = false; // TODO: configurable via cvar
 
+  enum DrawMode : uint32 {
+    Wireframe = 0,
+    SolidCullBack,
+    SolidCullFront,
+    SolidCullOff,
+
+    DrawModeCount
+  };
+
+  struct MeshInstance {
+    float4x4 transform = {};
+    uint32 color = 0; // unorm4x8
+  };
+
   struct TriangleBatch : public JPH::RefTargetVirtual {
-    std::vector<ox::DebugRenderer::Triangle> triangles;
+    // three vertices per triangle, color is packed into the normal
+    vuk::Unique<vuk::Buffer> vertex_buffer;
+    uint32 vertex_count = 0;
+
+    // recorded this frame
+    std::array<std::vector<MeshInstance>, DrawModeCount> instances = {};
+    bool queued = false;
 
     int ref_count = 0;
 
@@ -135,6 +221,15 @@ public:
     }
   };
 
+  // instances of one batch drawn with the same mode
+  struct InstancedDraw {
+    vuk::Buffer vertex_buffer = {};
+    uint32 vertex_count = 0;
+    uint32 first_instance = 0;
+    uint32 instance_count = 0;
+    DrawMode mode = Wireframe;
+  };
+
   PhysicsDebugRenderer();
 
   virtual void DrawLine(JPH::RVec3Arg inFrom, JPH::RVec3Arg inTo, JPH::ColorArg inColor) override;
@@ -154,5 +249,13 @@ public:
                             ECastShadow inCastShadow,
                             EDrawMode inDrawMode) override;
   virtual void DrawText3D(JPH::RVec3Arg inPosition, const std::string_view& inString, JPH::ColorArg inColor, float inHeight) override;
+
+  /// Appends the instances recorded since the last call and a draw per batch and mode.
+  void gather(std::vector<MeshInstance>& instances, std::vector<InstancedDraw>& draws);
+
+private:
+  std::vector<JPH::Ref<TriangleBatch>> queued_batches = {};
+
+  static Batch create_batch(std::vector<ox::Vertex>& vertices);
 };
 } // namespace ox
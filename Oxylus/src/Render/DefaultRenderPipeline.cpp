@@ -1,6 +1,7 @@
 #include "DefaultRenderPipeline.hpp"
 
 #include <ankerl/unordered_dense.h>
+#include <bit>
 #include <cstdint>
 #include <glm/gtc/type_ptr.inl>
 #include <vuk/RenderGraph.hpp>
@@ -13,9 +14,12 @@
 #include "MeshVertex.hpp"
 #include "RendererCommon.hpp"
 #include "SceneRendererEvents.hpp"
+#include "ShaderCache.hpp"
 
+#include "Assets/AssetManager.hpp"
 #include "Core/App.hpp"
 #include "Passes/Prefilter.hpp"
+#include "Physics/Physics.hpp"
 
 #include "Scene/Scene.hpp"
 
@@ -32,6 +36,7 @@
 #include "Renderer.hpp"
 #include "Utils/VukCommon.hpp"
 
+#include "Utils/RadixSort.hpp"
 #include "Utils/RectPacker.hpp"
 #include "vuk/ImageAttachment.hpp"
 #include "vuk/Value.hpp"
@@ -61,6 +66,13 @@ void DefaultRenderPipeline::init(vuk::Allocator& allocator) {
 
   const auto task_scheduler = App::get_system<TaskScheduler>();
 
+  light_clusterer.init();
+
+  const auto retire_latency = App::get_vkcontext().num_inflight_frames;
+  visible_meshlets_buffer.init({.retire_latency = retire_latency});
+  instanced_index_buffer.init({.retire_latency = retire_latency});
+  debug_aabb_buffer.init({.retire_latency = retire_latency});
+
   this->m_quad = RendererCommon::generate_quad();
   this->m_cube = RendererCommon::generate_cube();
   task_scheduler->add_task([this] { create_static_resources(); });
@@ -89,7 +101,7 @@ void DefaultRenderPipeline::load_pipelines(vuk::Allocator& allocator) {
     binding(7, vuk::DescriptorType::eSampledImage, 8),
     binding(8, vuk::DescriptorType::eStorageImage),
     binding(9, vuk::DescriptorType::eStorageImage),
-    binding(10, vuk::DescriptorType::eSampledImage),
+    binding(10, vuk::DescriptorType::eSampledImage, AssetManager::MAX_TEXTURE_SLOTS),
     binding(11, vuk::DescriptorType::eSampler),
     binding(12, vuk::DescriptorType::eSampler),
   };
@@ -103,22 +115,28 @@ void DefaultRenderPipeline::load_pipelines(vuk::Allocator& allocator) {
 #define SHADER_FILE(path) fs::read_shader_file(path), fs::get_shader_path(path)
 
   auto* task_scheduler = App::get_system<TaskScheduler>();
+  auto* shader_cache = App::get_system<ShaderCache>();
+  shader_cache->reset_stats();
+
+  using Mode = PipelineRegistry::Mode;
+  pipeline_registry.clear();
+  pipeline_registry.init(&allocator.get_context(), task_scheduler);
 
-  task_scheduler->add_task([=]() mutable {
-    bindless_pci.add_hlsl(SHADER_FILE("FullscreenTriangle.hlsl"), SS::eVertex);
-    bindless_pci.add_hlsl(SHADER_FILE("FinalPass.hlsl"), SS::ePixel);
-    TRY(allocator.get_context().create_named_pipeline("final_pipeline", bindless_pci))
+  pipeline_registry.add("final_pipeline", Mode::FirstFrame, [=]() mutable {
+    shader_cache->add_hlsl(bindless_pci, {.path = "FullscreenTriangle.hlsl", .stage = SS::eVertex});
+    shader_cache->add_hlsl(bindless_pci, {.path = "FinalPass.hlsl", .stage = SS::ePixel});
+    return bindless_pci;
   });
 
-  task_scheduler->add_task([=]() mutable {
-    bindless_pci.add_hlsl(SHADER_FILE("DepthCopy.hlsl"), SS::eCompute);
-    TRY(allocator.get_context().create_named_pipeline("depth_copy_pipeline", bindless_pci))
+  pipeline_registry.add("depth_copy_pipeline", Mode::FirstFrame, [=]() mutable {
+    shader_cache->add_hlsl(bindless_pci, {.path = "DepthCopy.hlsl", .stage = SS::eCompute});
+    return bindless_pci;
   });
 
-  task_scheduler->add_task([=]() mutable {
-    bindless_pci.add_hlsl(SHADER_FILE("Debug/DebugAABB.hlsl"), SS::eVertex, "VSmain");
-    bindless_pci.add_hlsl(SHADER_FILE("Debug/DebugAABB.hlsl"), SS::ePixel, "PSmain");
-    TRY(allocator.get_context().create_named_pipeline("debug_aabb_pipeline", bindless_pci))
+  pipeline_registry.add("debug_aabb_pipeline", Mode::FirstFrame, [=]() mutable {
+    shader_cache->add_hlsl(bindless_pci, {.path = "Debug/DebugAABB.hlsl", .stage = SS::eVertex, .entry_point = "VSmain"});
+    shader_cache->add_hlsl(bindless_pci, {.path = "Debug/DebugAABB.hlsl", .stage = SS::ePixel, .entry_point = "PSmain"});
+    return bindless_pci;
   });
 
   // --- Culling ---
@@ -131,159 +149,169 @@ void DefaultRenderPipeline::load_pipelines(vuk::Allocator& allocator) {
   for (int i = 0; i < 2; i++)
     bindless_dslci_01.flags.emplace_back(VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT);
 
-  task_scheduler->add_task([=]() mutable {
+  pipeline_registry.add("vis_buffer_pipeline", Mode::FirstFrame, [=]() mutable {
     bindless_pci.explicit_set_layouts.emplace_back(bindless_dslci_01);
-    bindless_pci.add_hlsl(SHADER_FILE("VisBuffer.hlsl"), SS::eVertex, "VSmain");
-    bindless_pci.add_hlsl(SHADER_FILE("VisBuffer.hlsl"), SS::ePixel, "PSmain");
-    TRY(allocator.get_context().create_named_pipeline("vis_buffer_pipeline", bindless_pci))
+    shader_cache->add_hlsl(bindless_pci, {.path = "VisBuffer.hlsl", .stage = SS::eVertex, .entry_point = "VSmain"});
+    shader_cache->add_hlsl(bindless_pci, {.path = "VisBuffer.hlsl", .stage = SS::ePixel, .entry_point = "PSmain"});
+    return bindless_pci;
   });
 
-  task_scheduler->add_task([=]() mutable {
+  pipeline_registry.add("material_vis_buffer_pipeline", Mode::FirstFrame, [=]() mutable {
     bindless_pci.explicit_set_layouts.emplace_back(bindless_dslci_01);
-    bindless_pci.add_hlsl(SHADER_FILE("FullscreenTriangle.hlsl"), SS::eVertex);
-    bindless_pci.add_hlsl(SHADER_FILE("MaterialVisBuffer.hlsl"), SS::ePixel, "PSmain");
-    TRY(allocator.get_context().create_named_pipeline("material_vis_buffer_pipeline", bindless_pci))
+    shader_cache->add_hlsl(bindless_pci, {.path = "FullscreenTriangle.hlsl", .stage = SS::eVertex});
+    shader_cache->add_hlsl(bindless_pci, {.path = "MaterialVisBuffer.hlsl", .stage = SS::ePixel, .entry_point = "PSmain"});
+    return bindless_pci;
   });
 
-  task_scheduler->add_task([=]() mutable {
+  pipeline_registry.add("resolve_vis_buffer_pipeline", Mode::FirstFrame, [=]() mutable {
     bindless_pci.explicit_set_layouts.emplace_back(bindless_dslci_01);
-    bindless_pci.add_hlsl(SHADER_FILE("VisBufferResolve.hlsl"), SS::eVertex, "VSmain");
-    bindless_pci.add_hlsl(SHADER_FILE("VisBufferResolve.hlsl"), SS::ePixel, "PSmain");
-    TRY(allocator.get_context().create_named_pipeline("resolve_vis_buffer_pipeline", bindless_pci))
+    shader_cache->add_hlsl(bindless_pci, {.path = "VisBufferResolve.hlsl", .stage = SS::eVertex, .entry_point = "VSmain"});
+    shader_cache->add_hlsl(bindless_pci, {.path = "VisBufferResolve.hlsl", .stage = SS::ePixel, .entry_point = "PSmain"});
+    return bindless_pci;
   });
 
-  task_scheduler->add_task([=]() mutable {
+  pipeline_registry.add("cull_meshlets_pipeline", Mode::FirstFrame, [=]() mutable {
     bindless_pci.explicit_set_layouts.emplace_back(bindless_dslci_01);
-    bindless_pci.add_hlsl(SHADER_FILE("CullMeshlets.hlsl"), SS::eCompute);
-    TRY(allocator.get_context().create_named_pipeline("cull_meshlets_pipeline", bindless_pci))
+    shader_cache->add_hlsl(bindless_pci, {.path = "CullMeshlets.hlsl", .stage = SS::eCompute});
+    return bindless_pci;
   });
 
-  task_scheduler->add_task([=]() mutable {
+  pipeline_registry.add("cull_triangles_pipeline", Mode::FirstFrame, [=]() mutable {
     bindless_pci.explicit_set_layouts.emplace_back(bindless_dslci_01);
-    bindless_pci.add_hlsl(SHADER_FILE("CullTriangles.hlsl"), SS::eCompute);
-    TRY(allocator.get_context().create_named_pipeline("cull_triangles_pipeline", bindless_pci))
+    shader_cache->add_hlsl(bindless_pci, {.path = "CullTriangles.hlsl", .stage = SS::eCompute});
+    return bindless_pci;
   });
 
-  task_scheduler->add_task([=]() mutable {
+  pipeline_registry.add("shading_pipeline", Mode::FirstFrame, [=]() mutable {
     bindless_pci.explicit_set_layouts.emplace_back(bindless_dslci_01);
-    bindless_pci.add_hlsl(SHADER_FILE("FullscreenTriangle.hlsl"), SS::eVertex);
-    bindless_pci.add_hlsl(SHADER_FILE("ShadePBR.hlsl"), SS::ePixel, "PSmain");
-    TRY(allocator.get_context().create_named_pipeline("shading_pipeline", bindless_pci))
+    shader_cache->add_hlsl(bindless_pci, {.path = "FullscreenTriangle.hlsl", .stage = SS::eVertex});
+    shader_cache->add_hlsl(bindless_pci, {.path = "ShadePBR.hlsl", .stage = SS::ePixel, .entry_point = "PSmain"});
+    return bindless_pci;
   });
 
   // --- GTAO ---
-  task_scheduler->add_task([&allocator]() mutable {
+  const std::vector<std::pair<std::string, std::string>> gtao_defines = {
+    {"XE_GTAO_FP32_DEPTHS", ""},
+    {"XE_GTAO_USE_HALF_FLOAT_PRECISION", "0"},
+    {"XE_GTAO_USE_DEFAULT_CONSTANTS", "0"},
+  };
+
+  pipeline_registry.add("gtao_first_pipeline", Mode::Lazy, [=]() mutable {
     vuk::PipelineBaseCreateInfo pci;
-    pci.add_hlsl(SHADER_FILE("GTAO/GTAO_First.hlsl"), SS::eCompute, "CSPrefilterDepths16x16");
-    pci.define("XE_GTAO_FP32_DEPTHS", "");
-    pci.define("XE_GTAO_USE_HALF_FLOAT_PRECISION", "0");
-    pci.define("XE_GTAO_USE_DEFAULT_CONSTANTS", "0");
-    TRY(allocator.get_context().create_named_pipeline("gtao_first_pipeline", pci))
+    shader_cache->add_hlsl(pci, {.path = "GTAO/GTAO_First.hlsl", .stage = SS::eCompute, .entry_point = "CSPrefilterDepths16x16", .defines = gtao_defines});
+    return pci;
   });
 
-  task_scheduler->add_task([&allocator]() mutable {
+  pipeline_registry.add("gtao_main_pipeline", Mode::Lazy, [=]() mutable {
     vuk::PipelineBaseCreateInfo pci;
-    pci.add_hlsl(SHADER_FILE("GTAO/GTAO_Main.hlsl"), SS::eCompute, "CSGTAOHigh");
-    pci.define("XE_GTAO_FP32_DEPTHS", "");
-    pci.define("XE_GTAO_USE_HALF_FLOAT_PRECISION", "0");
-    pci.define("XE_GTAO_USE_DEFAULT_CONSTANTS", "0");
-    TRY(allocator.get_context().create_named_pipeline("gtao_main_pipeline", pci))
-  });
+    shader_cache->add_hlsl(pci, {.path = "GTAO/GTAO_Main.hlsl", .stage = SS::eCompute, .entry_point = "CSGTAOHigh", .defines = gtao_defines});
+    return pci;
+  }, {"gtao_first_pipeline"});
 
-  task_scheduler->add_task([&allocator]() mutable {
+  pipeline_registry.add("gtao_denoise_pipeline", Mode::Lazy, [=]() mutable {
     vuk::PipelineBaseCreateInfo pci;
-    pci.add_hlsl(SHADER_FILE("GTAO/GTAO_Final.hlsl"), SS::eCompute, "CSDenoisePass");
-    pci.define("XE_GTAO_FP32_DEPTHS", "");
-    pci.define("XE_GTAO_USE_HALF_FLOAT_PRECISION", "0");
-    pci.define("XE_GTAO_USE_DEFAULT_CONSTANTS", "0");
-    TRY(allocator.get_context().create_named_pipeline("gtao_denoise_pipeline", pci))
-  });
+    shader_cache->add_hlsl(pci, {.path = "GTAO/GTAO_Final.hlsl", .stage = SS::eCompute, .entry_point = "CSDenoisePass", .defines = gtao_defines});
+    return pci;
+  }, {"gtao_main_pipeline"});
 
-  task_scheduler->add_task([&allocator]() mutable {
+  pipeline_registry.add("gtao_final_pipeline", Mode::Lazy, [=]() mutable {
     vuk::PipelineBaseCreateInfo pci;
-    pci.add_hlsl(SHADER_FILE("GTAO/GTAO_Final.hlsl"), SS::eCompute, "CSDenoiseLastPass");
-    pci.define("XE_GTAO_FP32_DEPTHS", "");
-    pci.define("XE_GTAO_USE_HALF_FLOAT_PRECISION", "0");
-    pci.define("XE_GTAO_USE_DEFAULT_CONSTANTS", "0");
-    TRY(allocator.get_context().create_named_pipeline("gtao_final_pipeline", pci))
-  });
+    shader_cache->add_hlsl(pci, {.path = "GTAO/GTAO_Final.hlsl", .stage = SS::eCompute, .entry_point = "CSDenoiseLastPass", .defines = gtao_defines});
+    return pci;
+  }, {"gtao_denoise_pipeline"});
 
-  task_scheduler->add_task([&allocator]() mutable {
+  pipeline_registry.add("fxaa_pipeline", Mode::Lazy, [=]() mutable {
     vuk::PipelineBaseCreateInfo pci;
-    pci.add_hlsl(SHADER_FILE("FullscreenTriangle.hlsl"), SS::eVertex);
+    shader_cache->add_hlsl(pci, {.path = "FullscreenTriangle.hlsl", .stage = SS::eVertex});
     pci.add_glsl(SHADER_FILE("PostProcess/FXAA.frag"));
-    TRY(allocator.get_context().create_named_pipeline("fxaa_pipeline", pci))
+    return pci;
   });
 
   // --- Bloom ---
-  task_scheduler->add_task([&allocator]() mutable {
+  pipeline_registry.add("bloom_prefilter_pipeline", Mode::Deferred, [=]() mutable {
     vuk::PipelineBaseCreateInfo pci;
     pci.add_glsl(SHADER_FILE("PostProcess/BloomPrefilter.comp"));
-    TRY(allocator.get_context().create_named_pipeline("bloom_prefilter_pipeline", pci))
+    return pci;
   });
 
-  task_scheduler->add_task([&allocator]() mutable {
+  pipeline_registry.add("bloom_downsample_pipeline", Mode::Deferred, [=]() mutable {
     vuk::PipelineBaseCreateInfo pci;
     pci.add_glsl(SHADER_FILE("PostProcess/BloomDownsample.comp"));
-    TRY(allocator.get_context().create_named_pipeline("bloom_downsample_pipeline", pci))
-  });
+    return pci;
+  }, {"bloom_prefilter_pipeline"});
 
-  task_scheduler->add_task([&allocator]() mutable {
+  pipeline_registry.add("bloom_upsample_pipeline", Mode::Deferred, [=]() mutable {
     vuk::PipelineBaseCreateInfo pci;
     pci.add_glsl(SHADER_FILE("PostProcess/BloomUpsample.comp"));
-    TRY(allocator.get_context().create_named_pipeline("bloom_upsample_pipeline", pci))
+    return pci;
+  }, {"bloom_downsample_pipeline"});
+
+  pipeline_registry.add("grid_pipeline", Mode::Deferred, [=]() mutable {
+    shader_cache->add_hlsl(bindless_pci, {.path = "Debug/Grid.hlsl", .stage = SS::eVertex});
+    shader_cache->add_hlsl(bindless_pci, {.path = "Debug/Grid.hlsl", .stage = SS::ePixel, .entry_point = "PSmain"});
+    return bindless_pci;
   });
 
-  task_scheduler->add_task([=]() mutable {
-    bindless_pci.add_hlsl(SHADER_FILE("Debug/Grid.hlsl"), SS::eVertex);
-    bindless_pci.add_hlsl(SHADER_FILE("Debug/Grid.hlsl"), SS::ePixel, "PSmain");
-    TRY(allocator.get_context().create_named_pipeline("grid_pipeline", bindless_pci))
+  pipeline_registry.add("unlit_pipeline", Mode::Deferred, [=]() mutable {
+    shader_cache->add_hlsl(bindless_pci, {.path = "Debug/Unlit.hlsl", .stage = SS::eVertex, .entry_point = "VSmain"});
+    shader_cache->add_hlsl(bindless_pci, {.path = "Debug/Unlit.hlsl", .stage = SS::ePixel, .entry_point = "PSmain"});
+    return bindless_pci;
   });
 
-  task_scheduler->add_task([=]() mutable {
-    bindless_pci.add_hlsl(SHADER_FILE("Debug/Unlit.hlsl"), SS::eVertex, "VSmain");
-    bindless_pci.add_hlsl(SHADER_FILE("Debug/Unlit.hlsl"), SS::ePixel, "PSmain");
-    TRY(allocator.get_context().create_named_pipeline("unlit_pipeline", bindless_pci))
+  pipeline_registry.add("debug_shape_pipeline", Mode::Deferred, [=]() mutable {
+    shader_cache->add_hlsl(bindless_pci, {.path = "Debug/DebugShape.hlsl", .stage = SS::eVertex, .entry_point = "VSmain"});
+    shader_cache->add_hlsl(bindless_pci, {.path = "Debug/DebugShape.hlsl", .stage = SS::ePixel, .entry_point = "PSmain"});
+    return bindless_pci;
   });
 
-  // --- Atmosphere ---
-  task_scheduler->add_task([=]() mutable {
-    bindless_pci.add_hlsl(SHADER_FILE("Atmosphere/TransmittanceLUT.hlsl"), SS::eCompute);
-    TRY(allocator.get_context().create_named_pipeline("sky_transmittance_pipeline", bindless_pci))
+  pipeline_registry.add("debug_mesh_pipeline", Mode::Deferred, [=]() mutable {
+    shader_cache->add_hlsl(bindless_pci, {.path = "Debug/DebugMesh.hlsl", .stage = SS::eVertex, .entry_point = "VSmain"});
+    shader_cache->add_hlsl(bindless_pci, {.path = "Debug/DebugMesh.hlsl", .stage = SS::ePixel, .entry_point = "PSmain"});
+    return bindless_pci;
   });
 
-  task_scheduler->add_task([=]() mutable {
-    bindless_pci.add_hlsl(SHADER_FILE("Atmosphere/MultiScatterLUT.hlsl"), SS::eCompute);
-    TRY(allocator.get_context().create_named_pipeline("sky_multiscatter_pipeline", bindless_pci))
+  // --- Atmosphere ---
+  pipeline_registry.add("sky_transmittance_pipeline", Mode::FirstFrame, [=]() mutable {
+    shader_cache->add_hlsl(bindless_pci, {.path = "Atmosphere/TransmittanceLUT.hlsl", .stage = SS::eCompute});
+    return bindless_pci;
   });
 
-  task_scheduler->add_task([=]() mutable {
-    bindless_pci.add_hlsl(SHADER_FILE("FullscreenTriangle.hlsl"), SS::eVertex);
-    bindless_pci.add_hlsl(SHADER_FILE("Atmosphere/SkyView.hlsl"), SS::ePixel);
-    TRY(allocator.get_context().create_named_pipeline("sky_view_pipeline", bindless_pci))
+  pipeline_registry.add("sky_multiscatter_pipeline", Mode::FirstFrame, [=]() mutable {
+    shader_cache->add_hlsl(bindless_pci, {.path = "Atmosphere/MultiScatterLUT.hlsl", .stage = SS::eCompute});
+    return bindless_pci;
+  }, {"sky_transmittance_pipeline"});
+
+  pipeline_registry.add("sky_view_pipeline", Mode::Lazy, [=]() mutable {
+    shader_cache->add_hlsl(bindless_pci, {.path = "FullscreenTriangle.hlsl", .stage = SS::eVertex});
+    shader_cache->add_hlsl(bindless_pci, {.path = "Atmosphere/SkyView.hlsl", .stage = SS::ePixel});
+    return bindless_pci;
   });
 
-  task_scheduler->add_task([=]() mutable {
-    bindless_pci.add_hlsl(SHADER_FILE("Atmosphere/SkyViewFinal.hlsl"), SS::eVertex, "VSmain");
-    bindless_pci.add_hlsl(SHADER_FILE("Atmosphere/SkyViewFinal.hlsl"), SS::ePixel, "PSmain");
-    TRY(allocator.get_context().create_named_pipeline("sky_view_final_pipeline", bindless_pci))
+  pipeline_registry.add("sky_view_final_pipeline", Mode::FirstFrame, [=]() mutable {
+    shader_cache->add_hlsl(bindless_pci, {.path = "Atmosphere/SkyViewFinal.hlsl", .stage = SS::eVertex, .entry_point = "VSmain"});
+    shader_cache->add_hlsl(bindless_pci, {.path = "Atmosphere/SkyViewFinal.hlsl", .stage = SS::ePixel, .entry_point = "PSmain"});
+    return bindless_pci;
   });
 
-  task_scheduler->add_task([=]() mutable {
-    bindless_pci.add_hlsl(SHADER_FILE("Atmosphere/SkyEnvMap.hlsl"), SS::eVertex, "VSmain");
-    bindless_pci.add_hlsl(SHADER_FILE("Atmosphere/SkyEnvMap.hlsl"), SS::ePixel, "PSmain");
-    TRY(allocator.get_context().create_named_pipeline("sky_envmap_pipeline", bindless_pci))
+  pipeline_registry.add("sky_envmap_pipeline", Mode::FirstFrame, [=]() mutable {
+    shader_cache->add_hlsl(bindless_pci, {.path = "Atmosphere/SkyEnvMap.hlsl", .stage = SS::eVertex, .entry_point = "VSmain"});
+    shader_cache->add_hlsl(bindless_pci, {.path = "Atmosphere/SkyEnvMap.hlsl", .stage = SS::ePixel, .entry_point = "PSmain"});
+    return bindless_pci;
   });
 
-  task_scheduler->add_task([=]() mutable {
-    bindless_pci.add_hlsl(SHADER_FILE("2DForward.hlsl"), SS::eVertex, "VSmain");
-    bindless_pci.add_hlsl(SHADER_FILE("2DForward.hlsl"), SS::ePixel, "PSmain");
-    TRY(allocator.get_context().create_named_pipeline("2d_forward_pipeline", bindless_pci))
+  pipeline_registry.add("2d_forward_pipeline", Mode::FirstFrame, [=]() mutable {
+    shader_cache->add_hlsl(bindless_pci, {.path = "2DForward.hlsl", .stage = SS::eVertex, .entry_point = "VSmain"});
+    shader_cache->add_hlsl(bindless_pci, {.path = "2DForward.hlsl", .stage = SS::ePixel, .entry_point = "PSmain"});
+    return bindless_pci;
   });
 
-  task_scheduler->wait_for_all();
+  fsr.load_pipelines(pipeline_registry);
 
-  fsr.load_pipelines(allocator, bindless_pci);
+  // only block on what the first frame needs, the rest is created after it or on first use
+  pipeline_registry.compile(Mode::FirstFrame);
+  pipeline_registry.wait(Mode::FirstFrame);
+
+  shader_cache->log_stats();
 
   vuk::SamplerCreateInfo envmap_spd_sampler_ci = {};
   envmap_spd_sampler_ci.magFilter = vuk::Filter::eLinear;
@@ -382,6 +410,7 @@ void DefaultRenderPipeline::create_dir_light_cameras(const LightComponent& light
   const auto to = math::transform_normal(Vec4(0.0f, -1.0f, 0.0f, 0.0f), lightRotation);
   const auto up = math::transform_normal(Vec4(0.0f, 0.0f, 1.0f, 0.0f), lightRotation);
   auto light_view = glm::lookAt(Vec3{}, Vec3(to), Vec3(up));
+  const auto inv_light_view = glm::inverse(light_view);
 
   const auto unproj = camera.get_inverse_projection_view();
 
@@ -450,6 +479,8 @@ void DefaultRenderPipeline::create_dir_light_cameras(const LightComponent& light
 
     camera_data[cascade].projection_view = view_proj;
     camera_data[cascade].frustum = Frustum::from_matrix(view_proj);
+    // the ortho box is fit onto the sphere, so its corners reach a bit further
+    camera_data[cascade].bounds = Sphere(float3(inv_light_view * Vec4(float3(center), 1.0f)), radius * 1.41421356f);
   }
 }
 
@@ -470,23 +501,404 @@ void DefaultRenderPipeline::create_cubemap_cameras(std::vector<DefaultRenderPipe
   }
 }
 
-void DefaultRenderPipeline::update_frame_data(vuk::Allocator& allocator) {
+static_assert(RenderStatistics::MAX_LODS == Mesh::MAX_LODS);
+
+static const Mat4& get_instance_transform(const MeshComponent& mc, const int node_index) {
+  return node_index == 0 ? mc.transform : mc.child_transforms[node_index - 1];
+}
+
+void DefaultRenderPipeline::SceneFlattened::update(const std::vector<MeshComponent>& mc_list,
+                                                   const std::vector<SpriteComponent>& sp_list,
+                                                   const Frustum* frustum,
+                                                   OcclusionCuller* occlusion_culler,
+                                                   const MeshletHierarchy::LodView* lod_view) {
+  OX_SCOPED_ZONE;
+
+  culling_stats = {};
+  lod_stats = {};
+
+  if (mc_list.empty()) {
+    meshlet_instances.emplace_back();
+    meshlets.emplace_back();
+    indices.emplace_back();
+    vertices.emplace_back();
+    quantized_vertices.emplace_back();
+    vertex_quantizations.emplace_back();
+    primitives.emplace_back();
+    transforms.emplace_back();
+    materials.emplace_back(create_shared<PBRMaterial>());
+
+    return;
+  }
+
+  if (frustum) {
+    cull_instances(mc_list, *frustum);
+    if (occlusion_culler)
+      cull_occluded_instances(mc_list, *occlusion_culler);
+  }
+
+  for (uint32 instance_index = 0; auto& mc : mc_list) {
+    for (int node_index = 0; auto& node : mc.mesh_base->nodes) {
+      if (!node.meshlet_indices.empty()) {
+        const bool visible = !frustum || instance_visibility[instance_index] != 0;
+        if (visible) {
+          const auto instance_id = (uint32)transforms.size();
+          const auto first_meshlet_instance = (uint32)meshlet_instances.size();
+          const auto& transform = transforms.emplace_back(get_instance_transform(mc, node_index));
+          const auto& meshlet_lods = mc.mesh_base->_meshlet_lods;
+          if (lod_view && !node.lod_levels.empty()) {
+            // whole levels are taken or skipped, only the ones crossing the cut test each cluster
+            const float scale = MeshletHierarchy::get_max_scale(transform);
+            for (const auto& level : node.lod_levels) {
+              const auto cut = MeshletHierarchy::get_level_cut(level, transform, scale, *lod_view);
+              for (uint32 i = level.first; cut != MeshletHierarchy::LevelCut::None && i < level.first + level.count; i++) {
+                const auto& [meshletIndex, _, materialId] = node.get_cut_meshlet(i);
+                if (cut == MeshletHierarchy::LevelCut::All || MeshletHierarchy::is_in_cut(meshlet_lods[meshletIndex], transform, scale, *lod_view))
+                  meshlet_instances.emplace_back(meshletIndex, instance_id, materialId);
+              }
+            }
+            culling_stats.lod_meshlets_selected += (uint32)meshlet_instances.size() - first_meshlet_instance;
+          } else {
+            const auto lod_meshlets = node.get_lod_meshlets(mc.lod_index);
+            for (auto& [meshletIndex, _, materialId] : lod_meshlets) {
+              // meshlet.instance_id = uint32(instance_id);
+              meshlet_instances.emplace_back(meshletIndex, instance_id, materialId);
+            }
+            culling_stats.lod_meshlets_selected += (uint32)lod_meshlets.size();
+          }
+
+          const auto lod = std::min(mc.lod_index, Mesh::MAX_LODS - 1);
+          lod_stats.instances[lod] += 1;
+          for (uint32 i = first_meshlet_instance; i < (uint32)meshlet_instances.size(); i++)
+            lod_stats.triangles[lod] += mc.mesh_base->_meshlets[meshlet_instances[i].meshletId].primitive_count;
+          culling_stats.lod_meshlets_full_detail += (uint32)node.meshlet_indices.size();
+          culling_stats.instances_accepted += 1;
+        }
+        instance_index++;
+        node_index++;
+      }
+    }
+
+    meshlets.insert(std::end(meshlets), std::begin(mc.mesh_base->_meshlets), std::end(mc.mesh_base->_meshlets));
+    indices.insert(std::end(indices), std::begin(mc.mesh_base->_indices), std::end(mc.mesh_base->_indices));
+    vertices.insert(std::end(vertices), std::begin(mc.mesh_base->_vertices), std::end(mc.mesh_base->_vertices));
+    quantized_vertices.insert(std::end(quantized_vertices), std::begin(mc.mesh_base->_quantized_vertices), std::end(mc.mesh_base->_quantized_vertices));
+    vertex_quantizations.insert(std::end(vertex_quantizations),
+                                std::begin(mc.mesh_base->_vertex_quantizations),
+                                std::end(mc.mesh_base->_vertex_quantizations));
+    primitives.insert(std::end(primitives), std::begin(mc.mesh_base->_primitives), std::end(mc.mesh_base->_primitives));
+    materials.insert(std::end(materials), std::begin(mc.materials), std::end(mc.materials));
+  }
+
+  if (!frustum)
+    culling_stats.instances_tested = culling_stats.instances_accepted;
+
+  // both vertex layouts are always bound, a scene that only uses one still needs valid buffers for the other
+  if (vertices.empty())
+    vertices.emplace_back();
+  if (quantized_vertices.empty()) {
+    quantized_vertices.emplace_back();
+    vertex_quantizations.emplace_back();
+  }
+
+  // everything got culled, keep a degenerate instance around so the buffers and dispatches stay valid
+  if (meshlet_instances.empty()) {
+    meshlet_instances.emplace_back();
+    transforms.emplace_back(Mat4(0.0f));
+  }
+}
+
+void DefaultRenderPipeline::SceneFlattened::cull_instances(const std::vector<MeshComponent>& mc_list, const Frustum& frustum) {
+  OX_SCOPED_ZONE;
+
+  instance_bounds.clear();
+  mesh_visibility.clear();
+  mesh_first_instance.clear();
+
+  culler.set_frustum(frustum);
+  culler.clear();
+
+  // whole meshes are classified first, only the instances of meshes that straddle the frustum are tested one by one
+  for (auto& mc : mc_list) {
+    const auto first_instance = (uint32)instance_bounds.size();
+    mesh_first_instance.emplace_back(first_instance);
+
+    AABB mesh_bounds(float3(std::numeric_limits<float>::max()), float3(std::numeric_limits<float>::lowest()));
+    for (int node_index = 0; auto& node : mc.mesh_base->nodes) {
+      if (!node.meshlet_indices.empty()) {
+        const auto& bounds = instance_bounds.emplace_back(node.aabb.get_transformed(get_instance_transform(mc, node_index)));
+        mesh_bounds.merge(bounds);
+        node_index++;
+      }
+    }
+
+    const auto intersection = first_instance == (uint32)instance_bounds.size() ? Outside : culler.classify(mesh_bounds);
+    mesh_visibility.emplace_back((uint8)intersection);
+    if (intersection == Intersects) {
+      for (uint32 i = first_instance; i < (uint32)instance_bounds.size(); i++)
+        culler.add(instance_bounds[i]);
+    }
+  }
+  mesh_first_instance.emplace_back((uint32)instance_bounds.size());
+
+  culler.cull();
+
+  instance_visibility.resize(instance_bounds.size());
+  for (uint32 culler_index = 0, mesh_index = 0; mesh_index < (uint32)mc_list.size(); mesh_index++) {
+    const auto intersection = (Intersection)mesh_visibility[mesh_index];
+    for (uint32 i = mesh_first_instance[mesh_index]; i < mesh_first_instance[mesh_index + 1]; i++) {
+      if (intersection == Intersects)
+        instance_visibility[i] = culler.is_visible(culler_index++);
+      else
+        instance_visibility[i] = intersection == Inside;
+    }
+  }
+
+  culling_stats.instances_tested = (uint32)instance_bounds.size();
+}
+
+void DefaultRenderPipeline::SceneFlattened::cull_occluded_instances(const std::vector<MeshComponent>& mc_list,
+                                                                    OcclusionCuller& occlusion_culler) {
+  OX_SCOPED_ZONE;
+  const Timer timer = {};
+
+  const auto instance_count = (uint32)instance_bounds.size();
+  instance_is_occluder.assign(instance_count, 0);
+  if (instance_count == 0)
+    return;
+
+  // pick the flagged meshes and the instances covering most of the screen as occluders
+  struct OccluderCandidate {
+    uint32 instance_index;
+    uint32 mesh_index;
+    int node_index;
+    const Mesh::Node* node;
+    float coverage;
+  };
+  std::vector<OccluderCandidate> candidates = {};
+
+  // masked and blended surfaces have holes, rasterizing them as solid would hide what's visible through them
+  const auto is_opaque = [](const MeshComponent& mc, const Mesh::Node& node) {
+    return std::ranges::all_of(node.meshlet_indices, [&mc](const Mesh::MeshletInstance& instance) {
+      return instance.materialId < mc.materials.size() && mc.materials[instance.materialId]->is_opaque();
+    });
+  };
+
+  const float min_coverage = RendererCVar::cvar_occluder_min_coverage.get();
+  for (uint32 mesh_index = 0; mesh_index < (uint32)mc_list.size(); mesh_index++) {
+    const auto& mc = mc_list[mesh_index];
+    // node_index counts only the nodes that have meshlets, same as the instance order
+    for (int node_index = 0; const auto& node : mc.mesh_base->nodes) {
+      if (node.meshlet_indices.empty())
+        continue;
+
+      const uint32 i = mesh_first_instance[mesh_index] + node_index++;
+      if (!instance_visibility[i] || !is_opaque(mc, node))
+        continue;
+
+      const float coverage = mc.occluder ? std::numeric_limits<float>::max() : occlusion_culler.get_screen_coverage(instance_bounds[i]);
+      if (coverage >= min_coverage)
+        candidates.emplace_back(OccluderCandidate{i, mesh_index, node_index - 1, &node, coverage});
+    }
+  }
+
+  const auto occluder_count = std::min((uint32)candidates.size(), (uint32)std::max(RendererCVar::cvar_max_occluders.get(), 0));
+  std::partial_sort(candidates.begin(), candidates.begin() + occluder_count, candidates.end(), [](const auto& a, const auto& b) {
+    return a.coverage > b.coverage;
+  });
+
+  for (uint32 c = 0; c < occluder_count; c++) {
+    const auto& candidate = candidates[c];
+    const auto& mc = mc_list[candidate.mesh_index];
+    occlusion_culler.add_occluder(*mc.mesh_base, *candidate.node, get_instance_transform(mc, candidate.node_index));
+    instance_is_occluder[candidate.instance_index] = 1;
+  }
+
+  auto* task_scheduler = App::get_system<TaskScheduler>();
+  occlusion_culler.rasterize(task_scheduler);
+
+  uint32 frustum_visible_count = 0;
+  for (const auto visible : instance_visibility)
+    frustum_visible_count += visible;
+
+  TaskSet test_task(instance_count, [this, &occlusion_culler](const TaskSetPartition range, uint32_t) {
+    for (uint32 i = range.start; i < range.end; i++) {
+      if (instance_visibility[i] && !instance_is_occluder[i] && !occlusion_culler.is_visible(instance_bounds[i]))
+        instance_visibility[i] = 0;
+    }
+  });
+  task_scheduler->schedule_task(&test_task);
+  task_scheduler->wait_task(&test_task);
+
+  uint32 visible_count = 0;
+  for (const auto visible : instance_visibility)
+    visible_count += visible;
+
+  culling_stats.occluders = occluder_count;
+  culling_stats.occluder_triangles = occlusion_culler.get_triangle_count();
+  culling_stats.instances_occluded = frustum_visible_count - visible_count;
+  culling_stats.occlusion_ms = timer.get_elapsed_ms();
+}
+
+void DefaultRenderPipeline::RenderQueue2D::sort() {
+  OX_SCOPED_ZONE;
+  const Timer timer = {};
+
+  RadixSort::sort(sort_keys, sort_indices, keys_scratch, indices_scratch);
+
+  sprite_data_scratch.resize(sprite_data.size());
+  for (uint32 i = 0; i < (uint32)sort_indices.size(); i++)
+    sprite_data_scratch[i] = sprite_data[sort_indices[i]];
+  std::swap(sprite_data, sprite_data_scratch);
+
+  sort_ms = timer.get_elapsed_ms();
+}
+
+void DefaultRenderPipeline::RenderQueue2D::update() {
+  OX_SCOPED_ZONE;
+
+  for (uint32 i = 0; i < (uint32)sort_keys.size(); i++) {
+    const auto pipeline_index = (uint32)(sort_keys[i] >> 48u) & 0xFF;
+    const auto pipeline_name = vuk::Name(PIPELINES[pipeline_index]);
+    if (batches.empty() || batches.back().pipeline_name != pipeline_name)
+      batches.emplace_back(DrawBatch2D{.pipeline_name = pipeline_name, .offset = i, .count = 0});
+
+    batches.back().count += 1;
+  }
+}
+
+void DefaultRenderPipeline::begin_frame() {
+  if (!current_camera) {
+    OX_LOG_ERROR("No camera is set for rendering!");
+    // set a temporary one
+    if (!default_camera)
+      default_camera = create_shared<Camera>();
+    current_camera = default_camera.get();
+  }
+
+  Vec3 sun_direction = {0, 1, 0};
+  Vec3 sun_color = {};
+
+  if (dir_light_data) {
+    sun_direction = dir_light_data->direction;
+    sun_color = dir_light_data->color * dir_light_data->intensity;
+  }
+
+  scene_data.sun_direction = sun_direction;
+  scene_data.sun_color = Vec4(sun_color, 1.0f);
+}
+
+static MeshletHierarchy::LodView get_camera_lod_view(const Camera& camera, const float error_threshold) {
+  const auto viewport_height = (float)std::max(Renderer::get_viewport_height(), 1u);
+  return {
+    .camera_position = camera.get_position(),
+    .projection_scale = std::abs(camera.get_projection_matrix()[1][1]) * viewport_height * 0.5f,
+    .error_threshold = std::max(error_threshold, 0.0f),
+  };
+}
+
+DefaultRenderPipeline::PassConfig DefaultRenderPipeline::get_pass_config() {
+  const auto require = [this](const std::initializer_list<const char*> names) { return !gpu_resources || pipeline_registry.require(names); };
+
+  return {
+    .sky_envmap = dir_light_data != nullptr,
+    .bloom = RendererCVar::cvar_bloom_enable.get() && require({"bloom_upsample_pipeline"}),
+    .debug_renderer = DebugRenderer::get_instance() && require({"unlit_pipeline", "debug_shape_pipeline", "debug_mesh_pipeline"}),
+  };
+}
+
+void DefaultRenderPipeline::prepare_frame_data() {
   OX_SCOPED_ZONE;
-  auto& ctx = allocator.get_context();
 
   scene_flattened.init();
-  scene_flattened.update(mesh_component_list, sprite_component_list);
+  {
+    auto* culling_camera = (bool)RendererCVar::cvar_freeze_culling_frustum.get() ? &frozen_camera : current_camera;
+    const auto culling_frustum = culling_camera->get_frustum();
+    const bool cpu_culling = (bool)RendererCVar::cvar_cpu_frustum_culling.get();
+    const bool occlusion_culling = cpu_culling && (bool)RendererCVar::cvar_occlusion_culling.get();
+    if (occlusion_culling)
+      occlusion_culler.begin(culling_camera->get_projection_matrix() * culling_camera->get_view_matrix());
+
+    // the cut is picked for the rendering camera, a frozen culling camera shouldn't change the detail
+    const auto lod_view = get_camera_lod_view(*current_camera, RendererCVar::cvar_meshlet_lod_error.get());
+
+    scene_flattened.update(mesh_component_list,
+                           sprite_component_list,
+                           cpu_culling ? &culling_frustum : nullptr,
+                           occlusion_culling ? &occlusion_culler : nullptr,
+                           (bool)RendererCVar::cvar_meshlet_lod.get() ? &lod_view : nullptr);
+
+    statistics.culling = scene_flattened.culling_stats;
+    statistics.lods = scene_flattened.lod_stats;
+
+    if (occlusion_culling && (bool)RendererCVar::cvar_occlusion_dump_depth.get()) {
+      constexpr auto dump_path = "occlusion_depth.pgm";
+      if (occlusion_culler.dump_depth(dump_path))
+        OX_LOG_INFO("Dumped occlusion depth buffer to {}", dump_path);
+      RendererCVar::cvar_occlusion_dump_depth.toggle();
+    }
+  }
 
   render_queue_2d.init();
-  render_queue_2d.update();
   render_queue_2d.sort();
+  render_queue_2d.update();
+
+  statistics.sprites.sprite_count = (uint32)render_queue_2d.sprite_data.size();
+  statistics.sprites.batch_count = (uint32)render_queue_2d.batches.size();
+  statistics.sprites.sort_ms = render_queue_2d.sort_ms;
+  statistics.sprites.atlas_pages = sprite_atlas.get_page_count();
+  statistics.sprites.atlas_textures = sprite_atlas.get_texture_count();
+
+  const auto pipeline_stats = pipeline_registry.get_stats();
+  statistics.pipelines.pipeline_count = pipeline_stats.pipeline_count;
+  statistics.pipelines.ready = pipeline_stats.ready;
+  statistics.pipelines.pending = pipeline_stats.pending + pipeline_stats.compiling;
+  statistics.pipelines.failed = pipeline_stats.failed;
+  statistics.pipelines.created_lazily = pipeline_stats.created_lazily;
+  statistics.pipelines.startup_ms = pipeline_stats.startup_ms;
+  statistics.pipelines.compile_ms = pipeline_stats.compile_ms;
 
   scene_data.num_lights = (uint32)scene_lights.size();
+
+  {
+    OX_SCOPED_ZONE_N("Light clustering");
+    const bool use_clusters = (bool)RendererCVar::cvar_light_clustering.get();
+    scene_data.light_clusters.enabled = use_clusters;
+    if (use_clusters) {
+      cluster_lights.clear();
+      for (const auto& lc : scene_lights)
+        cluster_lights.emplace_back(LightClusterer::Light{lc.position, lc.type == LightComponent::Directional ? 0.0f : lc.range});
+
+      const LightClusterer::View view = {
+        .view = current_camera->get_view_matrix(),
+        .projection = current_camera->get_projection_matrix(),
+        .near_clip = current_camera->get_near(),
+        .far_clip = current_camera->get_far(),
+      };
+      light_clusterer.build(view, cluster_lights, App::get_system<TaskScheduler>());
+
+      scene_data.light_clusters.grid_size = light_clusterer.get_grid_size();
+      scene_data.light_clusters.depth_scale = light_clusterer.get_depth_scale();
+      scene_data.light_clusters.depth_bias = light_clusterer.get_depth_bias();
+
+      const auto& cluster_stats = light_clusterer.get_stats();
+      statistics.lights.visible_lights = cluster_stats.visible_lights;
+      statistics.lights.non_empty_clusters = cluster_stats.non_empty_clusters;
+      statistics.lights.cluster_count = cluster_stats.cluster_count;
+      statistics.lights.max_lights_per_cluster = cluster_stats.max_lights_per_cluster;
+      statistics.lights.average_lights_per_cluster = cluster_stats.average_lights_per_cluster;
+      statistics.lights.clustering_ms = cluster_stats.build_ms;
+    } else {
+      statistics.lights = {};
+    }
+    statistics.lights.light_count = (uint32)scene_lights.size();
+  }
   scene_data.grid_max_distance = RendererCVar::cvar_draw_grid_distance.get();
   scene_data.screen_size = IVec2(Renderer::get_viewport_width(), Renderer::get_viewport_height());
   scene_data.screen_size_rcp = {1.0f / (float)std::max(1u, scene_data.screen_size.x), 1.0f / (float)std::max(1u, scene_data.screen_size.y)};
   scene_data.meshlet_count = scene_flattened.get_meshlet_instances_count();
   scene_data.draw_meshlet_aabbs = RendererCVar::cvar_draw_meshlet_aabbs.get();
+  scene_data.cull_meshlet_cones = RendererCVar::cvar_cull_meshlet_cones.get();
 
   scene_data.indices.albedo_image_index = ALBEDO_IMAGE_INDEX;
   scene_data.indices.normal_image_index = NORMAL_IMAGE_INDEX;
@@ -509,6 +921,8 @@ void DefaultRenderPipeline::update_frame_data(vuk::Allocator& allocator) {
   scene_data.indices.entites_buffer_index = ENTITIES_BUFFER_INDEX;
   scene_data.indices.transforms_buffer_index = TRANSFORMS_BUFFER_INDEX;
   scene_data.indices.sprite_materials_buffer_index = SPRITE_MATERIALS_BUFFER_INDEX;
+  scene_data.indices.light_clusters_buffer_index = LIGHT_CLUSTERS_BUFFER_INDEX;
+  scene_data.indices.cluster_lights_buffer_index = CLUSTER_LIGHTS_BUFFER_INDEX;
 
   scene_data.post_processing_data.tonemapper = RendererCVar::cvar_tonemapper.get();
   scene_data.post_processing_data.exposure = RendererCVar::cvar_exposure.get();
@@ -518,18 +932,11 @@ void DefaultRenderPipeline::update_frame_data(vuk::Allocator& allocator) {
   scene_data.post_processing_data.enable_gtao = RendererCVar::cvar_gtao_enable.get();
 
   {
-    OX_SCOPED_ZONE_N("Update 2d vertex data");
-    vertex_buffer_2d = *vuk::allocate_cpu_buffer(allocator, sizeof(SpriteGPUData) * 3000);
-    std::memcpy(vertex_buffer_2d.mapped_ptr, render_queue_2d.sprite_data.data(), sizeof(SpriteGPUData) * render_queue_2d.sprite_data.size());
-  }
-
-  {
-    OX_SCOPED_ZONE_N("Update 1st set data");
+    OX_SCOPED_ZONE_N("Prepare 1st set data");
 
-    auto [scene_buff, scene_buff_fut] = create_cpu_buffer(allocator, std::span(&scene_data, 1));
-    const auto& scene_buffer = *scene_buff;
+    bindless_textures.clear();
 
-    std::vector<PBRMaterial::Parameters> material_parameters = {};
+    material_parameters.clear();
     material_parameters.reserve(scene_flattened.get_material_count());
     for (auto& mat : scene_flattened.materials) {
       mat->set_id((uint32)material_parameters.size());
@@ -541,15 +948,15 @@ void DefaultRenderPipeline::update_frame_data(vuk::Allocator& allocator) {
       const auto& emissive = mat->get_emissive_texture();
 
       if (albedo && albedo->is_valid_id())
-        descriptor_set_00->update_sampled_image(10, albedo->get_id(), *albedo->get_view(), vuk::ImageLayout::eReadOnlyOptimalKHR);
+        bindless_textures.emplace_back(albedo.get());
       if (normal && normal->is_valid_id())
-        descriptor_set_00->update_sampled_image(10, normal->get_id(), *normal->get_view(), vuk::ImageLayout::eReadOnlyOptimalKHR);
+        bindless_textures.emplace_back(normal.get());
       if (physical && physical->is_valid_id())
-        descriptor_set_00->update_sampled_image(10, physical->get_id(), *physical->get_view(), vuk::ImageLayout::eReadOnlyOptimalKHR);
+        bindless_textures.emplace_back(physical.get());
       if (ao && ao->is_valid_id())
-        descriptor_set_00->update_sampled_image(10, ao->get_id(), *ao->get_view(), vuk::ImageLayout::eReadOnlyOptimalKHR);
+        bindless_textures.emplace_back(ao.get());
       if (emissive && emissive->is_valid_id())
-        descriptor_set_00->update_sampled_image(10, emissive->get_id(), *emissive->get_view(), vuk::ImageLayout::eReadOnlyOptimalKHR);
+        bindless_textures.emplace_back(emissive.get());
 
       material_parameters.emplace_back(mat->parameters);
     }
@@ -557,20 +964,37 @@ void DefaultRenderPipeline::update_frame_data(vuk::Allocator& allocator) {
     if (material_parameters.empty())
       material_parameters.emplace_back();
 
-    auto [matBuff, matBufferFut] = create_cpu_buffer(allocator, std::span(material_parameters));
-    auto& mat_buffer = *matBuff;
+    const bool use_sprite_atlas = gpu_resources && (bool)RendererCVar::cvar_sprite_atlas.get();
+    if (use_sprite_atlas) {
+      sprite_atlas.update();
+      for (uint32 page = 0; page < sprite_atlas.get_page_count(); page++) {
+        const auto& atlas_texture = sprite_atlas.get_page_texture(page);
+        if (atlas_texture && atlas_texture->is_valid_id())
+          bindless_textures.emplace_back(atlas_texture.get());
+      }
+    }
 
-    std::vector<SpriteMaterial::Parameters> sprite_material_parameters = {};
+    sprite_material_parameters.clear();
     sprite_material_parameters.reserve(render_queue_2d.materials.size());
     for (uint32 index = 0; auto& mat : render_queue_2d.materials) {
       const auto& albedo = mat->get_albedo_texture();
 
-      if (albedo && albedo->is_valid_id())
-        descriptor_set_00->update_sampled_image(10, albedo->get_id(), *albedo->get_view(), vuk::ImageLayout::eReadOnlyOptimalKHR);
-
       SpriteMaterial::Parameters par = mat->parameters;
       par.uv_offset = sprite_component_list[index].current_uv_offset.value_or(mat->parameters.uv_offset);
 
+      // remap into the atlas page, sprites sampling outside of their texture (e.g. repeating tilemaps) keep the original texture
+      const auto* region = use_sprite_atlas && albedo ? sprite_atlas.get_region(*albedo) : nullptr;
+      const bool in_texture_bounds = glm::all(glm::greaterThanEqual(par.uv_offset, float2(0.0f))) &&
+                                     glm::all(glm::lessThanEqual(par.uv_offset + par.uv_size, float2(1.0f)));
+      if (region && in_texture_bounds) {
+        const auto& atlas_texture = sprite_atlas.get_page_texture(region->page);
+        par.albedo_map_id = atlas_texture->get_id();
+        par.uv_size *= region->uv_scale;
+        par.uv_offset = par.uv_offset * region->uv_scale + region->uv_offset;
+      } else if (albedo && albedo->is_valid_id()) {
+        bindless_textures.emplace_back(albedo.get());
+      }
+
       sprite_material_parameters.emplace_back(par);
 
       index += 1;
@@ -579,12 +1003,11 @@ void DefaultRenderPipeline::update_frame_data(vuk::Allocator& allocator) {
     if (sprite_material_parameters.empty())
       sprite_material_parameters.emplace_back();
 
-    auto [sprite_mat_buff, sprite_mat_buff_fut] = create_cpu_buffer(allocator, std::span(sprite_material_parameters));
-    auto& sprite_mat_buffer = *sprite_mat_buff;
-
     light_datas.reserve(scene_lights.size());
 
-    const Vec2 atlas_dim_rcp = Vec2(1.0f / float(shadow_map_atlas.get_extent().width), 1.0f / float(shadow_map_atlas.get_extent().height));
+    // shadow_map_atlas is resized to this as soon as a tile is packed, lights without a tile don't read it
+    const float atlas_size = (float)shadow_atlas.get_config().atlas_size;
+    const Vec2 atlas_dim_rcp = Vec2(1.0f / atlas_size, 1.0f / atlas_size);
 
     for (auto& lc : scene_lights) {
       auto& light = light_datas.emplace_back();
@@ -638,13 +1061,16 @@ void DefaultRenderPipeline::update_frame_data(vuk::Allocator& allocator) {
       }
     }
 
-    std::vector<ShaderEntity> shader_entities = {};
+    shader_entities.clear();
+
+    if constexpr (SHADOW_PASS_ENABLED)
+      begin_shadow_caster_culling();
 
     for (uint32_t light_index = 0; light_index < light_datas.size(); ++light_index) {
       auto& light = light_datas[light_index];
       const auto& lc = scene_lights[light_index];
 
-      if (lc.cast_shadows) {
+      if (lc.cast_shadows && lc.shadow_rect.w > 0) {
         switch (lc.type) {
           case LightComponent::Directional: {
             auto cascade_count = (uint32)lc.cascade_distances.size();
@@ -655,9 +1081,21 @@ void DefaultRenderPipeline::update_frame_data(vuk::Allocator& allocator) {
             for (uint32 cascade = 0; cascade < cascade_count; ++cascade) {
               shader_entities.emplace_back(sh_cameras[cascade].projection_view);
             }
+
+            // casters up to this far toward the light can still throw a shadow into a cascade
+            const float extrusion = std::min(1500.0f, current_camera->get_far());
+            if constexpr (SHADOW_PASS_ENABLED)
+              cull_shadow_casters(light_index, sh_cameras, -lc.direction * extrusion);
             break;
           }
           case LightComponent::Point: {
+            auto sh_cameras = std::vector<CameraSH>(6);
+            create_cubemap_cameras(sh_cameras, lc.position, std::max(1.0f, lc.range), 0.1f); // reversed z
+            for (auto& camera : sh_cameras)
+              camera.bounds = Sphere(lc.position, lc.range);
+
+            if constexpr (SHADOW_PASS_ENABLED)
+              cull_shadow_casters(light_index, sh_cameras, {});
             break;
           }
           case LightComponent::Spot:
@@ -675,14 +1113,41 @@ void DefaultRenderPipeline::update_frame_data(vuk::Allocator& allocator) {
     if (shader_entities.empty())
       shader_entities.emplace_back();
 
-    auto [seBuff, seFut] = create_cpu_buffer(allocator, std::span(shader_entities));
-    const auto& shader_entities_buffer = *seBuff;
-
     if (light_datas.empty())
       light_datas.emplace_back();
+  }
+}
+
+void DefaultRenderPipeline::upload_frame_data(vuk::Allocator& allocator) {
+  OX_SCOPED_ZONE;
+  auto& ctx = allocator.get_context();
+
+  // persistent buffers outlive the frame allocator
+  auto& vk_context = App::get_vkcontext();
+  auto& superframe_allocator = *vk_context.superframe_allocator;
+
+  const uint64 upload_ring_size = (uint64)std::max(RendererCVar::cvar_upload_ring_size.get(), 1) * 1024 * 1024;
+  if (upload_ring.get_capacity() != upload_ring_size)
+    upload_ring.init(superframe_allocator, upload_ring_size, vk_context.num_inflight_frames);
+  upload_ring.begin_frame(vk_context.num_frames);
+
+  {
+    OX_SCOPED_ZONE_N("Update 2d vertex data");
+    vertex_buffer_2d = upload_ring.upload(allocator, std::span(render_queue_2d.sprite_data));
+  }
+
+  {
+    OX_SCOPED_ZONE_N("Update 1st set data");
+
+    const auto scene_buffer = upload_ring.upload(allocator, std::span(&scene_data, 1));
+    const auto mat_buffer = upload_ring.upload(allocator, std::span(material_parameters));
+    const auto sprite_mat_buffer = upload_ring.upload(allocator, std::span(sprite_material_parameters));
+    const auto shader_entities_buffer = upload_ring.upload(allocator, std::span(shader_entities));
 
-    auto [lights_buff, lights_buff_fut] = create_cpu_buffer(allocator, std::span(light_datas));
-    const auto& lights_buffer = *lights_buff;
+    for (const auto* texture : bindless_textures)
+      descriptor_set_00->update_sampled_image(10, texture->get_id(), *texture->get_view(), vuk::ImageLayout::eReadOnlyOptimalKHR);
+
+    const auto lights_buffer = upload_ring.upload(allocator, std::span(light_datas));
 
     descriptor_set_00->update_storage_buffer(0, 0, scene_buffer);
     descriptor_set_00->update_storage_buffer(1, LIGHTS_BUFFER_INDEX, lights_buffer);
@@ -690,14 +1155,22 @@ void DefaultRenderPipeline::update_frame_data(vuk::Allocator& allocator) {
     descriptor_set_00->update_storage_buffer(1, ENTITIES_BUFFER_INDEX, shader_entities_buffer);
     descriptor_set_00->update_storage_buffer(1, SPRITE_MATERIALS_BUFFER_INDEX, sprite_mat_buffer);
 
-    auto [transBuff, transfBuffFut] = create_cpu_buffer(allocator, std::span(scene_flattened.transforms));
-    transforms_buffer = *transBuff;
+    if (scene_data.light_clusters.enabled) {
+      static constexpr uint32 empty_indices[1] = {};
+      const auto& light_indices = light_clusterer.get_light_indices();
+      const auto indices_span = light_indices.empty() ? std::span<const uint32>(empty_indices) : std::span<const uint32>(light_indices);
+
+      const auto clusters_buffer = upload_ring.upload(allocator, std::span(light_clusterer.get_clusters()));
+      const auto cluster_lights_buffer = upload_ring.upload(allocator, indices_span);
+      descriptor_set_00->update_storage_buffer(1, LIGHT_CLUSTERS_BUFFER_INDEX, clusters_buffer);
+      descriptor_set_00->update_storage_buffer(1, CLUSTER_LIGHTS_BUFFER_INDEX, cluster_lights_buffer);
+    }
+
+    transforms_buffer = upload_ring.upload(allocator, std::span(scene_flattened.transforms));
     descriptor_set_00->update_storage_buffer(1, TRANSFORMS_BUFFER_INDEX, transforms_buffer);
 
-    debug_aabb_buffer = *vuk::allocate_cpu_buffer(allocator, sizeof(vuk::DrawIndirectCommand) + sizeof(DebugAabb) * MAX_AABB_COUNT);
-    uint32 vert_count = 14;
-    std::memcpy(debug_aabb_buffer.mapped_ptr, &vert_count, sizeof(uint32));
-    descriptor_set_00->update_storage_buffer(2, DEBUG_AABB_INDEX, debug_aabb_buffer);
+    debug_aabb_buffer.ensure(superframe_allocator, get_debug_aabb_buffer_size(), vk_context.num_frames);
+    descriptor_set_00->update_storage_buffer(2, DEBUG_AABB_INDEX, debug_aabb_buffer.get_buffer());
 
     // scene textures
     descriptor_set_00->update_sampled_image(3, ALBEDO_IMAGE_INDEX, *albedo_texture.get_view(), vuk::ImageLayout::eReadOnlyOptimalKHR);
@@ -741,6 +1214,8 @@ void DefaultRenderPipeline::update_frame_data(vuk::Allocator& allocator) {
     constexpr auto VERTEX_BUFFER_INDEX = 2;
     constexpr auto PRIMITIVES_BUFFER_INDEX = 3;
     constexpr auto MESHLET_INSTANCE_BUFFERS_INDEX = 5;
+    constexpr auto QUANTIZED_VERTEX_BUFFER_INDEX = 6;
+    constexpr auto VERTEX_QUANTIZATION_BUFFER_INDEX = 7;
 
     constexpr auto VISIBLE_MESHLETS_BUFFER_INDEX = 0;
     constexpr auto CULL_TRIANGLES_DISPATCH_PARAMS_BUFFERS_INDEX = 1;
@@ -750,16 +1225,16 @@ void DefaultRenderPipeline::update_frame_data(vuk::Allocator& allocator) {
     constexpr auto READ_ONLY = 0;
     constexpr auto READ_WRITE = 1;
 
-    auto [meshletBuff, meshletBuffFut] = create_cpu_buffer(allocator, std::span(scene_flattened.meshlets));
-    const auto& meshlet_data_buffer = *meshletBuff;
+    const auto meshlet_data_buffer = upload_ring.upload(allocator, std::span(scene_flattened.meshlets));
     descriptor_set_02->update_storage_buffer(READ_ONLY, MESHLET_DATA_BUFFERS_INDEX, meshlet_data_buffer);
 
-    auto [meshlet_instances_buff, meshlet_instances_buff_fut] = create_cpu_buffer(allocator, std::span(scene_flattened.meshlet_instances));
-    const auto& meshlet_instances_buffer = *meshlet_instances_buff;
+    const auto meshlet_instances_buffer = upload_ring.upload(allocator, std::span(scene_flattened.meshlet_instances));
     descriptor_set_02->update_storage_buffer(READ_ONLY, MESHLET_INSTANCE_BUFFERS_INDEX, meshlet_instances_buffer);
 
-    visible_meshlets_buffer = *allocate_gpu_buffer(allocator, scene_flattened.get_meshlet_instances_count() * sizeof(uint32_t));
-    descriptor_set_02->update_storage_buffer(READ_WRITE, VISIBLE_MESHLETS_BUFFER_INDEX, visible_meshlets_buffer);
+    const uint64 meshlet_instance_count = std::max(scene_flattened.get_meshlet_instances_count(), 1u);
+
+    visible_meshlets_buffer.ensure(superframe_allocator, meshlet_instance_count * sizeof(uint32), vk_context.num_frames);
+    descriptor_set_02->update_storage_buffer(READ_WRITE, VISIBLE_MESHLETS_BUFFER_INDEX, visible_meshlets_buffer.get_buffer());
 
     struct DispatchParams {
       uint32 groupCountX;
@@ -768,8 +1243,7 @@ void DefaultRenderPipeline::update_frame_data(vuk::Allocator& allocator) {
     };
 
     DispatchParams params{0, 1, 1};
-    auto [dispatchBuff, dispatchBuffFut] = create_cpu_buffer(allocator, std::span(&params, 1));
-    cull_triangles_dispatch_params_buffer = *dispatchBuff;
+    cull_triangles_dispatch_params_buffer = upload_ring.upload(allocator, std::span(&params, 1));
     descriptor_set_02->update_storage_buffer(READ_WRITE, CULL_TRIANGLES_DISPATCH_PARAMS_BUFFERS_INDEX, cull_triangles_dispatch_params_buffer);
 
     constexpr auto draw_command = vuk::DrawIndexedIndirectCommand{
@@ -780,29 +1254,97 @@ void DefaultRenderPipeline::update_frame_data(vuk::Allocator& allocator) {
       .firstInstance = 0,
     };
 
-    auto [indirectBuff, indirectBuffFut] = create_cpu_buffer(allocator, std::span(&draw_command, 1));
-    indirect_commands_buffer = *indirectBuff;
+    indirect_commands_buffer = upload_ring.upload(allocator, std::span(&draw_command, 1));
     descriptor_set_02->update_storage_buffer(READ_WRITE, INDIRECT_COMMAND_BUFFER_INDEX, indirect_commands_buffer);
 
-    auto [indicesBuff, indicesBuffFut] = create_cpu_buffer(allocator, std::span(scene_flattened.indices)); // static
-    index_buffer = *indicesBuff;
-    descriptor_set_02->update_storage_buffer(READ_ONLY, INDEX_BUFFER_INDEX, *indicesBuff);
+    index_buffer = upload_ring.upload(allocator, std::span(scene_flattened.indices)); // static
+    descriptor_set_02->update_storage_buffer(READ_ONLY, INDEX_BUFFER_INDEX, index_buffer);
 
-    auto [vertBuff, vertBuffFut] = create_cpu_buffer(allocator, std::span(scene_flattened.vertices)); // static
-    vertex_buffer = *vertBuff;
+    vertex_buffer = upload_ring.upload(allocator, std::span(scene_flattened.vertices)); // static
     descriptor_set_02->update_storage_buffer(READ_ONLY, VERTEX_BUFFER_INDEX, vertex_buffer);
 
-    auto [primsBuff, primsBuffFut] = create_cpu_buffer(allocator, std::span(scene_flattened.primitives)); // static
-    primitives_buffer = *primsBuff;
+    quantized_vertex_buffer = upload_ring.upload(allocator, std::span(scene_flattened.quantized_vertices)); // static
+    descriptor_set_02->update_storage_buffer(READ_ONLY, QUANTIZED_VERTEX_BUFFER_INDEX, quantized_vertex_buffer);
+
+    vertex_quantization_buffer = upload_ring.upload(allocator, std::span(scene_flattened.vertex_quantizations)); // static
+    descriptor_set_02->update_storage_buffer(READ_ONLY, VERTEX_QUANTIZATION_BUFFER_INDEX, vertex_quantization_buffer);
+
+    primitives_buffer = upload_ring.upload(allocator, std::span(scene_flattened.primitives)); // static
     descriptor_set_02->update_storage_buffer(READ_ONLY, PRIMITIVES_BUFFER_INDEX, primitives_buffer);
 
     constexpr auto max_meshlet_primitives = 64;
-    instanced_index_buffer = *allocate_gpu_buffer(allocator,
-                                                  scene_flattened.get_meshlet_instances_count() * max_meshlet_primitives * 3 * sizeof(uint32));
-    descriptor_set_02->update_storage_buffer(READ_WRITE, INSTANCED_INDEX_BUFFER_INDEX, instanced_index_buffer);
+    instanced_index_buffer.ensure(superframe_allocator, meshlet_instance_count * max_meshlet_primitives * 3 * sizeof(uint32), vk_context.num_frames);
+    descriptor_set_02->update_storage_buffer(READ_WRITE, INSTANCED_INDEX_BUFFER_INDEX, instanced_index_buffer.get_buffer());
 
     descriptor_set_02->commit(ctx);
   }
+
+  if (auto* debug_renderer = DebugRenderer::get_instance()) {
+    OX_SCOPED_ZONE_N("Update debug renderer data");
+    gather_debug_draws(*debug_renderer);
+
+    if (debug_vertices.empty())
+      debug_vertices.emplace_back(Vertex{});
+    debug_vertex_buffer = upload_ring.upload(allocator, std::span(debug_vertices));
+
+    for (uint32 list = 0; list < (uint32)debug_draw_ranges.size(); list++) {
+      auto& range = debug_draw_ranges[list];
+      for (size_t shape = 0; shape < range.shape_buffers.size(); shape++) {
+        const auto& instances = debug_renderer->get_shapes((DebugRenderer::Shape)shape, list == DEBUG_DEPTH_TESTED);
+        if (!instances.empty())
+          range.shape_buffers[shape] = upload_ring.upload(allocator, std::span(instances));
+      }
+    }
+
+    // physics shapes are drawn from their cached geometry, only the transforms are uploaded
+    if (!debug_mesh_instances.empty())
+      debug_mesh_instance_buffer = upload_ring.upload(allocator, std::span(debug_mesh_instances));
+
+    statistics.debug.lines = (debug_draw_ranges[DEBUG_ON_TOP].line_vertex_count + debug_draw_ranges[DEBUG_DEPTH_TESTED].line_vertex_count) / 2;
+    statistics.debug.mesh_instances = (uint32)debug_mesh_instances.size();
+    statistics.debug.mesh_draws = (uint32)debug_mesh_draws.size();
+    statistics.debug.triangles = (uint32)(debug_renderer->get_triangles(false).size() + debug_renderer->get_triangles(true).size());
+    statistics.debug.shapes = debug_renderer->get_shape_count();
+    statistics.debug.dropped = debug_renderer->get_dropped_count();
+
+    // everything was copied into the upload ring
+    DebugRenderer::reset();
+  }
+
+  upload_ring.end_frame();
+
+  const auto& ring_stats = upload_ring.get_stats();
+  statistics.uploads.capacity = ring_stats.capacity;
+  statistics.uploads.used = ring_stats.used;
+  statistics.uploads.peak_used = ring_stats.peak_used;
+  statistics.uploads.frame_bytes = ring_stats.frame_bytes;
+  statistics.uploads.frame_allocations = ring_stats.frame_allocations;
+  statistics.uploads.fallbacks = ring_stats.frame_failed;
+  statistics.uploads.fallback_bytes = ring_stats.frame_failed_bytes;
+  statistics.uploads.wraps = ring_stats.wraps;
+
+  const auto to_buffer_stats = [](const GrowableBuffer& buffer) {
+    const auto& stats = buffer.get_stats();
+    return RenderStatistics::Buffer{
+      .capacity = stats.capacity,
+      .used = stats.used,
+      .high_water = stats.high_water,
+      .grows = stats.grows,
+      .shrinks = stats.shrinks,
+    };
+  };
+  statistics.buffers.visible_meshlets = to_buffer_stats(visible_meshlets_buffer);
+  statistics.buffers.instanced_indices = to_buffer_stats(instanced_index_buffer);
+  statistics.buffers.debug_aabbs = to_buffer_stats(debug_aabb_buffer);
+  statistics.buffers.allocated_bytes = visible_meshlets_buffer.get_stats().allocated_bytes +
+                                       instanced_index_buffer.get_stats().allocated_bytes + debug_aabb_buffer.get_stats().allocated_bytes;
+}
+
+uint64 DefaultRenderPipeline::get_debug_aabb_buffer_size() const {
+  // cull_meshlets pushes at most one aabb per visible meshlet and nothing at all when they aren't drawn
+  const uint64 aabb_count = scene_data.draw_meshlet_aabbs ? std::clamp<uint64>(scene_flattened.get_meshlet_instances_count(), 1, MAX_AABB_COUNT)
+                                                          : 1;
+  return sizeof(vuk::DrawIndirectCommand) + sizeof(DebugAabb) * aabb_count;
 }
 
 void DefaultRenderPipeline::create_static_resources() {
@@ -854,104 +1396,207 @@ void DefaultRenderPipeline::create_dynamic_textures(const vuk::Extent3D& ext) {
     resized = true;
   }
 
-  // Shadow atlas packing:
-  {
-    OX_SCOPED_ZONE_N("Shadow atlas packing");
-    thread_local RectPacker::State packer;
-    float iterative_scaling = 1;
-
-    while (iterative_scaling > 0.03f) {
-      packer.clear();
-      for (uint32_t lightIndex = 0; lightIndex < scene_lights.size(); lightIndex++) {
-        LightComponent& light = scene_lights[lightIndex];
-        light.shadow_rect = {};
-        if (!light.cast_shadows)
-          continue;
+  allocate_shadow_tiles();
 
-        const float dist = distance(current_camera->get_position(), light.position);
-        const float range = light.range;
-        const float amount = std::min(1.0f, range / std::max(0.001f, dist)) * iterative_scaling;
-
-        constexpr int max_shadow_resolution_2D = 1024;
-        constexpr int max_shadow_resolution_cube = 256;
-
-        RectPacker::Rect rect = {};
-        rect.id = int(lightIndex);
-        switch (light.type) {
-          case LightComponent::Directional:
-            if (light.shadow_map_res > 0) {
-              rect.w = light.shadow_map_res * int(light.cascade_distances.size());
-              rect.h = light.shadow_map_res;
-            } else {
-              rect.w = int(max_shadow_resolution_2D * iterative_scaling) * int(light.cascade_distances.size());
-              rect.h = int(max_shadow_resolution_2D * iterative_scaling);
-            }
-            break;
-          case LightComponent::Spot:
-            if (light.shadow_map_res > 0) {
-              rect.w = int(light.shadow_map_res);
-              rect.h = int(light.shadow_map_res);
-            } else {
-              rect.w = int(max_shadow_resolution_2D * amount);
-              rect.h = int(max_shadow_resolution_2D * amount);
-            }
-            break;
-          case LightComponent::Point:
-            if (light.shadow_map_res > 0) {
-              rect.w = int(light.shadow_map_res) * 6;
-              rect.h = int(light.shadow_map_res);
-            } else {
-              rect.w = int(max_shadow_resolution_cube * amount) * 6;
-              rect.h = int(max_shadow_resolution_cube * amount);
-            }
-            break;
-        }
-        if (rect.w > 8 && rect.h > 8) {
-          packer.add_rect(rect);
-        }
+  // the atlas stays a 1x1 placeholder until a light actually needs it
+  const int atlas_size = shadow_atlas.get_config().atlas_size;
+  if (shadow_atlas.get_stats().tiles > 0 && (int)shadow_map_atlas.get_extent().width != atlas_size) {
+    auto ia = shadow_map_atlas.as_attachment();
+    ia.extent = vuk::Extent3D{(uint32)atlas_size, (uint32)atlas_size, 1};
+    shadow_map_atlas.create_texture(ia);
+    shadow_map_atlas_transparent.create_texture(ia);
+
+    scene_data.shadow_atlas_res = UVec2(shadow_map_atlas.get_extent().width, shadow_map_atlas.get_extent().height);
+    shadow_atlas.invalidate();
+  }
+}
+
+void DefaultRenderPipeline::allocate_shadow_tiles() {
+  OX_SCOPED_ZONE;
+  const int atlas_size = std::max(RendererCVar::cvar_shadow_atlas_size.get(), 256);
+  if (shadow_atlas.get_config().atlas_size != atlas_size)
+    shadow_atlas.init({.atlas_size = atlas_size});
+
+  const bool use_cache = (bool)RendererCVar::cvar_shadow_cache.get();
+  const uint64 static_casters_hash = get_static_casters_hash();
+
+  shadow_requests.clear();
+  shadow_light_indices.clear();
+  for (uint32_t light_index = 0; light_index < scene_lights.size(); light_index++) {
+    LightComponent& light = scene_lights[light_index];
+    light.shadow_rect = {};
+    light.shadow_cached = false;
+    if (!light.cast_shadows)
+      continue;
+
+    const float dist = distance(current_camera->get_position(), light.position);
+
+    ShadowAtlas::Request request = {};
+    request.key = light.id;
+    request.fixed_resolution = light.shadow_map_res;
+    switch (light.type) {
+      case LightComponent::Directional:
+        request.slice_count = (uint32)light.cascade_distances.size();
+        request.screen_coverage = 1.0f;
+        break;
+      case LightComponent::Spot : request.screen_coverage = std::min(1.0f, light.range / std::max(0.001f, dist)); break;
+      case LightComponent::Point:
+        request.slice_count = 6;
+        // cube faces are smaller than 2D maps
+        request.screen_coverage = std::min(1.0f, light.range / std::max(0.001f, dist)) * 0.25f;
+        break;
+    }
+
+    // cascades follow the camera and are reused one by one after caster culling instead
+    request.content_hash = hash_combine(get_light_hash(light), static_casters_hash);
+    request.casters_static = use_cache && (light.type == LightComponent::Directional || !has_moving_shadow_casters(light));
+
+    shadow_requests.emplace_back(request);
+    shadow_light_indices.emplace_back(light_index);
+  }
+
+  shadow_atlas.update(shadow_requests);
+
+  const auto& tiles = shadow_atlas.get_tiles();
+  for (uint32 i = 0; i < tiles.size(); i++) {
+    if (!tiles[i].is_valid())
+      continue;
+    auto& light = scene_lights[shadow_light_indices[i]];
+    light.shadow_rect.x = tiles[i].x;
+    light.shadow_rect.y = tiles[i].y;
+    light.shadow_rect.w = tiles[i].resolution;
+    light.shadow_rect.h = tiles[i].resolution;
+    light.shadow_rect.was_packed = 1;
+    light.shadow_cached = !tiles[i].needs_render;
+  }
+
+  const auto& atlas_stats = shadow_atlas.get_stats();
+  statistics.shadows.tiles = atlas_stats.tiles;
+  statistics.shadows.tiles_rendered = atlas_stats.tiles_rendered;
+  statistics.shadows.tiles_cached = atlas_stats.tiles_cached;
+  statistics.shadows.tiles_dropped = atlas_stats.tiles_dropped;
+  statistics.shadows.evictions = atlas_stats.evictions;
+  statistics.shadows.repacks = atlas_stats.repacks;
+  statistics.shadows.atlas_usage = atlas_stats.used_area;
+}
+
+uint64 DefaultRenderPipeline::hash_combine(const uint64 seed, const uint64 value) {
+  return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+uint64 DefaultRenderPipeline::get_light_hash(const LightComponent& light) {
+  using ankerl::unordered_dense::detail::wyhash::hash;
+
+  uint64 result = hash(&light.type, sizeof(light.type));
+  result = hash_combine(result, hash(&light.position, sizeof(light.position)));
+  result = hash_combine(result, hash(&light.direction, sizeof(light.direction)));
+  result = hash_combine(result, hash(&light.range, sizeof(light.range)));
+  result = hash_combine(result, hash(&light.outer_cone_angle, sizeof(light.outer_cone_angle)));
+  result = hash_combine(result, hash(light.cascade_distances.data(), light.cascade_distances.size() * sizeof(float)));
+
+  return result;
+}
+
+void DefaultRenderPipeline::begin_shadow_caster_culling() {
+  OX_SCOPED_ZONE;
+
+  shadow_caster_culler.end_frame();
+  shadow_caster_sets.clear();
+  statistics.shadows.caster_culling_ms = 0.0f;
+  statistics.shadows.views_rendered = 0;
+  statistics.shadows.views_reused = 0;
+  statistics.shadows.cascade_casters = {};
+
+  shadow_caster_bounds.clear();
+  for (const auto& mc : mesh_component_list) {
+    if (!mc.cast_shadows)
+      continue;
+
+    for (int node_index = 0; auto& node : mc.mesh_base->nodes) {
+      if (!node.meshlet_indices.empty()) {
+        shadow_caster_bounds.emplace_back(node.aabb.get_transformed(get_instance_transform(mc, node_index)));
+        node_index++;
       }
-      if (!packer.rects.empty()) {
-        if (packer.pack(8192)) {
-          for (const auto& rect : packer.rects) {
-            if (rect.id == -1) {
-              continue;
-            }
-            const uint32_t light_index = uint32_t(rect.id);
-            LightComponent& light = scene_lights[light_index];
-            if (rect.was_packed) {
-              light.shadow_rect = rect;
-
-              // Remove slice multipliers from rect:
-              switch (light.type) {
-                case LightComponent::Directional: light.shadow_rect.w /= int(light.cascade_distances.size()); break;
-                case LightComponent::Point      : light.shadow_rect.w /= 6; break;
-                case LightComponent::Spot       : break;
-              }
-            } else {
-              light.direction = {};
-            }
-          }
+    }
+  }
 
-          if ((int)shadow_map_atlas.get_extent().width < packer.width || (int)shadow_map_atlas.get_extent().height < packer.height) {
-            const auto shadow_size = vuk::Extent3D{(uint32_t)packer.width, (uint32_t)packer.height, 1};
+  shadow_caster_culler.set_casters(shadow_caster_bounds);
+}
 
-            auto ia = shadow_map_atlas.as_attachment();
-            ia.extent = shadow_size;
-            shadow_map_atlas.create_texture(ia);
-            shadow_map_atlas_transparent.create_texture(ia);
+void DefaultRenderPipeline::cull_shadow_casters(const uint32 light_index, const std::vector<CameraSH>& cameras, const float3& extrusion) {
+  OX_SCOPED_ZONE;
 
-            scene_data.shadow_atlas_res = UVec2(shadow_map_atlas.get_extent().width, shadow_map_atlas.get_extent().height);
-          }
+  const Timer timer = {};
+  const auto& lc = scene_lights[light_index];
 
-          break;
-        }
+  std::vector<ShadowCasterCuller::View> views(std::min((uint32)cameras.size(), ShadowCasterCuller::MAX_VIEWS));
+  for (uint32 i = 0; i < views.size(); i++) {
+    views[i].view_projection = cameras[i].projection_view;
+    views[i].bounds = cameras[i].bounds;
+    views[i].extrusion = extrusion;
+  }
+
+  shadow_caster_culler.cull(lc.id, views, App::get_system<TaskScheduler>());
+
+  // a view is only rendered again if its tile lost its contents or its matrix or casters changed
+  uint32 render_mask = 0;
+  const auto& results = shadow_caster_culler.get_view_results();
+  for (uint32 view = 0; view < results.size(); view++) {
+    if (!lc.shadow_cached || results[view].changed)
+      render_mask |= 1u << view;
+
+    if (lc.type == LightComponent::Directional && view < statistics.shadows.cascade_casters.size())
+      statistics.shadows.cascade_casters[view] = results[view].caster_count;
+  }
+
+  // every view of the light is reused from the atlas, nothing to draw
+  if (render_mask != 0) {
+    shadow_caster_sets.emplace_back(ShadowCasterSet{
+      .light_index = light_index,
+      .render_mask = render_mask,
+      .view_masks = shadow_caster_culler.get_view_masks(),
+    });
+  }
+
+  const auto rendered = (uint32)std::popcount(render_mask);
+  statistics.shadows.views_rendered += rendered;
+  statistics.shadows.views_reused += (uint32)results.size() - rendered;
+  statistics.shadows.caster_culling_ms += timer.get_elapsed_ms();
+}
+
+uint64 DefaultRenderPipeline::get_static_casters_hash() const {
+  using ankerl::unordered_dense::detail::wyhash::hash;
+
+  // moving a stationary mesh (e.g. in the editor) or adding/removing one invalidates every cached shadow
+  uint64 result = 0;
+  for (const auto& mc : mesh_component_list) {
+    if (!mc.cast_shadows || !mc.stationary)
+      continue;
+    result = hash_combine(result, hash(&mc.transform, sizeof(mc.transform)));
+    result = hash_combine(result, hash(mc.mesh_id));
+  }
+
+  return result;
+}
 
-        iterative_scaling *= 0.5f;
-      } else {
-        iterative_scaling = 0.0; // PE: fix - endless loop if some lights do not have shadows.
+bool DefaultRenderPipeline::has_moving_shadow_casters(const LightComponent& light) const {
+  const Sphere light_bounds(light.position, light.range);
+  for (const auto& mc : mesh_component_list) {
+    if (!mc.cast_shadows || mc.stationary)
+      continue;
+    if (light.type == LightComponent::Directional)
+      return true;
+
+    for (int node_index = 0; auto& node : mc.mesh_base->nodes) {
+      if (!node.meshlet_indices.empty()) {
+        if (light_bounds.intersects(node.aabb.get_transformed(get_instance_transform(mc, node_index))))
+          return true;
+        node_index++;
       }
     }
   }
+
+  return false;
 }
 
 void DefaultRenderPipeline::create_descriptor_sets(vuk::Allocator& allocator) {
@@ -1008,6 +1653,9 @@ void DefaultRenderPipeline::submit_sprite(const SpriteComponent& sprite) {
   OX_SCOPED_ZONE;
   sprite_component_list.emplace_back(sprite);
 
+  if ((bool)RendererCVar::cvar_sprite_atlas.get())
+    sprite_atlas.add(sprite.material->get_albedo_texture());
+
   const auto distance = glm::distance(float3(0.f, 0.f, current_camera->get_position().z), float3(0.f, 0.f, sprite.get_position().z));
   render_queue_2d.add(sprite, distance);
 }
@@ -1028,6 +1676,8 @@ void DefaultRenderPipeline::submit_camera(Camera* camera) {
   }
 
   current_camera = camera;
+  if (current_camera)
+    mesh_lod_view = get_camera_lod_view(*current_camera, RendererCVar::cvar_mesh_lod_error.get());
 }
 
 void DefaultRenderPipeline::shutdown() {}
@@ -1036,32 +1686,17 @@ vuk::Value<vuk::ImageAttachment> DefaultRenderPipeline::on_render(vuk::Allocator
                                                                   vuk::Value<vuk::ImageAttachment> target,
                                                                   vuk::Extent3D ext) {
   OX_SCOPED_ZONE;
-  if (!current_camera) {
-    OX_LOG_ERROR("No camera is set for rendering!");
-    // set a temporary one
-    if (!default_camera)
-      default_camera = create_shared<Camera>();
-    current_camera = default_camera.get();
-  }
+  begin_frame();
 
   auto& vk_context = App::get_vkcontext();
 
-  Vec3 sun_direction = {0, 1, 0};
-  Vec3 sun_color = {};
-
-  if (dir_light_data) {
-    sun_direction = dir_light_data->direction;
-    sun_color = dir_light_data->color * dir_light_data->intensity;
-  }
-
-  scene_data.sun_direction = sun_direction;
-  scene_data.sun_color = Vec4(sun_color, 1.0f);
-
   create_dynamic_textures(ext);
 
   std::swap(depth_texture, depth_texture_prev);
 
-  update_frame_data(frame_allocator);
+  prepare_frame_data();
+  upload_frame_data(frame_allocator);
+  const auto passes = get_pass_config();
 
   auto hiz_image = vuk::make_pass("transition", [](vuk::CommandBuffer&, VUK_IA(vuk::eComputeRW) output) {
     return output;
@@ -1073,11 +1708,17 @@ vuk::Value<vuk::ImageAttachment> DefaultRenderPipeline::on_render(vuk::Allocator
     resized = false;
   }
 
-  auto vis_meshlets_buf = vuk::declare_buf("visible_meshlets_buffer", visible_meshlets_buffer);
+  // persistent buffers, the previous frame last used them in these passes: cull_triangles, main_vis_buffer_pass and debug_pass
+  auto vis_meshlets_buf = visible_meshlets_buffer.acquire("visible_meshlets_buffer", vuk::eComputeRead);
   auto cull_triangles_buf = vuk::declare_buf("dispatch_params_buffer", cull_triangles_dispatch_params_buffer);
-  auto instanced_idx_buf = vuk::declare_buf("instanced_index_buffer", instanced_index_buffer);
+  auto instanced_idx_buf = instanced_index_buffer.acquire("instanced_index_buffer", vuk::eIndexRead);
   auto indirect_commands_buff = vuk::declare_buf("meshlet_indirect_commands_buffer", indirect_commands_buffer);
-  auto debug_aabb_buff = vuk::declare_buf("debug_aabb_buffer", debug_aabb_buffer);
+  auto debug_aabb_buff = vuk::make_pass("debug_aabb_reset", [](vuk::CommandBuffer& command_buffer, VUK_BA(vuk::eTransferWrite) buffer) {
+    // 14 vertices of a line strip cube, instance count is bumped by cull_meshlets
+    constexpr auto draw_command = vuk::DrawIndirectCommand{.vertexCount = 14, .instanceCount = 0, .firstVertex = 0, .firstInstance = 0};
+    command_buffer.update_buffer(buffer->subrange(0, sizeof(draw_command)), &draw_command);
+    return buffer;
+  })(debug_aabb_buffer.acquire("debug_aabb_buffer", vuk::eIndirectRead | vuk::eVertexRead));
 
   auto [vis_meshlets_buff_output,
         triangles_dis_buffer_output,
@@ -1217,7 +1858,7 @@ vuk::Value<vuk::ImageAttachment> DefaultRenderPipeline::on_render(vuk::Allocator
   })(material_depth_output, albedo, normal, normal_vertex, metallic_roughness, velocity, emission, vis_image_output);
 
   auto envmap_image = vuk::clear_image(vuk::declare_ia("sky_envmap_image", sky_envmap_texture.as_attachment()), vuk::Black<float>);
-  auto sky_envmap_output = dir_light_data ? sky_envmap_pass(envmap_image) : envmap_image;
+  auto sky_envmap_output = passes.sky_envmap ? sky_envmap_pass(envmap_image) : envmap_image;
 
   auto color_image = vuk::clear_image(vuk::declare_ia("color_image", color_texture.as_attachment()), vuk::Black<float>);
   // TODO: pass GTAO
@@ -1337,13 +1978,11 @@ vuk::Value<vuk::ImageAttachment> DefaultRenderPipeline::on_render(vuk::Allocator
   })(depth_output, color_output_w2d, debug_buffer_output);
 
   auto bloom_output = vuk::clear_image(vuk::declare_ia("bloom_output", vuk::dummy_attachment), vuk::Black<float>);
-  if (RendererCVar::cvar_bloom_enable.get()) {
-    constexpr uint32_t bloom_mip_count = 8;
-
+  if (passes.bloom) {
     auto bloom_ia = vuk::ImageAttachment{
       .format = vuk::Format::eR32G32B32A32Sfloat,
       .sample_count = vuk::SampleCountFlagBits::e1,
-      .level_count = bloom_mip_count,
+      .level_count = BLOOM_MIP_COUNT,
       .layer_count = 1,
     };
     auto bloom_down_image = vuk::clear_image(vuk::declare_ia("bloom_down_image", bloom_ia), vuk::Black<float>);
@@ -1352,7 +1991,7 @@ vuk::Value<vuk::ImageAttachment> DefaultRenderPipeline::on_render(vuk::Allocator
     auto bloom_up_ia = vuk::ImageAttachment{
       .format = vuk::Format::eR32G32B32A32Sfloat,
       .sample_count = vuk::SampleCountFlagBits::e1,
-      .level_count = bloom_mip_count - 1,
+      .level_count = BLOOM_MIP_COUNT - 1,
       .layer_count = 1,
     };
     auto bloom_up_image = vuk::clear_image(vuk::declare_ia("bloom_up_image", bloom_up_ia), vuk::Black<float>);
@@ -1379,13 +2018,13 @@ vuk::Value<vuk::ImageAttachment> DefaultRenderPipeline::on_render(vuk::Allocator
     return target;
   })(target, color_output_w2d, bloom_output);
 
-  return debug_pass(frame_allocator, depth_output, final_output);
+  return passes.debug_renderer ? debug_pass(frame_allocator, depth_output, final_output) : final_output;
 #if 0
   auto shadow_map = vuk::clear_image(vuk::declare_ia("shadow_map", shadow_map_atlas.as_attachment()), vuk::DepthZero);
   shadow_map = shadow_pass(shadow_map);
 
   auto gtao_output = vuk::clear_image(vuk::declare_ia("gtao_output", gtao_final_texture.as_attachment()), vuk::Black<uint32_t>);
-  if (RendererCVar::cvar_gtao_enable.get())
+  if (RendererCVar::cvar_gtao_enable.get() && pipeline_registry.require("gtao_final_pipeline"))
     gtao_output = gtao_pass(frame_allocator, gtao_output, depth_output, normal_output);
 
   #if FSR
@@ -1408,7 +2047,7 @@ vuk::Value<vuk::ImageAttachment> DefaultRenderPipeline::on_render(vuk::Allocator
   auto fxaa_ia = vuk::ImageAttachment::from_preset(Preset::eGeneric2D, vuk::Format::eR32G32B32A32Sfloat, {}, vuk::Samples::e1);
   auto fxaa_image = vuk::clear_image(vuk::declare_ia("fxaa_image", fxaa_ia), vuk::Black<float>);
   fxaa_image.same_extent_as(target);
-  if (RendererCVar::cvar_fxaa_enable.get())
+  if (RendererCVar::cvar_fxaa_enable.get() && pipeline_registry.require("fxaa_pipeline"))
     fxaa_image = apply_fxaa(fxaa_image, forward_output);
   else
     fxaa_image = forward_output;
@@ -1419,7 +2058,7 @@ vuk::Value<vuk::ImageAttachment> DefaultRenderPipeline::on_render(vuk::Allocator
   }
 
   auto grid_output = debug_output;
-  if (RendererCVar::cvar_draw_grid.get()) {
+  if (RendererCVar::cvar_draw_grid.get() && pipeline_registry.require("grid_pipeline")) {
     grid_output = apply_grid(grid_output, depth_output);
   }
 
@@ -1427,103 +2066,164 @@ vuk::Value<vuk::ImageAttachment> DefaultRenderPipeline::on_render(vuk::Allocator
 #endif
 }
 
+uint32 DefaultRenderPipeline::DebugDrawRange::get_draw_count() const {
+  uint32 count = (line_vertex_count > 0) + (triangle_vertex_count > 0);
+  for (const auto shape_count : shape_counts)
+    count += shape_count > 0;
+  return count;
+}
+
+void DefaultRenderPipeline::gather_debug_draws(const DebugRenderer& debug_renderer) {
+  OX_SCOPED_ZONE;
+  DebugRenderer::gather();
+
+  debug_vertices.clear();
+  for (uint32 list = 0; list < (uint32)debug_draw_ranges.size(); list++) {
+    const bool depth_tested = list == DEBUG_DEPTH_TESTED;
+    auto& range = debug_draw_ranges[list];
+    range.first_line_vertex = (uint32)debug_vertices.size();
+    range.line_vertex_count = DebugRenderer::get_vertices_from_lines(debug_renderer.get_lines(depth_tested), debug_vertices);
+    range.triangle_vertex_count = DebugRenderer::get_vertices_from_triangles(debug_renderer.get_triangles(depth_tested), debug_vertices);
+    for (size_t shape = 0; shape < range.shape_counts.size(); shape++)
+      range.shape_counts[shape] = (uint32)debug_renderer.get_shapes((DebugRenderer::Shape)shape, depth_tested).size();
+  }
+
+  debug_mesh_instances.clear();
+  debug_mesh_draws.clear();
+  if (App::get_system<Physics>())
+    Physics::get_debug_renderer()->gather(debug_mesh_instances, debug_mesh_draws);
+}
+
 vuk::Value<vuk::ImageAttachment> DefaultRenderPipeline::debug_pass(vuk::Allocator& frame_allocator,
                                                                    vuk::Value<vuk::ImageAttachment>& depth_output,
                                                                    vuk::Value<vuk::ImageAttachment>& input_clr) {
-  const auto& lines = DebugRenderer::get_instance()->get_lines(false);
-  auto [line_vertices, line_index_count] = DebugRenderer::get_vertices_from_lines(lines);
-
-  const auto& triangles = DebugRenderer::get_instance()->get_triangles(false);
-  auto [triangle_vertices, triangle_index_count] = DebugRenderer::get_vertices_from_triangles(triangles);
+  return vuk::make_pass("debug_pass2", [this](vuk::CommandBuffer& command_buffer, VUK_IA(vuk::eColorWrite) _output, VUK_IA(vuk::eDepthStencilRead) _depth) {
+    camera_cb.camera_data[0] = get_main_camera_data();
 
-  const uint32 index_count = line_index_count + triangle_index_count;
-  if (index_count >= DebugRenderer::MAX_LINE_INDICES)
-    OX_LOG_ERROR("Increase DebugRenderer::MAX_LINE_INDICES");
+    // one instanced draw per shape type, unit shapes are expanded in the vertex shader
+    auto shape_vertex_pack = vuk::Packed{vuk::Format::eR32G32B32A32Sfloat};
+    auto shape_instance_pack = vuk::Packed{
+      vuk::Format::eR32G32B32A32Sfloat, // 16 rotation
+      vuk::Format::eR32G32B32Sfloat,    // 12 position
+      vuk::Format::eR32G32B32Sfloat,    // 12 size
+      vuk::Format::eR32Sfloat,          // 4 length
+      vuk::Format::eR32Uint,            // 4 color
+    };
 
-  std::vector<Vertex> vertices = line_vertices;
-  vertices.insert(vertices.end(), triangle_vertices.begin(), triangle_vertices.end());
+    const auto* debug_renderer = DebugRenderer::get_instance();
 
-  if (vertices.empty())
-    vertices.emplace_back(Vertex{});
+    // depth tested lists first, so whatever is drawn on top isn't hidden by them
+    for (const uint32 list : {DEBUG_DEPTH_TESTED, DEBUG_ON_TOP}) {
+      const auto& draw_range = debug_draw_ranges[list];
+      const auto depth_stencil = vuk::PipelineDepthStencilStateCreateInfo{
+        .depthTestEnable = list == DEBUG_DEPTH_TESTED,
+        .depthWriteEnable = false,
+        .depthCompareOp = vuk::CompareOp::eGreaterOrEqual,
+      };
 
-  debug_vertex_buffer_previous = std::move(debug_vertex_buffer);
+      command_buffer.bind_graphics_pipeline("unlit_pipeline")
+        .set_depth_stencil(depth_stencil)
+        .set_dynamic_state(vuk::DynamicStateFlagBits::eScissor | vuk::DynamicStateFlagBits::eViewport)
+        .broadcast_color_blend({})
+        .set_rasterization({.polygonMode = vuk::PolygonMode::eLine, .cullMode = vuk::CullModeFlagBits::eNone})
+        .set_primitive_topology(vuk::PrimitiveTopology::eLineList)
+        .set_viewport(0, vuk::Rect2D::framebuffer())
+        .set_scissor(0, vuk::Rect2D::framebuffer())
+        .bind_vertex_buffer(0, debug_vertex_buffer, 0, vertex_pack)
+        .bind_persistent(0, *descriptor_set_00);
 
-  auto& vk_context = App::get_vkcontext();
+      bind_camera_buffer(command_buffer);
 
-  auto [v_buff, v_buff_fut] = create_cpu_buffer(*vk_context.superframe_allocator, std::span(vertices));
-  debug_vertex_buffer = std::move(v_buff);
+      if (draw_range.line_vertex_count > 0)
+        command_buffer.draw(draw_range.line_vertex_count, 1, draw_range.first_line_vertex, 0);
 
-  auto& dbg_index_buffer = *DebugRenderer::get_instance()->get_global_index_buffer();
+      if (draw_range.triangle_vertex_count > 0) {
+        command_buffer.set_primitive_topology(vuk::PrimitiveTopology::eTriangleList);
+        command_buffer.draw(draw_range.triangle_vertex_count, 1, draw_range.first_line_vertex + draw_range.line_vertex_count, 0);
+      }
 
-  if (!debug_vertex_buffer_previous)
-    return input_clr;
+      for (size_t shape = 0; shape < draw_range.shape_counts.size(); shape++) {
+        if (draw_range.shape_counts[shape] == 0)
+          continue;
 
-#if 0 // TODO:
-  // depth tested
-  const auto& lines_dt = DebugRenderer::get_instance()->get_lines(true);
-  auto [vertices_dt, index_count_dt] = DebugRenderer::get_vertices_from_lines(lines_dt);
+        const auto range = debug_renderer->get_shape_range((DebugRenderer::Shape)shape);
 
-  if (vertices_dt.empty())
-    vertices_dt.emplace_back(Vertex{});
+        command_buffer.bind_graphics_pipeline("debug_shape_pipeline")
+          .set_depth_stencil(depth_stencil)
+          .set_dynamic_state(vuk::DynamicStateFlagBits::eScissor | vuk::DynamicStateFlagBits::eViewport)
+          .broadcast_color_blend(vuk::BlendPreset::eAlphaBlend)
+          .set_rasterization({.polygonMode = vuk::PolygonMode::eLine, .cullMode = vuk::CullModeFlagBits::eNone})
+          .set_primitive_topology(vuk::PrimitiveTopology::eLineList)
+          .set_viewport(0, vuk::Rect2D::framebuffer())
+          .set_scissor(0, vuk::Rect2D::framebuffer())
+          .bind_vertex_buffer(0, *debug_renderer->get_shape_vertex_buffer(), 0, shape_vertex_pack)
+          .bind_vertex_buffer(1, draw_range.shape_buffers[shape], 1, shape_instance_pack, vuk::VertexInputRate::eInstance)
+          .bind_persistent(0, *descriptor_set_00);
 
-  auto [vd_buff, vd_buff_fut] = create_cpu_buffer(frame_allocator, std::span(vertices_dt));
-  auto& v_buffer_dt = *vd_buff;
-#endif
+        bind_camera_buffer(command_buffer);
 
-  return vuk::make_pass("debug_pass2", [this, line_index_count, dbg_index_buffer](vuk::CommandBuffer& command_buffer, VUK_IA(vuk::eColorWrite) _output) {
-    // not depth tested
-    command_buffer.bind_graphics_pipeline("unlit_pipeline")
-      .set_depth_stencil(vuk::PipelineDepthStencilStateCreateInfo{
-        .depthTestEnable = false,
-        .depthWriteEnable = false,
-        .depthCompareOp = vuk::CompareOp::eGreaterOrEqual,
-      })
-      .set_dynamic_state(vuk::DynamicStateFlagBits::eScissor | vuk::DynamicStateFlagBits::eViewport)
-      .broadcast_color_blend({})
-      .set_rasterization({.polygonMode = vuk::PolygonMode::eLine, .cullMode = vuk::CullModeFlagBits::eNone})
-      .set_primitive_topology(vuk::PrimitiveTopology::eLineList)
-      .set_viewport(0, vuk::Rect2D::framebuffer())
-      .set_scissor(0, vuk::Rect2D::framebuffer())
-      .bind_vertex_buffer(0, *debug_vertex_buffer, 0, vertex_pack)
-      .bind_index_buffer(dbg_index_buffer, vuk::IndexType::eUint32)
-      .bind_persistent(0, *descriptor_set_00);
+        command_buffer.draw(range.vertex_count, draw_range.shape_counts[shape], range.first_vertex, 0);
+      }
+    }
 
-    camera_cb.camera_data[0] = get_main_camera_data();
-    bind_camera_buffer(command_buffer);
+    auto mesh_vertex_pack = vuk::Packed{
+      vuk::Format::eR32G32B32Sfloat, // 12 position
+      vuk::Format::eR32Uint,         // 4 color
+      vuk::Format::eR32G32Sfloat,    // 8 uv
+    };
+    auto mesh_instance_pack = vuk::Packed{
+      vuk::Format::eR32G32B32A32Sfloat, // 16 row
+      vuk::Format::eR32G32B32A32Sfloat, // 16 row
+      vuk::Format::eR32G32B32A32Sfloat, // 16 row
+      vuk::Format::eR32G32B32A32Sfloat, // 16 row
+      vuk::Format::eR32Uint,            // 4 color
+    };
 
-    command_buffer.draw_indexed(line_index_count, 1, 0, 0, 0);
+    for (const auto& draw : debug_mesh_draws) {
+      const bool wireframe = draw.mode == PhysicsDebugRenderer::Wireframe;
+      auto cull_mode = vuk::CullModeFlagBits::eNone;
+      if (draw.mode == PhysicsDebugRenderer::SolidCullBack)
+        cull_mode = vuk::CullModeFlagBits::eBack;
+      else if (draw.mode == PhysicsDebugRenderer::SolidCullFront)
+        cull_mode = vuk::CullModeFlagBits::eFront;
 
-#if 0 // TODO
-  // depth tested
-    command_buffer.bind_graphics_pipeline("unlit_pipeline")
-      .set_depth_stencil(vuk::PipelineDepthStencilStateCreateInfo{
-        .depthTestEnable = true,
-        .depthWriteEnable = false,
-        .depthCompareOp = vuk::CompareOp::eGreaterOrEqual,
-      })
-      .set_dynamic_state(vuk::DynamicStateFlagBits::eScissor | vuk::DynamicStateFlagBits::eViewport)
-      .broadcast_color_blend({})
-      .set_rasterization({.polygonMode = vuk::PolygonMode::eLine, .cullMode = vuk::CullModeFlagBits::eNone})
-      .set_primitive_topology(vuk::PrimitiveTopology::eLineList)
-      .set_viewport(0, vuk::Rect2D::framebuffer())
-      .set_scissor(0, vuk::Rect2D::framebuffer())
-      .bind_index_buffer(index_buffer, vuk::IndexType::eUint32)
-      .bind_vertex_buffer(0, v_buffer_dt, 0, vertex_pack)
-      .bind_persistent(0, *descriptor_set_00);
-
-    camera_cb.camera_data[0] = get_main_camera_data();
-    bind_camera_buffer(command_buffer);
+      command_buffer.bind_graphics_pipeline("debug_mesh_pipeline")
+        .set_depth_stencil(vuk::PipelineDepthStencilStateCreateInfo{
+          .depthTestEnable = false,
+          .depthWriteEnable = false,
+          .depthCompareOp = vuk::CompareOp::eGreaterOrEqual,
+        })
+        .set_dynamic_state(vuk::DynamicStateFlagBits::eScissor | vuk::DynamicStateFlagBits::eViewport)
+        .broadcast_color_blend(vuk::BlendPreset::eAlphaBlend)
+        .set_rasterization({.polygonMode = wireframe ? vuk::PolygonMode::eLine : vuk::PolygonMode::eFill, .cullMode = cull_mode})
+        .set_primitive_topology(vuk::PrimitiveTopology::eTriangleList)
+        .set_viewport(0, vuk::Rect2D::framebuffer())
+        .set_scissor(0, vuk::Rect2D::framebuffer())
+        .bind_vertex_buffer(0, draw.vertex_buffer, 0, mesh_vertex_pack)
+        .bind_vertex_buffer(1, debug_mesh_instance_buffer, 3, mesh_instance_pack, vuk::VertexInputRate::eInstance)
+        .bind_persistent(0, *descriptor_set_00);
 
-    command_buffer.draw_indexed(index_count_dt, 1, 0, 0, 0);
-#endif
+      bind_camera_buffer(command_buffer);
 
-    DebugRenderer::reset();
+      command_buffer.draw(draw.vertex_count, draw.instance_count, 0, draw.first_instance);
+    }
 
     return _output;
-  })(input_clr);
+  })(input_clr, depth_output);
 }
 
 void DefaultRenderPipeline::on_update(Scene* scene) {
+  // pack all sprite textures of a newly loaded scene in one go, packs tighter than growing the atlas sprite by sprite
+  if (gpu_resources && atlas_scene != scene && (bool)RendererCVar::cvar_sprite_atlas.get()) {
+    atlas_scene = scene;
+    const auto sprite_view = scene->registry.view<SpriteComponent>();
+    for (auto&& [e, sprite] : sprite_view.each()) {
+      if (sprite.material)
+        sprite_atlas.add(sprite.material->get_albedo_texture());
+    }
+    sprite_atlas.update();
+  }
+
   // TODO: Account for the bounding volume of the probe
   const auto pp_view = scene->registry.view<PostProcessProbe>();
   for (auto&& [e, component] : pp_view.each()) {
@@ -1537,6 +2237,9 @@ void DefaultRenderPipeline::on_update(Scene* scene) {
 }
 
 void DefaultRenderPipeline::on_submit() {
+  if (first_pass)
+    pipeline_registry.compile(PipelineRegistry::Mode::Deferred);
+
   first_pass = false;
 
   clear();
@@ -1568,7 +2271,7 @@ vuk::Value<vuk::ImageAttachment> DefaultRenderPipeline::shadow_pass(vuk::Value<v
 #if 0
     const auto max_viewport_count = App::get_vkcontext().get_max_viewport_count();
     for (auto& light : scene_lights) {
-      if (!light.cast_shadows)
+      if (!light.cast_shadows || light.shadow_rect.w == 0 || light.shadow_cached)
         continue;
 
       switch (light.type) {
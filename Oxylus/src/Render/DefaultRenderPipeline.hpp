@@ -5,9 +5,20 @@
 #include <glm/gtc/packing.inl>
 #include <vuk/Value.hpp>
 
+#include "DebugRenderer.hpp"
+#include "FrustumCuller.hpp"
+#include "LightClusterer.hpp"
+#include "MeshletHierarchy.hpp"
+#include "OcclusionCuller.hpp"
 #include "Passes/FSR.hpp"
+#include "PipelineRegistry.hpp"
 #include "RenderPipeline.hpp"
 #include "RendererConfig.hpp"
+#include "ShadowAtlas.hpp"
+#include "ShadowCasterCuller.hpp"
+#include "SpriteAtlas.hpp"
+#include "Utils/GrowableBuffer.hpp"
+#include "Utils/UploadRing.hpp"
 
 #include "Passes/GTAO.hpp"
 #include "Passes/SPD.hpp"
@@ -39,14 +50,18 @@ public:
   void submit_camera(Camera* camera) override;
   void submit_sprite(const SpriteComponent& sprite) override;
 
-private:
+  const MeshletHierarchy::LodView* get_lod_view() const override { return current_camera ? &mesh_lod_view : nullptr; }
+
+protected:
   Camera* current_camera = nullptr;
   Camera frozen_camera = {};
+  MeshletHierarchy::LodView mesh_lod_view = {};
 
   bool initalized = false;
   bool first_pass = true;
   bool resized = false;
   bool saved_camera = false;
+  bool gpu_resources = true; // false when nothing is uploaded, e.g. NullRenderPipeline. skips the sprite atlas pages
 
   struct MeshInstance {
     Mat4 transform;
@@ -93,6 +108,8 @@ private:
   static constexpr auto GTAO_BUFFER_IMAGE_INDEX = 4;
   static constexpr auto TRANSFORMS_BUFFER_INDEX = 5;
   static constexpr auto SPRITE_MATERIALS_BUFFER_INDEX = 6;
+  static constexpr auto LIGHT_CLUSTERS_BUFFER_INDEX = 7;
+  static constexpr auto CLUSTER_LIGHTS_BUFFER_INDEX = 8;
 
   // rw buffers indices
   static constexpr auto DEBUG_AABB_INDEX = 0;
@@ -140,10 +157,15 @@ private:
   };
 
   std::vector<LightData> light_datas;
+  std::vector<ShaderEntity> shader_entities;
+  std::vector<PBRMaterial::Parameters> material_parameters;
+  std::vector<SpriteMaterial::Parameters> sprite_material_parameters;
+  std::vector<Texture*> bindless_textures; // textures bound to set 0 binding 10 this frame
 
   struct CameraSH {
     Mat4 projection_view;
     Frustum frustum;
+    Sphere bounds = {};
   };
 
   struct CameraData {
@@ -219,6 +241,8 @@ private:
       int metallic_roughness_ao_image_index;
       int transforms_buffer_index;
       int sprite_materials_buffer_index;
+      int light_clusters_buffer_index;
+      int cluster_lights_buffer_index;
     } indices;
 
     struct PostProcessingData {
@@ -236,6 +260,15 @@ private:
       Vec2 chromatic_aberration = {};                      // x: enable, y: amount
       Vec2 sharpen = {};                                   // x: enable, y: amount
     } post_processing_data;
+
+    struct LightClusters {
+      UVec3 grid_size = {};
+      float depth_scale = 0.0f; // slice = log(view depth) * depth_scale - depth_bias
+      float depth_bias = 0.0f;
+      int enabled = 0;
+    } light_clusters;
+
+    int cull_meshlet_cones = 0;
   } scene_data;
 
 #define MAX_AABB_COUNT 100000
@@ -249,19 +282,46 @@ private:
   vuk::Unique<vuk::PersistentDescriptorSet> descriptor_set_00;
   vuk::Unique<vuk::PersistentDescriptorSet> descriptor_set_02;
 
-  vuk::Buffer visible_meshlets_buffer;
   vuk::Buffer cull_triangles_dispatch_params_buffer;
   vuk::Buffer vertex_buffer;
+  vuk::Buffer quantized_vertex_buffer;
+  vuk::Buffer vertex_quantization_buffer;
   vuk::Buffer index_buffer;
   vuk::Buffer primitives_buffer;
   vuk::Buffer transforms_buffer;
-  vuk::Buffer instanced_index_buffer;
   vuk::Buffer indirect_commands_buffer;
-  vuk::Buffer debug_aabb_buffer;
+
+  // per frame uploads are sub-allocated from here
+  UploadRing upload_ring;
+
+  // written by the culling passes, sized for this frame's meshlet instances
+  GrowableBuffer visible_meshlets_buffer;
+  GrowableBuffer instanced_index_buffer;
+  GrowableBuffer debug_aabb_buffer;
 
   vuk::Buffer vertex_buffer_2d;
-  vuk::Unique<vuk::Buffer> debug_vertex_buffer;
-  vuk::Unique<vuk::Buffer> debug_vertex_buffer_previous;
+
+  // debug renderer lines and shape instances, gathered and uploaded with the frame data
+  struct DebugDrawRange {
+    uint32 first_line_vertex = 0; // into `debug_vertices`, the triangles follow the lines
+    uint32 line_vertex_count = 0;
+    uint32 triangle_vertex_count = 0;
+    std::array<vuk::Buffer, (size_t)DebugRenderer::Shape::Count> shape_buffers = {};
+    std::array<uint32, (size_t)DebugRenderer::Shape::Count> shape_counts = {};
+
+    /// @return Draws debug_pass records for the range.
+    uint32 get_draw_count() const;
+  };
+
+  static constexpr uint32 DEBUG_ON_TOP = 0;
+  static constexpr uint32 DEBUG_DEPTH_TESTED = 1;
+
+  std::vector<Vertex> debug_vertices = {};
+  vuk::Buffer debug_vertex_buffer;
+  std::array<DebugDrawRange, 2> debug_draw_ranges = {}; // DEBUG_ON_TOP and DEBUG_DEPTH_TESTED
+  std::vector<PhysicsDebugRenderer::MeshInstance> debug_mesh_instances = {};
+  std::vector<PhysicsDebugRenderer::InstancedDraw> debug_mesh_draws = {};
+  vuk::Buffer debug_mesh_instance_buffer;
 
   vuk::SamplerCreateInfo hiz_sampler_ci;
   VkSamplerReductionModeCreateInfoEXT create_info_reduction;
@@ -313,37 +373,8 @@ private:
 
   struct SpriteGPUData {
     float4x4 transform = {};
-    uint32 material_id16_ypos16 = 0;
-    uint32 flags16_distance16 = 0;
-
-    constexpr bool operator>(const SpriteGPUData& other) const {
-      union SortKey {
-        struct {
-          // The order of members is important here, it means the sort priority (low to high)!
-          uint64_t distance_y : 32;
-          uint64_t distance_z : 32;
-        } bits;
-
-        uint64_t value;
-      };
-      static_assert(sizeof(SortKey) == sizeof(uint64_t));
-      const SortKey a = {
-        .bits =
-          {
-            .distance_y = math::unpack_u32_low(flags16_distance16) & RENDER_FLAGS_2D_SORT_Y ? math::unpack_u32_high(material_id16_ypos16) : 0u,
-            .distance_z = math::unpack_u32_high(flags16_distance16),
-          },
-      };
-      const SortKey b = {
-        .bits =
-          {
-            .distance_y = math::unpack_u32_low(other.flags16_distance16) & RENDER_FLAGS_2D_SORT_Y ? math::unpack_u32_high(other.material_id16_ypos16)
-                                                                                                  : 0u,
-            .distance_z = math::unpack_u32_high(other.flags16_distance16),
-          },
-      };
-      return a.value > b.value;
-    }
+    uint32 material_id = 0;
+    uint32 flags = 0;
   };
 
   struct RenderQueue2D {
@@ -351,10 +382,16 @@ private:
     std::vector<SpriteGPUData> sprite_data = {};
     std::vector<Shared<SpriteMaterial>> materials = {};
 
-    vuk::Name current_pipeline_name = {};
+    // Sort key layout from high to low priority:
+    //	layer (8) | pipeline (8) | distance, far to near (16) | y position, high to low (16) | material (16)
+    // Pipelines are grouped within a layer, use layers if sprites of different pipelines need to blend in a specific order.
+    std::vector<uint64> sort_keys = {};
+    std::vector<uint32> sort_indices = {};
+
+    // indexed by the pipeline bits of the sort key, sprite materials don't pick a shader so every sprite uses the first one
+    static constexpr std::array<const char*, 1> PIPELINES = {"2d_forward_pipeline"};
 
-    uint32 num_sprites = 0;
-    uint32 previous_offset = 0;
+    float sort_ms = 0.0f;
 
     uint32 last_batches_size = 0;
     uint32 last_sprite_data_size = 0;
@@ -364,60 +401,69 @@ private:
       batches.reserve(last_batches_size);
       sprite_data.reserve(last_sprite_data_size);
       materials.reserve(last_materials_size);
-    }
-
-    // TODO: this will take a list of materials
-    // TODO: sort pipelines
-    void update() {
-      const vuk::Name pipeline_name = "2d_forward_pipeline"; // FIXME: hardcoded until we have a modular material shader system
-      if (current_pipeline_name != pipeline_name) {
-        batches.emplace_back(DrawBatch2D{.pipeline_name = pipeline_name, .offset = previous_offset, .count = num_sprites - previous_offset});
-        current_pipeline_name = pipeline_name;
-      }
-
-      previous_offset = num_sprites;
+      sort_keys.reserve(last_sprite_data_size);
+      sort_indices.reserve(last_sprite_data_size);
     }
 
     void add(const SpriteComponent& sprite, float distance) {
-      sprite.material->set_id((uint32)materials.size());
+      constexpr uint64 pipeline_index = 0;
+      const auto material_id = (uint32)materials.size();
+      sprite.material->set_id(material_id);
       materials.emplace_back(sprite.material);
 
-      uint16 flags = 0;
+      uint32 flags = 0;
       if (sprite.sort_y)
         flags |= RENDER_FLAGS_2D_SORT_Y;
 
       if (sprite.flip_x)
         flags |= RENDER_FLAGS_2D_FLIP_X;
 
-      const uint32 flags_and_distance = math::pack_u16(uint16(flags), glm::packHalf1x16(distance));
-      const uint32 materialid_and_ypos = math::pack_u16(uint16(sprite.material->get_id()), glm::packHalf1x16(sprite.get_position().y));
+      const uint64 distance_key = 0xFFFF - to_sortable_half(distance);
+      const uint64 y_key = sprite.sort_y ? 0xFFFF - to_sortable_half(sprite.get_position().y) : 0;
+
+      sort_keys.emplace_back((uint64)std::min(sprite.layer, 0xFFu) << 56u | pipeline_index << 48u | distance_key << 32u | y_key << 16u |
+                             (material_id & 0xFFFF));
+      sort_indices.emplace_back((uint32)sprite_data.size());
 
       sprite_data.emplace_back(SpriteGPUData{
         .transform = sprite.transform,
-        .material_id16_ypos16 = materialid_and_ypos,
-        .flags16_distance16 = flags_and_distance,
+        .material_id = material_id,
+        .flags = flags,
       });
-
-      num_sprites += 1;
     }
 
-    void sort() { std::sort(sprite_data.begin(), sprite_data.end(), std::greater<SpriteGPUData>()); }
+    // Radix sorts the keys and reorders the sprite data to match.
+    void sort();
+    // Builds the draw batches from the sorted sprites, a new batch starts whenever the pipeline changes.
+    void update();
 
     void clear() {
-      num_sprites = 0;
-      previous_offset = 0;
       last_batches_size = (uint32)batches.size();
       last_sprite_data_size = (uint32)sprite_data.size();
       last_materials_size = (uint32)materials.size();
-      current_pipeline_name = {};
 
       batches.clear();
       sprite_data.clear();
       materials.clear();
+      sort_keys.clear();
+      sort_indices.clear();
+    }
+
+  private:
+    std::vector<uint64> keys_scratch = {};
+    std::vector<uint32> indices_scratch = {};
+    std::vector<SpriteGPUData> sprite_data_scratch = {};
+
+    // maps the half float bits so unsigned comparisons order them like the floats
+    static uint16 to_sortable_half(const float value) {
+      const uint16 half = glm::packHalf1x16(value);
+      return half & 0x8000 ? (uint16)~half : (uint16)(half | 0x8000);
     }
   };
 
   RenderQueue2D render_queue_2d;
+  SpriteAtlas sprite_atlas;
+  Scene* atlas_scene = nullptr;
 
   struct SceneFlattened {
     std::vector<Mesh::Meshlet> meshlets;
@@ -427,12 +473,15 @@ private:
 
     std::vector<uint32> indices{};
     std::vector<Vertex> vertices{};
+    std::vector<QuantizedVertex> quantized_vertices{};
+    std::vector<VertexQuantization> vertex_quantizations{};
     std::vector<uint32> primitives{};
 
     uint32 last_meshlet_size = 0;
     uint32 last_meshlet_instances_size = 0;
     uint32 last_indices_size = 0;
     uint32 last_vertices_size = 0;
+    uint32 last_quantized_vertices_size = 0;
     uint32 last_primitives_size = 0;
     uint32 last_transforms_size = 0;
 
@@ -445,6 +494,7 @@ private:
 
       indices.reserve(last_indices_size);
       vertices.reserve(last_vertices_size);
+      quantized_vertices.reserve(last_quantized_vertices_size);
       primitives.reserve(last_primitives_size);
       transforms.reserve(last_transforms_size);
     }
@@ -455,10 +505,13 @@ private:
 
       last_indices_size = (uint32)indices.size();
       last_vertices_size = (uint32)vertices.size();
+      last_quantized_vertices_size = (uint32)quantized_vertices.size();
       last_primitives_size = (uint32)primitives.size();
 
       indices.clear();
       vertices.clear();
+      quantized_vertices.clear();
+      vertex_quantizations.clear();
       primitives.clear();
       transforms.clear();
 
@@ -467,45 +520,33 @@ private:
       materials.clear();
     }
 
-    void update(const std::vector<MeshComponent>& mc_list, const std::vector<SpriteComponent>& sp_list) {
-      OX_SCOPED_ZONE;
-
-      if (mc_list.empty()) {
-        meshlet_instances.emplace_back();
-        meshlets.emplace_back();
-        indices.emplace_back();
-        vertices.emplace_back();
-        primitives.emplace_back();
-        transforms.emplace_back();
-        materials.emplace_back(create_shared<PBRMaterial>());
-
-        return;
-      }
-
-      for (auto& mc : mc_list) {
-        for (int node_index = 0; auto& node : mc.mesh_base->nodes) {
-          if (!node.meshlet_indices.empty()) {
-            const auto instance_id = (uint32)transforms.size();
-            const auto transform = node_index == 0 ? mc.transform : mc.child_transforms[node_index - 1];
-            transforms.emplace_back(transform);
-            for (auto& [meshletIndex, _, materialId] : node.meshlet_indices) {
-              // meshlet.instance_id = uint32(instance_id);
-              meshlet_instances.emplace_back(meshletIndex, instance_id, materialId);
-            }
-            node_index++;
-          }
-        }
-
-        meshlets.insert(std::end(meshlets), std::begin(mc.mesh_base->_meshlets), std::end(mc.mesh_base->_meshlets));
-        indices.insert(std::end(indices), std::begin(mc.mesh_base->_indices), std::end(mc.mesh_base->_indices));
-        vertices.insert(std::end(vertices), std::begin(mc.mesh_base->_vertices), std::end(mc.mesh_base->_vertices));
-        primitives.insert(std::end(primitives), std::begin(mc.mesh_base->_primitives), std::end(mc.mesh_base->_primitives));
-        materials.insert(std::end(materials), std::begin(mc.materials), std::end(mc.materials));
-      }
-    }
+    // Flattens the submitted meshes into the buffers consumed by the meshlet culling passes.
+    // When a frustum is given, instances outside of it (and optionally hidden behind occluders) are dropped
+    // before their meshlets are expanded. With a LOD view only the meshlets in the hierarchy cut are expanded,
+    // meshes with a LOD chain expand the meshlets of the LOD selected for them at submit.
+    void update(const std::vector<MeshComponent>& mc_list,
+                const std::vector<SpriteComponent>& sp_list,
+                const Frustum* frustum,
+                OcclusionCuller* occlusion_culler,
+                const MeshletHierarchy::LodView* lod_view);
+
+    RenderStatistics::Culling culling_stats = {};
+    RenderStatistics::Lods lod_stats = {};
+
+  private:
+    FrustumCuller culler = {};
+    std::vector<AABB> instance_bounds = {};
+    std::vector<uint8> instance_visibility = {};
+    std::vector<uint8> instance_is_occluder = {};
+    std::vector<uint8> mesh_visibility = {};
+    std::vector<uint32> mesh_first_instance = {};
+
+    void cull_instances(const std::vector<MeshComponent>& mc_list, const Frustum& frustum);
+    void cull_occluded_instances(const std::vector<MeshComponent>& mc_list, OcclusionCuller& occlusion_culler);
   };
 
   SceneFlattened scene_flattened;
+  OcclusionCuller occlusion_culler;
   std::vector<MeshComponent> mesh_component_list;
   std::vector<SpriteComponent> sprite_component_list;
   Shared<Mesh> m_quad = nullptr;
@@ -515,14 +556,59 @@ private:
   std::vector<LightComponent> scene_lights = {};
   LightComponent* dir_light_data = nullptr;
 
+  PipelineRegistry pipeline_registry = {};
+
+  LightClusterer light_clusterer = {};
+  std::vector<LightClusterer::Light> cluster_lights = {};
+
+  ShadowAtlas shadow_atlas = {};
+  std::vector<ShadowAtlas::Request> shadow_requests = {};
+  std::vector<uint32> shadow_light_indices = {};
+
+  // shadow_pass doesn't draw anything yet, the caster sets are only built once it does
+  static constexpr bool SHADOW_PASS_ENABLED = false;
+
+  // only lights with at least one view to render get a set
+  struct ShadowCasterSet {
+    uint32 light_index = 0;
+    uint32 render_mask = 0;              // views that have to be rendered this frame
+    std::vector<uint32> view_masks = {}; // per entry of shadow_caster_bounds
+  };
+
+  ShadowCasterCuller shadow_caster_culler = {};
+  std::vector<AABB> shadow_caster_bounds = {};
+  std::vector<ShadowCasterSet> shadow_caster_sets = {};
+
   void clear();
   void bind_camera_buffer(vuk::CommandBuffer& command_buffer);
   CameraData get_main_camera_data(bool use_frozen_camera = false);
   void create_dir_light_cameras(const LightComponent& light, Camera& camera, std::vector<CameraSH>& camera_data, uint32_t cascade_count);
   void create_cubemap_cameras(std::vector<CameraSH>& camera_data, Vec3 pos = {}, float near = 0.1f, float far = 90.0f);
-  void update_frame_data(vuk::Allocator& allocator);
+  static constexpr uint32 BLOOM_MIP_COUNT = 8;
+
+  // optional passes `on_render()` records this frame, NullRenderPipeline counts the same ones
+  struct PassConfig {
+    bool sky_envmap = false;
+    bool bloom = false;
+    bool debug_renderer = false;
+  };
+
+  void begin_frame();
+  /// Doesn't wait for any pipeline without gpu resources, the passes are only counted then.
+  PassConfig get_pass_config();
+  void prepare_frame_data();
+  void upload_frame_data(vuk::Allocator& allocator);
   void create_static_resources();
   void create_dynamic_textures(const vuk::Extent3D& ext);
+  void allocate_shadow_tiles();
+  uint64 get_debug_aabb_buffer_size() const;
+
+  static uint64 hash_combine(uint64 seed, uint64 value);
+  static uint64 get_light_hash(const LightComponent& light);
+  uint64 get_static_casters_hash() const;
+  bool has_moving_shadow_casters(const LightComponent& light) const;
+  void begin_shadow_caster_culling();
+  void cull_shadow_casters(uint32 light_index, const std::vector<CameraSH>& cameras, const float3& extrusion);
   void create_descriptor_sets(vuk::Allocator& allocator);
   void run_static_passes(vuk::Allocator& allocator);
 
@@ -542,6 +628,8 @@ private:
                                                             vuk::Value<vuk::ImageAttachment>& upsample_image,
                                                             vuk::Value<vuk::ImageAttachment>& input);
   [[nodiscard]] vuk::Value<vuk::ImageAttachment> apply_grid(vuk::Value<vuk::ImageAttachment>& target, vuk::Value<vuk::ImageAttachment>& depth);
+  /// Fills `debug_vertices`, `debug_draw_ranges` and the physics mesh draws from the debug renderer, uploads nothing.
+  void gather_debug_draws(const DebugRenderer& debug_renderer);
   [[nodiscard]] vuk::Value<vuk::ImageAttachment> debug_pass(vuk::Allocator& frame_allocator,
                                                             vuk::Value<vuk::ImageAttachment>& depth_output,
                                                             vuk::Value<vuk::ImageAttachment>& input_clr);
@@ -0,0 +1,191 @@
+﻿#include "FrustumCuller.hpp"
+
+#include "Utils/Log.hpp"
+#include "Utils/Profiler.hpp"
+#include "Utils/SIMD.hpp"
+
+namespace ox {
+void FrustumCuller::set_frustum(const Frustum& frustum) {
+  // don't go through frustum.planes, they point into whichever copy called init()
+  const Plane* planes[6] = {
+    &frustum.top_face, &frustum.bottom_face, &frustum.right_face, &frustum.left_face, &frustum.far_face, &frustum.near_face};
+
+  for (uint32 i = 0; i < 6; i++) {
+    plane_nx[i] = planes[i]->normal.x;
+    plane_ny[i] = planes[i]->normal.y;
+    plane_nz[i] = planes[i]->normal.z;
+    plane_d[i] = planes[i]->distance;
+  }
+}
+
+Intersection FrustumCuller::classify(const AABB& aabb) const {
+  const float3 center = aabb.get_center();
+  const float3 extent = aabb.get_extents() * 0.5f;
+
+  Intersection result = Inside;
+  for (uint32 i = 0; i < 6; i++) {
+    const float dist = plane_nx[i] * center.x + plane_ny[i] * center.y + plane_nz[i] * center.z - plane_d[i];
+    const float radius = std::abs(plane_nx[i]) * extent.x + std::abs(plane_ny[i]) * extent.y + std::abs(plane_nz[i]) * extent.z;
+
+    if (dist < -radius)
+      return Outside;
+    if (dist < radius)
+      result = Intersects;
+  }
+
+  return result;
+}
+
+void FrustumCuller::clear() {
+  count = 0;
+  center_x.clear();
+  center_y.clear();
+  center_z.clear();
+  extent_x.clear();
+  extent_y.clear();
+  extent_z.clear();
+  visibility.clear();
+}
+
+uint32 FrustumCuller::add(const AABB& aabb) {
+  const float3 center = aabb.get_center();
+  const float3 extent = aabb.get_extents() * 0.5f;
+
+  center_x.emplace_back(center.x);
+  center_y.emplace_back(center.y);
+  center_z.emplace_back(center.z);
+  extent_x.emplace_back(extent.x);
+  extent_y.emplace_back(extent.y);
+  extent_z.emplace_back(extent.z);
+
+  return count++;
+}
+
+void FrustumCuller::cull() {
+  OX_SCOPED_ZONE;
+
+  // pad to a multiple of 4 with boxes that are never read back
+  const uint32 padded_count = (count + 3u) & ~3u;
+  center_x.resize(padded_count);
+  center_y.resize(padded_count);
+  center_z.resize(padded_count);
+  extent_x.resize(padded_count);
+  extent_y.resize(padded_count);
+  extent_z.resize(padded_count);
+  visibility.resize(padded_count);
+
+  uint32 accepted = 0;
+
+#if OX_SIMD_SSE
+  const __m128 sign_mask = _mm_set1_ps(-0.0f);
+
+  for (uint32 i = 0; i < padded_count; i += 4) {
+    const __m128 cx = _mm_loadu_ps(&center_x[i]);
+    const __m128 cy = _mm_loadu_ps(&center_y[i]);
+    const __m128 cz = _mm_loadu_ps(&center_z[i]);
+    const __m128 ex = _mm_loadu_ps(&extent_x[i]);
+    const __m128 ey = _mm_loadu_ps(&extent_y[i]);
+    const __m128 ez = _mm_loadu_ps(&extent_z[i]);
+
+    __m128 outside = _mm_setzero_ps();
+    for (uint32 p = 0; p < 6; p++) {
+      const __m128 nx = _mm_set1_ps(plane_nx[p]);
+      const __m128 ny = _mm_set1_ps(plane_ny[p]);
+      const __m128 nz = _mm_set1_ps(plane_nz[p]);
+
+      const __m128 dist = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_mul_ps(nz, cz)), _mm_set1_ps(plane_d[p]));
+      const __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign_mask, nx), ex), _mm_mul_ps(_mm_andnot_ps(sign_mask, ny), ey)),
+                                       _mm_mul_ps(_mm_andnot_ps(sign_mask, nz), ez));
+
+      // dist + radius < 0 means the whole box is behind the plane
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, radius), _mm_setzero_ps()));
+    }
+
+    const int mask = _mm_movemask_ps(outside);
+    for (uint32 lane = 0; lane < 4; lane++) {
+      const uint8 visible = (mask & (1 << lane)) == 0;
+      visibility[i + lane] = visible;
+      accepted += visible && i + lane < count;
+    }
+  }
+#else
+  for (uint32 i = 0; i < count; i++) {
+    bool outside = false;
+    for (uint32 p = 0; p < 6; p++) {
+      const float dist = plane_nx[p] * center_x[i] + plane_ny[p] * center_y[i] + plane_nz[p] * center_z[i] - plane_d[p];
+      const float radius = std::abs(plane_nx[p]) * extent_x[i] + std::abs(plane_ny[p]) * extent_y[i] + std::abs(plane_nz[p]) * extent_z[i];
+      outside |= dist + radius < 0.0f;
+    }
+    visibility[i] = !outside;
+    accepted += !outside;
+  }
+#endif
+
+  stats.instances_tested = count;
+  stats.instances_accepted = accepted;
+}
+
+bool FrustumCuller::verify() {
+  const auto fail = [](const char* message) {
+    OX_LOG_ERROR("FrustumCuller: {}", message);
+    return false;
+  };
+
+  // a box shaped frustum around the origin, the zero sized boxes padding the batch would be inside of it
+  Frustum frustum = {
+    .top_face = {float3(0.0f, 10.0f, 0.0f), float3(0.0f, -1.0f, 0.0f)},
+    .bottom_face = {float3(0.0f, -10.0f, 0.0f), float3(0.0f, 1.0f, 0.0f)},
+    .right_face = {float3(10.0f, 0.0f, 0.0f), float3(-1.0f, 0.0f, 0.0f)},
+    .left_face = {float3(-10.0f, 0.0f, 0.0f), float3(1.0f, 0.0f, 0.0f)},
+    .far_face = {float3(0.0f, 0.0f, 100.0f), float3(0.0f, 0.0f, -1.0f)},
+    .near_face = {float3(0.0f, 0.0f, -1.0f), float3(0.0f, 0.0f, 1.0f)},
+  };
+  frustum.init();
+
+  struct Box {
+    AABB aabb;
+    Intersection expected;
+  };
+  const Box boxes[] = {
+    {{float3(-1.0f), float3(1.0f)}, Inside},
+    {{float3(-9.0f, -9.0f, 0.0f), float3(-8.0f, -8.0f, 1.0f)}, Inside},
+    {{float3(5.0f, 5.0f, 90.0f), float3(6.0f, 6.0f, 99.0f)}, Inside},
+    {{float3(9.0f, -1.0f, 50.0f), float3(11.0f, 1.0f, 51.0f)}, Intersects},
+    {{float3(-1.0f, -1.0f, 99.0f), float3(1.0f, 1.0f, 101.0f)}, Intersects},
+    {{float3(-20.0f, -20.0f, -20.0f), float3(20.0f, 20.0f, 200.0f)}, Intersects},
+    {{float3(-1.0f, -1.0f, -5.0f), float3(1.0f, 1.0f, -2.0f)}, Outside},
+    {{float3(-1.0f, -1.0f, 150.0f), float3(1.0f, 1.0f, 160.0f)}, Outside},
+    {{float3(-31.0f, -1.0f, 10.0f), float3(-30.0f, 1.0f, 11.0f)}, Outside},
+    {{float3(-1.0f, 10.5f, 10.0f), float3(1.0f, 12.0f, 11.0f)}, Outside},
+    {{float3(10.001f, 0.0f, 10.0f), float3(10.5f, 1.0f, 11.0f)}, Outside},
+  };
+
+  FrustumCuller culler = {};
+  culler.set_frustum(frustum);
+  for (const auto& box : boxes) {
+    if (culler.classify(box.aabb) != box.expected)
+      return fail("a box was classified wrong");
+    culler.add(box.aabb);
+  }
+
+  // 11 boxes, the last batch of 4 is padded
+  culler.cull();
+  for (uint32 i = 0; i < std::size(boxes); i++) {
+    if (culler.is_visible(i) != (boxes[i].expected != Outside))
+      return fail("the batched test disagrees with the classification");
+  }
+  if (culler.get_stats().instances_tested != 11 || culler.get_stats().instances_accepted != 6)
+    return fail("the counters include padding or missed boxes");
+
+  // counters are per batch, not accumulated
+  culler.clear();
+  culler.add(boxes[0].aabb);
+  culler.add(boxes[6].aabb);
+  culler.cull();
+  if (culler.get_count() != 2 || culler.get_stats().instances_tested != 2 || culler.get_stats().instances_accepted != 1 || !culler.is_visible(0) ||
+      culler.is_visible(1))
+    return fail("a second batch didn't reset the counters");
+
+  return true;
+}
+} // namespace ox
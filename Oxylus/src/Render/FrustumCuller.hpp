@@ -0,0 +1,57 @@
+﻿#pragma once
+#include <vector>
+
+#include "BoundingVolume.hpp"
+#include "Frustum.hpp"
+
+#include "Core/Types.hpp"
+
+namespace ox {
+// CPU side frustum culling of world space bounds.
+//	Bounds are stored as SoA center/half extents so the plane tests can run on 4 boxes at once.
+//	Doesn't depend on any GPU state so it can be driven with plain camera and bounds data.
+class FrustumCuller {
+public:
+  struct Stats {
+    uint32 instances_tested = 0;
+    uint32 instances_accepted = 0;
+  };
+
+  void set_frustum(const Frustum& frustum);
+
+  // Scalar classification, used for coarse groups (e.g. a whole mesh) before testing their instances.
+  Intersection classify(const AABB& aabb) const;
+
+  void clear();
+  // Returns the index of the bounds in the batch.
+  uint32 add(const AABB& aabb);
+  // Tests every added bounds against the frustum.
+  void cull();
+
+  bool is_visible(const uint32 index) const { return visibility[index] != 0; }
+  uint32 get_count() const { return count; }
+  const Stats& get_stats() const { return stats; }
+
+  /// Culls a fixture of boxes inside, outside and across an axis aligned frustum and checks visibility and the counters.
+  /// @return false on the first mismatch, which is logged.
+  static bool verify();
+
+private:
+  // plane normals and distances, a point is inside if dot(n, p) - d >= 0
+  float plane_nx[6] = {};
+  float plane_ny[6] = {};
+  float plane_nz[6] = {};
+  float plane_d[6] = {};
+
+  uint32 count = 0;
+  std::vector<float> center_x = {};
+  std::vector<float> center_y = {};
+  std::vector<float> center_z = {};
+  std::vector<float> extent_x = {};
+  std::vector<float> extent_y = {};
+  std::vector<float> extent_z = {};
+  std::vector<uint8> visibility = {};
+
+  Stats stats = {};
+};
+} // namespace ox
@@ -0,0 +1,285 @@
+﻿#include "LightClusterer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <limits>
+
+#include "Thread/TaskScheduler.hpp"
+#include "Utils/Log.hpp"
+#include "Utils/Profiler.hpp"
+#include "Utils/Timer.hpp"
+
+namespace ox {
+void LightClusterer::init(const uint32 grid_x, const uint32 grid_y, const uint32 grid_z) {
+  this->grid_x = std::max(grid_x, 1u);
+  this->grid_y = std::max(grid_y, 1u);
+  this->grid_z = std::max(grid_z, 1u);
+
+  slices.clear();
+  slices.resize(this->grid_z);
+  clusters.clear();
+  light_indices.clear();
+  stats = {};
+}
+
+uint32 LightClusterer::get_slice(const float view_depth) const {
+  if (view_depth <= current_view.near_clip)
+    return 0;
+
+  const float slice = std::floor(std::log(view_depth) * depth_scale - depth_bias);
+  return (uint32)std::clamp(slice, 0.0f, (float)(grid_z - 1));
+}
+
+float LightClusterer::get_slice_depth(const uint32 slice) const {
+  return current_view.near_clip * std::pow(current_view.far_clip / current_view.near_clip, (float)slice / (float)grid_z);
+}
+
+std::span<const uint32> LightClusterer::get_cluster_lights(const uint32 cluster_index) const {
+  if (cluster_index >= clusters.size())
+    return {};
+
+  const auto& cluster = clusters[cluster_index];
+  return {light_indices.data() + cluster.offset, cluster.count};
+}
+
+void LightClusterer::build(const View& view, const std::span<const Light> lights, TaskScheduler* scheduler) {
+  OX_SCOPED_ZONE;
+
+  const Timer timer = {};
+
+  if (slices.size() != grid_z)
+    slices.resize(grid_z);
+
+  current_view = view;
+  current_view.near_clip = std::max(view.near_clip, 0.0001f);
+  current_view.far_clip = std::max(view.far_clip, current_view.near_clip * 1.001f);
+  const float depth_range_log = std::log(current_view.far_clip / current_view.near_clip);
+  depth_scale = (float)grid_z / depth_range_log;
+  depth_bias = (float)grid_z * std::log(current_view.near_clip) / depth_range_log;
+
+  const float near_clip = current_view.near_clip;
+  const float far_clip = current_view.far_clip;
+  const float scale_x = view.projection[0][0];
+  const float scale_y = view.projection[1][1];
+  const bool clustered = is_perspective(view.projection);
+
+  // find the clusters each light can touch, lights outside of the frustum are dropped here
+  std::vector<uint32> global_lights = {};
+  bounds.clear();
+  for (uint32 light_index = 0; light_index < lights.size(); light_index++) {
+    const auto& light = lights[light_index];
+    if (light.range <= 0.0f || !clustered) {
+      global_lights.emplace_back(light_index);
+      continue;
+    }
+
+    const float3 view_position = float3(view.view * float4(light.position, 1.0f));
+    const float depth = -view_position.z;
+    const float radius = light.range;
+    if (depth + radius < near_clip || depth - radius > far_clip)
+      continue;
+
+    float2 ndc_min = float2(-1.0f);
+    float2 ndc_max = float2(1.0f);
+    if (depth - radius > near_clip) {
+      // the projection of the bounding box is the hull of its projected corners
+      ndc_min = float2(std::numeric_limits<float>::max());
+      ndc_max = float2(std::numeric_limits<float>::lowest());
+      for (const float d : {depth - radius, depth + radius}) {
+        for (const float x : {view_position.x - radius, view_position.x + radius}) {
+          for (const float y : {view_position.y - radius, view_position.y + radius}) {
+            const float2 ndc = float2(scale_x * x / d, scale_y * y / d);
+            ndc_min = glm::min(ndc_min, ndc);
+            ndc_max = glm::max(ndc_max, ndc);
+          }
+        }
+      }
+      if (ndc_max.x < -1.0f || ndc_min.x > 1.0f || ndc_max.y < -1.0f || ndc_min.y > 1.0f)
+        continue;
+    }
+
+    const auto to_tile = [](const float ndc, const uint32 count) {
+      return (uint32)std::clamp((ndc * 0.5f + 0.5f) * (float)count, 0.0f, (float)(count - 1));
+    };
+
+    LightBounds& b = bounds.emplace_back();
+    b.view_position = view_position;
+    b.radius = radius;
+    b.light_index = light_index;
+    b.min_x = to_tile(ndc_min.x, grid_x);
+    b.max_x = to_tile(ndc_max.x, grid_x);
+    b.min_y = to_tile(ndc_min.y, grid_y);
+    b.max_y = to_tile(ndc_max.y, grid_y);
+    b.min_z = get_slice(std::max(depth - radius, near_clip));
+    b.max_z = get_slice(std::min(depth + radius, far_clip));
+  }
+
+  if (scheduler) {
+    TaskSet task(grid_z, [this](const TaskSetPartition range, uint32_t) {
+      for (uint32 z = range.start; z < range.end; z++)
+        build_slice(z);
+    });
+    scheduler->schedule_task(&task);
+    scheduler->wait_task(&task);
+  } else {
+    for (uint32 z = 0; z < grid_z; z++)
+      build_slice(z);
+  }
+
+  // stitch the slices together into one list
+  const uint32 slice_cluster_count = grid_x * grid_y;
+  clusters.resize(slice_cluster_count * grid_z + 1);
+  light_indices.clear();
+  for (uint32 z = 0; z < grid_z; z++) {
+    const auto& slice = slices[z];
+    const auto base = (uint32)light_indices.size();
+    light_indices.insert(light_indices.end(), slice.indices.begin(), slice.indices.end());
+    for (uint32 i = 0; i < slice_cluster_count; i++) {
+      clusters[z * slice_cluster_count + i] = {base + slice.clusters[i].offset, slice.clusters[i].count};
+    }
+  }
+
+  clusters.back() = {(uint32)light_indices.size(), (uint32)global_lights.size()};
+  light_indices.insert(light_indices.end(), global_lights.begin(), global_lights.end());
+
+  stats = {};
+  stats.cluster_count = slice_cluster_count * grid_z;
+  stats.visible_lights = (uint32)bounds.size();
+  stats.global_lights = (uint32)global_lights.size();
+  for (uint32 i = 0; i < stats.cluster_count; i++) {
+    const uint32 count = clusters[i].count;
+    stats.non_empty_clusters += count > 0 ? 1 : 0;
+    stats.light_references += count;
+    stats.max_lights_per_cluster = std::max(stats.max_lights_per_cluster, count);
+  }
+  if (stats.non_empty_clusters > 0)
+    stats.average_lights_per_cluster = (float)stats.light_references / (float)stats.non_empty_clusters;
+  stats.build_ms = timer.get_elapsed_ms();
+}
+
+void LightClusterer::build_slice(const uint32 z) {
+  auto& slice = slices[z];
+  const uint32 slice_cluster_count = grid_x * grid_y;
+
+  const float depth_near = get_slice_depth(z);
+  const float depth_far = get_slice_depth(z + 1);
+  const float scale_x = current_view.projection[0][0];
+  const float scale_y = current_view.projection[1][1];
+
+  const auto get_extent = [](const float ndc_min, const float ndc_max, const float d0, const float d1, const float scale) {
+    const float a = ndc_min * d0 / scale, b = ndc_min * d1 / scale;
+    const float c = ndc_max * d0 / scale, d = ndc_max * d1 / scale;
+    return float2(std::min({a, b, c, d}), std::max({a, b, c, d}));
+  };
+
+  slice.pairs.clear();
+  for (const auto& b : bounds) {
+    if (z < b.min_z || z > b.max_z)
+      continue;
+
+    for (uint32 y = b.min_y; y <= b.max_y; y++) {
+      const float2 extent_y = get_extent((float)y / (float)grid_y * 2.0f - 1.0f,
+                                         (float)(y + 1) / (float)grid_y * 2.0f - 1.0f,
+                                         depth_near,
+                                         depth_far,
+                                         scale_y);
+      for (uint32 x = b.min_x; x <= b.max_x; x++) {
+        const float2 extent_x = get_extent((float)x / (float)grid_x * 2.0f - 1.0f,
+                                           (float)(x + 1) / (float)grid_x * 2.0f - 1.0f,
+                                           depth_near,
+                                           depth_far,
+                                           scale_x);
+
+        // sphere against the view space bounds of the froxel
+        const float3 aabb_min = float3(extent_x.x, extent_y.x, -depth_far);
+        const float3 aabb_max = float3(extent_x.y, extent_y.y, -depth_near);
+        const float3 closest = glm::clamp(b.view_position, aabb_min, aabb_max);
+        const float3 delta = closest - b.view_position;
+        if (glm::dot(delta, delta) > b.radius * b.radius)
+          continue;
+
+        slice.pairs.emplace_back((uint64)(y * grid_x + x) << 32 | b.light_index);
+      }
+    }
+  }
+
+  // counting sort by cluster, lights stay in order within a cluster since bounds are sorted by light index and the sort is stable
+  slice.clusters.assign(slice_cluster_count, {});
+  for (const auto pair : slice.pairs)
+    slice.clusters[pair >> 32].count += 1;
+
+  uint32 offset = 0;
+  for (auto& cluster : slice.clusters) {
+    cluster.offset = offset;
+    offset += cluster.count;
+    cluster.count = 0;
+  }
+
+  slice.indices.resize(slice.pairs.size());
+  for (const auto pair : slice.pairs) {
+    auto& cluster = slice.clusters[pair >> 32];
+    slice.indices[cluster.offset + cluster.count] = (uint32)(pair & 0xFFFFFFFF);
+    cluster.count += 1;
+  }
+}
+
+bool LightClusterer::verify(TaskScheduler* scheduler) {
+  OX_SCOPED_ZONE;
+
+  // same conventions as Camera: looking down -z, reversed-z and a flipped y
+  auto perspective = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 100.0f, 0.1f);
+  perspective[1][1] *= -1.0f;
+  auto orthographic = glm::ortho(-16.0f / 9.0f * 10.0f, 16.0f / 9.0f * 10.0f, -10.0f, 10.0f, 100.0f, -100.0f);
+  orthographic[1][1] *= -1.0f;
+
+  const Light lights[] = {
+    {float3(0.0f, 0.0f, -10.0f), 1.0f},  // in front of the camera
+    {float3(0.0f, 0.0f, 10.0f), 1.0f},   // behind it
+    {float3(0.0f, 0.0f, 0.0f), 0.0f},    // directional
+    {float3(50.0f, 0.0f, -10.0f), 1.0f}, // outside of the frustum on x
+    {float3(2.0f, -1.0f, -40.0f), 5.0f}, // spans several slices and tiles
+  };
+
+  const auto fail = [](const char* view_name, const char* message) {
+    OX_LOG_ERROR("LightClusterer: {} view, {}", view_name, message);
+    return false;
+  };
+
+  LightClusterer clusterer = {};
+  clusterer.init();
+  clusterer.build({.view = Mat4(1.0f), .projection = perspective, .near_clip = 0.1f, .far_clip = 100.0f}, lights, scheduler);
+
+  // the cluster under the center of a light has to list it, using the mapping of the shaders
+  for (const uint32 light_index : {0u, 4u}) {
+    const auto& light = lights[light_index];
+    const float4 clip = perspective * float4(light.position, 1.0f);
+    const float2 ndc = float2(clip) / clip.w;
+    const uint3 grid = clusterer.get_grid_size();
+    const auto tile_x = (uint32)std::clamp((ndc.x * 0.5f + 0.5f) * (float)grid.x, 0.0f, (float)(grid.x - 1));
+    const auto tile_y = (uint32)std::clamp((ndc.y * 0.5f + 0.5f) * (float)grid.y, 0.0f, (float)(grid.y - 1));
+    const auto cluster_lights = clusterer.get_cluster_lights(clusterer.get_cluster_index(tile_x, tile_y, clusterer.get_slice(-light.position.z)));
+    if (std::ranges::find(cluster_lights, light_index) == cluster_lights.end())
+      return fail("perspective", "a light is missing from the cluster at its center");
+  }
+
+  const auto& stats = clusterer.get_stats();
+  if (stats.visible_lights != 2 || stats.global_lights != 1)
+    return fail("perspective", "lights outside of the frustum weren't dropped");
+  for (uint32 i = 0; i < stats.cluster_count; i++) {
+    const auto cluster_lights = clusterer.get_cluster_lights(i);
+    if (!std::ranges::is_sorted(cluster_lights) || std::ranges::any_of(cluster_lights, [](const uint32 l) { return l != 0 && l != 4; }))
+      return fail("perspective", "a cluster lists a light it can't see or isn't sorted");
+  }
+  const auto global = clusterer.get_cluster_lights(clusterer.get_global_cluster_index());
+  if (global.size() != 1 || global[0] != 2)
+    return fail("perspective", "the directional light isn't global");
+
+  // unclustered, everything is global
+  clusterer.build({.view = Mat4(1.0f), .projection = orthographic, .near_clip = -100.0f, .far_clip = 100.0f}, lights, scheduler);
+  if (clusterer.get_stats().light_references != 0 || clusterer.get_stats().global_lights != std::size(lights))
+    return fail("orthographic", "lights weren't all put into the global cluster");
+
+  return true;
+}
+}
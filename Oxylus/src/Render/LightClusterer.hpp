@@ -0,0 +1,110 @@
+﻿#pragma once
+#include <span>
+#include <vector>
+
+#include "Core/Types.hpp"
+
+namespace ox {
+class TaskScheduler;
+
+// Assigns lights to a froxel grid built from the camera frustum.
+//	The grid is split in screen tiles on x/y and exponentially distributed depth slices on z.
+//	Every cluster ends up with an offset/count into one compact light index list, indices are sorted within a cluster.
+//	Lights without a range (directional) affect every cluster and are put in an extra cluster after the grid.
+//	Slices are processed in parallel on the TaskScheduler when one is given.
+//	Orthographic views aren't clustered, their view depth can be negative which the log slices can't map.
+//	Every light goes into the global cluster for them instead, which shades the same as clustering being off.
+class LightClusterer {
+public:
+  static constexpr uint32 DEFAULT_GRID_X = 16;
+  static constexpr uint32 DEFAULT_GRID_Y = 9;
+  static constexpr uint32 DEFAULT_GRID_Z = 24;
+
+  struct View {
+    Mat4 view = {};
+    Mat4 projection = {}; // only the x/y scale is used, so reversed-z and infinite projections work as well
+    float near_clip = 0.1f;
+    float far_clip = 1000.0f;
+  };
+
+  struct Light {
+    float3 position = {};
+    float range = 0.0f; // <= 0 for lights that affect everything
+  };
+
+  struct Cluster {
+    uint32 offset = 0;
+    uint32 count = 0;
+  };
+
+  struct Stats {
+    uint32 cluster_count = 0;
+    uint32 non_empty_clusters = 0;
+    uint32 light_references = 0;
+    uint32 max_lights_per_cluster = 0;
+    float average_lights_per_cluster = 0.0f; // of the non empty ones
+    uint32 visible_lights = 0;
+    uint32 global_lights = 0;
+    float build_ms = 0.0f;
+  };
+
+  void init(uint32 grid_x = DEFAULT_GRID_X, uint32 grid_y = DEFAULT_GRID_Y, uint32 grid_z = DEFAULT_GRID_Z);
+
+  void build(const View& view, std::span<const Light> lights, TaskScheduler* scheduler = nullptr);
+
+  /// Perspective projections have w = -z, orthographic ones a constant w.
+  static bool is_perspective(const Mat4& projection) { return projection[2][3] != 0.0f; }
+
+  /// Builds synthetic perspective and orthographic views and checks where a set of known lights ends up.
+  /// @return false and logs the first mismatch.
+  static bool verify(TaskScheduler* scheduler = nullptr);
+
+  uint32 get_cluster_index(const uint32 x, const uint32 y, const uint32 z) const { return (z * grid_y + y) * grid_x + x; }
+  uint32 get_global_cluster_index() const { return grid_x * grid_y * grid_z; }
+  // Slice of a positive view space depth, same mapping the shaders use.
+  uint32 get_slice(float view_depth) const;
+
+  std::span<const uint32> get_cluster_lights(uint32 cluster_index) const;
+
+  const std::vector<Cluster>& get_clusters() const { return clusters; }
+  const std::vector<uint32>& get_light_indices() const { return light_indices; }
+  const Stats& get_stats() const { return stats; }
+
+  uint3 get_grid_size() const { return {grid_x, grid_y, grid_z}; }
+  // slice = log(depth) * depth_scale - depth_bias
+  float get_depth_scale() const { return depth_scale; }
+  float get_depth_bias() const { return depth_bias; }
+
+private:
+  struct LightBounds {
+    float3 view_position = {};
+    float radius = 0.0f;
+    uint32 light_index = 0;
+    uint32 min_x = 0, max_x = 0;
+    uint32 min_y = 0, max_y = 0;
+    uint32 min_z = 0, max_z = 0;
+  };
+
+  struct Slice {
+    std::vector<uint64> pairs = {}; // cluster in the slice << 32 | light index
+    std::vector<uint32> indices = {};
+    std::vector<Cluster> clusters = {};
+  };
+
+  uint32 grid_x = DEFAULT_GRID_X;
+  uint32 grid_y = DEFAULT_GRID_Y;
+  uint32 grid_z = DEFAULT_GRID_Z;
+  float depth_scale = 0.0f;
+  float depth_bias = 0.0f;
+
+  View current_view = {};
+  std::vector<LightBounds> bounds = {};
+  std::vector<Slice> slices = {};
+  std::vector<Cluster> clusters = {};
+  std::vector<uint32> light_indices = {};
+  Stats stats = {};
+
+  float get_slice_depth(uint32 slice) const;
+  void build_slice(uint32 z);
+};
+}
@@ -12,15 +12,19 @@
 #include <vuk/Types.hpp>
 #include <vuk/vsl/Core.hpp>
 
-#include <execution>
+#include <bit>
 #include <ranges>
 #include <stack>
 
 #include "Assets/AssetManager.hpp"
 #include "Core/FileSystem.hpp"
+#include "MeshCodec.hpp"
+#include "RendererConfig.hpp"
 
 #include "Scene/Components.hpp"
 
+#include "Thread/TaskScheduler.hpp"
+
 #include "Utils/Log.hpp"
 #include "Utils/Profiler.hpp"
 #include "Utils/Timer.hpp"
@@ -30,6 +34,11 @@
 namespace ox {
 Mesh::Mesh(const std::string_view path) { load_from_file(path.data()); }
 
+Mesh::~Mesh() {
+  for (const auto& handle : _texture_handles)
+    AssetManager::release(handle);
+}
+
 void Mesh::set_transforms() const {
   struct StackElement {
     Node* node;
@@ -56,6 +65,58 @@ void Mesh::set_transforms() const {
   }
 }
 
+uint32 Mesh::select_lod(const uint32 current_lod,
+                        const float3& center,
+                        const float radius,
+                        const float transform_scale,
+                        const MeshletHierarchy::LodView& view,
+                        const float hysteresis) const {
+  const uint32 lod_count = get_lod_count();
+  if (lod_count == 1)
+    return 0;
+
+  const auto get_error = [&](const uint32 lod) {
+    const auto bounds = MeshletHierarchy::Bounds{.center = center, .radius = radius, .error = _lods[lod].error * transform_scale};
+    return MeshletHierarchy::get_projected_error(bounds, Mat4(1.0f), 1.0f, view);
+  };
+
+  // errors grow with every LOD, a coarser one is only picked once it's clearly below the threshold
+  uint32 lod = 0;
+  for (uint32 i = 1; i < lod_count; i++) {
+    if (get_error(i) > view.error_threshold * (1.0f - hysteresis))
+      break;
+    lod = i;
+  }
+
+  // and a coarser current one is kept until it's clearly above it
+  if (current_lod > lod && current_lod < lod_count && get_error(current_lod) <= view.error_threshold * (1.0f + hysteresis))
+    lod = current_lod;
+
+  return lod;
+}
+
+void Mesh::Node::build_lod_levels(const std::span<const MeshletHierarchy::ClusterLod> meshlet_lods) {
+  lod_levels.clear();
+  if (lod_meshlet_indices.empty())
+    return;
+
+  std::vector<MeshletHierarchy::ClusterLod> lods = {};
+  for (uint32 i = 0; i < (uint32)(meshlet_indices.size() + lod_meshlet_indices.size()); i++) {
+    const auto meshlet_id = get_cut_meshlet(i).meshletId;
+    if (meshlet_id >= meshlet_lods.size())
+      return;
+    lods.emplace_back(meshlet_lods[meshlet_id]);
+  }
+  lod_levels = MeshletHierarchy::build_level_bounds(lods);
+}
+
+float3 Mesh::get_vertex_position(const Meshlet& meshlet, const uint32 vertex) const {
+  if (!meshlet.is_quantized())
+    return _vertices[meshlet.vertex_offset + vertex].position;
+
+  return VertexQuantizer::decode(_quantized_vertices[meshlet.vertex_offset + vertex], _vertex_quantizations[meshlet.vertex_quantization]).position;
+}
+
 Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32>& indices) {
   this->_vertices = vertices;
   this->_indices = indices;
@@ -82,21 +143,112 @@ Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32>& indic
   index_count = (uint32)indices.size();
 }
 
+// Reads EXT_meshopt_compression buffer views from their decoded copies, every other view straight from its buffer.
+struct GltfBufferDataAdapter {
+  std::vector<std::vector<uint8>> decoded_views = {}; // indexed like `bufferViews`, empty for views without compression
+
+  auto operator()(const fastgltf::Asset& asset, const std::size_t buffer_view_index) const {
+    using Span = decltype(fastgltf::DefaultBufferDataAdapter{}(asset, buffer_view_index));
+    if (asset.bufferViews[buffer_view_index].meshoptCompression) {
+      const auto& decoded = decoded_views[buffer_view_index];
+      return Span(reinterpret_cast<const std::byte*>(decoded.data()), decoded.size());
+    }
+    return fastgltf::DefaultBufferDataAdapter{}(asset, buffer_view_index);
+  }
+};
+
+static std::span<const uint8> get_buffer_data(const fastgltf::Buffer& buffer) {
+  if (const auto* array = std::get_if<fastgltf::sources::Array>(&buffer.data))
+    return {reinterpret_cast<const uint8*>(array->bytes.data()), array->bytes.size()};
+  if (const auto* vector = std::get_if<fastgltf::sources::Vector>(&buffer.data))
+    return {reinterpret_cast<const uint8*>(vector->bytes.data()), vector->bytes.size()};
+  if (const auto* view = std::get_if<fastgltf::sources::ByteView>(&buffer.data))
+    return {reinterpret_cast<const uint8*>(view->bytes.data()), view->bytes.size()};
+  return {};
+}
+
+static std::optional<MeshCodec::Stream> get_meshopt_stream(const fastgltf::Asset& asset,
+                                                           const fastgltf::CompressedBufferView& view,
+                                                           std::vector<uint8>& decoded) {
+  auto stream = MeshCodec::Stream{.count = (uint32)view.count, .stride = (uint32)view.byteStride};
+  switch (view.mode) {
+    case fastgltf::MeshoptCompressionMode::Attributes: stream.mode = MeshCodec::Mode::Attributes; break;
+    case fastgltf::MeshoptCompressionMode::Triangles : stream.mode = MeshCodec::Mode::Triangles; break;
+    case fastgltf::MeshoptCompressionMode::Indices   : stream.mode = MeshCodec::Mode::Indices; break;
+    default                                          : return std::nullopt;
+  }
+  switch (view.filter) {
+    case fastgltf::MeshoptCompressionFilter::None       : stream.filter = MeshCodec::Filter::None; break;
+    case fastgltf::MeshoptCompressionFilter::Octahedral : stream.filter = MeshCodec::Filter::Octahedral; break;
+    case fastgltf::MeshoptCompressionFilter::Quaternion : stream.filter = MeshCodec::Filter::Quaternion; break;
+    case fastgltf::MeshoptCompressionFilter::Exponential: stream.filter = MeshCodec::Filter::Exponential; break;
+    default                                             : return std::nullopt;
+  }
+
+  const auto buffer = get_buffer_data(asset.buffers[view.bufferIndex]);
+  if (view.byteOffset > buffer.size() || view.byteLength > buffer.size() - view.byteOffset)
+    return std::nullopt;
+
+  decoded.resize(view.count * view.byteStride);
+  stream.encoded = buffer.subspan(view.byteOffset, view.byteLength);
+  stream.decoded = decoded.data();
+  return stream;
+}
+
+/// Decodes every EXT_meshopt_compression buffer view of `asset` in parallel.
+/// @return false if any of them is corrupt or uses an unknown mode or filter.
+static bool decode_meshopt_buffer_views(const fastgltf::Asset& asset, GltfBufferDataAdapter& adapter) {
+  OX_SCOPED_ZONE;
+  adapter.decoded_views.resize(asset.bufferViews.size());
+
+  std::vector<MeshCodec::Stream> streams = {};
+  for (size_t i = 0; i < asset.bufferViews.size(); i++) {
+    const auto& compression = asset.bufferViews[i].meshoptCompression;
+    if (!compression)
+      continue;
+    const auto stream = get_meshopt_stream(asset, *compression, adapter.decoded_views[i]);
+    if (!stream)
+      return false;
+    streams.emplace_back(*stream);
+  }
+
+  if (streams.empty())
+    return true;
+
+  const Timer timer = {};
+  if (!MeshCodec::decode(streams, App::get_system<TaskScheduler>()))
+    return false;
+
+  uint64 encoded_size = 0;
+  uint64 decoded_size = 0;
+  for (const auto& stream : streams) {
+    encoded_size += stream.encoded.size();
+    decoded_size += (uint64)stream.count * stream.stride;
+  }
+  OX_LOG_INFO("Decoded {} meshopt compressed buffer views, {:.2f} KiB -> {:.2f} KiB in {:.3f} ms",
+              streams.size(),
+              (float)encoded_size / 1024.0f,
+              (float)decoded_size / 1024.0f,
+              timer.get_elapsed_ms());
+  return true;
+}
+
 static std::vector<Vertex> convert_vertex_buffer_format(const fastgltf::Asset& model,
                                                         std::size_t position_accessor_index,
                                                         std::size_t normal_accessor_index,
                                                         std::optional<std::size_t> texcoord_accessor_index,
-                                                        std::optional<std::size_t> color_accessor_index) {
+                                                        std::optional<std::size_t> color_accessor_index,
+                                                        const GltfBufferDataAdapter& adapter) {
   OX_SCOPED_ZONE;
   std::vector<float3> positions;
   auto& position_accessor = model.accessors[position_accessor_index];
   positions.resize(position_accessor.count);
-  fastgltf::iterateAccessorWithIndex<float3>(model, position_accessor, [&](float3 position, std::size_t idx) { positions[idx] = position; });
+  fastgltf::iterateAccessorWithIndex<float3>(model, position_accessor, [&](float3 position, std::size_t idx) { positions[idx] = position; }, adapter);
 
   std::vector<float3> normals;
   auto& normalAccessor = model.accessors[normal_accessor_index];
   normals.resize(normalAccessor.count);
-  fastgltf::iterateAccessorWithIndex<float3>(model, normalAccessor, [&](float3 normal, std::size_t idx) { normals[idx] = normal; });
+  fastgltf::iterateAccessorWithIndex<float3>(model, normalAccessor, [&](float3 normal, std::size_t idx) { normals[idx] = normal; }, adapter);
 
   std::vector<float2> texcoords;
 
@@ -104,7 +256,7 @@ static std::vector<Vertex> convert_vertex_buffer_format(const fastgltf::Asset& m
   if (texcoord_accessor_index.has_value()) {
     auto& texcoordAccessor = model.accessors[texcoord_accessor_index.value()];
     texcoords.resize(texcoordAccessor.count);
-    fastgltf::iterateAccessorWithIndex<float2>(model, texcoordAccessor, [&](float2 texcoord, std::size_t idx) { texcoords[idx] = texcoord; });
+    fastgltf::iterateAccessorWithIndex<float2>(model, texcoordAccessor, [&](float2 texcoord, std::size_t idx) { texcoords[idx] = texcoord; }, adapter);
   } else {
     // If no texcoord attribute, fill with empty texcoords to keep everything consistent and happy
     texcoords.resize(positions.size(), {});
@@ -114,7 +266,7 @@ static std::vector<Vertex> convert_vertex_buffer_format(const fastgltf::Asset& m
   if (color_accessor_index.has_value()) {
     auto& color_accessor = model.accessors[color_accessor_index.value()];
     colors.resize(color_accessor.count);
-    fastgltf::iterateAccessorWithIndex<float3>(model, color_accessor, [&](float3 color, std::size_t idx) { colors[idx] = float4(color, 1.0f); });
+    fastgltf::iterateAccessorWithIndex<float3>(model, color_accessor, [&](float3 color, std::size_t idx) { colors[idx] = float4(color, 1.0f); }, adapter);
   } else {
     colors.resize(positions.size(), float4(1.0f));
   }
@@ -131,12 +283,14 @@ static std::vector<Vertex> convert_vertex_buffer_format(const fastgltf::Asset& m
   return vertices;
 }
 
-static std::vector<uint32> convert_index_buffer_format(const fastgltf::Asset& model, std::size_t indicesAccessorIndex) {
+static std::vector<uint32> convert_index_buffer_format(const fastgltf::Asset& model,
+                                                      std::size_t indicesAccessorIndex,
+                                                      const GltfBufferDataAdapter& adapter) {
   OX_SCOPED_ZONE;
   auto indices = std::vector<uint32>();
   auto& accessor = model.accessors[indicesAccessorIndex];
   indices.resize(accessor.count);
-  fastgltf::iterateAccessorWithIndex<uint32>(model, accessor, [&](uint32 index, size_t idx) { indices[idx] = index; });
+  fastgltf::iterateAccessorWithIndex<uint32>(model, accessor, [&](uint32 index, size_t idx) { indices[idx] = index; }, adapter);
   return indices;
 }
 
@@ -164,14 +318,185 @@ glm::mat4 node_to_mat4(const fastgltf::Node& node) {
 // TODO: move to cvars maybe
 constexpr auto MAX_MESHLET_INDICES = 64u;
 constexpr auto MAX_MESHLET_PRIMITIVES = 64u;
-constexpr auto MESHLET_CONE_WEIGHT = 0.0f;
+constexpr auto MESHLET_CONE_WEIGHT = 0.25f;
+
+// triangles may be reordered for less overdraw as long as the vertex cache hit ratio gets at most this much worse
+constexpr auto OVERDRAW_THRESHOLD = 1.05f;
+// cache size meshoptimizer's documentation reports ACMR with
+constexpr auto ANALYZE_CACHE_SIZE = 16u;
+
+constexpr auto MESHLET_HIERARCHY_SETTINGS = MeshletHierarchy::Settings{
+  .max_vertices = MAX_MESHLET_INDICES,
+  .max_triangles = MAX_MESHLET_PRIMITIVES,
+  .cone_weight = MESHLET_CONE_WEIGHT,
+};
+
+// levels of the LOD chain that keep more than this fraction of the previous level's triangles aren't worth drawing
+constexpr auto MIN_LOD_REDUCTION = 0.85f;
+
+struct ImportSettings {
+  bool optimize = false;
+  bool report = false;
+  bool quantize = false;
+  VertexQuantizer::ErrorBounds quantization_bounds = {};
+};
+
+static ImportSettings get_import_settings() {
+  return {
+    .optimize = (bool)RendererCVar::cvar_mesh_optimize.get(),
+    .report = (bool)RendererCVar::cvar_mesh_optimize_report.get(),
+    .quantize = (bool)RendererCVar::cvar_mesh_quantize.get(),
+    .quantization_bounds =
+      {
+        .position = std::max(RendererCVar::cvar_mesh_quantize_position_error.get(), 0.0f),
+        .normal = std::max(RendererCVar::cvar_mesh_quantize_normal_error.get(), 0.0f),
+        .uv = std::max(RendererCVar::cvar_mesh_quantize_uv_error.get(), 0.0f),
+      },
+  };
+}
+
+struct LodChainSettings {
+  uint32 lod_count = 0; // simplified LODs, not counting the source mesh
+  float target_error = 0.0f;
+};
+
+static LodChainSettings get_lod_chain_settings() {
+  return {
+    .lod_count = (uint32)std::clamp(RendererCVar::cvar_mesh_lod_count.get(), 0, (int)Mesh::MAX_LODS - 1),
+    .target_error = std::max(RendererCVar::cvar_mesh_lod_target_error.get(), 0.0f),
+  };
+}
+
+// everything that changes the result of an import, part of the mesh cache key
+static uint64 get_import_settings_hash() {
+  const auto lod_chain = get_lod_chain_settings();
+  const auto import_settings = get_import_settings();
+  uint64 hash = MESHLET_HIERARCHY_SETTINGS.max_vertices;
+  hash = hash * 31 + MESHLET_HIERARCHY_SETTINGS.max_triangles;
+  hash = hash * 31 + std::bit_cast<uint32>(MESHLET_HIERARCHY_SETTINGS.cone_weight);
+  hash = hash * 31 + MESHLET_HIERARCHY_SETTINGS.group_size;
+  hash = hash * 31 + MESHLET_HIERARCHY_SETTINGS.max_levels;
+  hash = hash * 31 + std::bit_cast<uint32>(MESHLET_HIERARCHY_SETTINGS.min_reduction);
+  hash = hash * 31 + import_settings.optimize;
+  hash = hash * 31 + import_settings.quantize;
+  if (import_settings.quantize) {
+    hash = hash * 31 + std::bit_cast<uint32>(import_settings.quantization_bounds.position);
+    hash = hash * 31 + std::bit_cast<uint32>(import_settings.quantization_bounds.normal);
+    hash = hash * 31 + std::bit_cast<uint32>(import_settings.quantization_bounds.uv);
+  }
+  hash = hash * 31 + lod_chain.lod_count;
+  hash = hash * 31 + std::bit_cast<uint32>(lod_chain.target_error);
+  hash = hash * 31 + sizeof(Vertex);
+  hash = hash * 31 + sizeof(QuantizedVertex);
+  hash = hash * 31 + sizeof(Mesh::Meshlet);
+  hash = hash * 31 + sizeof(PBRMaterial::Parameters);
+  return hash;
+}
 
 struct RawMesh {
   std::vector<Vertex> vertices;
   std::vector<uint32> indices;
   AABB bounding_box;
+  Mesh::ImportStats stats;
+  // only filled when the vertices could be quantized within the import's error bounds
+  std::vector<QuantizedVertex> quantized_vertices;
+  VertexQuantization quantization;
+  Mesh::ImportTimings timings; // only the per primitive stages
 };
 
+static Mesh::GeometryStats analyze_geometry(const RawMesh& mesh) {
+  OX_SCOPED_ZONE;
+  const auto* positions = reinterpret_cast<const float*>(mesh.vertices.data());
+  const auto cache = meshopt_analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), ANALYZE_CACHE_SIZE, 0, 0);
+  const auto fetch = meshopt_analyzeVertexFetch(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), sizeof(Vertex));
+  const auto overdraw = meshopt_analyzeOverdraw(mesh.indices.data(), mesh.indices.size(), positions, mesh.vertices.size(), sizeof(Vertex));
+
+  return {
+    .triangles = mesh.indices.size() / 3,
+    .vertices = mesh.vertices.size(),
+    .vertices_transformed = cache.vertices_transformed,
+    .bytes_fetched = fetch.bytes_fetched,
+    .pixels_covered = overdraw.pixels_covered,
+    .pixels_shaded = overdraw.pixels_shaded,
+  };
+}
+
+// Reorders triangles for the post-transform cache, then for overdraw, then vertices in the order they're first used.
+//	Meshlets are built from the result so they get the same locality.
+static void optimize_raw_mesh(RawMesh& mesh) {
+  OX_SCOPED_ZONE;
+  const auto* positions = reinterpret_cast<const float*>(mesh.vertices.data());
+  auto& indices = mesh.indices;
+
+  meshopt_optimizeVertexCache(indices.data(), indices.data(), indices.size(), mesh.vertices.size());
+  meshopt_optimizeOverdraw(indices.data(), indices.data(), indices.size(), positions, mesh.vertices.size(), sizeof(Vertex), OVERDRAW_THRESHOLD);
+
+  // drops the vertices no triangle references as well
+  const auto vertex_count =
+    meshopt_optimizeVertexFetch(mesh.vertices.data(), indices.data(), indices.size(), mesh.vertices.data(), mesh.vertices.size(), sizeof(Vertex));
+  mesh.vertices.resize(vertex_count);
+}
+
+struct RawMeshLods {
+  MeshletHierarchy hierarchy;
+  std::vector<MeshletHierarchy> chain; // meshlets of LOD 1 and up, can be shorter than requested if simplification stalled
+  std::vector<float> chain_errors;     // in mesh space
+};
+
+static RawMeshLods build_raw_mesh_lods(const RawMesh& mesh, const LodChainSettings& lod_chain, const ImportSettings& import_settings) {
+  const auto* positions = reinterpret_cast<const float*>(mesh.vertices.data());
+  const auto vertex_count = mesh.vertices.size();
+
+  // the chain takes the place of the simplified hierarchy levels
+  auto hierarchy_settings = MESHLET_HIERARCHY_SETTINGS;
+  if (lod_chain.lod_count > 0)
+    hierarchy_settings.max_levels = 1;
+
+  RawMeshLods lods = {};
+  lods.hierarchy = MeshletHierarchy::build(positions, vertex_count, sizeof(Vertex), mesh.indices, hierarchy_settings);
+  if (lod_chain.lod_count == 0)
+    return lods;
+
+  OX_SCOPED_ZONE_N("Build LOD chain for mesh");
+
+  auto level_settings = MESHLET_HIERARCHY_SETTINGS;
+  level_settings.max_levels = 1;
+
+  const float error_scale = meshopt_simplifyScale(positions, vertex_count, sizeof(Vertex));
+  std::vector<uint32> simplified(mesh.indices.size());
+  size_t previous_index_count = mesh.indices.size();
+  float error = 0.0f;
+  for (uint32 lod = 1; lod <= lod_chain.lod_count; lod++) {
+    // every LOD is simplified from the source so errors don't compound, halving the triangles and doubling the error target each time
+    const size_t target_index_count = (mesh.indices.size() >> lod) / 3 * 3;
+    const float target_error = lod_chain.target_error * (float)(1u << (lod - 1));
+    float result_error = 0.0f;
+    const size_t index_count = meshopt_simplify(simplified.data(),
+                                                mesh.indices.data(),
+                                                mesh.indices.size(),
+                                                positions,
+                                                vertex_count,
+                                                sizeof(Vertex),
+                                                target_index_count,
+                                                target_error,
+                                                0,
+                                                &result_error);
+    if (index_count == 0 || (float)index_count > (float)previous_index_count * MIN_LOD_REDUCTION)
+      break;
+
+    if (import_settings.optimize)
+      meshopt_optimizeVertexCache(simplified.data(), simplified.data(), index_count, vertex_count);
+
+    previous_index_count = index_count;
+    error = std::max(error, result_error * error_scale);
+    lods.chain.emplace_back(
+      MeshletHierarchy::build(positions, vertex_count, sizeof(Vertex), std::span(simplified.data(), index_count), level_settings));
+    lods.chain_errors.emplace_back(error);
+  }
+
+  return lods;
+}
+
 struct NodeTempData {
   struct Indices {
     size_t raw_mesh_index;
@@ -184,6 +509,7 @@ void Mesh::load_from_file(const std::string& file_path, glm::mat4 rootTransform)
   OX_SCOPED_ZONE;
 
   Timer timer;
+  import_timings = {};
 
   const auto extension = fs::get_file_extension(file_path);
   const auto is_text = extension == "gltf";
@@ -194,6 +520,17 @@ void Mesh::load_from_file(const std::string& file_path, glm::mat4 rootTransform)
     return;
   }
 
+  // only a fresh mesh maps 1:1 to a cache entry
+  const bool use_cache = RendererCVar::cvar_mesh_cache.get() && nodes.empty() && _vertices.empty();
+  const uint64 cache_key = use_cache ? MeshCache::get_key(file_path, get_import_settings_hash()) : 0;
+  if (cache_key != 0 && MeshCache::read(file_path, cache_key, *this)) {
+    import_timings.cache_read = import_timings.total = timer.get_elapsed_ms();
+    OX_LOG_INFO("Loaded mesh {0} from cache:{1}", fs::get_name_with_extension(file_path), timer.get_elapsed_ms());
+    return;
+  }
+
+  Timer stage_timer = {};
+
   auto maybeAsset = [&]() -> fastgltf::Expected<fastgltf::Asset> {
     OX_SCOPED_ZONE_N("Parse glTF");
     using fastgltf::Extensions;
@@ -214,11 +551,22 @@ void Mesh::load_from_file(const std::string& file_path, glm::mat4 rootTransform)
   }
 
   const auto& asset = maybeAsset.get();
+  import_timings.parse = stage_timer.get_elapsed_ms();
 
   OX_ASSERT(asset.scenes.size() == 1, "Multiple scenes are not supported for now...");
 
-  auto images = load_images(asset);
-  _materials = load_materials(asset, images);
+  stage_timer = {};
+  auto buffer_data_adapter = GltfBufferDataAdapter{};
+  if (!decode_meshopt_buffer_views(asset, buffer_data_adapter)) {
+    OX_LOG_ERROR("Couldn't decode the meshopt compressed buffers of {}", fs::get_name_with_extension(file_path));
+    return;
+  }
+  import_timings.decode_buffers = stage_timer.get_elapsed_ms();
+
+  // Nodes are traversed first to find the unique primitives. Their geometry is then processed as one task per primitive
+  // while the images are decoded and uploaded, one task per image, and the materials created. Meshlets are emitted with one task per primitive
+  // and nodes are assembled with one task per node once all of that is done.
+  stage_timer = {};
 
   struct AccessorIndices {
     std::optional<std::size_t> positions_index;
@@ -325,152 +673,350 @@ void Mesh::load_from_file(const std::string& file_path, glm::mat4 rootTransform)
     }
   }
 
-  std::vector<RawMesh> raw_meshes = {};
-  raw_meshes.resize(unique_accessor_combinations.size());
-
-  std::transform(std::execution::par,
-                 unique_accessor_combinations.begin(),
-                 unique_accessor_combinations.end(),
-                 raw_meshes.begin(),
-                 [&](const std::pair<AccessorIndices, std::size_t>& keyValue) -> RawMesh {
-    OX_SCOPED_ZONE_N("Convert vertices and indices");
-    const auto& [accessorIndices, _] = keyValue;
-    auto vertices = convert_vertex_buffer_format(asset,
-                                                 accessorIndices.positions_index.value(),
-                                                 accessorIndices.normals_index.value(),
-                                                 accessorIndices.texcoords_index,
-                                                 accessorIndices.colors_index);
-    auto indices = convert_index_buffer_format(asset, accessorIndices.indices_index.value());
-
-    const auto& positionAccessor = asset.accessors[accessorIndices.positions_index.value()];
-
-    glm::vec3 bboxMin{};
-    if (auto* dv = std::get_if<std::pmr::vector<double>>(&positionAccessor.min)) {
-      bboxMin = {(*dv)[0], (*dv)[1], (*dv)[2]};
-    }
-    if (auto* iv = std::get_if<std::pmr::vector<int64_t>>(&positionAccessor.min)) {
-      bboxMin = {(*iv)[0], (*iv)[1], (*iv)[2]};
+  float node_traversal_ms = stage_timer.get_elapsed_ms();
+
+  const auto import_settings = get_import_settings();
+  const auto lod_chain = get_lod_chain_settings();
+
+  std::vector<RawMesh> raw_meshes(unique_accessor_combinations.size());
+  std::vector<RawMeshLods> raw_mesh_lods(raw_meshes.size());
+
+  const auto process_raw_mesh = [&](const size_t mesh_index) {
+    const auto& [accessorIndices, _] = unique_accessor_combinations[mesh_index];
+    auto& raw_mesh = raw_meshes[mesh_index];
+    {
+      OX_SCOPED_ZONE_N("Convert vertices and indices");
+      const Timer convert_timer = {};
+      auto vertices = convert_vertex_buffer_format(asset,
+                                                   accessorIndices.positions_index.value(),
+                                                   accessorIndices.normals_index.value(),
+                                                   accessorIndices.texcoords_index,
+                                                   accessorIndices.colors_index,
+                                                   buffer_data_adapter);
+      auto indices = convert_index_buffer_format(asset, accessorIndices.indices_index.value(), buffer_data_adapter);
+
+      const auto& positionAccessor = asset.accessors[accessorIndices.positions_index.value()];
+
+      glm::vec3 bboxMin{};
+      if (auto* dv = std::get_if<std::pmr::vector<double>>(&positionAccessor.min)) {
+        bboxMin = {(*dv)[0], (*dv)[1], (*dv)[2]};
+      }
+      if (auto* iv = std::get_if<std::pmr::vector<int64_t>>(&positionAccessor.min)) {
+        bboxMin = {(*iv)[0], (*iv)[1], (*iv)[2]};
+      }
+
+      glm::vec3 bboxMax{};
+      if (auto* dv = std::get_if<std::pmr::vector<double>>(&positionAccessor.max)) {
+        bboxMax = {(*dv)[0], (*dv)[1], (*dv)[2]};
+      }
+      if (auto* iv = std::get_if<std::pmr::vector<int64_t>>(&positionAccessor.max)) {
+        bboxMax = {(*iv)[0], (*iv)[1], (*iv)[2]};
+      }
+
+      raw_mesh = RawMesh{
+        .vertices = std::move(vertices),
+        .indices = std::move(indices),
+        .bounding_box = AABB{bboxMin, bboxMax},
+      };
+      raw_mesh.timings.convert = convert_timer.get_elapsed_ms();
     }
 
-    glm::vec3 bboxMax{};
-    if (auto* dv = std::get_if<std::pmr::vector<double>>(&positionAccessor.max)) {
-      bboxMax = {(*dv)[0], (*dv)[1], (*dv)[2]};
+    const Timer optimize_timer = {};
+    if (import_settings.report)
+      raw_mesh.stats.source = analyze_geometry(raw_mesh);
+    if (import_settings.optimize) {
+      optimize_raw_mesh(raw_mesh);
+      if (import_settings.report)
+        raw_mesh.stats.optimized = analyze_geometry(raw_mesh);
     }
-    if (auto* iv = std::get_if<std::pmr::vector<int64_t>>(&positionAccessor.max)) {
-      bboxMax = {(*iv)[0], (*iv)[1], (*iv)[2]};
+
+    raw_mesh.stats.primitives = 1;
+    raw_mesh.stats.vertex_bytes_full = raw_mesh.vertices.size() * sizeof(Vertex);
+    raw_mesh.stats.vertex_bytes = raw_mesh.stats.vertex_bytes_full;
+    if (import_settings.quantize) {
+      auto error = VertexQuantizer::ErrorBounds{};
+      if (VertexQuantizer::quantize(raw_mesh.vertices, import_settings.quantization_bounds, raw_mesh.quantized_vertices, raw_mesh.quantization, error)) {
+        raw_mesh.stats.quantized_primitives = 1;
+        raw_mesh.stats.vertex_bytes = raw_mesh.quantized_vertices.size() * sizeof(QuantizedVertex);
+        raw_mesh.stats.quantization_error = error;
+      }
     }
+    raw_mesh.timings.optimize = optimize_timer.get_elapsed_ms();
 
-    return RawMesh{
-      .vertices = std::move(vertices),
-      .indices = std::move(indices),
-      .bounding_box = AABB{bboxMin, bboxMax},
-    };
+    OX_SCOPED_ZONE_N("Build meshlet hierarchy for mesh");
+    const Timer meshlets_timer = {};
+    raw_mesh_lods[mesh_index] = build_raw_mesh_lods(raw_mesh, lod_chain, import_settings);
+    raw_mesh.timings.meshlets = meshlets_timer.get_elapsed_ms();
+  };
+
+  auto* task_scheduler = App::get_system<TaskScheduler>();
+
+  TaskSet raw_meshes_task((uint32)raw_meshes.size(), [&](const TaskSetPartition range, uint32_t) {
+    for (uint32 i = range.start; i < range.end; i++)
+      process_raw_mesh(i);
   });
+  task_scheduler->schedule_task(&raw_meshes_task);
+
+  // overlaps with the geometry tasks, waiting on the image tasks lets this thread pick up geometry tasks too
+  std::vector<MeshCache::Image> cache_images = {};
+  auto images = load_images(asset, cache_key != 0 ? &cache_images : nullptr);
+
+  // materials stay on this thread, they take their ids from Material's counter and only set parameters
+  stage_timer = {};
+  _materials = load_materials(asset, images);
+  import_timings.materials = stage_timer.get_elapsed_ms();
+
+  task_scheduler->wait_task(&raw_meshes_task);
+
+  import_stats = {};
+  for (const auto& raw_mesh : raw_meshes) {
+    import_stats.source.merge(raw_mesh.stats.source);
+    import_stats.optimized.merge(raw_mesh.stats.optimized);
+    import_stats.primitives += raw_mesh.stats.primitives;
+    import_stats.quantized_primitives += raw_mesh.stats.quantized_primitives;
+    import_stats.vertex_bytes_full += raw_mesh.stats.vertex_bytes_full;
+    import_stats.vertex_bytes += raw_mesh.stats.vertex_bytes;
+    auto& error = import_stats.quantization_error;
+    error.position = std::max(error.position, raw_mesh.stats.quantization_error.position);
+    error.normal = std::max(error.normal, raw_mesh.stats.quantization_error.normal);
+    error.uv = std::max(error.uv, raw_mesh.stats.quantization_error.uv);
+
+    import_timings.convert += raw_mesh.timings.convert;
+    import_timings.optimize += raw_mesh.timings.optimize;
+    import_timings.meshlets += raw_mesh.timings.meshlets;
+  }
+  if (import_settings.quantize) {
+    const auto& stats = import_stats;
+    OX_LOG_INFO("Mesh {}: quantized {}/{} primitives, vertices {:.2f} KiB -> {:.2f} KiB ({:.1f}%), max error position {:.6f}, normal {:.3f} deg, uv {:.6f}",
+                fs::get_name_with_extension(file_path),
+                stats.quantized_primitives,
+                stats.primitives,
+                (float)stats.vertex_bytes_full / 1024.0f,
+                (float)stats.vertex_bytes / 1024.0f,
+                stats.vertex_bytes_full ? 100.0f * (float)stats.vertex_bytes / (float)stats.vertex_bytes_full : 100.0f,
+                stats.quantization_error.position,
+                stats.quantization_error.normal,
+                stats.quantization_error.uv);
+  }
+  if (import_settings.report) {
+    const auto& source = import_stats.source;
+    const auto& optimized = import_stats.optimized;
+    if (import_settings.optimize)
+      OX_LOG_INFO("Mesh {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}, overdraw {:.3f} -> {:.3f}, overfetch {:.3f} -> {:.3f}",
+                  fs::get_name_with_extension(file_path),
+                  source.get_acmr(),
+                  optimized.get_acmr(),
+                  source.get_atvr(),
+                  optimized.get_atvr(),
+                  source.get_overdraw(),
+                  optimized.get_overdraw(),
+                  source.get_overfetch(),
+                  optimized.get_overfetch());
+    else
+      OX_LOG_INFO("Mesh {}: ACMR {:.3f}, ATVR {:.3f}, overdraw {:.3f}, overfetch {:.3f}",
+                  fs::get_name_with_extension(file_path),
+                  source.get_acmr(),
+                  source.get_atvr(),
+                  source.get_overdraw(),
+                  source.get_overfetch());
+  }
+
+  stage_timer = {};
 
-  const auto baseVertexOffset = _vertices.size();
-  const auto baseIndexOffset = _indices.size();
-  const auto basePrimitiveOffset = _primitives.size();
+  // LODs past the end of a shorter chain reuse its last level
+  uint32 lod_count = 1;
+  for (const auto& lods : raw_mesh_lods)
+    lod_count = std::max(lod_count, (uint32)lods.chain.size() + 1);
+  const auto get_chain_level = [](const RawMeshLods& lods, const uint32 lod) { return std::min(lod, (uint32)lods.chain.size()); };
 
-  uint32_t vertex_offset = (uint32_t)baseVertexOffset;
-  uint32_t index_offset = (uint32_t)baseIndexOffset;
-  uint32_t primitive_offset = (uint32_t)basePrimitiveOffset;
+  _lods.assign(lod_count, {});
 
-  struct MeshletInfo {
-    const RawMesh* rawMeshPtr{};
-    std::span<const Vertex> vertices;
-    std::vector<uint32_t> meshlet_indices;
-    std::vector<uint8_t> meshlet_primitives;
-    std::vector<meshopt_Meshlet> raw_meshlets;
+  // where each mesh goes in the mega buffers, so every mesh can be copied by its own task
+  struct MeshOffsets {
+    uint32 meshlet = 0;
+    uint32 vertex = 0;
+    uint32 quantized_vertex = 0;
+    uint32 quantization = 0;
+    uint32 index = 0;
+    uint32 primitive = 0;
   };
+  std::vector<MeshOffsets> mesh_offsets(raw_meshes.size());
+
+  auto end_offsets = MeshOffsets{
+    .meshlet = (uint32)_meshlets.size(),
+    .vertex = (uint32)_vertices.size(),
+    .quantized_vertex = (uint32)_quantized_vertices.size(),
+    .quantization = (uint32)_vertex_quantizations.size(),
+    .index = (uint32)_indices.size(),
+    .primitive = (uint32)_primitives.size(),
+  };
+  for (size_t mesh_index = 0; mesh_index < raw_meshes.size(); mesh_index++) {
+    const auto& raw_mesh = raw_meshes[mesh_index];
+    const auto& lods = raw_mesh_lods[mesh_index];
+    mesh_offsets[mesh_index] = end_offsets;
+
+    // every level of the chain indexes the same vertices
+    const auto add_hierarchy = [&end_offsets](const MeshletHierarchy& hierarchy) {
+      end_offsets.meshlet += (uint32)hierarchy.clusters.size();
+      end_offsets.index += (uint32)hierarchy.meshlet_vertices.size();
+      end_offsets.primitive += (uint32)hierarchy.meshlet_triangles.size();
+    };
+    add_hierarchy(lods.hierarchy);
+    for (const auto& hierarchy : lods.chain)
+      add_hierarchy(hierarchy);
 
-  std::vector<MeshletInfo> meshlet_infos(raw_meshes.size());
-
-  std::transform(std::execution::par, raw_meshes.begin(), raw_meshes.end(), meshlet_infos.begin(), [](const RawMesh& mesh) -> MeshletInfo {
-    OX_SCOPED_ZONE_N("Create meshlets for mesh");
-
-    const auto max_meshlets = meshopt_buildMeshletsBound(mesh.indices.size(), MAX_MESHLET_INDICES, MAX_MESHLET_PRIMITIVES);
-
-    MeshletInfo meshletInfo;
-    auto& [raw_mesh_ptr, vertices, meshlet_indices, meshlet_primitives, raw_meshlets] = meshletInfo;
-
-    raw_mesh_ptr = &mesh;
-    vertices = mesh.vertices;
-    meshlet_indices.resize(max_meshlets * MAX_MESHLET_INDICES);
-    meshlet_primitives.resize(max_meshlets * MAX_MESHLET_PRIMITIVES * 3);
-    raw_meshlets.resize(max_meshlets);
-
-    const auto meshlet_count = [&] {
-      OX_SCOPED_ZONE_N("meshopt_buildMeshlets");
-      return meshopt_buildMeshlets(raw_meshlets.data(),
-                                   meshlet_indices.data(),
-                                   meshlet_primitives.data(),
-                                   mesh.indices.data(),
-                                   mesh.indices.size(),
-                                   reinterpret_cast<const float*>(mesh.vertices.data()),
-                                   mesh.vertices.size(),
-                                   sizeof(Vertex),
-                                   MAX_MESHLET_INDICES,
-                                   MAX_MESHLET_PRIMITIVES,
-                                   MESHLET_CONE_WEIGHT);
-    }();
+    if (!raw_mesh.quantized_vertices.empty()) {
+      end_offsets.quantized_vertex += (uint32)raw_mesh.quantized_vertices.size();
+      end_offsets.quantization++;
+    } else {
+      end_offsets.vertex += (uint32)raw_mesh.vertices.size();
+    }
 
-    const auto& last_meshlet = raw_meshlets[meshlet_count - 1];
-    meshlet_indices.resize(last_meshlet.vertex_offset + last_meshlet.vertex_count);
-    meshlet_primitives.resize(last_meshlet.triangle_offset + ((last_meshlet.triangle_count * 3 + 3) & ~3));
-    raw_meshlets.resize(meshlet_count);
+    _lods[0].triangle_count += lods.hierarchy.get_triangle_count(0);
+    for (uint32 lod = 1; lod < lod_count; lod++) {
+      const auto level = get_chain_level(lods, lod);
+      _lods[lod].error = std::max(_lods[lod].error, level == 0 ? 0.0f : lods.chain_errors[level - 1]);
+      _lods[lod].triangle_count += level == 0 ? lods.hierarchy.get_triangle_count(0) : lods.chain[level - 1].get_triangle_count(0);
+    }
+  }
 
-    return meshletInfo;
-  });
+  _meshlets.resize(end_offsets.meshlet);
+  _meshlet_lods.resize(end_offsets.meshlet);
+  _vertices.resize(end_offsets.vertex);
+  _quantized_vertices.resize(end_offsets.quantized_vertex);
+  _vertex_quantizations.resize(end_offsets.quantization);
+  _indices.resize(end_offsets.index);
+  _primitives.resize(end_offsets.primitive);
 
-  auto per_mesh_meshlets = std::vector<std::vector<uint32_t>>(meshlet_infos.size());
+  auto per_mesh_meshlets = std::vector<std::vector<uint32_t>>(raw_mesh_lods.size());
+  auto per_mesh_lod_meshlets = std::vector<std::vector<uint32_t>>(raw_mesh_lods.size());
+  auto per_mesh_chain_meshlets = std::vector<std::vector<std::vector<uint32_t>>>(raw_mesh_lods.size());
 
   // For each mesh, create "meshlet templates" (meshlets without per-instance data) and copy vertices, indices, and primitives to mega buffers
-  for (size_t mesh_index = 0; mesh_index < meshlet_infos.size(); mesh_index++) {
-    auto& [rawMesh, vert, meshlet_indices, meshlet_primitives, rawMeshlets] = meshlet_infos[mesh_index];
-    per_mesh_meshlets[mesh_index].reserve(rawMeshlets.size());
-
-    for (const auto& meshlet : rawMeshlets) {
-      auto min = glm::vec3(std::numeric_limits<float>::max());
-      auto max = glm::vec3(std::numeric_limits<float>::lowest());
-      for (uint32_t i = 0; i < meshlet.triangle_count * 3; ++i) {
-        const auto& vertex = rawMesh->vertices[meshlet_indices[meshlet.vertex_offset + meshlet_primitives[meshlet.triangle_offset + i]]];
-        min = glm::min(min, vertex.position);
-        max = glm::max(max, vertex.position);
+  const auto emit_raw_mesh = [&](const size_t mesh_index) {
+    OX_SCOPED_ZONE_N("Emit meshlets for mesh");
+    const auto& raw_mesh = raw_meshes[mesh_index];
+    const auto& lods = raw_mesh_lods[mesh_index];
+    auto offsets = mesh_offsets[mesh_index];
+    per_mesh_meshlets[mesh_index].reserve(lods.hierarchy.levels.empty() ? 0 : lods.hierarchy.levels.front().cluster_count);
+
+    const bool quantized = !raw_mesh.quantized_vertices.empty();
+    const auto vertex_quantization = quantized ? offsets.quantization : ~0u;
+    if (quantized)
+      _vertex_quantizations[offsets.quantization] = raw_mesh.quantization;
+
+    const auto add_clusters = [&](const MeshletHierarchy& hierarchy, std::vector<uint32_t>* chain_meshlets) {
+      for (const auto& cluster : hierarchy.clusters) {
+        auto min = glm::vec3(std::numeric_limits<float>::max());
+        auto max = glm::vec3(std::numeric_limits<float>::lowest());
+        for (uint32_t i = 0; i < cluster.triangle_count * 3; ++i) {
+          const auto local_vertex = hierarchy.meshlet_triangles[cluster.triangle_offset + i];
+          const auto vertex = hierarchy.meshlet_vertices[cluster.vertex_offset + local_vertex];
+          // bounds of what the gpu decodes, quantized positions can be off by half a step
+          const auto position = quantized ? VertexQuantizer::decode(raw_mesh.quantized_vertices[vertex], raw_mesh.quantization).position
+                                          : raw_mesh.vertices[vertex].position;
+          min = glm::min(min, position);
+          max = glm::max(max, position);
+        }
+
+        auto meshlet_id = offsets.meshlet++;
+        // level 0 is the full detail mesh, everything above it is only drawn through the LOD cut
+        auto& meshlets = chain_meshlets ? *chain_meshlets : (cluster.level == 0 ? per_mesh_meshlets : per_mesh_lod_meshlets)[mesh_index];
+        meshlets.emplace_back(meshlet_id);
+
+        const auto& culling = cluster.culling;
+        _meshlets[meshlet_id] = Mesh::Meshlet{
+          .vertex_offset = quantized ? offsets.quantized_vertex : offsets.vertex,
+          .index_offset = offsets.index + cluster.vertex_offset,
+          .primitive_offset = offsets.primitive + cluster.triangle_offset,
+          .index_count = cluster.vertex_count,
+          .primitive_count = cluster.triangle_count,
+          .aabbMin = {min.x, min.y, min.z},
+          .aabbMax = {max.x, max.y, max.z},
+          .center = {culling.center.x, culling.center.y, culling.center.z},
+          .radius = culling.radius,
+          .cone_apex = {culling.apex.x, culling.apex.y, culling.apex.z},
+          .cone_axis = {culling.axis.x, culling.axis.y, culling.axis.z},
+          .cone_cutoff = culling.cutoff,
+          .vertex_quantization = vertex_quantization,
+        };
+        _meshlet_lods[meshlet_id] = cluster.lod;
       }
 
-      auto meshlet_id = _meshlets.size();
-      per_mesh_meshlets[mesh_index].emplace_back((uint32_t)meshlet_id);
-
-      _meshlets.emplace_back(Mesh::Meshlet{
-        .vertex_offset = vertex_offset,
-        .index_offset = index_offset + meshlet.vertex_offset,
-        .primitive_offset = primitive_offset + meshlet.triangle_offset,
-        .index_count = meshlet.vertex_count,
-        .primitive_count = meshlet.triangle_count,
-        .aabbMin = {min.x, min.y, min.z},
-        .aabbMax = {max.x, max.y, max.z},
-      });
-    }
+      std::ranges::copy(hierarchy.meshlet_vertices, _indices.begin() + offsets.index);
+      std::ranges::copy(hierarchy.meshlet_triangles, _primitives.begin() + offsets.primitive);
 
-    vertex_offset += (uint32_t)vert.size();
-    index_offset += (uint32_t)meshlet_indices.size();
-    primitive_offset += (uint32_t)meshlet_primitives.size();
+      offsets.index += (uint32_t)hierarchy.meshlet_vertices.size();
+      offsets.primitive += (uint32_t)hierarchy.meshlet_triangles.size();
+    };
 
-    std::ranges::copy(vert, std::back_inserter(_vertices));
-    std::ranges::copy(meshlet_indices, std::back_inserter(_indices));
-    std::ranges::copy(meshlet_primitives, std::back_inserter(_primitives));
-  }
+    add_clusters(lods.hierarchy, nullptr);
+    per_mesh_chain_meshlets[mesh_index].resize(lods.chain.size());
+    for (size_t level = 0; level < lods.chain.size(); level++)
+      add_clusters(lods.chain[level], &per_mesh_chain_meshlets[mesh_index][level]);
 
-  for (size_t i = 0; auto& node : nodes) {
-    if (!node.parent)
-      root_nodes.emplace_back(&node);
+    if (quantized)
+      std::ranges::copy(raw_mesh.quantized_vertices, _quantized_vertices.begin() + offsets.quantized_vertex);
+    else
+      std::ranges::copy(raw_mesh.vertices, _vertices.begin() + offsets.vertex);
+  };
+
+  TaskSet emit_task((uint32)raw_meshes.size(), [&](const TaskSetPartition range, uint32_t) {
+    for (uint32 i = range.start; i < range.end; i++)
+      emit_raw_mesh(i);
+  });
+  task_scheduler->schedule_task(&emit_task);
+  task_scheduler->wait_task(&emit_task);
+  import_timings.emit = stage_timer.get_elapsed_ms();
 
-    for (const auto& [rawMeshIndex, materialId] : temp_data[i++].indices) {
+  stage_timer = {};
+
+  const auto assemble_node = [&](const size_t node_index) {
+    auto& node = nodes[node_index];
+
+    // local bounds of the node, used for instance level culling on the cpu
+    node.aabb = AABB(float3(std::numeric_limits<float>::max()), float3(std::numeric_limits<float>::lowest()));
+
+    const auto& node_indices = temp_data[node_index].indices;
+    for (const auto& [rawMeshIndex, materialId] : node_indices) {
       for (auto meshlet_index : per_mesh_meshlets[rawMeshIndex]) {
         // Instance index is determined each frame
         node.meshlet_indices.emplace_back(meshlet_index, 0, (uint32_t)materialId);
+
+        const auto& meshlet = _meshlets[meshlet_index];
+        node.aabb.merge(AABB(float3(meshlet.aabbMin[0], meshlet.aabbMin[1], meshlet.aabbMin[2]),
+                             float3(meshlet.aabbMax[0], meshlet.aabbMax[1], meshlet.aabbMax[2])));
       }
+
+      for (auto meshlet_index : per_mesh_lod_meshlets[rawMeshIndex])
+        node.lod_meshlet_indices.emplace_back(meshlet_index, 0, (uint32_t)materialId);
     }
+    node.build_lod_levels(_meshlet_lods);
+
+    if (lod_count > 1 && !node_indices.empty()) {
+      node.lod_chain_offsets.emplace_back(0u);
+      for (uint32 lod = 1; lod < lod_count; lod++) {
+        for (const auto& [rawMeshIndex, materialId] : node_indices) {
+          const auto level = get_chain_level(raw_mesh_lods[rawMeshIndex], lod);
+          const auto& meshlets = level == 0 ? per_mesh_meshlets[rawMeshIndex] : per_mesh_chain_meshlets[rawMeshIndex][level - 1];
+          for (auto meshlet_index : meshlets)
+            node.lod_chain_meshlet_indices.emplace_back(meshlet_index, 0, (uint32_t)materialId);
+        }
+        node.lod_chain_offsets.emplace_back((uint32)node.lod_chain_meshlet_indices.size());
+      }
+    }
+  };
+
+  TaskSet nodes_task((uint32)nodes.size(), [&](const TaskSetPartition range, uint32_t) {
+    for (uint32 i = range.start; i < range.end; i++)
+      assemble_node(i);
+  });
+  task_scheduler->schedule_task(&nodes_task);
+  task_scheduler->wait_task(&nodes_task);
+
+  for (auto& node : nodes) {
+    if (!node.parent)
+      root_nodes.emplace_back(&node);
   }
 
   if (root_nodes.empty()) {
@@ -478,9 +1024,11 @@ void Mesh::load_from_file(const std::string& file_path, glm::mat4 rootTransform)
   }
 
   set_transforms();
+  node_traversal_ms += stage_timer.get_elapsed_ms();
+  import_timings.nodes = node_traversal_ms;
 
   index_count = (uint32)_indices.size();
-  vertex_count = (uint32)_vertices.size();
+  vertex_count = (uint32)(_vertices.size() + _quantized_vertices.size());
 
 // create buffers
 #if 0
@@ -504,6 +1052,32 @@ void Mesh::load_from_file(const std::string& file_path, glm::mat4 rootTransform)
   index_buffer = std::move(iBuffer);
 #endif
   OX_LOG_INFO("Loaded mesh {0}:{1}", fs::get_name_with_extension(file_path), timer.get_elapsed_ms());
+
+  stage_timer = {};
+  if (cache_key != 0 && !MeshCache::write(file_path, cache_key, *this, cache_images, images))
+    OX_LOG_WARN("MeshCache: Couldn't write the cache entry for {}", file_path);
+  import_timings.cache_write = stage_timer.get_elapsed_ms();
+  import_timings.total = timer.get_elapsed_ms();
+
+  if (import_settings.report) {
+    const auto& t = import_timings;
+    OX_LOG_INFO("Mesh {}: parse {:.2f} ms, buffers {:.2f} ms, images {:.2f} ms decode + {:.2f} ms upload (summed), "
+                "materials {:.2f} ms, convert {:.2f} ms, optimize {:.2f} ms, meshlets {:.2f} ms (summed), emit {:.2f} ms, "
+                "nodes {:.2f} ms, cache {:.2f} ms, total {:.2f} ms",
+                fs::get_name_with_extension(file_path),
+                t.parse,
+                t.decode_buffers,
+                t.decode_images,
+                t.upload_images,
+                t.materials,
+                t.convert,
+                t.optimize,
+                t.meshlets,
+                t.emit,
+                t.nodes,
+                t.cache_write,
+                t.total);
+  }
 }
 
 const Mesh* Mesh::bind_vertex_buffer(vuk::CommandBuffer& command_buffer) const {
@@ -518,7 +1092,7 @@ const Mesh* Mesh::bind_index_buffer(vuk::CommandBuffer& command_buffer) const {
   return this;
 }
 
-std::vector<Shared<Texture>> Mesh::load_images(const fastgltf::Asset& asset) {
+std::vector<Shared<Texture>> Mesh::load_images(const fastgltf::Asset& asset, std::vector<MeshCache::Image>* cache_images) {
   struct RawImageData {
     // Used for ktx and non-ktx images alike
     std::unique_ptr<std::byte[]> encoded_pixel_data = {};
@@ -535,6 +1109,10 @@ std::vector<Shared<Texture>> Mesh::load_images(const fastgltf::Asset& asset) {
 
     // ktx
     std::unique_ptr<ktxTexture2, decltype([](ktxTexture2* p) { ktxTexture_Destroy(ktxTexture(p)); })> ktx = {};
+
+    // what gets uploaded, points into `data` or `ktx`
+    uint8* pixels = nullptr;
+    size_t pixels_size = 0;
   };
 
   auto make_raw_image_data = [](const void* data, std::size_t data_size, fastgltf::MimeType mime_type, std::string_view name) -> RawImageData {
@@ -549,13 +1127,16 @@ std::vector<Shared<Texture>> Mesh::load_images(const fastgltf::Asset& asset) {
     };
   };
 
-  const auto indices = std::ranges::iota_view((size_t)0, asset.images.size());
-
-  // Load and decode image data locally, in parallel
+  // Load and decode image data locally, one task per image
   auto raw_image_datas = std::vector<RawImageData>(asset.images.size());
+  auto decode_ms = std::vector<float>(asset.images.size());
+
+  if (cache_images)
+    cache_images->resize(raw_image_datas.size());
 
-  std::transform(std::execution::par, indices.begin(), indices.end(), raw_image_datas.begin(), [&](size_t index) {
+  const auto decode_image = [&](size_t index) {
     OX_SCOPED_ZONE_N("Load Image");
+    const Timer timer = {};
     const fastgltf::Image& image = asset.images[index];
     OX_ZONE_NAME(image.name.c_str(), image.name.size());
 
@@ -629,30 +1210,82 @@ std::vector<Shared<Texture>> Mesh::load_images(const fastgltf::Asset& asset) {
       rawImage.data.reset(pixels);
     }
 
-    return rawImage;
-  });
+    // first mip level of the transcoded ktx texture or the decoded rgba8 pixels
+    auto* ktx = rawImage.ktx.get();
+    rawImage.pixels = rawImage.data.get();
+    rawImage.pixels_size = (size_t)rawImage.width1 * rawImage.height * 4;
+    if (rawImage.is_ktx) {
+      ktx_size_t level_offset = 0;
+      ktxTexture_GetImageOffset(ktxTexture(ktx), 0, 0, 0, &level_offset);
+      rawImage.pixels = ktxTexture_GetData(ktxTexture(ktx)) + level_offset;
+      rawImage.pixels_size = ktxTexture_GetImageSize(ktxTexture(ktx), 0);
+    }
 
-  // Upload image data to GPU
-  std::vector<Shared<Texture>> loaded_images = {};
-  loaded_images.reserve(raw_image_datas.size());
+    // the copy for the cache is made here so the upload loop below only does what has to happen in order
+    if (cache_images)
+      (*cache_images)[index] = MeshCache::Image{
+        .name = rawImage.name,
+        .extent = {static_cast<uint32>(rawImage.width1), static_cast<uint32>(rawImage.height), 1u},
+        .format = rawImage.is_ktx ? rawImage.format_ktx : vuk::Format::eR8G8B8A8Unorm,
+        .data = std::vector<uint8>(rawImage.pixels, rawImage.pixels + rawImage.pixels_size),
+      };
+
+    raw_image_datas[index] = std::move(rawImage);
+    decode_ms[index] = timer.get_elapsed_ms();
+  };
 
-  for (const auto& image : raw_image_datas) {
+  TaskSet decode_task((uint32)raw_image_datas.size(), [&](const TaskSetPartition range, uint32_t) {
+    for (uint32 i = range.start; i < range.end; i++)
+      decode_image(i);
+  });
+  auto* task_scheduler = App::get_system<TaskScheduler>();
+  task_scheduler->schedule_task(&decode_task);
+  task_scheduler->wait_task(&decode_task);
+
+  for (const auto ms : decode_ms)
+    import_timings.decode_images += ms;
+
+  // Upload image data to GPU, one task per image as well
+  std::vector<Shared<Texture>> loaded_images(raw_image_datas.size());
+  std::vector<AssetHandle<Texture>> texture_handles(raw_image_datas.size());
+  auto upload_ms = std::vector<float>(raw_image_datas.size());
+
+  const auto upload_image = [&](size_t index) {
+    OX_SCOPED_ZONE_N("Upload Image");
+    const Timer timer = {};
+    const auto& image = raw_image_datas[index];
     const vuk::Extent3D dims = {static_cast<uint32>(image.width1), static_cast<uint32>(image.height), 1u};
 
-    const auto* ktx = image.ktx.get();
-
     auto ci = TextureLoadInfo{
       .path = {},
       .preset = Preset::eMap2D,
       .extent = dims,
-      .format = vuk::Format::eR8G8B8A8Unorm,
-      .data = image.is_ktx ? ktx->kvData : image.data.get(),
+      .format = image.is_ktx ? image.format_ktx : vuk::Format::eR8G8B8A8Unorm,
+      .data = image.pixels,
       .mime = image.is_ktx ? TextureLoadInfo::MimeType::KTX : TextureLoadInfo::MimeType::Generic,
     };
 
-    const auto& t = loaded_images.emplace_back(AssetManager::get_texture_asset(image.name, ci));
-    t->set_name(image.name);
-  }
+    texture_handles[index] = AssetManager::acquire_texture_asset(image.name, ci);
+    if (auto texture = AssetManager::get(texture_handles[index])) {
+      texture->set_name(image.name);
+      loaded_images[index] = std::move(texture);
+    } else {
+      OX_LOG_ERROR("Couldn't create texture {}, using a white texture instead", image.name);
+      loaded_images[index] = Texture::get_white_texture();
+    }
+    upload_ms[index] = timer.get_elapsed_ms();
+  };
+
+  TaskSet upload_task((uint32)raw_image_datas.size(), [&](const TaskSetPartition range, uint32_t) {
+    for (uint32 i = range.start; i < range.end; i++)
+      upload_image(i);
+  });
+  task_scheduler->schedule_task(&upload_task);
+  task_scheduler->wait_task(&upload_task);
+
+  for (const auto ms : upload_ms)
+    import_timings.upload_images += ms;
+  _texture_handles.insert(_texture_handles.end(), texture_handles.begin(), texture_handles.end());
 
   return loaded_images;
 }
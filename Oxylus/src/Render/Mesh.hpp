@@ -2,15 +2,20 @@
 
 #include <glm/detail/type_quat.hpp>
 #include <glm/glm.hpp>
+#include <span>
 #include <string>
 #include <vector>
 
+#include "Assets/AssetManager.hpp"
 #include "Assets/PBRMaterial.hpp"
 
 #include <vuk/Buffer.hpp>
 
 #include "BoundingVolume.hpp"
+#include "MeshCache.hpp"
+#include "MeshletHierarchy.hpp"
 #include "MeshVertex.hpp"
+#include "VertexQuantizer.hpp"
 
 #include "Core/Types.hpp"
 
@@ -20,6 +25,8 @@ class Asset;
 namespace ox {
 class Mesh : public Asset {
 public:
+  static constexpr uint32 MAX_LODS = 8; // including the full detail LOD 0
+
   struct Meshlet {
     uint32_t vertex_offset = 0;
     uint32_t index_offset = 0;
@@ -28,6 +35,15 @@ public:
     uint32_t primitive_count = 0;
     float aabbMin[3];
     float aabbMax[3];
+    float center[3]; // bounding sphere
+    float radius = 0.0f;
+    float cone_apex[3];
+    float cone_axis[3];
+    float cone_cutoff = 1.0f; // every triangle faces away when dot(normalize(cone_apex - camera), cone_axis) >= cone_cutoff
+    // index into `_vertex_quantizations`, `vertex_offset` points into `_quantized_vertices` then instead of `_vertices`
+    uint32_t vertex_quantization = ~0u;
+
+    bool is_quantized() const { return vertex_quantization != ~0u; }
   };
 
   struct MeshletInstance {
@@ -51,17 +67,103 @@ public:
     Node* parent = nullptr;
     std::vector<Node*> children = {};
     std::vector<MeshletInstance> meshlet_indices;
+    // simplified clusters of the meshlet hierarchy, a cut through them and `meshlet_indices` is drawn when LODs are used
+    std::vector<MeshletInstance> lod_meshlet_indices;
+    // runs of one hierarchy level over `meshlet_indices` followed by `lod_meshlet_indices`, empty without a hierarchy
+    std::vector<MeshletHierarchy::LevelBounds> lod_levels;
+    // meshlets of the discrete LOD chain, LOD `i` (>= 1) is [lod_chain_offsets[i - 1], lod_chain_offsets[i]) of `lod_chain_meshlet_indices`
+    std::vector<MeshletInstance> lod_chain_meshlet_indices;
+    std::vector<uint32> lod_chain_offsets;
+
+    /// @return Meshlet `i` of `meshlet_indices` followed by `lod_meshlet_indices`, what `lod_levels` index into.
+    const MeshletInstance& get_cut_meshlet(const uint32 i) const {
+      return i < meshlet_indices.size() ? meshlet_indices[i] : lod_meshlet_indices[i - meshlet_indices.size()];
+    }
+    void build_lod_levels(std::span<const MeshletHierarchy::ClusterLod> meshlet_lods);
+
+    /// @return Meshlets drawn for `lod`, full detail meshlets if the chain doesn't have it.
+    std::span<const MeshletInstance> get_lod_meshlets(const uint32 lod) const {
+      if (lod == 0 || lod >= lod_chain_offsets.size())
+        return meshlet_indices;
+      return std::span(lod_chain_meshlet_indices).subspan(lod_chain_offsets[lod - 1], lod_chain_offsets[lod] - lod_chain_offsets[lod - 1]);
+    }
 
     Mat4 get_local_transform() const { return translate(Mat4(1.0f), translation) * Mat4(rotation) * glm::scale(Mat4(1.0f), scale); }
   };
 
+  // one level of the discrete LOD chain
+  struct Lod {
+    float error = 0.0f;        // simplification error in mesh space, largest of all primitives
+    uint32 triangle_count = 0; // of all primitives
+  };
+
+  // Locality of the imported geometry as measured by meshoptimizer's analyzers, summed over all primitives.
+  struct GeometryStats {
+    uint64 triangles = 0;
+    uint64 vertices = 0;
+    uint64 vertices_transformed = 0; // by a simulated 16 entry post-transform cache
+    uint64 bytes_fetched = 0;        // by a simulated vertex fetch cache
+    uint64 pixels_covered = 0;       // when rasterized from the axis directions
+    uint64 pixels_shaded = 0;
+
+    float get_acmr() const { return triangles ? (float)vertices_transformed / (float)triangles : 0.0f; }
+    float get_atvr() const { return vertices ? (float)vertices_transformed / (float)vertices : 0.0f; }
+    float get_overdraw() const { return pixels_covered ? (float)pixels_shaded / (float)pixels_covered : 0.0f; }
+    float get_overfetch() const { return vertices ? (float)bytes_fetched / (float)(vertices * sizeof(Vertex)) : 0.0f; }
+
+    void merge(const GeometryStats& other) {
+      triangles += other.triangles;
+      vertices += other.vertices;
+      vertices_transformed += other.vertices_transformed;
+      bytes_fetched += other.bytes_fetched;
+      pixels_covered += other.pixels_covered;
+      pixels_shaded += other.pixels_shaded;
+    }
+  };
+
+  struct ImportStats {
+    GeometryStats source = {};    // as it's stored in the file
+    GeometryStats optimized = {}; // after the import reordered it, empty if it wasn't
+
+    uint32 primitives = 0;
+    uint32 quantized_primitives = 0;
+    uint64 vertex_bytes_full = 0; // all vertices in the full precision layout
+    uint64 vertex_bytes = 0;      // as they're stored, smaller than `vertex_bytes_full` when primitives got quantized
+    VertexQuantizer::ErrorBounds quantization_error = {}; // largest measured error of the quantized primitives
+  };
+
+  // Time spent in each stage of the last import in ms, not cached. Stages marked as summed run as one task per primitive or image,
+  //	they add up the time of all of their tasks and can be larger than `total` when they ran on several threads.
+  struct ImportTimings {
+    float cache_read = 0.0f; // only set when the mesh came from the cache
+    float parse = 0.0f;
+    float decode_buffers = 0.0f; // EXT_meshopt_compression buffer views
+    float decode_images = 0.0f;  // summed
+    float upload_images = 0.0f;  // summed
+    float materials = 0.0f;
+    float convert = 0.0f;  // vertex and index conversion, summed
+    float optimize = 0.0f; // reordering, analysis and quantization, summed
+    float meshlets = 0.0f; // meshlet hierarchies and LOD chains, summed
+    float emit = 0.0f;     // meshlets, indices and vertices copied into the mesh buffers
+    float nodes = 0.0f;    // node hierarchy and per node meshlet lists
+    float cache_write = 0.0f;
+    float total = 0.0f;
+  };
+
   std::vector<Node*> root_nodes;
   std::vector<Node> nodes;
   std::vector<Meshlet> _meshlets;
+  std::vector<MeshletHierarchy::ClusterLod> _meshlet_lods; // parallel to `_meshlets`
   std::vector<Vertex> _vertices;
+  std::vector<QuantizedVertex> _quantized_vertices;
+  std::vector<VertexQuantization> _vertex_quantizations;
   std::vector<uint32> _indices;
   std::vector<uint8_t> _primitives;
   std::vector<Shared<PBRMaterial>> _materials;
+  std::vector<AssetHandle<Texture>> _texture_handles; // the mesh's references to the textures of its materials
+  std::vector<Lod> _lods; // LOD 0 is the source mesh, the rest is only there when a LOD chain was generated at import
+  ImportStats import_stats = {};
+  ImportTimings import_timings = {};
 
   uint32 index_count = 0;
   uint32 vertex_count = 0;
@@ -69,7 +171,7 @@ public:
   vuk::Unique<vuk::Buffer> index_buffer;
 
   Mesh() = default;
-  ~Mesh() = default;
+  ~Mesh();
   Mesh(std::string_view path);
   Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
 
@@ -77,11 +179,26 @@ public:
 
   void set_transforms() const;
 
+  uint32 get_lod_count() const { return std::max((uint32)_lods.size(), 1u); }
+  /// Picks the coarsest LOD whose error is below `view.error_threshold` pixels for a world space bounding sphere.
+  /// Leaves `current_lod` only once the error is `hysteresis` (relative) past the threshold, so LODs don't flicker at the boundary.
+  uint32 select_lod(uint32 current_lod,
+                    const float3& center,
+                    float radius,
+                    float transform_scale,
+                    const MeshletHierarchy::LodView& view,
+                    float hysteresis) const;
+
+  /// @return Position of `vertex`, relative to the `vertex_offset` of `meshlet`, decoded when the meshlet is quantized.
+  float3 get_vertex_position(const Meshlet& meshlet, uint32 vertex) const;
+
   const Mesh* bind_vertex_buffer(vuk::CommandBuffer& command_buffer) const;
   const Mesh* bind_index_buffer(vuk::CommandBuffer& command_buffer) const;
 
 private:
-  [[nodiscard]] std::vector<Shared<Texture>> load_images(const fastgltf::Asset& asset);
+  /// Decodes and uploads the images on the TaskScheduler, one task per image for each.
+  /// `cache_images` receives a copy of the decoded images when it's set.
+  [[nodiscard]] std::vector<Shared<Texture>> load_images(const fastgltf::Asset& asset, std::vector<MeshCache::Image>* cache_images = nullptr);
   [[nodiscard]] std::vector<Shared<PBRMaterial>> load_materials(const fastgltf::Asset& asset, const std::vector<Shared<Texture>>& images);
 };
 } // namespace ox
@@ -0,0 +1,741 @@
+#include "MeshCache.hpp"
+
+#include <ankerl/unordered_dense.h>
+#include <cstring>
+#include <fastgltf/core.hpp>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <type_traits>
+
+#include "Assets/AssetManager.hpp"
+#include "Assets/PBRMaterial.hpp"
+#include "Assets/Texture.hpp"
+#include "Core/App.hpp"
+#include "Core/FileSystem.hpp"
+#include "Core/Project.hpp"
+#include "Mesh.hpp"
+#include "MeshCodec.hpp"
+#include "RendererConfig.hpp"
+#include "Thread/TaskScheduler.hpp"
+#include "Utils/Log.hpp"
+#include "Utils/Profiler.hpp"
+
+namespace ox {
+namespace {
+constexpr uint32 CACHE_MAGIC = 0x434d584f; // OXMC
+constexpr uint64 SECTION_ALIGNMENT = 16;
+constexpr uint32 INVALID_INDEX = ~0u;
+constexpr uint32 NOT_ENCODED = ~0u;
+
+enum Section : uint32 {
+  Vertices = 0,
+  Indices,
+  Primitives,
+  Meshlets,
+  MeshletLods,
+  Nodes,
+  NodeChildren,
+  MeshletInstances,
+  Materials,
+  Images,
+  ImageData,
+  Dependencies,
+  Lods,
+  LodChainOffsets,
+  ImportStats,
+  QuantizedVertices,
+  VertexQuantizations,
+  Strings,
+
+  SectionCount
+};
+
+struct SectionRange {
+  uint64 offset = 0; // bytes from the start of the file
+  uint64 size = 0;
+  // MeshCodec::Mode of sections written with `write_encoded_section`, they start with `chunk_count` ChunkRecords then
+  uint32 encoding = NOT_ENCODED;
+  uint32 chunk_count = 0;
+  uint64 decoded_size = 0;
+};
+
+struct ChunkRecord {
+  uint64 offset = 0; // from the start of the section
+  uint32 size = 0;
+  uint32 count = 0; // elements
+};
+
+struct CacheFileHeader {
+  uint32 magic = CACHE_MAGIC;
+  uint32 version = MeshCache::CACHE_VERSION;
+  uint64 key = 0;
+  uint64 file_size = 0;
+  SectionRange sections[SectionCount] = {};
+};
+
+struct StringRange {
+  uint32 offset = 0; // into the Strings section
+  uint32 size = 0;
+};
+
+struct NodeRecord {
+  StringRange name = {};
+  float3 translation = {};
+  Quat rotation = {};
+  float3 scale = {};
+  float3 aabb_min = {};
+  float3 aabb_max = {};
+  uint32 parent = INVALID_INDEX;
+  uint32 first_child = 0; // into NodeChildren
+  uint32 child_count = 0;
+  uint32 first_meshlet_instance = 0; // into MeshletInstances
+  uint32 meshlet_instance_count = 0;
+  uint32 first_lod_meshlet_instance = 0; // into MeshletInstances
+  uint32 lod_meshlet_instance_count = 0;
+  uint32 first_lod_chain_meshlet_instance = 0; // into MeshletInstances
+  uint32 lod_chain_meshlet_instance_count = 0;
+  uint32 first_lod_chain_offset = 0; // into LodChainOffsets
+  uint32 lod_chain_offset_count = 0;
+};
+
+struct MaterialRecord {
+  StringRange name = {};
+  PBRMaterial::Parameters parameters = {}; // texture ids are reassigned on load
+  uint32 albedo_image = INVALID_INDEX;
+  uint32 normal_image = INVALID_INDEX;
+  uint32 physical_image = INVALID_INDEX;
+  uint32 ao_image = INVALID_INDEX;
+  uint32 emissive_image = INVALID_INDEX;
+};
+
+struct ImageRecord {
+  StringRange name = {};
+  uint32 width = 0;
+  uint32 height = 0;
+  uint32 format = 0;
+  uint64 data_offset = 0; // into ImageData
+  uint64 data_size = 0;
+};
+
+struct DependencyRecord {
+  StringRange path = {}; // relative to the source directory
+  uint64 hash = 0;
+};
+
+static_assert(std::is_trivially_copyable_v<Vertex>);
+static_assert(std::is_trivially_copyable_v<QuantizedVertex>);
+static_assert(std::is_trivially_copyable_v<VertexQuantization>);
+static_assert(std::is_trivially_copyable_v<Mesh::Meshlet>);
+static_assert(std::is_trivially_copyable_v<Mesh::MeshletInstance>);
+static_assert(std::is_trivially_copyable_v<MeshletHierarchy::ClusterLod>);
+static_assert(std::is_trivially_copyable_v<PBRMaterial::Parameters>);
+static_assert(std::is_trivially_copyable_v<Mesh::Lod>);
+static_assert(std::is_trivially_copyable_v<Mesh::ImportStats>);
+
+uint64 hash_combine(const uint64 seed, const uint64 value) { return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2)); }
+
+uint64 hash_bytes(const void* data, const size_t size) { return ankerl::unordered_dense::detail::wyhash::hash(data, size); }
+
+/// @return 0 if the file couldn't be read
+uint64 hash_file(const std::string& path) {
+  const fs::MappedFile file(path);
+  if (!file.is_open())
+    return 0;
+  const uint64 hash = hash_bytes(file.data(), file.size());
+  return hash == 0 ? 1 : hash;
+}
+
+std::string get_entry_path(const std::string& directory, const uint64 key) { return fmt::format("{}/{:016x}.oxmesh", directory, key); }
+
+// Local files the source pulls in, the cache entry is only valid as long as none of them changed.
+std::vector<std::string> get_dependencies(const std::string& path) {
+  OX_SCOPED_ZONE;
+
+  auto data = fastgltf::GltfDataBuffer::FromPath(path);
+  if (data.error() != fastgltf::Error::None)
+    return {};
+
+  auto parser = fastgltf::Parser(fastgltf::Extensions::KHR_texture_basisu | fastgltf::Extensions::KHR_mesh_quantization |
+                                 fastgltf::Extensions::EXT_meshopt_compression | fastgltf::Extensions::KHR_lights_punctual |
+                                 fastgltf::Extensions::KHR_materials_emissive_strength);
+  auto asset = parser.loadGltf(data.get(),
+                               fs::get_directory(path),
+                               fastgltf::Options::None,
+                               fastgltf::Category::Buffers | fastgltf::Category::Images);
+  if (asset.error() != fastgltf::Error::None)
+    return {};
+
+  std::vector<std::string> dependencies = {};
+  const auto add_uri = [&dependencies](const fastgltf::sources::URI& uri) {
+    if (uri.uri.isLocalPath())
+      dependencies.emplace_back(uri.uri.path());
+  };
+
+  for (const auto& buffer : asset->buffers) {
+    if (const auto* uri = std::get_if<fastgltf::sources::URI>(&buffer.data))
+      add_uri(*uri);
+  }
+  for (const auto& image : asset->images) {
+    if (const auto* uri = std::get_if<fastgltf::sources::URI>(&image.data))
+      add_uri(*uri);
+  }
+
+  return dependencies;
+}
+
+class CacheWriter {
+public:
+  CacheWriter() { blob.resize(sizeof(CacheFileHeader)); }
+
+  template <typename T>
+  void write_section(const Section section, const std::span<const T> values) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    blob.resize((blob.size() + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1));
+    header.sections[section] = {.offset = blob.size(), .size = values.size_bytes()};
+    const auto* bytes = (const uint8*)values.data();
+    blob.insert(blob.end(), bytes, bytes + values.size_bytes());
+  }
+
+  // Writes `values` as MeshCodec chunks, or as they are if that isn't any smaller or doesn't decode to the exact same bytes.
+  template <typename T>
+  void write_encoded_section(const Section section, const std::span<const T> values, const MeshCodec::Mode mode) {
+    const auto chunks = MeshCodec::encode(values.data(), (uint32)values.size(), sizeof(T), mode);
+    uint64 size = chunks.size() * sizeof(ChunkRecord);
+    for (const auto& chunk : chunks)
+      size += chunk.data.size();
+    if (chunks.empty() || size >= values.size_bytes() || !decodes_to(chunks, values, mode)) {
+      write_section(section, values);
+      return;
+    }
+
+    blob.resize((blob.size() + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1));
+    header.sections[section] = {
+      .offset = blob.size(),
+      .size = size,
+      .encoding = (uint32)mode,
+      .chunk_count = (uint32)chunks.size(),
+      .decoded_size = values.size_bytes(),
+    };
+
+    std::vector<ChunkRecord> records = {};
+    for (uint64 offset = chunks.size() * sizeof(ChunkRecord); const auto& chunk : chunks) {
+      records.emplace_back(ChunkRecord{.offset = offset, .size = (uint32)chunk.data.size(), .count = chunk.count});
+      offset += chunk.data.size();
+    }
+    const auto* record_bytes = (const uint8*)records.data();
+    blob.insert(blob.end(), record_bytes, record_bytes + records.size() * sizeof(ChunkRecord));
+    for (const auto& chunk : chunks)
+      blob.insert(blob.end(), chunk.data.begin(), chunk.data.end());
+  }
+
+  // round trip of every encoded section, a codec that isn't lossless for the data would corrupt the cache silently
+  template <typename T>
+  static bool decodes_to(const std::vector<MeshCodec::Chunk>& chunks, const std::span<const T> values, const MeshCodec::Mode mode) {
+    std::vector<T> decoded(values.size());
+    uint64 first = 0;
+    for (const auto& chunk : chunks) {
+      const auto stream = MeshCodec::Stream{
+        .encoded = chunk.data,
+        .decoded = decoded.data() + first,
+        .count = chunk.count,
+        .stride = sizeof(T),
+        .mode = mode,
+      };
+      if (first + chunk.count > decoded.size() || !MeshCodec::decode(stream))
+        return false;
+      first += chunk.count;
+    }
+
+    if (first != values.size() || std::memcmp(decoded.data(), values.data(), values.size_bytes()) != 0) {
+      OX_LOG_ERROR("MeshCache: section didn't survive an encode/decode round trip, it's stored unencoded");
+      return false;
+    }
+    return true;
+  }
+
+  StringRange add_string(const std::string_view str) {
+    const StringRange range = {.offset = (uint32)strings.size(), .size = (uint32)str.size()};
+    strings.insert(strings.end(), str.begin(), str.end());
+    return range;
+  }
+
+  std::vector<uint8>& finish(const uint64 key) {
+    write_section(Strings, std::span<const char>(strings));
+    header.key = key;
+    header.file_size = blob.size();
+    std::memcpy(blob.data(), &header, sizeof(header));
+    return blob;
+  }
+
+private:
+  CacheFileHeader header = {};
+  std::vector<uint8> blob = {};
+  std::vector<char> strings = {};
+};
+
+class CacheReader {
+public:
+  explicit CacheReader(const fs::MappedFile& file) : file(file) {}
+
+  bool validate(const uint64 key) {
+    if (file.size() < sizeof(CacheFileHeader))
+      return false;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != CACHE_MAGIC || header.version != MeshCache::CACHE_VERSION || header.key != key || header.file_size != file.size())
+      return false;
+
+    for (const auto& section : header.sections) {
+      if (section.offset % SECTION_ALIGNMENT != 0 || section.offset > file.size() || section.size > file.size() - section.offset)
+        return false;
+    }
+    return true;
+  }
+
+  // sections are aligned in the file and the mapping is page aligned, so offsets can be used as pointers directly
+  template <typename T>
+  bool get_section(const Section section, std::span<const T>& values) const {
+    const auto& range = header.sections[section];
+    if (range.encoding != NOT_ENCODED || range.size % sizeof(T) != 0)
+      return false;
+    values = {(const T*)(file.data() + range.offset), range.size / sizeof(T)};
+    return true;
+  }
+
+  // Sections written with `write_encoded_section`. `values` is sized for the decoded data,
+  //	its chunks are appended to `streams` to be decoded together with the other sections.
+  template <typename T>
+  bool get_encoded_section(const Section section, std::vector<T>& values, std::vector<MeshCodec::Stream>& streams) const {
+    const auto& range = header.sections[section];
+    if (range.encoding == NOT_ENCODED) {
+      std::span<const T> raw = {};
+      if (!get_section(section, raw))
+        return false;
+      values.assign(raw.begin(), raw.end());
+      return true;
+    }
+
+    if (range.encoding > (uint32)MeshCodec::Mode::Indices || (uint64)range.chunk_count * sizeof(ChunkRecord) > range.size)
+      return false;
+
+    const auto* section_data = file.data() + range.offset;
+    const auto* chunks = (const ChunkRecord*)section_data;
+
+    // the decoded size comes from the file, it has to match the chunks and the encoded size before anything is allocated.
+    // meshoptimizer's codecs don't get below 2 bits per 16 bytes, the header of an all zero block of the vertex codec
+    constexpr uint64 MAX_COMPRESSION_RATIO = 64;
+    uint64 chunk_element_count = 0;
+    for (uint32 i = 0; i < range.chunk_count; i++) {
+      if (chunks[i].count > MeshCodec::CHUNK_SIZE)
+        return false;
+      chunk_element_count += chunks[i].count;
+    }
+    if (range.decoded_size != chunk_element_count * sizeof(T) || range.decoded_size > range.size * MAX_COMPRESSION_RATIO)
+      return false;
+
+    values.resize(chunk_element_count);
+    uint64 decoded_count = 0;
+    for (uint32 i = 0; i < range.chunk_count; i++) {
+      const auto& chunk = chunks[i];
+      if (chunk.offset > range.size || chunk.size > range.size - chunk.offset || chunk.count > values.size() - decoded_count)
+        return false;
+      streams.emplace_back(MeshCodec::Stream{
+        .encoded = {section_data + chunk.offset, chunk.size},
+        .decoded = values.data() + decoded_count,
+        .count = chunk.count,
+        .stride = sizeof(T),
+        .mode = (MeshCodec::Mode)range.encoding,
+      });
+      decoded_count += chunk.count;
+    }
+
+    return decoded_count == values.size();
+  }
+
+  bool get_string(const StringRange range, std::string& str) const {
+    std::span<const char> strings = {};
+    if (!get_section(Strings, strings) || (uint64)range.offset + range.size > strings.size())
+      return false;
+    str.assign(strings.data() + range.offset, range.size);
+    return true;
+  }
+
+private:
+  const fs::MappedFile& file;
+  CacheFileHeader header = {};
+};
+} // namespace
+
+uint64 MeshCache::get_key(const std::string& path, const uint64 settings_hash) {
+  OX_SCOPED_ZONE;
+
+  const uint64 file_hash = hash_file(path);
+  if (file_hash == 0)
+    return 0;
+
+  uint64 key = hash_combine(file_hash, CACHE_VERSION);
+  key = hash_combine(key, settings_hash);
+  return key == 0 ? 1 : key;
+}
+
+bool MeshCache::read(const std::string& path, const uint64 key, Mesh& mesh) {
+  OX_SCOPED_ZONE;
+
+  const fs::MappedFile file(get_entry_path(get_cache_directory(), key));
+  if (!file.is_open())
+    return false;
+
+  CacheReader reader(file);
+  if (!reader.validate(key)) {
+    OX_LOG_WARN("MeshCache: Ignoring invalid cache entry for {}", path);
+    return false;
+  }
+
+  // decoded into owned storage, the rest is read in place
+  std::vector<Vertex> vertices = {};
+  std::vector<QuantizedVertex> quantized_vertices = {};
+  std::vector<uint32> indices = {};
+  std::vector<uint8> primitives = {};
+  std::vector<Mesh::Meshlet> meshlets = {};
+  std::vector<MeshCodec::Stream> streams = {};
+  std::span<const MeshletHierarchy::ClusterLod> meshlet_lods = {};
+  std::span<const NodeRecord> nodes = {};
+  std::span<const uint32> node_children = {};
+  std::span<const Mesh::MeshletInstance> meshlet_instances = {};
+  std::span<const MaterialRecord> materials = {};
+  std::span<const ImageRecord> images = {};
+  std::span<const uint8> image_data = {};
+  std::span<const DependencyRecord> dependencies = {};
+  std::span<const Mesh::Lod> lods = {};
+  std::span<const uint32> lod_chain_offsets = {};
+  std::span<const Mesh::ImportStats> import_stats = {};
+  std::span<const VertexQuantization> vertex_quantizations = {};
+  if (!reader.get_encoded_section(Vertices, vertices, streams) || !reader.get_encoded_section(QuantizedVertices, quantized_vertices, streams) ||
+      !reader.get_encoded_section(Indices, indices, streams) || !reader.get_encoded_section(Primitives, primitives, streams) ||
+      !reader.get_encoded_section(Meshlets, meshlets, streams) || !reader.get_section(MeshletLods, meshlet_lods) ||
+      !reader.get_section(Nodes, nodes) || !reader.get_section(NodeChildren, node_children) ||
+      !reader.get_section(MeshletInstances, meshlet_instances) || !reader.get_section(Materials, materials) ||
+      !reader.get_section(Images, images) || !reader.get_section(ImageData, image_data) ||
+      !reader.get_section(Dependencies, dependencies) || !reader.get_section(Lods, lods) ||
+      !reader.get_section(LodChainOffsets, lod_chain_offsets) || !reader.get_section(ImportStats, import_stats) ||
+      !reader.get_section(VertexQuantizations, vertex_quantizations) ||
+      import_stats.size() != 1 || lods.size() > Mesh::MAX_LODS || nodes.empty() || meshlet_lods.size() != meshlets.size()) {
+    OX_LOG_WARN("MeshCache: Ignoring corrupt cache entry for {}", path);
+    return false;
+  }
+
+  // external buffers and images aren't part of the key
+  const auto directory = std::filesystem::path(fs::get_directory(path));
+  for (const auto& dependency : dependencies) {
+    std::string dependency_path = {};
+    if (!reader.get_string(dependency.path, dependency_path))
+      return false;
+    if (hash_file((directory / dependency_path).string()) != dependency.hash)
+      return false;
+  }
+
+  if (!MeshCodec::decode(streams, App::get_system<TaskScheduler>())) {
+    OX_LOG_WARN("MeshCache: Ignoring corrupt cache entry for {}", path);
+    return false;
+  }
+
+  // validate every index before touching the mesh
+  for (const auto& node : nodes) {
+    if ((node.parent != INVALID_INDEX && node.parent >= nodes.size()) || (uint64)node.first_child + node.child_count > node_children.size() ||
+        (uint64)node.first_meshlet_instance + node.meshlet_instance_count > meshlet_instances.size() ||
+        (uint64)node.first_lod_meshlet_instance + node.lod_meshlet_instance_count > meshlet_instances.size() ||
+        (uint64)node.first_lod_chain_meshlet_instance + node.lod_chain_meshlet_instance_count > meshlet_instances.size() ||
+        (uint64)node.first_lod_chain_offset + node.lod_chain_offset_count > lod_chain_offsets.size() ||
+        node.lod_chain_offset_count > lods.size())
+      return false;
+    for (uint32 previous = 0; const auto offset : lod_chain_offsets.subspan(node.first_lod_chain_offset, node.lod_chain_offset_count)) {
+      if (offset < previous || offset > node.lod_chain_meshlet_instance_count)
+        return false;
+      previous = offset;
+    }
+  }
+  for (const auto child : node_children) {
+    if (child >= nodes.size())
+      return false;
+  }
+  for (const auto& instance : meshlet_instances) {
+    if (instance.meshletId >= meshlets.size())
+      return false;
+  }
+  for (const auto& meshlet : meshlets) {
+    if (meshlet.is_quantized() && meshlet.vertex_quantization >= vertex_quantizations.size())
+      return false;
+    // the renderer and the occlusion culler index with these without checking
+    if ((uint64)meshlet.index_offset + meshlet.index_count > indices.size() ||
+        (uint64)meshlet.primitive_offset + (uint64)meshlet.primitive_count * 3 > primitives.size())
+      return false;
+    const uint64 vertex_count = meshlet.is_quantized() ? quantized_vertices.size() : vertices.size();
+    for (const auto index : std::span(indices).subspan(meshlet.index_offset, meshlet.index_count)) {
+      if ((uint64)meshlet.vertex_offset + index >= vertex_count)
+        return false;
+    }
+    for (const auto primitive : std::span(primitives).subspan(meshlet.primitive_offset, (size_t)meshlet.primitive_count * 3)) {
+      if (primitive >= meshlet.index_count)
+        return false;
+    }
+  }
+  for (const auto& image : images) {
+    if (image.data_offset > image_data.size() || image.data_size > image_data.size() - image.data_offset)
+      return false;
+  }
+
+  mesh._vertices = std::move(vertices);
+  mesh._quantized_vertices = std::move(quantized_vertices);
+  mesh._vertex_quantizations.assign(vertex_quantizations.begin(), vertex_quantizations.end());
+  mesh._indices = std::move(indices);
+  mesh._primitives = std::move(primitives);
+  mesh._meshlets = std::move(meshlets);
+  mesh._meshlet_lods.assign(meshlet_lods.begin(), meshlet_lods.end());
+  mesh._lods.assign(lods.begin(), lods.end());
+  mesh.import_stats = import_stats.front();
+
+  mesh.nodes.resize(nodes.size());
+  for (size_t i = 0; i < nodes.size(); i++) {
+    const auto& record = nodes[i];
+    auto& node = mesh.nodes[i];
+    reader.get_string(record.name, node.name);
+    node.translation = record.translation;
+    node.rotation = record.rotation;
+    node.scale = record.scale;
+    node.aabb = AABB(record.aabb_min, record.aabb_max);
+    node.index = (uint32)i;
+    node.parent = record.parent != INVALID_INDEX ? &mesh.nodes[record.parent] : nullptr;
+
+    node.children.reserve(record.child_count);
+    for (const auto child : node_children.subspan(record.first_child, record.child_count))
+      node.children.emplace_back(&mesh.nodes[child]);
+
+    const auto instances = meshlet_instances.subspan(record.first_meshlet_instance, record.meshlet_instance_count);
+    node.meshlet_indices.assign(instances.begin(), instances.end());
+    const auto lod_instances = meshlet_instances.subspan(record.first_lod_meshlet_instance, record.lod_meshlet_instance_count);
+    node.lod_meshlet_indices.assign(lod_instances.begin(), lod_instances.end());
+    const auto lod_chain_instances = meshlet_instances.subspan(record.first_lod_chain_meshlet_instance, record.lod_chain_meshlet_instance_count);
+    node.lod_chain_meshlet_indices.assign(lod_chain_instances.begin(), lod_chain_instances.end());
+    const auto chain_offsets = lod_chain_offsets.subspan(record.first_lod_chain_offset, record.lod_chain_offset_count);
+    node.lod_chain_offsets.assign(chain_offsets.begin(), chain_offsets.end());
+    node.build_lod_levels(mesh._meshlet_lods);
+
+    if (!node.parent)
+      mesh.root_nodes.emplace_back(&node);
+  }
+
+  std::vector<Shared<Texture>> textures = {};
+  textures.reserve(images.size());
+  for (const auto& image : images) {
+    std::string name = {};
+    reader.get_string(image.name, name);
+
+    auto ci = TextureLoadInfo{
+      .path = {},
+      .preset = Preset::eMap2D,
+      .extent = {image.width, image.height, 1u},
+      .format = (vuk::Format)image.format,
+      .data = (void*)(image_data.data() + image.data_offset),
+      .mime = TextureLoadInfo::MimeType::Generic,
+    };
+
+    const auto& handle = mesh._texture_handles.emplace_back(AssetManager::acquire_texture_asset(name, ci));
+    if (auto texture = AssetManager::get(handle)) {
+      texture->set_name(name);
+      textures.emplace_back(std::move(texture));
+    } else {
+      OX_LOG_ERROR("MeshCache: Couldn't create texture {}, using a white texture instead", name);
+      textures.emplace_back(Texture::get_white_texture());
+    }
+  }
+
+  const auto get_texture = [&textures](const uint32 index) -> Shared<Texture> { return index < textures.size() ? textures[index] : nullptr; };
+
+  mesh._materials.reserve(materials.size());
+  for (const auto& record : materials) {
+    std::string name = {};
+    reader.get_string(record.name, name);
+
+    const auto& material = mesh._materials.emplace_back(create_shared<PBRMaterial>(name));
+    material->create();
+    material->parameters = record.parameters;
+    material->set_albedo_texture(get_texture(record.albedo_image))
+      ->set_normal_texture(get_texture(record.normal_image))
+      ->set_physical_texture(get_texture(record.physical_image))
+      ->set_ao_texture(get_texture(record.ao_image))
+      ->set_emissive_texture(get_texture(record.emissive_image));
+  }
+
+  mesh.set_transforms();
+  mesh.index_count = (uint32)mesh._indices.size();
+  mesh.vertex_count = (uint32)(mesh._vertices.size() + mesh._quantized_vertices.size());
+
+  return true;
+}
+
+bool MeshCache::write(const std::string& path,
+                      const uint64 key,
+                      const Mesh& mesh,
+                      const std::span<const Image> images,
+                      const std::span<const Shared<Texture>> textures) {
+  OX_SCOPED_ZONE;
+
+  CacheWriter writer = {};
+  // the bulk of an entry, each section falls back to the raw layout when the codec doesn't make it smaller
+  if (RendererCVar::cvar_mesh_cache_compression.get()) {
+    writer.write_encoded_section(Vertices, std::span(mesh._vertices), MeshCodec::Mode::Attributes);
+    writer.write_encoded_section(QuantizedVertices, std::span(mesh._quantized_vertices), MeshCodec::Mode::Attributes);
+    writer.write_encoded_section(Indices, std::span(mesh._indices), MeshCodec::Mode::Indices);
+    // meshlet triangles are padded to 4 bytes, so this isn't a plain triangle list the index buffer codec could rotate
+    writer.write_encoded_section(Primitives, std::span(mesh._primitives), MeshCodec::Mode::Indices);
+    writer.write_encoded_section(Meshlets, std::span(mesh._meshlets), MeshCodec::Mode::Attributes);
+  } else {
+    writer.write_section(Vertices, std::span(mesh._vertices));
+    writer.write_section(QuantizedVertices, std::span(mesh._quantized_vertices));
+    writer.write_section(Indices, std::span(mesh._indices));
+    writer.write_section(Primitives, std::span(mesh._primitives));
+    writer.write_section(Meshlets, std::span(mesh._meshlets));
+  }
+  writer.write_section(VertexQuantizations, std::span(mesh._vertex_quantizations));
+  writer.write_section(MeshletLods, std::span(mesh._meshlet_lods));
+
+  // node pointers are stored as indices
+  std::vector<NodeRecord> nodes = {};
+  std::vector<uint32> node_children = {};
+  std::vector<Mesh::MeshletInstance> meshlet_instances = {};
+  std::vector<uint32> lod_chain_offsets = {};
+  nodes.reserve(mesh.nodes.size());
+  for (const auto& node : mesh.nodes) {
+    nodes.emplace_back(NodeRecord{
+      .name = writer.add_string(node.name),
+      .translation = node.translation,
+      .rotation = node.rotation,
+      .scale = node.scale,
+      .aabb_min = node.aabb.min,
+      .aabb_max = node.aabb.max,
+      .parent = node.parent ? node.parent->index : INVALID_INDEX,
+      .first_child = (uint32)node_children.size(),
+      .child_count = (uint32)node.children.size(),
+      .first_meshlet_instance = (uint32)meshlet_instances.size(),
+      .meshlet_instance_count = (uint32)node.meshlet_indices.size(),
+      .first_lod_meshlet_instance = (uint32)(meshlet_instances.size() + node.meshlet_indices.size()),
+      .lod_meshlet_instance_count = (uint32)node.lod_meshlet_indices.size(),
+      .first_lod_chain_meshlet_instance = (uint32)(meshlet_instances.size() + node.meshlet_indices.size() + node.lod_meshlet_indices.size()),
+      .lod_chain_meshlet_instance_count = (uint32)node.lod_chain_meshlet_indices.size(),
+      .first_lod_chain_offset = (uint32)lod_chain_offsets.size(),
+      .lod_chain_offset_count = (uint32)node.lod_chain_offsets.size(),
+    });
+    for (const auto* child : node.children)
+      node_children.emplace_back(child->index);
+    meshlet_instances.insert(meshlet_instances.end(), node.meshlet_indices.begin(), node.meshlet_indices.end());
+    meshlet_instances.insert(meshlet_instances.end(), node.lod_meshlet_indices.begin(), node.lod_meshlet_indices.end());
+    meshlet_instances.insert(meshlet_instances.end(), node.lod_chain_meshlet_indices.begin(), node.lod_chain_meshlet_indices.end());
+    lod_chain_offsets.insert(lod_chain_offsets.end(), node.lod_chain_offsets.begin(), node.lod_chain_offsets.end());
+  }
+  writer.write_section(Nodes, std::span<const NodeRecord>(nodes));
+  writer.write_section(NodeChildren, std::span<const uint32>(node_children));
+  writer.write_section(MeshletInstances, std::span<const Mesh::MeshletInstance>(meshlet_instances));
+  writer.write_section(LodChainOffsets, std::span<const uint32>(lod_chain_offsets));
+  writer.write_section(Lods, std::span(mesh._lods));
+  writer.write_section(ImportStats, std::span(&mesh.import_stats, 1));
+
+  ankerl::unordered_dense::map<const Texture*, uint32> image_indices = {};
+  for (uint32 i = 0; i < (uint32)textures.size(); i++)
+    image_indices.emplace(textures[i].get(), i);
+  const auto get_image_index = [&image_indices](const Shared<Texture>& texture) {
+    const auto it = image_indices.find(texture.get());
+    return it != image_indices.end() ? it->second : INVALID_INDEX;
+  };
+
+  std::vector<MaterialRecord> materials = {};
+  materials.reserve(mesh._materials.size());
+  for (const auto& material : mesh._materials) {
+    auto parameters = material->parameters;
+    parameters.albedo_map_id = Asset::INVALID_ID;
+    parameters.normal_map_id = Asset::INVALID_ID;
+    parameters.physical_map_id = Asset::INVALID_ID;
+    parameters.ao_map_id = Asset::INVALID_ID;
+    parameters.emissive_map_id = Asset::INVALID_ID;
+
+    materials.emplace_back(MaterialRecord{
+      .name = writer.add_string(material->get_name()),
+      .parameters = parameters,
+      .albedo_image = get_image_index(material->get_albedo_texture()),
+      .normal_image = get_image_index(material->get_normal_texture()),
+      .physical_image = get_image_index(material->get_physical_texture()),
+      .ao_image = get_image_index(material->get_ao_texture()),
+      .emissive_image = get_image_index(material->get_emissive_texture()),
+    });
+  }
+  writer.write_section(Materials, std::span<const MaterialRecord>(materials));
+
+  std::vector<ImageRecord> image_records = {};
+  std::vector<uint8> image_data = {};
+  image_records.reserve(images.size());
+  for (const auto& image : images) {
+    image_records.emplace_back(ImageRecord{
+      .name = writer.add_string(image.name),
+      .width = image.extent.width,
+      .height = image.extent.height,
+      .format = (uint32)image.format,
+      .data_offset = image_data.size(),
+      .data_size = image.data.size(),
+    });
+    image_data.insert(image_data.end(), image.data.begin(), image.data.end());
+    image_data.resize((image_data.size() + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1));
+  }
+  writer.write_section(Images, std::span<const ImageRecord>(image_records));
+  writer.write_section(ImageData, std::span<const uint8>(image_data));
+
+  const auto directory = std::filesystem::path(fs::get_directory(path));
+  std::vector<DependencyRecord> dependencies = {};
+  for (const auto& dependency : get_dependencies(path)) {
+    const uint64 hash = hash_file((directory / dependency).string());
+    if (hash == 0)
+      return false;
+    dependencies.emplace_back(DependencyRecord{.path = writer.add_string(dependency), .hash = hash});
+  }
+  writer.write_section(Dependencies, std::span<const DependencyRecord>(dependencies));
+
+  const auto& blob = writer.finish(key);
+
+  const auto cache_directory = get_cache_directory();
+  std::error_code ec;
+  std::filesystem::create_directories(cache_directory, ec);
+  if (ec)
+    return false;
+
+  // write to a temporary first so a crash or a concurrent reader never sees a half written entry
+  const auto entry_path = get_entry_path(cache_directory, key);
+  const auto temp_path = fmt::format("{}.{}.tmp", entry_path, std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+      return false;
+    file.write((const char*)blob.data(), (std::streamsize)blob.size());
+    if (!file.good())
+      return false;
+  }
+
+  std::filesystem::rename(temp_path, entry_path, ec);
+  if (ec) {
+    std::filesystem::remove(temp_path, ec);
+    return false;
+  }
+
+  return true;
+}
+
+void MeshCache::clear() {
+  std::error_code ec;
+  for (const auto& entry : std::filesystem::directory_iterator(get_cache_directory(), ec)) {
+    if (entry.path().extension() == ".oxmesh")
+      std::filesystem::remove(entry.path(), ec);
+  }
+}
+
+std::string MeshCache::get_cache_directory() {
+  const auto root = Project::get_active() ? Project::get_project_directory() : App::get()->get_specification().working_directory;
+  return fs::preferred_path((std::filesystem::path(root) / ".cache" / "meshes").string());
+}
+} // namespace ox
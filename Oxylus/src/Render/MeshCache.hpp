@@ -0,0 +1,49 @@
+#pragma once
+#include <span>
+#include <string>
+#include <vector>
+#include <vuk/Types.hpp>
+
+#include "Core/Base.hpp"
+#include "Core/Types.hpp"
+
+namespace ox {
+class Mesh;
+class Texture;
+
+// Versioned binary cache of imported glTF files, everything `Mesh::load_from_file` produces is written once:
+//	vertices (full precision and quantized), indices, meshlets with their LOD and culling bounds, the LOD chain, primitives, the node tree, materials and the decoded/transcoded images.
+//	A load from the cache maps the file, turns the stored offsets back into pointers and copies the sections out,
+//	no parsing, image decoding or meshlet building happens. Geometry is stored with meshoptimizer's vertex and index codecs
+//	and decoded in parallel chunks on load. Entries are keyed by the content of the source file,
+//	the import settings and CACHE_VERSION. External buffers and images are recorded with their hashes and checked on load.
+//	Cache lives in `<project>/.cache/meshes`.
+class MeshCache {
+public:
+  static constexpr uint32 CACHE_VERSION = 8;
+
+  struct Image {
+    std::string name = {};
+    vuk::Extent3D extent = {};
+    vuk::Format format = vuk::Format::eR8G8B8A8Unorm;
+    std::vector<uint8> data = {}; // first mip level, exactly as it's uploaded
+  };
+
+  /// @return Key of the source at `path` imported with the given settings, 0 if the file can't be read.
+  static uint64 get_key(const std::string& path, uint64 settings_hash);
+
+  /// Fills the empty `mesh` from the cache entry of `key`.
+  /// @return false on a miss, a stale dependency or a corrupt entry, `mesh` is left untouched then.
+  static bool read(const std::string& path, uint64 key, Mesh& mesh);
+  /// Writes `mesh` as the entry of `key`. `textures` are the textures created from `images`, in the same order.
+  static bool write(const std::string& path,
+                    uint64 key,
+                    const Mesh& mesh,
+                    std::span<const Image> images,
+                    std::span<const Shared<Texture>> textures);
+
+  /// Removes every cached mesh.
+  static void clear();
+  static std::string get_cache_directory();
+};
+} // namespace ox
@@ -0,0 +1,233 @@
+#include "MeshCodec.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <meshoptimizer.h>
+
+#include "Mesh.hpp"
+#include "Thread/TaskScheduler.hpp"
+#include "Utils/Log.hpp"
+#include "Utils/Profiler.hpp"
+#include "Utils/Timer.hpp"
+
+namespace ox {
+namespace {
+// triangle chunks must not split a triangle
+uint32 get_chunk_size(const MeshCodec::Mode mode) {
+  return mode == MeshCodec::Mode::Triangles ? MeshCodec::CHUNK_SIZE - MeshCodec::CHUNK_SIZE % 3 : MeshCodec::CHUNK_SIZE;
+}
+
+bool is_valid_stride(const MeshCodec::Mode mode, const uint32 stride) {
+  if (mode == MeshCodec::Mode::Attributes)
+    return stride != 0 && stride % 4 == 0 && stride <= 256;
+  return stride == 1 || stride == 2 || stride == 4;
+}
+
+bool is_valid_filter(const MeshCodec::Filter filter, const MeshCodec::Mode mode, const uint32 stride) {
+  switch (filter) {
+    case MeshCodec::Filter::None       : return true;
+    case MeshCodec::Filter::Octahedral : return mode == MeshCodec::Mode::Attributes && (stride == 4 || stride == 8);
+    case MeshCodec::Filter::Quaternion : return mode == MeshCodec::Mode::Attributes && stride == 8;
+    case MeshCodec::Filter::Exponential: return mode == MeshCodec::Mode::Attributes;
+  }
+  return false;
+}
+
+uint32 read_index(const uint8* data, const size_t index, const uint32 stride) {
+  if (stride == 1)
+    return data[index];
+  if (stride == 2) {
+    uint16 value;
+    std::memcpy(&value, data + index * 2, sizeof(value));
+    return value;
+  }
+  uint32 value;
+  std::memcpy(&value, data + index * 4, sizeof(value));
+  return value;
+}
+} // namespace
+
+std::vector<MeshCodec::Chunk> MeshCodec::encode(const void* data, const uint32 count, const uint32 stride, const Mode mode) {
+  OX_SCOPED_ZONE;
+  if (!is_valid_stride(mode, stride) || (mode == Mode::Triangles && count % 3 != 0))
+    return {};
+
+  const auto* bytes = static_cast<const uint8*>(data);
+  const uint32 chunk_size = get_chunk_size(mode);
+
+  std::vector<Chunk> chunks = {};
+  std::vector<uint32> indices = {};
+  for (uint32 first = 0; first < count; first += chunk_size) {
+    auto& chunk = chunks.emplace_back(Chunk{.count = std::min(chunk_size, count - first)});
+
+    if (mode == Mode::Attributes) {
+      chunk.data.resize(meshopt_encodeVertexBufferBound(chunk.count, stride));
+      chunk.data.resize(meshopt_encodeVertexBuffer(chunk.data.data(), chunk.data.size(), bytes + (size_t)first * stride, chunk.count, stride));
+    } else {
+      // the index codecs only take 32 bit indices
+      uint32 vertex_count = 0;
+      indices.resize(chunk.count);
+      for (uint32 i = 0; i < chunk.count; i++) {
+        indices[i] = read_index(bytes, (size_t)first + i, stride);
+        vertex_count = std::max(vertex_count, indices[i] + 1);
+      }
+
+      if (mode == Mode::Triangles) {
+        chunk.data.resize(meshopt_encodeIndexBufferBound(chunk.count, vertex_count));
+        chunk.data.resize(meshopt_encodeIndexBuffer(chunk.data.data(), chunk.data.size(), indices.data(), chunk.count));
+      } else {
+        chunk.data.resize(meshopt_encodeIndexSequenceBound(chunk.count, vertex_count));
+        chunk.data.resize(meshopt_encodeIndexSequence(chunk.data.data(), chunk.data.size(), indices.data(), chunk.count));
+      }
+    }
+
+    if (chunk.data.empty())
+      return {};
+  }
+
+  return chunks;
+}
+
+bool MeshCodec::decode(const Stream& stream) {
+  OX_SCOPED_ZONE;
+  if (stream.count == 0)
+    return true;
+  if (!stream.decoded || !is_valid_stride(stream.mode, stream.stride) || !is_valid_filter(stream.filter, stream.mode, stream.stride) ||
+      (stream.mode == Mode::Triangles && stream.count % 3 != 0))
+    return false;
+
+  int result = -1;
+  if (stream.mode == Mode::Attributes) {
+    result = meshopt_decodeVertexBuffer(stream.decoded, stream.count, stream.stride, stream.encoded.data(), stream.encoded.size());
+  } else {
+    const auto decode_indices = stream.mode == Mode::Triangles ? meshopt_decodeIndexBuffer : meshopt_decodeIndexSequence;
+    if (stream.stride != 1) {
+      result = decode_indices(stream.decoded, stream.count, stream.stride, stream.encoded.data(), stream.encoded.size());
+    } else {
+      // there is no 8 bit output, decode to 16 bit and narrow
+      std::vector<uint16> indices(stream.count);
+      result = decode_indices(indices.data(), stream.count, sizeof(uint16), stream.encoded.data(), stream.encoded.size());
+      auto* decoded = static_cast<uint8*>(stream.decoded);
+      for (uint32 i = 0; i < stream.count; i++)
+        decoded[i] = (uint8)indices[i];
+    }
+  }
+
+  if (result != 0)
+    return false;
+
+  switch (stream.filter) {
+    case Filter::None       : break;
+    case Filter::Octahedral : meshopt_decodeFilterOct(stream.decoded, stream.count, stream.stride); break;
+    case Filter::Quaternion : meshopt_decodeFilterQuat(stream.decoded, stream.count, stream.stride); break;
+    case Filter::Exponential: meshopt_decodeFilterExp(stream.decoded, stream.count, stream.stride); break;
+  }
+
+  return true;
+}
+
+bool MeshCodec::decode(std::span<const Stream> streams, TaskScheduler* scheduler) {
+  OX_SCOPED_ZONE;
+  if (!scheduler || streams.size() < 2) {
+    bool decoded = true;
+    for (const auto& stream : streams)
+      decoded &= decode(stream);
+    return decoded;
+  }
+
+  // streams write to disjoint memory
+  std::atomic_bool decoded = true;
+  TaskSet task((uint32)streams.size(), [streams, &decoded](const TaskSetPartition range, uint32_t) {
+    for (uint32 i = range.start; i < range.end; i++) {
+      if (!decode(streams[i]))
+        decoded = false;
+    }
+  });
+  scheduler->schedule_task(&task);
+  scheduler->wait_task(&task);
+
+  return decoded;
+}
+
+MeshCodec::BenchmarkResult MeshCodec::benchmark(const Mesh& mesh, const uint32 iteration_count, TaskScheduler* scheduler) {
+  OX_SCOPED_ZONE;
+
+  struct Source {
+    const void* data;
+    uint32 count;
+    uint32 stride;
+    Mode mode;
+  };
+  const Source sources[] = {
+    {mesh._vertices.data(), (uint32)mesh._vertices.size(), sizeof(Vertex), Mode::Attributes},
+    {mesh._quantized_vertices.data(), (uint32)mesh._quantized_vertices.size(), sizeof(QuantizedVertex), Mode::Attributes},
+    {mesh._indices.data(), (uint32)mesh._indices.size(), sizeof(uint32), Mode::Indices},
+    // padded per meshlet, not a triangle list
+    {mesh._primitives.data(), (uint32)mesh._primitives.size(), sizeof(uint8), Mode::Indices},
+  };
+  constexpr auto source_count = std::size(sources);
+
+  BenchmarkResult result = {.iteration_count = iteration_count};
+
+  std::vector<Chunk> chunks[source_count] = {};
+  const Timer encode_timer = {};
+  for (size_t i = 0; i < source_count; i++)
+    chunks[i] = encode(sources[i].data, sources[i].count, sources[i].stride, sources[i].mode);
+  result.encode_ms = encode_timer.get_elapsed_ms();
+
+  std::vector<uint8> decoded[source_count] = {};
+  std::vector<Stream> streams = {};
+  for (size_t i = 0; i < source_count; i++) {
+    const auto& [data, count, stride, mode] = sources[i];
+    decoded[i].resize((size_t)count * stride);
+    result.raw_bytes += decoded[i].size();
+
+    for (uint32 first = 0; const auto& chunk : chunks[i]) {
+      streams.emplace_back(Stream{
+        .encoded = chunk.data,
+        .decoded = decoded[i].data() + (size_t)first * stride,
+        .count = chunk.count,
+        .stride = stride,
+        .mode = mode,
+      });
+      result.encoded_bytes += chunk.data.size();
+      first += chunk.count;
+    }
+  }
+  result.chunk_count = (uint32)streams.size();
+
+  const auto measure = [&](TaskScheduler* decode_scheduler) {
+    float best_ms = std::numeric_limits<float>::max();
+    for (uint32 i = 0; i < iteration_count; i++) {
+      const Timer timer = {};
+      decode(streams, decode_scheduler);
+      best_ms = std::min(best_ms, timer.get_elapsed_ms());
+    }
+    return iteration_count > 0 ? best_ms : 0.0f;
+  };
+  result.decode_ms = measure(nullptr);
+  result.parallel_decode_ms = scheduler ? measure(scheduler) : result.decode_ms;
+
+  for (size_t i = 0; i < source_count; i++) {
+    if (iteration_count > 0 && !decoded[i].empty() && std::memcmp(decoded[i].data(), sources[i].data, decoded[i].size()) != 0)
+      OX_LOG_ERROR("MeshCodec benchmark: stream {} didn't decode to its source", i);
+  }
+
+  OX_LOG_INFO("MeshCodec benchmark: {:.2f} MiB -> {:.2f} MiB ({:.2f}x) in {} chunks, encode {:.3f} ms ({:.1f} MB/s), decode {:.3f} ms ({:.1f} MB/s), "
+              "parallel decode {:.3f} ms ({:.1f} MB/s), best of {}",
+              (float)result.raw_bytes / (1024.0f * 1024.0f),
+              (float)result.encoded_bytes / (1024.0f * 1024.0f),
+              result.get_ratio(),
+              result.chunk_count,
+              result.encode_ms,
+              result.get_throughput(result.encode_ms),
+              result.decode_ms,
+              result.get_throughput(result.decode_ms),
+              result.parallel_decode_ms,
+              result.get_throughput(result.parallel_decode_ms),
+              result.iteration_count);
+
+  return result;
+}
+} // namespace ox
@@ -0,0 +1,75 @@
+#pragma once
+#include <span>
+#include <vector>
+
+#include "Core/Types.hpp"
+
+namespace ox {
+class Mesh;
+class TaskScheduler;
+
+// meshoptimizer's vertex and index codecs, used for EXT_meshopt_compression buffer views of glTF files and the mesh cache.
+//	Data is encoded in chunks of at most CHUNK_SIZE elements that decode independently,
+//	a list of streams is decoded in parallel on the TaskScheduler, one task per stream.
+class MeshCodec {
+public:
+  // same values as the modes and filters of EXT_meshopt_compression
+  enum class Mode : uint32 {
+    Attributes, // any data with a stride multiple of 4, up to 256 bytes
+    Triangles,  // triangle list indices, the order of vertices in a triangle is not preserved
+    Indices,    // index sequences
+  };
+
+  enum class Filter : uint32 {
+    None,
+    Octahedral,
+    Quaternion,
+    Exponential,
+  };
+
+  static constexpr uint32 CHUNK_SIZE = 16384;
+
+  struct Chunk {
+    uint32 count = 0; // elements
+    std::vector<uint8> data = {};
+  };
+
+  // one independently decodable piece of encoded data
+  struct Stream {
+    std::span<const uint8> encoded = {};
+    void* decoded = nullptr; // count * stride bytes
+    uint32 count = 0;
+    uint32 stride = 0; // index modes also accept 1 byte indices, they're decoded as 16 bit and narrowed
+    Mode mode = Mode::Attributes;
+    Filter filter = Filter::None;
+  };
+
+  struct BenchmarkResult {
+    uint64 raw_bytes = 0;
+    uint64 encoded_bytes = 0;
+    uint32 chunk_count = 0;
+    uint32 iteration_count = 0;
+    float encode_ms = 0.0f;
+    float decode_ms = 0.0f;          // single threaded, best of all iterations
+    float parallel_decode_ms = 0.0f; // chunks spread over the TaskScheduler, best of all iterations
+
+    float get_ratio() const { return encoded_bytes ? (float)raw_bytes / (float)encoded_bytes : 0.0f; }
+    /// @return Raw bytes processed per second in MB.
+    float get_throughput(const float ms) const { return ms > 0.0f ? (float)raw_bytes / (ms * 1e3f) : 0.0f; }
+  };
+
+  /// Encodes `count` elements of `stride` bytes, index modes take 1, 2 or 4 byte indices.
+  /// @return Encoded chunks, empty if the data can't be encoded with `mode`.
+  static std::vector<Chunk> encode(const void* data, uint32 count, uint32 stride, Mode mode);
+
+  /// @return false if the stream is corrupt or doesn't match its count and stride.
+  static bool decode(const Stream& stream);
+  /// Decodes every stream, single threaded if no scheduler is given.
+  /// @return false if any of them failed.
+  static bool decode(std::span<const Stream> streams, TaskScheduler* scheduler = nullptr);
+
+  /// Encodes the vertices, indices and primitives of `mesh` and decodes them `iteration_count` times.
+  /// Run it from the command line with `OxylusEditor mesh-codec-benchmark <mesh path>`.
+  static BenchmarkResult benchmark(const Mesh& mesh, uint32 iteration_count, TaskScheduler* scheduler = nullptr);
+};
+} // namespace ox
@@ -10,6 +10,21 @@ struct Vertex {
   float2 uv;
 };
 
+// Half sized vertex of quantized meshes, see VertexQuantizer.
+struct QuantizedVertex {
+  uint16 position[3]; // unorm, relative to the bounds of the primitive
+  uint16 normal;      // octahedral, two snorm8
+  uint16 uv[2];       // unorm, relative to the uv bounds of the primitive
+};
+
+// Decodes the quantized vertices of one primitive: value = min + unorm * scale
+struct VertexQuantization {
+  float3 position_min;
+  float3 position_scale;
+  float2 uv_min;
+  float2 uv_scale;
+};
+
 inline auto vertex_pack = vuk::Packed{
   vuk::Format::eR32Sfloat, // 4 postition x
   vuk::Format::eR32Sfloat, // 4 postition y
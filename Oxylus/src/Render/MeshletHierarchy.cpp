@@ -0,0 +1,536 @@
+#include "MeshletHierarchy.hpp"
+
+#include <algorithm>
+#include <ankerl/unordered_dense.h>
+#include <cmath>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtx/norm.hpp>
+#include <meshoptimizer.h>
+
+#include "Thread/TaskScheduler.hpp"
+#include "Utils/Log.hpp"
+#include "Utils/Profiler.hpp"
+
+namespace ox {
+namespace {
+using Settings = MeshletHierarchy::Settings;
+using Bounds = MeshletHierarchy::Bounds;
+using Cluster = MeshletHierarchy::Cluster;
+
+struct ClusterBatch {
+  std::vector<Cluster> clusters = {};
+  std::vector<uint32> vertices = {};
+  std::vector<uint8> triangles = {};
+};
+
+struct GroupResult {
+  bool simplified = false;
+  Bounds bounds = {};
+  ClusterBatch batch = {};
+};
+
+// Splits `indices` into clusters. Level 0 clusters get their own bounds, simplified ones share the bounds of their group.
+//	`local_to_global` maps the vertex indices of a compacted group back to the source vertices.
+void build_clusters(ClusterBatch& batch,
+                    const std::span<const uint32> indices,
+                    const float* positions,
+                    const size_t vertex_count,
+                    const size_t stride,
+                    const Settings& settings,
+                    const uint32* local_to_global,
+                    const Bounds* group,
+                    const uint32 level) {
+  const size_t max_meshlets = meshopt_buildMeshletsBound(indices.size(), settings.max_vertices, settings.max_triangles);
+  std::vector<meshopt_Meshlet> meshlets(max_meshlets);
+  std::vector<uint32> meshlet_vertices(max_meshlets * settings.max_vertices);
+  std::vector<uint8> meshlet_triangles(max_meshlets * settings.max_triangles * 3);
+
+  const size_t meshlet_count = meshopt_buildMeshlets(meshlets.data(),
+                                                     meshlet_vertices.data(),
+                                                     meshlet_triangles.data(),
+                                                     indices.data(),
+                                                     indices.size(),
+                                                     positions,
+                                                     vertex_count,
+                                                     stride,
+                                                     settings.max_vertices,
+                                                     settings.max_triangles,
+                                                     settings.cone_weight);
+
+  for (size_t i = 0; i < meshlet_count; i++) {
+    const auto& meshlet = meshlets[i];
+
+    Cluster cluster = {
+      .vertex_offset = (uint32)batch.vertices.size(),
+      .vertex_count = meshlet.vertex_count,
+      .triangle_offset = (uint32)batch.triangles.size(),
+      .triangle_count = meshlet.triangle_count,
+      .level = level,
+    };
+
+    const auto bounds = meshopt_computeMeshletBounds(&meshlet_vertices[meshlet.vertex_offset],
+                                                     &meshlet_triangles[meshlet.triangle_offset],
+                                                     meshlet.triangle_count,
+                                                     positions,
+                                                     vertex_count,
+                                                     stride);
+    cluster.culling = {
+      .center = float3(bounds.center[0], bounds.center[1], bounds.center[2]),
+      .radius = bounds.radius,
+      .apex = float3(bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2]),
+      .axis = float3(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]),
+      .cutoff = bounds.cone_cutoff,
+    };
+    cluster.lod.self = group ? *group : Bounds{.center = cluster.culling.center, .radius = cluster.culling.radius, .error = 0.0f};
+    cluster.lod.level = level;
+
+    for (uint32 v = 0; v < meshlet.vertex_count; v++) {
+      const uint32 vertex = meshlet_vertices[meshlet.vertex_offset + v];
+      batch.vertices.emplace_back(local_to_global ? local_to_global[vertex] : vertex);
+    }
+
+    const auto* triangles = &meshlet_triangles[meshlet.triangle_offset];
+    batch.triangles.insert(batch.triangles.end(), triangles, triangles + meshlet.triangle_count * 3);
+    batch.triangles.resize((batch.triangles.size() + 3) & ~3);
+
+    batch.clusters.emplace_back(cluster);
+  }
+}
+
+// smallest sphere around the spheres' bounding box center that encloses all of them, keeps the largest error
+Bounds merge_bounds(const std::span<const Bounds> bounds) {
+  float3 min = float3(std::numeric_limits<float>::max());
+  float3 max = float3(std::numeric_limits<float>::lowest());
+  for (const auto& b : bounds) {
+    min = glm::min(min, b.center - b.radius);
+    max = glm::max(max, b.center + b.radius);
+  }
+
+  Bounds merged = {.center = (min + max) * 0.5f};
+  for (const auto& b : bounds) {
+    merged.radius = std::max(merged.radius, glm::distance(merged.center, b.center) + b.radius);
+    merged.error = std::max(merged.error, b.error);
+  }
+  return merged;
+}
+
+// Greedily grows groups of clusters that share the most edges, so group borders (which stay locked) are as short as possible.
+std::vector<std::vector<uint32>> partition_clusters(const MeshletHierarchy& hierarchy,
+                                                    const std::span<const uint32> level_clusters,
+                                                    const std::span<const uint32> position_remap,
+                                                    const uint32 group_size) {
+  OX_SCOPED_ZONE;
+
+  const auto cluster_count = (uint32)level_clusters.size();
+
+  // every edge with the clusters using it, sorted so clusters sharing an edge are next to each other
+  std::vector<std::pair<uint64, uint32>> edges = {};
+  for (uint32 i = 0; i < cluster_count; i++) {
+    const auto& cluster = hierarchy.clusters[level_clusters[i]];
+    for (uint32 t = 0; t < cluster.triangle_count; t++) {
+      uint32 corners[3] = {};
+      for (uint32 k = 0; k < 3; k++) {
+        const uint32 local = hierarchy.meshlet_triangles[cluster.triangle_offset + t * 3 + k];
+        corners[k] = position_remap[hierarchy.meshlet_vertices[cluster.vertex_offset + local]];
+      }
+      for (uint32 k = 0; k < 3; k++) {
+        const uint32 a = corners[k];
+        const uint32 b = corners[(k + 1) % 3];
+        if (a != b)
+          edges.emplace_back(((uint64)std::min(a, b) << 32) | std::max(a, b), i);
+      }
+    }
+  }
+  std::ranges::sort(edges);
+
+  std::vector<uint64> pairs = {};
+  for (size_t begin = 0; begin < edges.size();) {
+    size_t end = begin + 1;
+    while (end < edges.size() && edges[end].first == edges[begin].first)
+      end++;
+    for (size_t j = begin; j < end; j++) {
+      for (size_t k = j + 1; k < end; k++) {
+        if (edges[j].second != edges[k].second)
+          pairs.emplace_back(((uint64)edges[j].second << 32) | edges[k].second);
+      }
+    }
+    begin = end;
+  }
+  std::ranges::sort(pairs);
+
+  // neighbours weighted by the amount of shared edges
+  std::vector<std::vector<std::pair<uint32, uint32>>> adjacency(cluster_count);
+  for (size_t begin = 0; begin < pairs.size();) {
+    size_t end = begin + 1;
+    while (end < pairs.size() && pairs[end] == pairs[begin])
+      end++;
+    const auto a = (uint32)(pairs[begin] >> 32);
+    const auto b = (uint32)(pairs[begin] & 0xffffffff);
+    adjacency[a].emplace_back(b, (uint32)(end - begin));
+    adjacency[b].emplace_back(a, (uint32)(end - begin));
+    begin = end;
+  }
+
+  std::vector<std::vector<uint32>> groups = {};
+  std::vector<uint8> assigned(cluster_count, 0);
+  std::vector<std::pair<uint32, uint32>> candidates = {};
+  for (uint32 seed = 0; seed < cluster_count; seed++) {
+    if (assigned[seed])
+      continue;
+
+    std::vector<uint32> group = {seed};
+    assigned[seed] = 1;
+    while (group.size() < group_size) {
+      candidates.clear();
+      for (const auto member : group) {
+        for (const auto& [neighbour, weight] : adjacency[member]) {
+          if (assigned[neighbour])
+            continue;
+          if (auto it = std::ranges::find(candidates, neighbour, &std::pair<uint32, uint32>::first); it != candidates.end())
+            it->second += weight;
+          else
+            candidates.emplace_back(neighbour, weight);
+        }
+      }
+      if (candidates.empty())
+        break;
+
+      const auto best = std::ranges::max_element(candidates, {}, &std::pair<uint32, uint32>::second)->first;
+      group.emplace_back(best);
+      assigned[best] = 1;
+    }
+
+    for (auto& member : group)
+      member = level_clusters[member];
+    groups.emplace_back(std::move(group));
+  }
+
+  return groups;
+}
+
+GroupResult simplify_group(const MeshletHierarchy& hierarchy,
+                           const std::span<const uint32> group,
+                           const float* vertex_positions,
+                           const size_t vertex_stride,
+                           const Settings& settings,
+                           const uint32 level) {
+  OX_SCOPED_ZONE;
+
+  // compact the group so simplification and clustering only touch its own vertices
+  std::vector<uint32> indices = {};
+  std::vector<uint32> local_to_global = {};
+  std::vector<float3> positions = {};
+  ankerl::unordered_dense::map<uint32, uint32> global_to_local = {};
+  std::vector<Bounds> child_bounds = {};
+  for (const auto cluster_index : group) {
+    const auto& cluster = hierarchy.clusters[cluster_index];
+    child_bounds.emplace_back(cluster.lod.self);
+    for (uint32 i = 0; i < cluster.triangle_count * 3; i++) {
+      const uint32 global = hierarchy.meshlet_vertices[cluster.vertex_offset + hierarchy.meshlet_triangles[cluster.triangle_offset + i]];
+      const auto [it, inserted] = global_to_local.try_emplace(global, (uint32)local_to_global.size());
+      if (inserted) {
+        local_to_global.emplace_back(global);
+        const auto* position = (const float*)((const uint8*)vertex_positions + global * vertex_stride);
+        positions.emplace_back(position[0], position[1], position[2]);
+      }
+      indices.emplace_back(it->second);
+    }
+  }
+
+  const size_t target_index_count = (indices.size() / 6) * 3;
+  std::vector<uint32> simplified(indices.size());
+  float error = 0.0f;
+  const size_t index_count = meshopt_simplify(simplified.data(),
+                                              indices.data(),
+                                              indices.size(),
+                                              &positions[0].x,
+                                              positions.size(),
+                                              sizeof(float3),
+                                              target_index_count,
+                                              MeshletHierarchy::INFINITE_ERROR,
+                                              meshopt_SimplifyLockBorder | meshopt_SimplifyErrorAbsolute,
+                                              &error);
+
+  GroupResult result = {};
+  if (index_count == 0 || (float)index_count > (float)indices.size() * settings.min_reduction)
+    return result;
+
+  result.simplified = true;
+  // the error is relative to the children, which are already simplified themselves
+  result.bounds = merge_bounds(child_bounds);
+  result.bounds.error += error;
+
+  simplified.resize(index_count);
+  build_clusters(result.batch,
+                 simplified,
+                 &positions[0].x,
+                 positions.size(),
+                 sizeof(float3),
+                 settings,
+                 local_to_global.data(),
+                 &result.bounds,
+                 level);
+
+  return result;
+}
+
+void append_batch(MeshletHierarchy& hierarchy, const ClusterBatch& batch) {
+  const auto vertex_base = (uint32)hierarchy.meshlet_vertices.size();
+  const auto triangle_base = (uint32)hierarchy.meshlet_triangles.size();
+  for (auto cluster : batch.clusters) {
+    cluster.vertex_offset += vertex_base;
+    cluster.triangle_offset += triangle_base;
+    hierarchy.clusters.emplace_back(cluster);
+  }
+  hierarchy.meshlet_vertices.insert(hierarchy.meshlet_vertices.end(), batch.vertices.begin(), batch.vertices.end());
+  hierarchy.meshlet_triangles.insert(hierarchy.meshlet_triangles.end(), batch.triangles.begin(), batch.triangles.end());
+}
+} // namespace
+
+MeshletHierarchy MeshletHierarchy::build(const float* vertex_positions,
+                                         const size_t vertex_count,
+                                         const size_t vertex_stride,
+                                         const std::span<const uint32> indices,
+                                         const Settings& settings,
+                                         TaskScheduler* scheduler) {
+  OX_SCOPED_ZONE;
+
+  MeshletHierarchy hierarchy = {};
+  if (indices.empty() || vertex_count == 0)
+    return hierarchy;
+
+  ClusterBatch base = {};
+  build_clusters(base, indices, vertex_positions, vertex_count, vertex_stride, settings, nullptr, nullptr, 0);
+  append_batch(hierarchy, base);
+  hierarchy.levels.emplace_back(Level{
+    .first_cluster = 0,
+    .cluster_count = (uint32)hierarchy.clusters.size(),
+    .triangle_count = (uint32)(indices.size() / 3),
+  });
+
+  // vertices split by uv or normal seams still connect clusters
+  std::vector<uint32> position_remap(vertex_count);
+  const meshopt_Stream position_stream = {vertex_positions, sizeof(float) * 3, vertex_stride};
+  meshopt_generateVertexRemapMulti(position_remap.data(), nullptr, vertex_count, vertex_count, &position_stream, 1);
+
+  std::vector<uint32> level_clusters(hierarchy.clusters.size());
+  for (uint32 i = 0; i < (uint32)level_clusters.size(); i++)
+    level_clusters[i] = i;
+
+  for (uint32 level = 1; level < settings.max_levels && level_clusters.size() > 1; level++) {
+    const auto groups = partition_clusters(hierarchy, level_clusters, position_remap, std::max(settings.group_size, 2u));
+
+    std::vector<GroupResult> results(groups.size());
+    const auto simplify_range = [&](const uint32 begin, const uint32 end) {
+      for (uint32 g = begin; g < end; g++)
+        results[g] = simplify_group(hierarchy, groups[g], vertex_positions, vertex_stride, settings, level);
+    };
+
+    if (scheduler && groups.size() > 1) {
+      TaskSet task((uint32)groups.size(), [&simplify_range](const TaskSetPartition range, uint32_t) { simplify_range(range.start, range.end); });
+      scheduler->schedule_task(&task);
+      scheduler->wait_task(&task);
+    } else {
+      simplify_range(0, (uint32)groups.size());
+    }
+
+    // clusters of groups that couldn't be simplified are regrouped with the next level
+    Level new_level = {.first_cluster = (uint32)hierarchy.clusters.size()};
+    std::vector<uint32> next_clusters = {};
+    for (size_t g = 0; g < groups.size(); g++) {
+      const auto& result = results[g];
+      if (!result.simplified) {
+        next_clusters.insert(next_clusters.end(), groups[g].begin(), groups[g].end());
+        continue;
+      }
+
+      for (const auto child : groups[g])
+        hierarchy.clusters[child].lod.parent = result.bounds;
+
+      const auto first_new = (uint32)hierarchy.clusters.size();
+      append_batch(hierarchy, result.batch);
+      for (uint32 c = first_new; c < (uint32)hierarchy.clusters.size(); c++) {
+        next_clusters.emplace_back(c);
+        new_level.triangle_count += hierarchy.clusters[c].triangle_count;
+      }
+    }
+
+    new_level.cluster_count = (uint32)hierarchy.clusters.size() - new_level.first_cluster;
+    if (new_level.cluster_count == 0)
+      break;
+
+    hierarchy.levels.emplace_back(new_level);
+    level_clusters = std::move(next_clusters);
+  }
+
+  return hierarchy;
+}
+
+float MeshletHierarchy::get_max_scale(const Mat4& transform) {
+  const float scale = std::max({glm::length2(float3(transform[0])), glm::length2(float3(transform[1])), glm::length2(float3(transform[2]))});
+  return std::sqrt(scale);
+}
+
+float MeshletHierarchy::get_projected_error(const Bounds& bounds, const Mat4& transform, const float transform_scale, const LodView& view) {
+  // lossless clusters are always fine, infinite errors never are
+  if (bounds.error <= 0.0f)
+    return 0.0f;
+  if (bounds.error >= INFINITE_ERROR)
+    return INFINITE_ERROR;
+
+  const float3 center = float3(transform * float4(bounds.center, 1.0f));
+  const float distance = glm::distance(center, view.camera_position) - bounds.radius * transform_scale;
+  if (distance <= 0.0f)
+    return INFINITE_ERROR;
+
+  return bounds.error * transform_scale * view.projection_scale / distance;
+}
+
+void MeshletHierarchy::select_cut(const std::span<const ClusterLod> lods,
+                                  const Mat4& transform,
+                                  const LodView& view,
+                                  std::vector<uint32>& selected) {
+  const float scale = get_max_scale(transform);
+  for (uint32 i = 0; i < (uint32)lods.size(); i++) {
+    if (is_in_cut(lods[i], transform, scale, view))
+      selected.emplace_back(i);
+  }
+}
+
+std::vector<MeshletHierarchy::LevelBounds> MeshletHierarchy::build_level_bounds(const std::span<const ClusterLod> lods) {
+  std::vector<LevelBounds> levels = {};
+  for (uint32 first = 0; first < (uint32)lods.size();) {
+    uint32 end = first + 1;
+    while (end < (uint32)lods.size() && lods[end].level == lods[first].level)
+      end++;
+
+    // parents with an infinite error are never fine no matter where they are, their bounds don't matter
+    std::vector<Bounds> spheres = {};
+    auto& level = levels.emplace_back(LevelBounds{
+      .first = first,
+      .count = end - first,
+      .min_self_error = INFINITE_ERROR,
+      .max_self_error = 0.0f,
+      .min_parent_error = INFINITE_ERROR,
+      .max_parent_error = 0.0f,
+    });
+    for (const auto& lod : lods.subspan(first, end - first)) {
+      spheres.emplace_back(lod.self);
+      if (lod.parent.error < INFINITE_ERROR)
+        spheres.emplace_back(lod.parent);
+      level.min_self_error = std::min(level.min_self_error, lod.self.error);
+      level.max_self_error = std::max(level.max_self_error, lod.self.error);
+      level.min_parent_error = std::min(level.min_parent_error, lod.parent.error);
+      level.max_parent_error = std::max(level.max_parent_error, lod.parent.error);
+    }
+
+    const auto merged = merge_bounds(spheres);
+    level.center = merged.center;
+    level.radius = merged.radius;
+    first = end;
+  }
+
+  return levels;
+}
+
+MeshletHierarchy::LevelCut MeshletHierarchy::get_level_cut(const LevelBounds& level,
+                                                           const Mat4& transform,
+                                                           const float transform_scale,
+                                                           const LodView& view) {
+  // every cluster's distance minus its radius lies in [near, far], so its projected error lies between
+  // its error seen from `far` and seen from `near`
+  const float distance = glm::distance(float3(transform * float4(level.center, 1.0f)), view.camera_position);
+  const float near = distance - level.radius * transform_scale;
+  const float far = distance + level.radius * transform_scale;
+  const auto project = [&](const float error, const float d) {
+    if (error <= 0.0f)
+      return 0.0f;
+    if (error >= INFINITE_ERROR || d <= 0.0f)
+      return INFINITE_ERROR;
+    return error * transform_scale * view.projection_scale / d;
+  };
+
+  if (project(level.min_self_error, far) > view.error_threshold || project(level.max_parent_error, near) <= view.error_threshold)
+    return LevelCut::None;
+  if (project(level.max_self_error, near) <= view.error_threshold && project(level.min_parent_error, far) > view.error_threshold)
+    return LevelCut::All;
+  return LevelCut::Partial;
+}
+
+bool MeshletHierarchy::verify(TaskScheduler* scheduler) {
+  OX_SCOPED_ZONE;
+
+  // a bumpy 128x128 quad height field, big enough for several levels
+  constexpr uint32 GRID_SIZE = 129;
+  std::vector<float3> positions = {};
+  for (uint32 y = 0; y < GRID_SIZE; y++) {
+    for (uint32 x = 0; x < GRID_SIZE; x++)
+      positions.emplace_back((float)x, std::sin((float)x * 0.3f) * std::cos((float)y * 0.2f) * 2.0f, (float)y);
+  }
+  std::vector<uint32> indices = {};
+  for (uint32 y = 0; y + 1 < GRID_SIZE; y++) {
+    for (uint32 x = 0; x + 1 < GRID_SIZE; x++) {
+      const uint32 i = y * GRID_SIZE + x;
+      indices.insert(indices.end(), {i, i + GRID_SIZE, i + 1, i + 1, i + GRID_SIZE, i + GRID_SIZE + 1});
+    }
+  }
+
+  const auto hierarchy = build(&positions[0].x, positions.size(), sizeof(float3), indices, {}, scheduler);
+  const auto fail = [](const char* message) {
+    OX_LOG_ERROR("MeshletHierarchy: {}", message);
+    return false;
+  };
+
+  if (hierarchy.levels.size() < 3)
+    return fail("the fixture didn't simplify into at least 3 levels");
+
+  std::vector<ClusterLod> lods = {};
+  for (const auto& cluster : hierarchy.clusters) {
+    const auto& lod = cluster.lod;
+    const bool has_parent = lod.parent.error < INFINITE_ERROR;
+    if (has_parent && lod.parent.error < lod.self.error)
+      return fail("a parent's error is smaller than its child's");
+    if (has_parent && glm::distance(lod.parent.center, lod.self.center) + lod.self.radius > lod.parent.radius * 1.001f + 1e-4f)
+      return fail("a parent's bounds don't enclose its child's");
+    if (lod.level != cluster.level)
+      return fail("a cluster's lod doesn't know its level");
+    lods.emplace_back(lod);
+  }
+
+  // the whole height field from close by to far away, in front of it and straight above it
+  const auto levels = build_level_bounds(lods);
+  const Mat4 transforms[] = {Mat4(1.0f), glm::scale(Mat4(1.0f), float3(0.25f, 0.5f, 0.25f))};
+  std::vector<uint32> expected = {};
+  std::vector<uint32> selected = {};
+  for (const auto& transform : transforms) {
+    const float scale = get_max_scale(transform);
+    for (const float distance : {0.0f, 10.0f, 50.0f, 200.0f, 1000.0f, 10000.0f}) {
+      for (const float3& direction : {float3(0.0f, 0.3f, -1.0f), float3(0.0f, 1.0f, 0.0f)}) {
+        const LodView view = {
+          .camera_position = float3(transform * float4(64.0f, 0.0f, 64.0f, 1.0f)) + glm::normalize(direction) * distance,
+          .projection_scale = 1080.0f,
+          .error_threshold = 1.0f,
+        };
+
+        expected.clear();
+        select_cut(lods, transform, view, expected);
+        if (expected.empty())
+          return fail("the cut is empty");
+
+        selected.clear();
+        for (const auto& level : levels) {
+          const auto cut = get_level_cut(level, transform, scale, view);
+          for (uint32 i = level.first; cut != LevelCut::None && i < level.first + level.count; i++) {
+            if (cut == LevelCut::All || is_in_cut(lods[i], transform, scale, view))
+              selected.emplace_back(i);
+          }
+        }
+        if (selected != expected)
+          return fail("the per level cut doesn't match testing every cluster");
+      }
+    }
+  }
+
+  return true;
+}
+} // namespace ox
@@ -0,0 +1,133 @@
+#pragma once
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "Core/Types.hpp"
+
+namespace ox {
+class TaskScheduler;
+
+// Cluster hierarchy for continuous LOD, built once at import time from an indexed triangle mesh.
+//	Level 0 are the meshlets of the source mesh. Every following level groups neighbouring clusters of the previous one,
+//	simplifies each group to half of its triangles with the group border locked and splits the result into new clusters.
+//	A cluster stores the bounds and error of the group it was built from (`self`) and of the group it was simplified into (`parent`).
+//	Errors only grow towards the root and parent bounds enclose self bounds, so each cluster decides on its own whether it's
+//	part of the cut: its own error is small enough on screen while its parent's isn't.
+//	The simplification error of a group is measured against its already simplified children, so it's added to their largest error.
+//	Per frame the cut is decided per level first (`get_level_cut`), only levels that straddle it test each of their clusters.
+//	Only depends on vertex positions and indices so both the build and the cut selection can be driven from plain CPU data.
+class MeshletHierarchy {
+public:
+  static constexpr float INFINITE_ERROR = std::numeric_limits<float>::max();
+
+  struct Settings {
+    uint32 max_vertices = 64;
+    uint32 max_triangles = 64;
+    float cone_weight = 0.0f;  // trades spatial locality for tighter backface cones
+    uint32 group_size = 4;     // clusters merged and simplified together
+    uint32 max_levels = 16;    // including level 0
+    float min_reduction = 0.85f; // groups that keep more than this fraction of their triangles aren't simplified any further
+  };
+
+  // bounding sphere and simplification error, in mesh space
+  struct Bounds {
+    float3 center = {};
+    float radius = 0.0f;
+    float error = 0.0f;
+  };
+
+  struct ClusterLod {
+    Bounds self = {};
+    Bounds parent = {.error = INFINITE_ERROR};
+    uint32 level = 0;
+  };
+
+  // Bounds over a run of clusters of the same level, enough to accept or reject all of them for the cut at once.
+  struct LevelBounds {
+    uint32 first = 0; // into the cluster list the levels were built from
+    uint32 count = 0;
+    float3 center = {};
+    float radius = 0.0f; // encloses the self and parent bounds of every cluster in the run
+    float min_self_error = 0.0f;
+    float max_self_error = 0.0f;
+    float min_parent_error = INFINITE_ERROR;
+    float max_parent_error = INFINITE_ERROR;
+  };
+
+  enum class LevelCut {
+    None,    // no cluster of the level is part of the cut
+    All,     // every cluster is
+    Partial, // each one has to be tested with `is_in_cut`
+  };
+
+  // bounding sphere and backface cone of the cluster's own triangles, see meshopt_computeMeshletBounds
+  struct CullingBounds {
+    float3 center = {};
+    float radius = 0.0f;
+    float3 apex = {};
+    float3 axis = {};
+    float cutoff = 1.0f;
+  };
+
+  struct Cluster {
+    uint32 vertex_offset = 0;   // into `meshlet_vertices`
+    uint32 vertex_count = 0;
+    uint32 triangle_offset = 0; // into `meshlet_triangles`, multiple of 4
+    uint32 triangle_count = 0;
+    uint32 level = 0;
+    ClusterLod lod = {};
+    CullingBounds culling = {};
+  };
+
+  struct Level {
+    uint32 first_cluster = 0;
+    uint32 cluster_count = 0;
+    uint32 triangle_count = 0;
+  };
+
+  // what the cut is selected for, in world space
+  struct LodView {
+    float3 camera_position = {};
+    float projection_scale = 1.0f; // pixels covered by one unit at distance one, projection[1][1] * viewport height / 2
+    float error_threshold = 1.0f;  // in pixels
+  };
+
+  std::vector<Cluster> clusters = {};
+  std::vector<uint32> meshlet_vertices = {}; // indices into the source vertices
+  std::vector<uint8> meshlet_triangles = {}; // cluster local vertex indices
+  std::vector<Level> levels = {};
+
+  /// Builds the hierarchy, groups of a level are simplified in parallel when `scheduler` is set.
+  static MeshletHierarchy build(const float* vertex_positions,
+                                size_t vertex_count,
+                                size_t vertex_stride,
+                                std::span<const uint32> indices,
+                                const Settings& settings = {},
+                                TaskScheduler* scheduler = nullptr);
+
+  /// @return Largest axis scale of `transform`, errors and radii are scaled by it.
+  static float get_max_scale(const Mat4& transform);
+  /// @return `bounds.error` in pixels when seen from `view`, infinite if the camera is inside the bounds.
+  static float get_projected_error(const Bounds& bounds, const Mat4& transform, float transform_scale, const LodView& view);
+  static bool is_in_cut(const ClusterLod& lod, const Mat4& transform, float transform_scale, const LodView& view) {
+    return get_projected_error(lod.self, transform, transform_scale, view) <= view.error_threshold &&
+           get_projected_error(lod.parent, transform, transform_scale, view) > view.error_threshold;
+  }
+
+  /// Appends every index of `lods` that's part of the cut to `selected`.
+  static void select_cut(std::span<const ClusterLod> lods, const Mat4& transform, const LodView& view, std::vector<uint32>& selected);
+
+  /// Splits `lods` into runs of clusters of the same level.
+  static std::vector<LevelBounds> build_level_bounds(std::span<const ClusterLod> lods);
+  /// Conservative, a level is only None or All if that holds for every one of its clusters.
+  static LevelCut get_level_cut(const LevelBounds& level, const Mat4& transform, float transform_scale, const LodView& view);
+
+  /// Builds the hierarchy of a synthetic height field and checks the error and bounds invariants,
+  /// and that the per level cut selects the same clusters as testing each one for a range of views.
+  /// @return false and logs the first mismatch.
+  static bool verify(TaskScheduler* scheduler = nullptr);
+
+  uint32 get_triangle_count(uint32 level) const { return level < levels.size() ? levels[level].triangle_count : 0; }
+};
+} // namespace ox
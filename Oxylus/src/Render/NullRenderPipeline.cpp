@@ -0,0 +1,196 @@
+﻿#include "NullRenderPipeline.hpp"
+
+#include <vuk/runtime/CommandBuffer.hpp>
+
+#include "Core/App.hpp"
+#include "DebugRenderer.hpp"
+#include "MeshVertex.hpp"
+#include "Physics/Physics.hpp"
+#include "RendererConfig.hpp"
+#include "Thread/TaskScheduler.hpp"
+#include "Utils/Log.hpp"
+#include "Utils/Profiler.hpp"
+#include "Utils/RingAllocator.hpp"
+#include "Utils/Timer.hpp"
+#include "VertexQuantizer.hpp"
+
+namespace ox {
+void NullRenderPipeline::init() {
+  OX_SCOPED_ZONE;
+
+  if (initalized)
+    return;
+
+  light_clusterer.init();
+
+  // there's no image to look at, so check the cpu side systems against known results once instead
+  if (!FrustumCuller::verify())
+    OX_LOG_ERROR("NullRenderPipeline: frustum culling self check failed.");
+  if (!LightClusterer::verify(App::get_system<TaskScheduler>()))
+    OX_LOG_ERROR("NullRenderPipeline: light clustering self check failed.");
+  if (!MeshletHierarchy::verify(App::get_system<TaskScheduler>()))
+    OX_LOG_ERROR("NullRenderPipeline: meshlet hierarchy self check failed.");
+  if (!ShadowAtlas::verify())
+    OX_LOG_ERROR("NullRenderPipeline: shadow atlas self check failed.");
+  if (!VertexQuantizer::verify())
+    OX_LOG_ERROR("NullRenderPipeline: vertex quantization self check failed.");
+  if (!RingAllocator::verify())
+    OX_LOG_ERROR("NullRenderPipeline: upload ring allocator self check failed.");
+
+  initalized = true;
+
+  OX_LOG_INFO("NullRenderPipeline initialized, frames are prepared but not rendered.");
+}
+
+vuk::Value<vuk::ImageAttachment> NullRenderPipeline::on_render(vuk::Allocator&,
+                                                               vuk::Value<vuk::ImageAttachment> target,
+                                                               vuk::Extent3D ext) {
+  render_frame(ext);
+  return target;
+}
+
+const NullRenderPipeline::FrameStats& NullRenderPipeline::render_frame(const vuk::Extent3D& ext) {
+  OX_SCOPED_ZONE;
+
+  FrameStats frame = {};
+
+  const Timer timer = {};
+  begin_frame();
+  allocate_shadow_tiles();
+  prepare_frame_data();
+  frame.prepare_ms = timer.get_elapsed_ms();
+
+  record_frame(frame, ext);
+
+  stats.last_frame = frame;
+  stats.frame_count += 1;
+  stats.total_prepare_ms += frame.prepare_ms;
+  stats.max_prepare_ms = std::max(stats.max_prepare_ms, frame.prepare_ms);
+  stats.peak_buffer_size = std::max(stats.peak_buffer_size, frame.total_buffer_size);
+
+  if (stats.frame_count % LOG_INTERVAL == 0)
+    log_stats();
+
+  return stats.last_frame;
+}
+
+void NullRenderPipeline::record_frame(FrameStats& frame, const vuk::Extent3D& ext) {
+  OX_SCOPED_ZONE;
+  frame.extent = ext;
+
+  // mirrors upload_frame_data()
+  const auto meshlet_instance_count = (uint64)scene_flattened.get_meshlet_instances_count();
+  constexpr uint64 max_meshlet_primitives = 64;
+
+  frame.scene_buffer_size = sizeof(SceneData);
+  frame.material_buffer_size = material_parameters.size() * sizeof(PBRMaterial::Parameters);
+  frame.sprite_material_buffer_size = sprite_material_parameters.size() * sizeof(SpriteMaterial::Parameters);
+  frame.light_buffer_size = light_datas.size() * sizeof(LightData);
+  frame.shader_entity_buffer_size = shader_entities.size() * sizeof(ShaderEntity);
+  frame.transform_buffer_size = scene_flattened.transforms.size() * sizeof(Mat4);
+  if (scene_data.light_clusters.enabled) {
+    frame.light_cluster_buffer_size = light_clusterer.get_clusters().size() * sizeof(LightClusterer::Cluster);
+    frame.cluster_light_buffer_size = std::max<size_t>(light_clusterer.get_light_indices().size(), 1) * sizeof(uint32);
+  }
+  frame.meshlet_buffer_size = scene_flattened.meshlets.size() * sizeof(Mesh::Meshlet);
+  frame.meshlet_instance_buffer_size = scene_flattened.meshlet_instances.size() * sizeof(Mesh::MeshletInstance);
+  frame.visible_meshlet_buffer_size = meshlet_instance_count * sizeof(uint32);
+  frame.instanced_index_buffer_size = meshlet_instance_count * max_meshlet_primitives * 3 * sizeof(uint32);
+  frame.index_buffer_size = scene_flattened.indices.size() * sizeof(uint32);
+  frame.vertex_buffer_size = scene_flattened.vertices.size() * sizeof(Vertex);
+  frame.primitive_buffer_size = scene_flattened.primitives.size() * sizeof(uint32);
+  frame.sprite_vertex_buffer_size = std::max<size_t>(render_queue_2d.sprite_data.size(), 1) * sizeof(SpriteGPUData);
+  frame.debug_aabb_buffer_size = get_debug_aabb_buffer_size();
+
+  frame.texture_bindings = (uint32)bindless_textures.size();
+
+  // mirrors the passes recorded in DefaultRenderPipeline::on_render(), gtao, fxaa, fsr and the grid are compiled out of it
+  const auto passes = get_pass_config();
+  frame.passes += 1; // cull_meshlets
+  frame.dispatches += 1;
+  frame.passes += 1; // cull_triangles
+  frame.indirect_dispatches += 1;
+  frame.passes += 1; // main_vis_buffer_pass
+  frame.indirect_draws += 1;
+  frame.passes += 1; // depth_copy_pass
+  frame.dispatches += 1;
+  frame.passes += 1; // hiz_pass
+  frame.dispatches += 1;
+  frame.passes += 1; // material_vis_buffer_pass
+  frame.draws += 1;
+  frame.passes += 1; // resolve_vis_buffer_pass
+  frame.draws += (uint32)scene_flattened.materials.size();
+
+  if (passes.sky_envmap) {
+    frame.passes += 2; // sky_envmap_pass + envmap_spd
+    frame.draws += 1;
+    frame.dispatches += 1;
+  }
+
+  frame.passes += 1; // shading_pass, sky view and shading
+  frame.draws += 2;
+
+  frame.passes += 1; // 2d_forward_pass
+  for (const auto& batch : render_queue_2d.batches) {
+    if (batch.count > 0)
+      frame.draws += 1;
+  }
+
+  frame.passes += 1; // debug_pass
+  frame.indirect_draws += 1;
+
+  if (passes.bloom) {
+    frame.passes += 1 + (BLOOM_MIP_COUNT - 1) * 2; // prefilter, downsample and upsample chains
+    frame.dispatches += 1 + (BLOOM_MIP_COUNT - 1) * 2;
+  }
+
+  frame.passes += 1; // final_pass
+  frame.draws += 1;
+
+  if (const auto* debug_renderer = DebugRenderer::get_instance()) {
+    gather_debug_draws(*debug_renderer);
+    frame.debug_vertex_buffer_size = std::max<size_t>(debug_vertices.size(), 1) * sizeof(Vertex);
+
+    for (const auto& range : debug_draw_ranges) {
+      for (const auto shape_count : range.shape_counts)
+        frame.debug_shape_buffer_size += shape_count * sizeof(DebugRenderer::ShapeInstance);
+    }
+    frame.debug_shape_buffer_size += debug_mesh_instances.size() * sizeof(PhysicsDebugRenderer::MeshInstance);
+
+    // the data is uploaded either way, the pass only exists once its pipelines are there
+    if (passes.debug_renderer) {
+      frame.passes += 1; // debug_pass2
+      frame.draws += debug_draw_ranges[DEBUG_ON_TOP].get_draw_count() + debug_draw_ranges[DEBUG_DEPTH_TESTED].get_draw_count() +
+                     (uint32)debug_mesh_draws.size();
+    }
+
+    DebugRenderer::reset();
+  }
+
+  frame.total_buffer_size = frame.scene_buffer_size + frame.material_buffer_size + frame.sprite_material_buffer_size + frame.light_buffer_size +
+                            frame.shader_entity_buffer_size + frame.transform_buffer_size + frame.light_cluster_buffer_size +
+                            frame.cluster_light_buffer_size + frame.meshlet_buffer_size + frame.meshlet_instance_buffer_size +
+                            frame.visible_meshlet_buffer_size + frame.instanced_index_buffer_size + frame.index_buffer_size +
+                            frame.vertex_buffer_size + frame.primitive_buffer_size + frame.sprite_vertex_buffer_size +
+                            frame.debug_aabb_buffer_size + frame.debug_vertex_buffer_size + frame.debug_shape_buffer_size;
+}
+
+void NullRenderPipeline::log_stats() const {
+  const auto& frame = stats.last_frame;
+  OX_LOG_INFO("NullRenderPipeline: {} frames at {}x{}, prepare avg {:.3f} ms max {:.3f} ms, buffers {} KB (peak {} KB)",
+              stats.frame_count,
+              frame.extent.width,
+              frame.extent.height,
+              stats.get_average_prepare_ms(),
+              stats.max_prepare_ms,
+              frame.total_buffer_size / 1024,
+              stats.peak_buffer_size / 1024);
+  OX_LOG_INFO("NullRenderPipeline: {} passes, {} draws, {} indirect draws, {} dispatches, {} indirect dispatches, {} texture bindings",
+              frame.passes,
+              frame.draws,
+              frame.indirect_draws,
+              frame.dispatches,
+              frame.indirect_dispatches,
+              frame.texture_bindings);
+}
+} // namespace ox
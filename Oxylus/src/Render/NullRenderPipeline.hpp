@@ -0,0 +1,86 @@
+﻿#pragma once
+#include "DefaultRenderPipeline.hpp"
+
+namespace ox {
+// Runs the CPU side of DefaultRenderPipeline without a Vulkan device.
+//	Submissions go through the same flattening, culling, sorting, light clustering, shadow atlas packing and
+//	material/sprite preparation, but instead of creating buffers and recording passes it records what
+//	DefaultRenderPipeline would have uploaded and recorded for the frame.
+//	Meant to measure render side CPU regressions on machines without a GPU, it's used in place of DefaultRenderPipeline
+//	with `rr.null_render_pipeline` or the `null-render-pipeline` command line argument and logs its stats every
+//	`LOG_INTERVAL` frames. Use `render_frame()` when there is no vuk allocator to pass to `on_render()`.
+class NullRenderPipeline : public DefaultRenderPipeline {
+public:
+  static constexpr uint64 LOG_INTERVAL = 600;
+
+  struct FrameStats {
+    vuk::Extent3D extent = {};
+
+    // bytes DefaultRenderPipeline would allocate for each buffer
+    uint64 scene_buffer_size = 0;
+    uint64 material_buffer_size = 0;
+    uint64 sprite_material_buffer_size = 0;
+    uint64 light_buffer_size = 0;
+    uint64 shader_entity_buffer_size = 0;
+    uint64 transform_buffer_size = 0;
+    uint64 light_cluster_buffer_size = 0;
+    uint64 cluster_light_buffer_size = 0;
+    uint64 meshlet_buffer_size = 0;
+    uint64 meshlet_instance_buffer_size = 0;
+    uint64 visible_meshlet_buffer_size = 0;
+    uint64 instanced_index_buffer_size = 0;
+    uint64 index_buffer_size = 0;
+    uint64 vertex_buffer_size = 0;
+    uint64 primitive_buffer_size = 0;
+    uint64 sprite_vertex_buffer_size = 0;
+    uint64 debug_aabb_buffer_size = 0;
+    uint64 debug_vertex_buffer_size = 0;
+    uint64 debug_shape_buffer_size = 0; // shape and physics mesh instances
+    uint64 total_buffer_size = 0;
+
+    uint32 texture_bindings = 0; // bindless texture descriptor writes
+
+    uint32 passes = 0;
+    uint32 draws = 0;
+    uint32 indirect_draws = 0;
+    uint32 dispatches = 0;
+    uint32 indirect_dispatches = 0;
+
+    float prepare_ms = 0.0f; // begin_frame + shadow tiles + prepare_frame_data
+  };
+
+  struct Stats {
+    FrameStats last_frame = {};
+    uint64 frame_count = 0;
+    double total_prepare_ms = 0.0;
+    float max_prepare_ms = 0.0f;
+    uint64 peak_buffer_size = 0;
+
+    float get_average_prepare_ms() const { return frame_count ? float(total_prepare_ms / (double)frame_count) : 0.0f; }
+  };
+
+  explicit NullRenderPipeline(const std::string& name) : DefaultRenderPipeline(name) { gpu_resources = false; }
+
+  ~NullRenderPipeline() override = default;
+
+  /// Nothing is allocated, the allocator isn't used.
+  void init(vuk::Allocator&) override { init(); }
+  void init();
+  void shutdown() override {}
+
+  /// Does the frame's CPU work and returns `target` untouched, nothing is allocated from `frame_allocator`.
+  [[nodiscard]] vuk::Value<vuk::ImageAttachment> on_render(vuk::Allocator& frame_allocator,
+                                                           vuk::Value<vuk::ImageAttachment> target,
+                                                           vuk::Extent3D ext) override;
+  const FrameStats& render_frame(const vuk::Extent3D& ext);
+
+  const Stats& get_stats() const { return stats; }
+  void reset_stats() { stats = {}; }
+  void log_stats() const;
+
+private:
+  Stats stats = {};
+
+  void record_frame(FrameStats& frame, const vuk::Extent3D& ext);
+};
+} // namespace ox
@@ -0,0 +1,265 @@
+﻿#include "OcclusionCuller.hpp"
+
+#include <fmt/format.h>
+
+#include "Core/FileSystem.hpp"
+#include "Thread/TaskScheduler.hpp"
+
+#include "Utils/Profiler.hpp"
+#include "Utils/SIMD.hpp"
+
+namespace ox {
+static constexpr float NEAR_W_EPSILON = 1e-4f;
+
+void OcclusionCuller::init(const uint32 width_, const uint32 height_) {
+  // rows are processed 4 pixels at a time
+  width = (std::max(width_, 4u) + 3u) & ~3u;
+  height = std::max(height_, 1u);
+  depth.assign((size_t)width * height, 0.0f);
+}
+
+void OcclusionCuller::begin(const Mat4& view_projection_) {
+  if (depth.empty())
+    init();
+
+  view_projection = view_projection_;
+  std::fill(depth.begin(), depth.end(), 0.0f);
+  triangles.clear();
+}
+
+void OcclusionCuller::add_occluder(const Mesh& mesh, const Mesh::Node& node, const Mat4& transform) {
+  OX_SCOPED_ZONE;
+
+  const Mat4 mvp = view_projection * transform;
+  const float2 screen_size = float2((float)width, (float)height);
+
+  for (const auto& instance : node.meshlet_indices) {
+    const auto& meshlet = mesh._meshlets[instance.meshletId];
+
+    for (uint32 tri = 0; tri < meshlet.primitive_count; tri++) {
+      float3 screen[3];
+      bool behind_near = false;
+
+      for (uint32 k = 0; k < 3; k++) {
+        const uint32 primitive = mesh._primitives[meshlet.primitive_offset + tri * 3 + k];
+        const auto position = mesh.get_vertex_position(meshlet, mesh._indices[meshlet.index_offset + primitive]);
+
+        const float4 clip = mvp * float4(position, 1.0f);
+        if (clip.w <= NEAR_W_EPSILON) {
+          behind_near = true;
+          break;
+        }
+
+        const float3 ndc = float3(clip) / clip.w;
+        screen[k] = float3((float2(ndc) * 0.5f + 0.5f) * screen_size, ndc.z);
+      }
+
+      // dropping an occluder is always safe, it can only make culling less effective
+      if (behind_near)
+        continue;
+
+      const float2 min = glm::min(glm::min(float2(screen[0]), float2(screen[1])), float2(screen[2]));
+      const float2 max = glm::max(glm::max(float2(screen[0]), float2(screen[1])), float2(screen[2]));
+      if (max.x < 0.0f || max.y < 0.0f || min.x >= screen_size.x || min.y >= screen_size.y)
+        continue;
+
+      ScreenTriangle triangle = {
+        .v0 = float2(screen[0]),
+        .v1 = float2(screen[1]),
+        .v2 = float2(screen[2]),
+        .depth = std::max(std::min(std::min(screen[0].z, screen[1].z), screen[2].z), 0.0f),
+      };
+
+      const float2 e0 = triangle.v1 - triangle.v0;
+      const float2 e1 = triangle.v2 - triangle.v0;
+      const float area = e0.x * e1.y - e0.y * e1.x;
+      if (std::abs(area) < 1e-6f)
+        continue;
+
+      // make the winding consistent so edge functions are positive inside
+      if (area < 0.0f)
+        std::swap(triangle.v1, triangle.v2);
+
+      triangles.emplace_back(triangle);
+    }
+  }
+}
+
+void OcclusionCuller::rasterize(TaskScheduler* scheduler) {
+  OX_SCOPED_ZONE;
+
+  const uint32 bin_count = (height + BIN_HEIGHT - 1) / BIN_HEIGHT;
+
+  if (!scheduler) {
+    for (uint32 bin = 0; bin < bin_count; bin++)
+      rasterize_bin(bin);
+    return;
+  }
+
+  // bins own disjoint rows of the depth buffer so they don't need any synchronization
+  TaskSet task(bin_count, [this](const TaskSetPartition range, uint32_t) {
+    for (uint32 bin = range.start; bin < range.end; bin++)
+      rasterize_bin(bin);
+  });
+  scheduler->schedule_task(&task);
+  scheduler->wait_task(&task);
+}
+
+void OcclusionCuller::rasterize_bin(const uint32 bin) {
+  OX_SCOPED_ZONE;
+
+  const int32 bin_min_y = (int32)(bin * BIN_HEIGHT);
+  const int32 bin_max_y = std::min((int32)height, bin_min_y + (int32)BIN_HEIGHT) - 1;
+
+  for (const auto& tri : triangles) {
+    const int32 min_y = std::max(bin_min_y, (int32)std::floor(std::min(std::min(tri.v0.y, tri.v1.y), tri.v2.y)));
+    const int32 max_y = std::min(bin_max_y, (int32)std::ceil(std::max(std::max(tri.v0.y, tri.v1.y), tri.v2.y)));
+    if (min_y > max_y)
+      continue;
+
+    const int32 min_x = std::max(0, (int32)std::floor(std::min(std::min(tri.v0.x, tri.v1.x), tri.v2.x))) & ~3;
+    const int32 max_x = std::min((int32)width - 1, (int32)std::ceil(std::max(std::max(tri.v0.x, tri.v1.x), tri.v2.x)));
+    if (min_x > max_x)
+      continue;
+
+    // edge functions in the form a * x + b * y + c, the edge opposite of each vertex
+    const float2* v[3] = {&tri.v0, &tri.v1, &tri.v2};
+    float a[3], b[3], c[3];
+    for (uint32 i = 0; i < 3; i++) {
+      const float2& p0 = *v[(i + 1) % 3];
+      const float2& p1 = *v[(i + 2) % 3];
+      a[i] = p0.y - p1.y;
+      b[i] = p1.x - p0.x;
+      c[i] = p0.x * p1.y - p0.y * p1.x;
+    }
+
+    for (int32 y = min_y; y <= max_y; y++) {
+      const float py = (float)y + 0.5f;
+      float* row = depth.data() + (size_t)y * width;
+
+#if OX_SIMD_SSE
+      const __m128 tri_depth = _mm_set1_ps(tri.depth);
+      const __m128 lane_offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+      const __m128 a0 = _mm_set1_ps(a[0]), a1 = _mm_set1_ps(a[1]), a2 = _mm_set1_ps(a[2]);
+      const __m128 row0 = _mm_set1_ps(b[0] * py + c[0]), row1 = _mm_set1_ps(b[1] * py + c[1]), row2 = _mm_set1_ps(b[2] * py + c[2]);
+
+      for (int32 x = min_x; x <= max_x; x += 4) {
+        const __m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane_offsets);
+        const __m128 w0 = _mm_add_ps(_mm_mul_ps(a0, px), row0);
+        const __m128 w1 = _mm_add_ps(_mm_mul_ps(a1, px), row1);
+        const __m128 w2 = _mm_add_ps(_mm_mul_ps(a2, px), row2);
+
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)), _mm_cmpge_ps(w2, zero));
+        if (_mm_movemask_ps(inside) == 0)
+          continue;
+
+        const __m128 current = _mm_loadu_ps(row + x);
+        const __m128 nearer = _mm_max_ps(current, tri_depth);
+        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, current)));
+      }
+#else
+      for (int32 x = min_x; x <= max_x; x++) {
+        const float px = (float)x + 0.5f;
+        const bool inside = a[0] * px + b[0] * py + c[0] >= 0.0f && a[1] * px + b[1] * py + c[1] >= 0.0f && a[2] * px + b[2] * py + c[2] >= 0.0f;
+        if (inside)
+          row[x] = std::max(row[x], tri.depth);
+      }
+#endif
+    }
+  }
+}
+
+bool OcclusionCuller::project(const AABB& aabb, ScreenRect& rect) const {
+  float2 min = float2(std::numeric_limits<float>::max());
+  float2 max = float2(std::numeric_limits<float>::lowest());
+  float nearest = 0.0f;
+
+  for (uint32 i = 0; i < 8; i++) {
+    const float3 corner = float3(i & 1 ? aabb.max.x : aabb.min.x, i & 2 ? aabb.max.y : aabb.min.y, i & 4 ? aabb.max.z : aabb.min.z);
+    const float4 clip = view_projection * float4(corner, 1.0f);
+    if (clip.w <= NEAR_W_EPSILON)
+      return false;
+
+    const float3 ndc = float3(clip) / clip.w;
+    const float2 screen = (float2(ndc) * 0.5f + 0.5f) * float2((float)width, (float)height);
+    min = glm::min(min, screen);
+    max = glm::max(max, screen);
+    nearest = std::max(nearest, ndc.z);
+  }
+
+  rect = {
+    .min_x = std::max(0, (int32)std::floor(min.x)),
+    .min_y = std::max(0, (int32)std::floor(min.y)),
+    .max_x = std::min((int32)width - 1, (int32)std::floor(max.x)),
+    .max_y = std::min((int32)height - 1, (int32)std::floor(max.y)),
+    .nearest_depth = nearest,
+  };
+
+  return true;
+}
+
+bool OcclusionCuller::is_visible(const AABB& aabb) const {
+  ScreenRect rect;
+  if (!project(aabb, rect))
+    return true;
+
+  // off-screen bounds are left to frustum culling
+  if (rect.min_x > rect.max_x || rect.min_y > rect.max_y)
+    return true;
+
+  for (int32 y = rect.min_y; y <= rect.max_y; y++) {
+    const float* row = depth.data() + (size_t)y * width;
+
+#if OX_SIMD_SSE
+    const __m128 nearest = _mm_set1_ps(rect.nearest_depth);
+    const __m128i min_x = _mm_set1_epi32(rect.min_x - 1);
+    const __m128i max_x = _mm_set1_epi32(rect.max_x + 1);
+
+    for (int32 x = rect.min_x & ~3; x <= rect.max_x; x += 4) {
+      const __m128i lanes = _mm_add_epi32(_mm_set1_epi32(x), _mm_setr_epi32(0, 1, 2, 3));
+      const __m128 in_rect = _mm_castsi128_ps(_mm_and_si128(_mm_cmpgt_epi32(lanes, min_x), _mm_cmplt_epi32(lanes, max_x)));
+      // visible if any covered pixel is farther than the nearest point of the bounds
+      const __m128 visible = _mm_and_ps(in_rect, _mm_cmplt_ps(_mm_loadu_ps(row + x), nearest));
+      if (_mm_movemask_ps(visible) != 0)
+        return true;
+    }
+#else
+    for (int32 x = rect.min_x; x <= rect.max_x; x++) {
+      if (row[x] < rect.nearest_depth)
+        return true;
+    }
+#endif
+  }
+
+  return false;
+}
+
+float OcclusionCuller::get_screen_coverage(const AABB& aabb) const {
+  ScreenRect rect;
+  if (!project(aabb, rect))
+    return 1.0f;
+
+  if (rect.min_x > rect.max_x || rect.min_y > rect.max_y)
+    return 0.0f;
+
+  return float((rect.max_x - rect.min_x + 1) * (rect.max_y - rect.min_y + 1)) / float(width * height);
+}
+
+bool OcclusionCuller::dump_depth(const std::string_view path) const {
+  const std::string header = fmt::format("P5\n{} {}\n255\n", width, height);
+
+  // reversed-z values are tiny for anything not right in front of the camera, normalize to make them readable
+  float max_depth = 0.0f;
+  for (const float d : depth)
+    max_depth = std::max(max_depth, d);
+  const float scale = max_depth > 0.0f ? 255.0f / max_depth : 0.0f;
+
+  std::vector<uint8_t> data(header.begin(), header.end());
+  data.reserve(header.size() + depth.size());
+  for (const float d : depth)
+    data.emplace_back((uint8_t)(d * scale));
+
+  return fs::write_file_binary(path, data);
+}
+} // namespace ox
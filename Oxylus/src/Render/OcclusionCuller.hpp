@@ -0,0 +1,71 @@
+﻿#pragma once
+#include <string_view>
+#include <vector>
+
+#include "BoundingVolume.hpp"
+#include "Mesh.hpp"
+
+#include "Core/Types.hpp"
+
+namespace ox {
+class TaskScheduler;
+
+// Software occlusion culling against a low resolution depth buffer.
+//	Occluder triangles are rasterized with SIMD edge tests into horizontal bins that run on the TaskScheduler,
+//	each triangle writes its farthest vertex depth so the result stays conservative.
+//	Bounds are then tested against the buffer and rejected if every pixel they cover is already occluded.
+//	Depth is reversed-z like the rest of the renderer, 0 is the far plane.
+class OcclusionCuller {
+public:
+  static constexpr uint32 DEFAULT_WIDTH = 320;
+  static constexpr uint32 DEFAULT_HEIGHT = 192;
+  static constexpr uint32 BIN_HEIGHT = 16;
+
+  void init(uint32 width = DEFAULT_WIDTH, uint32 height = DEFAULT_HEIGHT);
+
+  // Clears the depth buffer and occluders for a new view.
+  void begin(const Mat4& view_projection);
+
+  // Adds the triangles of a mesh node as occluders. Triangles crossing the near plane are skipped.
+  void add_occluder(const Mesh& mesh, const Mesh::Node& node, const Mat4& transform);
+
+  // Rasterizes all occluders. Runs single threaded if no scheduler is given.
+  void rasterize(TaskScheduler* scheduler = nullptr);
+
+  // Returns false if the bounds are fully hidden behind the rasterized occluders.
+  bool is_visible(const AABB& aabb) const;
+
+  // Fraction of the screen the bounds cover, used for picking occluders automatically.
+  float get_screen_coverage(const AABB& aabb) const;
+
+  // Writes the depth buffer as a binary PGM image.
+  bool dump_depth(std::string_view path) const;
+
+  uint32 get_width() const { return width; }
+  uint32 get_height() const { return height; }
+  uint32 get_triangle_count() const { return (uint32)triangles.size(); }
+  const std::vector<float>& get_depth() const { return depth; }
+
+private:
+  struct ScreenTriangle {
+    float2 v0, v1, v2;
+    float depth; // farthest depth of the triangle
+  };
+
+  struct ScreenRect {
+    int32 min_x, min_y, max_x, max_y;
+    float nearest_depth;
+  };
+
+  uint32 width = 0;
+  uint32 height = 0;
+  Mat4 view_projection = {};
+
+  std::vector<float> depth = {};
+  std::vector<ScreenTriangle> triangles = {};
+
+  void rasterize_bin(uint32 bin);
+  // Returns false if the bounds cross the near plane, which makes them trivially visible.
+  bool project(const AABB& aabb, ScreenRect& rect) const;
+};
+} // namespace ox
@@ -1,11 +1,161 @@
 #include "ParticleSystem.hpp"
 
+#include <cstring>
 #include <glm/gtx/norm.hpp>
+#include <limits>
+#include <random>
 
+#include "Thread/TaskScheduler.hpp"
+#include "Utils/Log.hpp"
 #include "Utils/Profiler.hpp"
+#include "Utils/SIMD.hpp"
+#include "Utils/Timer.hpp"
 
 namespace ox {
-ParticleSystem::ParticleSystem() : particles(10000) {
+namespace {
+uint32_t round_up_4(const uint32_t value) { return (value + 3u) & ~3u; }
+
+// kernels below work on [begin, end), begin and end are multiples of 4
+
+void fill(float* out, const float value, const uint32_t begin, const uint32_t end) {
+  for (uint32_t i = begin; i < end; i++)
+    out[i] = value;
+}
+
+// life -= dt, age_factor = clamp(life / lifetime, 0, 1)
+void age(float* life, float* age_factor, const float dt, const float inv_lifetime, const uint32_t begin, const uint32_t end) {
+#if OX_SIMD_SSE
+  const __m128 dt4 = _mm_set1_ps(dt);
+  const __m128 inv4 = _mm_set1_ps(inv_lifetime);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (uint32_t i = begin; i < end; i += 4) {
+    const __m128 l = _mm_sub_ps(_mm_loadu_ps(&life[i]), dt4);
+    _mm_storeu_ps(&life[i], l);
+    _mm_storeu_ps(&age_factor[i], _mm_min_ps(_mm_max_ps(_mm_mul_ps(l, inv4), zero), one));
+  }
+#else
+  for (uint32_t i = begin; i < end; i++) {
+    life[i] -= dt;
+    age_factor[i] = glm::clamp(life[i] * inv_lifetime, 0.0f, 1.0f);
+  }
+#endif
+}
+
+// value += (lerp(to, from, factor) + constant) * dt
+void accumulate(float* value, const float* factor, const float from, const float to, const float constant, const float dt, const uint32_t begin, const uint32_t end) {
+#if OX_SIMD_SSE
+  const __m128 to4 = _mm_set1_ps(to);
+  const __m128 range4 = _mm_set1_ps(from - to);
+  const __m128 constant4 = _mm_set1_ps(constant);
+  const __m128 dt4 = _mm_set1_ps(dt);
+  for (uint32_t i = begin; i < end; i += 4) {
+    const __m128 f = _mm_add_ps(_mm_add_ps(to4, _mm_mul_ps(range4, _mm_loadu_ps(&factor[i]))), constant4);
+    _mm_storeu_ps(&value[i], _mm_add_ps(_mm_loadu_ps(&value[i]), _mm_mul_ps(f, dt4)));
+  }
+#else
+  for (uint32_t i = begin; i < end; i++)
+    value[i] += (to + (from - to) * factor[i] + constant) * dt;
+#endif
+}
+
+// out = out * lerp(to, from, factor)
+void multiply_lerp(float* out, const float* factor, const float from, const float to, const uint32_t begin, const uint32_t end) {
+#if OX_SIMD_SSE
+  const __m128 to4 = _mm_set1_ps(to);
+  const __m128 range4 = _mm_set1_ps(from - to);
+  for (uint32_t i = begin; i < end; i += 4) {
+    const __m128 f = _mm_add_ps(to4, _mm_mul_ps(range4, _mm_loadu_ps(&factor[i])));
+    _mm_storeu_ps(&out[i], _mm_mul_ps(_mm_loadu_ps(&out[i]), f));
+  }
+#else
+  for (uint32_t i = begin; i < end; i++)
+    out[i] *= to + (from - to) * factor[i];
+#endif
+}
+
+// out = out + lerp(to, from, factor)
+void add_lerp(float* out, const float* factor, const float from, const float to, const uint32_t begin, const uint32_t end) {
+#if OX_SIMD_SSE
+  const __m128 to4 = _mm_set1_ps(to);
+  const __m128 range4 = _mm_set1_ps(from - to);
+  for (uint32_t i = begin; i < end; i += 4) {
+    const __m128 f = _mm_add_ps(to4, _mm_mul_ps(range4, _mm_loadu_ps(&factor[i])));
+    _mm_storeu_ps(&out[i], _mm_add_ps(_mm_loadu_ps(&out[i]), f));
+  }
+#else
+  for (uint32_t i = begin; i < end; i++)
+    out[i] += to + (from - to) * factor[i];
+#endif
+}
+
+// position += velocity * scale(age) * dt and speed = |velocity * scale(age)|
+void integrate(float* const* position,
+               const float* const* velocity,
+               const float* age_factor,
+               const glm::vec3& scale_from,
+               const glm::vec3& scale_to,
+               float* speed,
+               const float dt,
+               const uint32_t begin,
+               const uint32_t end) {
+#if OX_SIMD_SSE
+  const __m128 dt4 = _mm_set1_ps(dt);
+  for (uint32_t i = begin; i < end; i += 4) {
+    const __m128 t = _mm_loadu_ps(&age_factor[i]);
+    __m128 speed_sq = _mm_setzero_ps();
+    for (uint32_t axis = 0; axis < 3; axis++) {
+      const __m128 scale = _mm_add_ps(_mm_set1_ps(scale_to[axis]), _mm_mul_ps(_mm_set1_ps(scale_from[axis] - scale_to[axis]), t));
+      const __m128 v = _mm_mul_ps(_mm_loadu_ps(&velocity[axis][i]), scale);
+      _mm_storeu_ps(&position[axis][i], _mm_add_ps(_mm_loadu_ps(&position[axis][i]), _mm_mul_ps(v, dt4)));
+      speed_sq = _mm_add_ps(speed_sq, _mm_mul_ps(v, v));
+    }
+    _mm_storeu_ps(&speed[i], _mm_sqrt_ps(speed_sq));
+  }
+#else
+  for (uint32_t i = begin; i < end; i++) {
+    float speed_sq = 0.0f;
+    for (uint32_t axis = 0; axis < 3; axis++) {
+      const float v = velocity[axis][i] * (scale_to[axis] + (scale_from[axis] - scale_to[axis]) * age_factor[i]);
+      position[axis][i] += v * dt;
+      speed_sq += v * v;
+    }
+    speed[i] = std::sqrt(speed_sq);
+  }
+#endif
+}
+
+// factor = clamp((speed - min) / (max - min), 0, 1)
+void speed_factor(const float* speed, float* factor, const float min_speed, const float max_speed, const uint32_t begin, const uint32_t end) {
+  const float range = max_speed - min_speed;
+  const float inv_range = range != 0.0f ? 1.0f / range : 0.0f;
+#if OX_SIMD_SSE
+  const __m128 min4 = _mm_set1_ps(min_speed);
+  const __m128 inv4 = _mm_set1_ps(inv_range);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (uint32_t i = begin; i < end; i += 4) {
+    const __m128 f = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&speed[i]), min4), inv4);
+    _mm_storeu_ps(&factor[i], _mm_min_ps(_mm_max_ps(f, zero), one));
+  }
+#else
+  for (uint32_t i = begin; i < end; i++)
+    factor[i] = glm::clamp((speed[i] - min_speed) * inv_range, 0.0f, 1.0f);
+#endif
+}
+
+// splitmix64, small and good enough for spawn positions
+uint64_t next_random(uint64_t& state) {
+  uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+} // namespace
+
+ParticleSystem::ParticleSystem() {
+  reseed();
+
   if (properties.play_on_awake)
     play();
 
@@ -14,33 +164,76 @@ ParticleSystem::ParticleSystem() : particles(10000) {
 
 void ParticleSystem::play() {
   system_time = 0.0f;
+  step_accumulator = 0.0f;
+  // a deterministic run always starts from the same state
+  if (properties.deterministic)
+    reset();
   playing = true;
 }
 
+void ParticleSystem::reset() {
+  particle_count = 0;
+  system_time = 0.0f;
+  step_accumulator = 0.0f;
+  spawn_time = 0.0f;
+  burst_time = 0.0f;
+  last_spawned_position = glm::vec3(0.0f);
+  reseed();
+}
+
+void ParticleSystem::reseed() {
+  random_state = properties.deterministic ? properties.seed : std::random_device{}();
+  seeded_deterministic = properties.deterministic;
+  seeded_seed = properties.seed;
+}
+
 void ParticleSystem::stop(bool force) {
-  if (force) {
-    for (auto& particle : particles)
-      particle.life_remaining = 0.0f;
-  }
+  if (force)
+    particle_count = 0;
 
   system_time = properties.start_delay + properties.duration;
   playing = false;
 }
 
-void ParticleSystem::on_update(float ts, const glm::vec3& position) {
+void ParticleSystem::on_update(float ts, const glm::vec3& position, TaskScheduler* scheduler) {
   OX_SCOPED_ZONE;
-  const float simTs = ts * properties.simulation_speed;
+  const Timer timer = {};
+  stats = {};
+
+  reserve(properties.max_particles);
+
+  // properties are edited in place (inspector, deserialization), so changes to the random stream are picked up here
+  if (properties.deterministic != seeded_deterministic || (properties.deterministic && properties.seed != seeded_seed))
+    reset();
+
+  const float sim_ts = ts * properties.simulation_speed;
+  if (!properties.deterministic) {
+    step(sim_ts, position, scheduler);
+  } else {
+    step_accumulator = std::min(step_accumulator + sim_ts, properties.fixed_time_step * MAX_FIXED_STEPS);
+    while (properties.fixed_time_step > 0.0f && step_accumulator >= properties.fixed_time_step) {
+      step(properties.fixed_time_step, position, scheduler);
+      step_accumulator -= properties.fixed_time_step;
+    }
+  }
+
+  stats.update_ms = timer.get_elapsed_ms();
+}
+
+void ParticleSystem::step(const float dt, const glm::vec3& position, TaskScheduler* scheduler) {
+  stats.steps += 1;
 
   if (playing && !properties.looping)
-    system_time += simTs;
+    system_time += dt;
   const float delay = properties.start_delay;
-  if (playing && (properties.looping || (system_time <= delay + properties.duration && system_time >
-                                             delay))) {
-    // Emit particles in unit time
-    spawn_time += simTs;
-    if (spawn_time >= 1.0f / static_cast<float>(properties.rate_over_time)) {
-      spawn_time = 0.0f;
-      emit(position, 1);
+  if (playing && (properties.looping || (system_time <= delay + properties.duration && system_time > delay))) {
+    // Emit particles in unit time, the remainder carries over to the next step
+    if (properties.rate_over_time > 0) {
+      spawn_time += dt;
+      const float interval = 1.0f / static_cast<float>(properties.rate_over_time);
+      const auto count = static_cast<uint32_t>(spawn_time / interval);
+      spawn_time -= static_cast<float>(count) * interval;
+      emit(position, count);
     }
 
     // Emit particles over unit distance
@@ -50,95 +243,302 @@ void ParticleSystem::on_update(float ts, const glm::vec3& position) {
     }
 
     // Emit bursts of particles over time
-    burst_time += simTs;
+    burst_time += dt;
     if (burst_time >= properties.burst_time) {
       burst_time = 0.0f;
       emit(position, properties.burst_count);
     }
   }
 
-  // Simulate
-  active_particle_count = 0;
-  for (auto& particle : particles) {
-    if (particle.life_remaining <= 0.0f)
-      continue;
+  // every kernel is element wise, so the result doesn't depend on how the particles are split up
+  const uint32_t padded_count = round_up_4(particle_count);
+  const uint32_t chunk_count = (padded_count + SIMULATION_CHUNK_SIZE - 1) / SIMULATION_CHUNK_SIZE;
+  if (scheduler && chunk_count > 1) {
+    TaskSet task(chunk_count, [this, dt, padded_count](const TaskSetPartition range, uint32_t) {
+      for (uint32_t chunk = range.start; chunk < range.end; chunk++)
+        simulate(chunk * SIMULATION_CHUNK_SIZE, std::min(padded_count, (chunk + 1) * SIMULATION_CHUNK_SIZE), dt);
+    });
+    scheduler->schedule_task(&task);
+    scheduler->wait_task(&task);
+  } else if (padded_count > 0) {
+    simulate(0, padded_count, dt);
+  }
 
-    particle.life_remaining -= simTs;
+  compact();
+}
 
-    const float t = glm::clamp(particle.life_remaining / properties.start_lifetime, 0.0f, 1.0f);
+void ParticleSystem::simulate(const uint32_t begin, const uint32_t end, const float dt) {
+  OX_SCOPED_ZONE;
+  auto* s = streams.data();
+  float* t = age_factors.data();
 
-    glm::vec3 velocity = properties.start_velocity;
-    if (properties.velocity_over_lifetime.enabled)
-      velocity *= properties.velocity_over_lifetime.evaluate(t);
+  age(s[Life].data(), t, dt, properties.start_lifetime > 0.0f ? 1.0f / properties.start_lifetime : 0.0f, begin, end);
 
-    glm::vec3 force(0.0f);
-    if (properties.force_over_lifetime.enabled)
-      force = properties.force_over_lifetime.evaluate(t);
+  // Forces
+  const glm::vec3 force_from = properties.force_over_lifetime.enabled ? properties.force_over_lifetime.start : glm::vec3(0.0f);
+  const glm::vec3 force_to = properties.force_over_lifetime.enabled ? properties.force_over_lifetime.end : glm::vec3(0.0f);
+  const glm::vec3 gravity = glm::vec3(0.0f, properties.gravity_modifier * -9.8f, 0.0f);
+  for (uint32_t axis = 0; axis < 3; axis++) {
+    if (force_from[axis] != 0.0f || force_to[axis] != 0.0f || gravity[axis] != 0.0f)
+      accumulate(s[VelocityX + axis].data(), t, force_from[axis], force_to[axis], gravity[axis], dt, begin, end);
+  }
 
-    force.y += properties.gravity_modifier * -9.8f;
-    velocity += force * simTs;
+  // Velocity
+  const glm::vec3 scale_from = properties.velocity_over_lifetime.enabled ? properties.velocity_over_lifetime.start : glm::vec3(1.0f);
+  const glm::vec3 scale_to = properties.velocity_over_lifetime.enabled ? properties.velocity_over_lifetime.end : glm::vec3(1.0f);
+  float* position[3] = {s[PositionX].data(), s[PositionY].data(), s[PositionZ].data()};
+  const float* velocity[3] = {s[VelocityX].data(), s[VelocityY].data(), s[VelocityZ].data()};
+  integrate(position, velocity, t, scale_from, scale_to, speeds.data(), dt, begin, end);
 
-    const float velocityMagnitude = glm::length(velocity);
+  // Color
+  for (uint32_t c = 0; c < 4; c++)
+    fill(s[ColorR + c].data(), properties.start_color[c], begin, end);
+  if (properties.color_over_lifetime.enabled) {
+    for (uint32_t c = 0; c < 4; c++)
+      multiply_lerp(s[ColorR + c].data(), t, properties.color_over_lifetime.start[c], properties.color_over_lifetime.end[c], begin, end);
+  }
+  if (properties.color_by_speed.enabled) {
+    const auto& module = properties.color_by_speed;
+    speed_factor(speeds.data(), speed_factors.data(), module.min_speed, module.max_speed, begin, end);
+    for (uint32_t c = 0; c < 4; c++)
+      multiply_lerp(s[ColorR + c].data(), speed_factors.data(), module.start[c], module.end[c], begin, end);
+  }
 
-    // Color
-    particle.color = properties.start_color;
-    if (properties.color_over_lifetime.enabled)
-      particle.color *= properties.color_over_lifetime.evaluate(t);
-    if (properties.color_by_speed.enabled)
-      particle.color *= properties.color_by_speed.evaluate(velocityMagnitude);
+  // Size
+  for (uint32_t c = 0; c < 3; c++)
+    fill(s[SizeX + c].data(), properties.start_size[c], begin, end);
+  if (properties.size_over_lifetime.enabled) {
+    for (uint32_t c = 0; c < 3; c++)
+      multiply_lerp(s[SizeX + c].data(), t, properties.size_over_lifetime.start[c], properties.size_over_lifetime.end[c], begin, end);
+  }
+  if (properties.size_by_speed.enabled) {
+    const auto& module = properties.size_by_speed;
+    speed_factor(speeds.data(), speed_factors.data(), module.min_speed, module.max_speed, begin, end);
+    for (uint32_t c = 0; c < 3; c++)
+      multiply_lerp(s[SizeX + c].data(), speed_factors.data(), module.start[c], module.end[c], begin, end);
+  }
 
-    // Size
-    particle.size = properties.start_size;
-    if (properties.size_over_lifetime.enabled)
-      particle.size *= properties.size_over_lifetime.evaluate(t);
-    if (properties.size_by_speed.enabled)
-      particle.size *= properties.size_by_speed.evaluate(velocityMagnitude);
+  // Rotation
+  for (uint32_t c = 0; c < 3; c++)
+    fill(s[RotationX + c].data(), properties.start_rotation[c], begin, end);
+  if (properties.rotation_over_lifetime.enabled) {
+    for (uint32_t c = 0; c < 3; c++)
+      add_lerp(s[RotationX + c].data(), t, properties.rotation_over_lifetime.start[c], properties.rotation_over_lifetime.end[c], begin, end);
+  }
+  if (properties.rotation_by_speed.enabled) {
+    const auto& module = properties.rotation_by_speed;
+    speed_factor(speeds.data(), speed_factors.data(), module.min_speed, module.max_speed, begin, end);
+    for (uint32_t c = 0; c < 3; c++)
+      add_lerp(s[RotationX + c].data(), speed_factors.data(), module.start[c], module.end[c], begin, end);
+  }
+}
 
-    // Rotation
-    particle.rotation = properties.start_rotation;
-    if (properties.rotation_over_lifetime.enabled)
-      particle.rotation += properties.rotation_over_lifetime.evaluate(t);
-    if (properties.rotation_by_speed.enabled)
-      particle.rotation += properties.rotation_by_speed.evaluate(velocityMagnitude);
+void ParticleSystem::compact() {
+  OX_SCOPED_ZONE;
+  // dead particles are replaced by the last live one, which is then checked in their place
+  const float* life = streams[Life].data();
+  uint32_t i = 0;
+  while (i < particle_count) {
+    if (life[i] > 0.0f) {
+      i++;
+      continue;
+    }
 
-    particle.position += velocity * simTs;
-    ++active_particle_count;
+    particle_count -= 1;
+    stats.killed += 1;
+    for (auto& stream : streams)
+      stream[i] = stream[particle_count];
   }
 }
 
-void ParticleSystem::on_render() const {
-  for (const auto& particle : particles) {
-    if (particle.life_remaining <= 0.0f)
-      continue;
+void ParticleSystem::reserve(const uint32_t max_particles) {
+  if (max_particles == capacity)
+    return;
 
-    glm::mat4 transform = glm::translate(glm::mat4(1.0f), particle.position) * glm::mat4(glm::quat(particle.rotation))
-                          * glm::scale(glm::mat4(1.0f), particle.size);
+  capacity = max_particles;
+  particle_count = std::min(particle_count, capacity);
 
-    //Renderer::SubmitQuad(transform, m_Properties.Texture, particle.Color);
-  }
+  const uint32_t padded_capacity = round_up_4(capacity);
+  for (auto& stream : streams)
+    stream.resize(padded_capacity);
+  age_factors.resize(padded_capacity);
+  speeds.resize(padded_capacity);
+  speed_factors.resize(padded_capacity);
 }
 
-static float RandomFloat(float min, float max) {
-  const float r = static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX);
+float ParticleSystem::random_float(const float min, const float max) {
+  const float r = static_cast<float>(next_random(random_state) >> 40) * (1.0f / 16777216.0f);
   return min + r * (max - min);
 }
 
 void ParticleSystem::emit(const glm::vec3& position, uint32_t count) {
-  if (active_particle_count >= properties.max_particles)
+  count = std::min(count, capacity - particle_count);
+
+  auto* s = streams.data();
+  for (uint32_t i = particle_count; i < particle_count + count; ++i) {
+    s[PositionX][i] = position.x + random_float(properties.position_start.x, properties.position_end.x);
+    s[PositionY][i] = position.y + random_float(properties.position_start.y, properties.position_end.y);
+    s[PositionZ][i] = position.z + random_float(properties.position_start.z, properties.position_end.z);
+    s[VelocityX][i] = properties.start_velocity.x;
+    s[VelocityY][i] = properties.start_velocity.y;
+    s[VelocityZ][i] = properties.start_velocity.z;
+    s[Life][i] = properties.start_lifetime;
+  }
+
+  particle_count += count;
+  stats.emitted += count;
+}
+
+uint64_t ParticleSystem::get_checksum() const {
+  // fnv-1a over the position bits
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (const auto stream : {PositionX, PositionY, PositionZ}) {
+    for (uint32_t i = 0; i < particle_count; i++) {
+      uint32_t bits;
+      std::memcpy(&bits, &streams[stream][i], sizeof(bits));
+      hash = (hash ^ bits) * 0x100000001b3ull;
+    }
+  }
+  return hash;
+}
+
+void ParticleSystem::update_systems(std::span<ParticleSystem* const> systems,
+                                    std::span<const glm::vec3> positions,
+                                    const float delta_time,
+                                    TaskScheduler* scheduler) {
+  OX_SCOPED_ZONE;
+  if (!scheduler || systems.size() < 2) {
+    for (size_t i = 0; i < systems.size(); i++)
+      systems[i]->on_update(delta_time, positions[i], scheduler);
     return;
+  }
+
+  // systems don't share any state, chunk tasks of big systems are picked up by the waiting threads
+  TaskSet task((uint32_t)systems.size(), [systems, positions, delta_time, scheduler](const TaskSetPartition range, uint32_t) {
+    for (uint32_t i = range.start; i < range.end; i++)
+      systems[i]->on_update(delta_time, positions[i], scheduler);
+  });
+  scheduler->schedule_task(&task);
+  scheduler->wait_task(&task);
+}
+
+bool ParticleSystem::verify_determinism(const uint32_t step_count, TaskScheduler* scheduler) {
+  OX_SCOPED_ZONE;
+  const auto configure = [](ParticleProperties& props) {
+    props.seed = 1234;
+    props.max_particles = SIMULATION_CHUNK_SIZE * 4; // big enough to get split into chunks
+    props.rate_over_time = 100000;
+    props.burst_count = 500;
+    props.burst_time = 0.1f;
+    props.start_lifetime = 0.5f;
+    props.gravity_modifier = 1.0f;
+    props.color_by_speed.enabled = true;
+    props.size_over_lifetime.enabled = true;
+  };
+
+  // `a` is deterministic from the start, `b` only gets switched over after it already simulated with a random seed
+  ParticleSystem a = {};
+  configure(a.properties);
+  a.properties.deterministic = true;
+  a.play();
+
+  ParticleSystem b = {};
+  configure(b.properties);
+  b.play();
+  b.on_update(0.1f, glm::vec3(0.0f), scheduler);
+  b.properties.deterministic = true;
+
+  // uneven frame times, the fixed steps have to line up anyway
+  for (uint32_t i = 0; i < step_count; i++) {
+    const float delta_time = i % 3 == 0 ? 1.0f / 30.0f : 1.0f / 144.0f;
+    const glm::vec3 position = glm::vec3((float)i * 0.1f, 0.0f, 0.0f);
+    a.on_update(delta_time, position, scheduler);
+    b.on_update(delta_time, position, scheduler);
+  }
+
+  bool equal = a.particle_count == b.particle_count;
+  for (uint32_t stream = 0; equal && stream < StreamCount; stream++)
+    equal = std::memcmp(a.streams[stream].data(), b.streams[stream].data(), a.particle_count * sizeof(float)) == 0;
+
+  if (!equal)
+    OX_LOG_ERROR("ParticleSystem: two runs with seed {} diverged after {} steps ({} and {} particles)",
+                 a.properties.seed,
+                 step_count,
+                 a.particle_count,
+                 b.particle_count);
 
-  for (uint32_t i = 0; i < count; ++i) {
-    if (++pool_index >= 10000)
-      pool_index = 0;
+  return equal;
+}
+
+ParticleSystem::BenchmarkResult ParticleSystem::benchmark(const uint32_t particle_count,
+                                                          const uint32_t emitter_count,
+                                                          const uint32_t frame_count,
+                                                          TaskScheduler* scheduler) {
+  OX_SCOPED_ZONE;
+  BenchmarkResult result = {.particle_count = particle_count, .emitter_count = std::max(emitter_count, 1u), .frame_count = frame_count};
+  result.deterministic = verify_determinism(120, scheduler);
 
-    auto& particle = particles[pool_index];
+  std::vector<ParticleSystem> emitters(result.emitter_count);
+  std::vector<ParticleSystem*> systems = {};
+  std::vector<glm::vec3> positions = {};
+  for (uint32_t i = 0; i < result.emitter_count; i++) {
+    auto& emitter = emitters[i];
+    auto& props = emitter.properties;
+    props.deterministic = true;
+    props.seed = i + 1;
+    props.max_particles = particle_count / result.emitter_count + (i < particle_count % result.emitter_count ? 1 : 0);
+    props.start_lifetime = 1000.0f; // nothing dies during the run, so every frame simulates the full count
+    props.gravity_modifier = 1.0f;
+    props.position_start = glm::vec3(-5.0f);
+    props.position_end = glm::vec3(5.0f);
+    props.velocity_over_lifetime = {glm::vec3(1.0f), glm::vec3(0.5f)};
+    props.velocity_over_lifetime.enabled = true;
+    props.force_over_lifetime = {glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f)};
+    props.force_over_lifetime.enabled = true;
+    props.color_over_lifetime.enabled = true;
+    props.color_by_speed.enabled = true;
+    props.size_over_lifetime.enabled = true;
+    props.size_by_speed.enabled = true;
+    props.rotation_over_lifetime.enabled = true;
+    props.rotation_by_speed.enabled = true;
 
-    particle.position = position;
-    particle.position.x += RandomFloat(properties.position_start.x, properties.position_end.x);
-    particle.position.y += RandomFloat(properties.position_start.y, properties.position_end.y);
-    particle.position.z += RandomFloat(properties.position_start.z, properties.position_end.z);
+    emitter.play();
+    emitter.reserve(props.max_particles);
+    emitter.emit(glm::vec3((float)i, 0.0f, 0.0f), props.max_particles);
 
-    particle.life_remaining = properties.start_lifetime;
+    systems.emplace_back(&emitter);
+    positions.emplace_back((float)i, 0.0f, 0.0f);
   }
+
+  constexpr float frame_time = 1.0f / 60.0f;
+  double total_ms = 0.0;
+  result.min_ms = std::numeric_limits<float>::max();
+  for (uint32_t frame = 0; frame < frame_count; frame++) {
+    const Timer timer = {};
+    update_systems(systems, positions, frame_time, scheduler);
+    const float ms = timer.get_elapsed_ms();
+    total_ms += ms;
+    result.min_ms = std::min(result.min_ms, ms);
+    result.max_ms = std::max(result.max_ms, ms);
+  }
+
+  if (frame_count == 0)
+    result.min_ms = 0.0f;
+  result.average_ms = frame_count > 0 ? (float)(total_ms / frame_count) : 0.0f;
+  for (const auto& emitter : emitters)
+    result.checksum = result.checksum * 31 + emitter.get_checksum();
+
+  OX_LOG_INFO("ParticleSystem benchmark: {} particles in {} emitters, {} frames, avg {:.3f} ms min {:.3f} ms max {:.3f} ms, checksum {:016x}, "
+              "deterministic {}",
+              result.particle_count,
+              result.emitter_count,
+              result.frame_count,
+              result.average_ms,
+              result.min_ms,
+              result.max_ms,
+              result.checksum,
+              result.deterministic);
+
+  return result;
 }
 }
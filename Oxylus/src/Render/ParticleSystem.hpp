@@ -1,4 +1,6 @@
 #pragma once
+#include <array>
+#include <span>
 #include <vector>
 
 #include <glm/gtx/compatibility.hpp>
@@ -8,14 +10,7 @@
 
 namespace ox {
 class Texture;
-
-struct Particle {
-  glm::vec3 position = glm::vec3(0.0f);
-  glm::vec3 rotation = glm::vec3(0.0f);
-  glm::vec3 size = glm::vec3(1.0f);
-  glm::vec4 color = glm::vec4(1.0f);
-  float life_remaining = 0.0f;
-};
+class TaskScheduler;
 
 template <typename T> struct OverLifetimeModule {
   T start;
@@ -25,7 +20,7 @@ template <typename T> struct OverLifetimeModule {
   OverLifetimeModule() : start(), end() {}
   OverLifetimeModule(const T& start, const T& end) : start(start), end(end) {}
 
-  T evaluate(float factor) {
+  T evaluate(float factor) const {
     return glm::lerp(end, start, factor);
   }
 };
@@ -40,7 +35,7 @@ template <typename T> struct BySpeedModule {
   BySpeedModule() : start(), end() {}
   BySpeedModule(const T& start, const T& end) : start(start), end(end) {}
 
-  T evaluate(float speed) {
+  T evaluate(float speed) const {
     float factor = math::inverse_lerp_clamped(min_speed, max_speed, speed);
     return glm::lerp(end, start, factor);
   }
@@ -68,6 +63,11 @@ struct ParticleProperties {
   glm::vec3 position_start = glm::vec3(-0.2f, 0.0f, 0.0f);
   glm::vec3 position_end = glm::vec3(0.2f, 0.0f, 0.0f);
 
+  // fixed time steps and a seeded random stream, same inputs give the same particles on every machine and thread count
+  bool deterministic = false;
+  uint32_t seed = 0;
+  float fixed_time_step = 1.0f / 60.0f;
+
   OverLifetimeModule<glm::vec3> velocity_over_lifetime;
   OverLifetimeModule<glm::vec3> force_over_lifetime;
   OverLifetimeModule<glm::vec4> color_over_lifetime = {{0.8f, 0.2f, 0.2f, 0.0f}, {0.2f, 0.2f, 0.75f, 1.0f}};
@@ -80,32 +80,115 @@ struct ParticleProperties {
   Shared<Texture> texture = nullptr;
 };
 
+// Particles are stored as structure of arrays, every module is a kernel over whole streams.
+//	Live particles are always packed in [0, count), dead ones are swapped with the last live particle.
+//	Streams are padded to a multiple of 4 so kernels can run 4 wide without a tail loop.
 class ParticleSystem {
 public:
+  enum Stream : uint32_t {
+    PositionX = 0,
+    PositionY,
+    PositionZ,
+    VelocityX,
+    VelocityY,
+    VelocityZ,
+    Life,
+    ColorR,
+    ColorG,
+    ColorB,
+    ColorA,
+    SizeX,
+    SizeY,
+    SizeZ,
+    RotationX,
+    RotationY,
+    RotationZ,
+
+    StreamCount
+  };
+
+  // particles simulated by one task, multiple of 4
+  static constexpr uint32_t SIMULATION_CHUNK_SIZE = 16 * 1024;
+  // upper bound of fixed steps per update in deterministic mode so a long frame can't stall the simulation
+  static constexpr uint32_t MAX_FIXED_STEPS = 8;
+
+  struct Stats {
+    uint32_t emitted = 0;
+    uint32_t killed = 0;
+    uint32_t steps = 0;
+    float update_ms = 0.0f;
+  };
+
+  struct BenchmarkResult {
+    uint32_t particle_count = 0;
+    uint32_t emitter_count = 0;
+    uint32_t frame_count = 0;
+    float average_ms = 0.0f;
+    float min_ms = 0.0f;
+    float max_ms = 0.0f;
+    uint64_t checksum = 0; // of the final positions, equal between runs in deterministic mode
+    bool deterministic = false; // result of `verify_determinism`
+  };
+
   ParticleSystem();
 
   void play();
   void stop(bool force = false);
-  void on_update(float deltaTime, const glm::vec3& position);
-  void on_render() const;
+  /// Kills every particle and restarts the random stream, from `seed` in deterministic mode.
+  void reset();
+  void on_update(float deltaTime, const glm::vec3& position, TaskScheduler* scheduler = nullptr);
+
+  /// Updates every system in parallel, big systems additionally split their particles into chunks.
+  static void update_systems(std::span<ParticleSystem* const> systems,
+                             std::span<const glm::vec3> positions,
+                             float delta_time,
+                             TaskScheduler* scheduler = nullptr);
+
+  /// Runs two deterministic systems with the same seed for `step_count` updates and compares every stream,
+  /// one of them is switched to deterministic mode only after it already simulated.
+  /// @return false if they diverged.
+  static bool verify_determinism(uint32_t step_count, TaskScheduler* scheduler = nullptr);
+
+  /// Simulates `particle_count` particles spread over `emitter_count` deterministic emitters for `frame_count` frames.
+  static BenchmarkResult benchmark(uint32_t particle_count, uint32_t emitter_count, uint32_t frame_count, TaskScheduler* scheduler = nullptr);
 
   ParticleProperties& get_properties() { return properties; }
   const ParticleProperties& get_properties() const { return properties; }
-  uint32_t get_active_particle_count() const { return active_particle_count; }
+  uint32_t get_active_particle_count() const { return particle_count; }
+  const Stats& get_stats() const { return stats; }
+
+  std::span<const float> get_stream(Stream stream) const { return {streams[stream].data(), particle_count}; }
+  uint64_t get_checksum() const;
 
 private:
   void emit(const glm::vec3& position, uint32_t count = 1);
-
-  std::vector<Particle> particles;
-  uint32_t pool_index = 0;
+  void step(float dt, const glm::vec3& position, TaskScheduler* scheduler);
+  void simulate(uint32_t begin, uint32_t end, float dt);
+  void compact();
+  void reserve(uint32_t max_particles);
+  void reseed();
+  float random_float(float min, float max);
+
+  std::array<std::vector<float>, StreamCount> streams = {};
+  // per particle scratch, rewritten by every step
+  std::vector<float> age_factors = {};
+  std::vector<float> speeds = {};
+  std::vector<float> speed_factors = {};
+  uint32_t particle_count = 0;
+  uint32_t capacity = 0;
   ParticleProperties properties;
 
+  uint64_t random_state = 0;
+  // what the random stream was last seeded with
+  bool seeded_deterministic = false;
+  uint32_t seeded_seed = 0;
   float system_time = 0.0f;
   float burst_time = 0.0f;
   float spawn_time = 0.0f;
+  float step_accumulator = 0.0f;
   glm::vec3 last_spawned_position = glm::vec3(0.0f);
 
-  uint32_t active_particle_count = 0;
+  Stats stats = {};
   bool playing = false;
 };
 }
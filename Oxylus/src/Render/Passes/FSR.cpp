@@ -11,6 +11,8 @@
 #include "Core/App.hpp"
 #include "Core/FileSystem.hpp"
 #include "Render/Camera.hpp"
+#include "Render/PipelineRegistry.hpp"
+#include "Render/ShaderCache.hpp"
 #include "Thread/TaskScheduler.hpp"
 
 #include "Render/Vulkan/VkContext.hpp"
@@ -130,60 +132,59 @@ Vec2 FSR::get_jitter() const {
   return {x, y};
 }
 
-void FSR::load_pipelines(vuk::Allocator& allocator, vuk::PipelineBaseCreateInfo& pipeline_ci) {
-#define SHADER_FILE(path) fs::read_shader_file(path), fs::get_shader_path(path)
+void FSR::load_pipelines(PipelineRegistry& registry) {
+  // created on the first dispatch
+  auto* shader_cache = App::get_system<ShaderCache>();
 
-  auto* task_scheduler = App::get_system<TaskScheduler>();
-
-  task_scheduler->add_task([=]() mutable {
+  registry.add("autogen_reactive_pass", PipelineRegistry::Mode::Lazy, [shader_cache] {
     vuk::PipelineBaseCreateInfo ci;
-    ci.add_hlsl(SHADER_FILE("FFX/FSR2/ffx_fsr2_autogen_reactive_pass.hlsl"), vuk::HlslShaderStage::eCompute);
-    TRY(allocator.get_context().create_named_pipeline("autogen_reactive_pass", ci))
+    shader_cache->add_hlsl(ci, {.path = "FFX/FSR2/ffx_fsr2_autogen_reactive_pass.hlsl", .stage = vuk::HlslShaderStage::eCompute});
+    return ci;
   });
 
-  task_scheduler->add_task([=]() mutable {
+  registry.add("luminance_pyramid_pass", PipelineRegistry::Mode::Lazy, [shader_cache] {
     vuk::PipelineBaseCreateInfo ci;
-    ci.add_hlsl(SHADER_FILE("FFX/FSR2/ffx_fsr2_compute_luminance_pyramid_pass.hlsl"), vuk::HlslShaderStage::eCompute);
-    TRY(allocator.get_context().create_named_pipeline("luminance_pyramid_pass", ci))
+    shader_cache->add_hlsl(ci, {.path = "FFX/FSR2/ffx_fsr2_compute_luminance_pyramid_pass.hlsl", .stage = vuk::HlslShaderStage::eCompute});
+    return ci;
   });
 
-  task_scheduler->add_task([=]() mutable {
+  registry.add("prepare_input_color_pass", PipelineRegistry::Mode::Lazy, [shader_cache] {
     vuk::PipelineBaseCreateInfo ci;
-    ci.add_hlsl(SHADER_FILE("FFX/FSR2/ffx_fsr2_prepare_input_color_pass.hlsl"), vuk::HlslShaderStage::eCompute);
-    TRY(allocator.get_context().create_named_pipeline("prepare_input_color_pass", ci))
+    shader_cache->add_hlsl(ci, {.path = "FFX/FSR2/ffx_fsr2_prepare_input_color_pass.hlsl", .stage = vuk::HlslShaderStage::eCompute});
+    return ci;
   });
 
-  task_scheduler->add_task([=]() mutable {
+  registry.add("reconstruct_previous_depth_pass", PipelineRegistry::Mode::Lazy, [shader_cache] {
     vuk::PipelineBaseCreateInfo ci;
-    ci.add_hlsl(SHADER_FILE("FFX/FSR2/ffx_fsr2_reconstruct_previous_depth_pass.hlsl"), vuk::HlslShaderStage::eCompute);
-    TRY(allocator.get_context().create_named_pipeline("reconstruct_previous_depth_pass", ci))
+    shader_cache->add_hlsl(ci, {.path = "FFX/FSR2/ffx_fsr2_reconstruct_previous_depth_pass.hlsl", .stage = vuk::HlslShaderStage::eCompute});
+    return ci;
   });
 
-  task_scheduler->add_task([=]() mutable {
+  registry.add("depth_clip_pass", PipelineRegistry::Mode::Lazy, [shader_cache] {
     vuk::PipelineBaseCreateInfo ci;
-    ci.add_hlsl(SHADER_FILE("FFX/FSR2/ffx_fsr2_depth_clip_pass.hlsl"), vuk::HlslShaderStage::eCompute);
-    TRY(allocator.get_context().create_named_pipeline("depth_clip_pass", ci))
+    shader_cache->add_hlsl(ci, {.path = "FFX/FSR2/ffx_fsr2_depth_clip_pass.hlsl", .stage = vuk::HlslShaderStage::eCompute});
+    return ci;
   });
 
-  task_scheduler->add_task([=]() mutable {
+  registry.add("lock_pass", PipelineRegistry::Mode::Lazy, [shader_cache] {
     vuk::PipelineBaseCreateInfo ci;
-    ci.add_hlsl(SHADER_FILE("FFX/FSR2/ffx_fsr2_lock_pass.hlsl"), vuk::HlslShaderStage::eCompute);
-    TRY(allocator.get_context().create_named_pipeline("lock_pass", ci))
+    shader_cache->add_hlsl(ci, {.path = "FFX/FSR2/ffx_fsr2_lock_pass.hlsl", .stage = vuk::HlslShaderStage::eCompute});
+    return ci;
   });
 
-  task_scheduler->add_task([=]() mutable {
+  registry.add("accumulate_pass", PipelineRegistry::Mode::Lazy, [shader_cache] {
     vuk::PipelineBaseCreateInfo ci;
-    ci.add_hlsl(SHADER_FILE("FFX/FSR2/ffx_fsr2_accumulate_pass.hlsl"), vuk::HlslShaderStage::eCompute);
-    TRY(allocator.get_context().create_named_pipeline("accumulate_pass", ci))
+    shader_cache->add_hlsl(ci, {.path = "FFX/FSR2/ffx_fsr2_accumulate_pass.hlsl", .stage = vuk::HlslShaderStage::eCompute});
+    return ci;
   });
 
-  task_scheduler->add_task([=]() mutable {
+  registry.add("rcas_pass", PipelineRegistry::Mode::Lazy, [shader_cache] {
     vuk::PipelineBaseCreateInfo ci;
-    ci.add_hlsl(SHADER_FILE("FFX/FSR2/ffx_fsr2_rcas_pass.hlsl"), vuk::HlslShaderStage::eCompute);
-    TRY(allocator.get_context().create_named_pipeline("rcas_pass", ci))
+    shader_cache->add_hlsl(ci, {.path = "FFX/FSR2/ffx_fsr2_rcas_pass.hlsl", .stage = vuk::HlslShaderStage::eCompute});
+    return ci;
   });
 
-  task_scheduler->wait_for_all();
+  pipeline_registry = &registry;
 }
 
 void FSR::create_fs2_resources(vuk::Extent3D render_resolution, vuk::Extent3D presentation_resolution) {
@@ -260,6 +261,17 @@ vuk::Value<vuk::ImageAttachment> FSR::dispatch(vuk::Value<vuk::ImageAttachment>&
                                                double dt,
                                                float sharpness,
                                                uint32_t frame_index) {
+  if (!pipeline_registry->require({"autogen_reactive_pass",
+                                   "luminance_pyramid_pass",
+                                   "prepare_input_color_pass",
+                                   "reconstruct_previous_depth_pass",
+                                   "depth_clip_pass",
+                                   "lock_pass",
+                                   "accumulate_pass",
+                                   "rcas_pass"})) {
+    return output;
+  }
+
   struct Fsr2SpdConstants {
     uint32_t mips;
     uint32_t numworkGroups;
@@ -11,6 +11,8 @@ class Context;
 } // namespace vuk
 namespace ox {
 class Camera;
+class PipelineRegistry;
+
 class FSR {
 public:
   FSR() = default;
@@ -20,7 +22,7 @@ public:
   vuk::Extent3D get_render_res() const { return _render_res;}
   vuk::Extent3D get_present_res() const { return _present_res;}
 
-  void load_pipelines(vuk::Allocator& allocator, vuk::PipelineBaseCreateInfo& pipeline_ci);
+  void load_pipelines(PipelineRegistry& registry);
   void create_fs2_resources(vuk::Extent3D render_resolution, vuk::Extent3D presentation_resolution);
   vuk::Value<vuk::ImageAttachment> dispatch(vuk::Value<vuk::ImageAttachment>& input_color_post_alpha,
                                             vuk::Value<vuk::ImageAttachment>& input_color_pre_alpha,
@@ -58,6 +60,8 @@ private:
     float lumaMipRcp;
   } fsr2_constants;
 
+  PipelineRegistry* pipeline_registry = nullptr;
+
   vuk::Extent3D _render_res;
   vuk::Extent3D _present_res;
 
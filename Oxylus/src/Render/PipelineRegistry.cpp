@@ -0,0 +1,236 @@
+﻿#include "PipelineRegistry.hpp"
+
+#include <vuk/runtime/vk/VkRuntime.hpp>
+
+#include "Utils/Log.hpp"
+#include "Utils/Profiler.hpp"
+#include "Utils/Timer.hpp"
+
+namespace ox {
+PipelineRegistry::~PipelineRegistry() { wait_tasks(); }
+
+void PipelineRegistry::init(vuk::Runtime* ctx, TaskScheduler* task_scheduler) {
+  context = ctx;
+  scheduler = task_scheduler;
+}
+
+void PipelineRegistry::clear() {
+  wait_tasks();
+
+  std::lock_guard lock(mutex);
+  entries.clear();
+  startup_us = 0;
+}
+
+void PipelineRegistry::add(const std::string& name, const Mode mode, CreateFunction create, std::vector<std::string> dependencies) {
+  auto entry = create_unique<Entry>();
+  entry->name = name;
+  entry->mode = mode;
+  entry->create = std::move(create);
+  entry->dependencies = std::move(dependencies);
+
+  std::lock_guard lock(mutex);
+  if (!entries.emplace(name, std::move(entry)).second)
+    OX_LOG_ERROR("Pipeline {} is already registered!", name);
+}
+
+void PipelineRegistry::compile(const Mode mode) {
+  OX_SCOPED_ZONE;
+
+  std::vector<Entry*> pending = {};
+  {
+    std::lock_guard lock(mutex);
+    for (const auto& [_, entry] : entries) {
+      if (entry->mode == mode && entry->status == Status::Pending)
+        pending.emplace_back(entry.get());
+    }
+  }
+
+  if (pending.empty())
+    return;
+
+  auto& task = tasks.emplace_back(create_unique<TaskSet>((uint32)pending.size(), [this, pending](const TaskSetPartition range, uint32_t) {
+    for (uint32 i = range.start; i < range.end; i++)
+      build(*pending[i]);
+  }));
+  scheduler->schedule_task(task.get());
+}
+
+void PipelineRegistry::wait(const Mode mode) {
+  OX_SCOPED_ZONE;
+
+  const Timer timer = {};
+
+  std::vector<Entry*> list = {};
+  {
+    std::lock_guard lock(mutex);
+    for (const auto& [_, entry] : entries) {
+      if (entry->mode == mode)
+        list.emplace_back(entry.get());
+    }
+  }
+
+  uint32 failed = 0;
+  for (auto* entry : list)
+    failed += build(*entry) == Status::Failed;
+
+  if (mode == Mode::FirstFrame) {
+    startup_us += (uint64)(timer.get_elapsed_msd() * 1000.0);
+    OX_LOG_INFO("PipelineRegistry: {} first frame pipelines ready in {} ms", list.size() - failed, timer.get_elapsed_ms());
+  }
+
+  if (failed > 0)
+    OX_LOG_ERROR("PipelineRegistry: {} pipelines failed to compile", failed);
+}
+
+bool PipelineRegistry::require(const std::string& name) {
+  auto* entry = find(name);
+  if (!entry) {
+    OX_LOG_ERROR("Pipeline {} isn't registered!", name);
+    return false;
+  }
+
+  return build(*entry) == Status::Ready;
+}
+
+bool PipelineRegistry::require(const std::initializer_list<const char*> names) {
+  bool ready = true;
+  for (const auto* name : names)
+    ready &= require(name);
+  return ready;
+}
+
+PipelineRegistry::Status PipelineRegistry::get_status(const std::string& name) const {
+  const auto* entry = find(name);
+  return entry ? entry->status.load() : Status::Unknown;
+}
+
+PipelineRegistry::Stats PipelineRegistry::get_stats() const {
+  std::lock_guard lock(mutex);
+
+  Stats stats = {};
+  stats.pipeline_count = (uint32)entries.size();
+  stats.startup_ms = (float)startup_us.load() / 1000.0f;
+  for (const auto& [name, entry] : entries) {
+    switch (entry->status.load()) {
+      case Status::Pending  : stats.pending++; break;
+      case Status::Compiling: stats.compiling++; break;
+      case Status::Ready    : stats.ready++; break;
+      case Status::Failed   : stats.failed++; break;
+      default               : break;
+    }
+    stats.created_lazily += entry->created_lazily;
+    stats.compile_ms += entry->compile_ms;
+    if (entry->compile_ms > stats.slowest_ms) {
+      stats.slowest_ms = entry->compile_ms;
+      stats.slowest_pipeline = name;
+    }
+  }
+
+  return stats;
+}
+
+const char* PipelineRegistry::to_string(const Status status) {
+  switch (status) {
+    case Status::Pending  : return "Pending";
+    case Status::Compiling: return "Compiling";
+    case Status::Ready    : return "Ready";
+    case Status::Failed   : return "Failed";
+    default               : return "Unknown";
+  }
+}
+
+PipelineRegistry::Entry* PipelineRegistry::find(const std::string& name) const {
+  std::lock_guard lock(mutex);
+  const auto it = entries.find(name);
+  return it != entries.end() ? it->second.get() : nullptr;
+}
+
+PipelineRegistry::Status PipelineRegistry::build(Entry& entry) {
+  auto expected = Status::Pending;
+  if (!entry.status.compare_exchange_strong(expected, Status::Compiling)) {
+    // someone else is creating it, they are making progress so blocking here is fine
+    std::unique_lock lock(mutex);
+    status_changed.wait(lock, [&entry] { return entry.status != Status::Compiling; });
+    return entry.status;
+  }
+
+  OX_SCOPED_ZONE_N("Create Pipeline");
+
+  // A pipeline on a dependency cycle would end up waiting on itself, possibly through another thread
+  // that started compiling a different pipeline of the same cycle. Every entry of a cycle fails here
+  // before building any dependency, so nobody ever waits on a pipeline of the cycle.
+  bool ready = true;
+  if (is_circular(entry)) {
+    OX_LOG_ERROR("Pipeline {} has a circular dependency", entry.name);
+    ready = false;
+  }
+
+  for (const auto& dependency : entry.dependencies) {
+    if (!ready)
+      break;
+    auto* dependency_entry = find(dependency);
+    if (!dependency_entry) {
+      OX_LOG_ERROR("Pipeline {} has a missing dependency: {}", entry.name, dependency);
+      ready = false;
+      break;
+    }
+    if (build(*dependency_entry) != Status::Ready) {
+      OX_LOG_ERROR("Pipeline {} can't be used, its dependency {} failed", entry.name, dependency);
+      ready = false;
+      break;
+    }
+  }
+
+  const Timer timer = {};
+
+  if (ready) {
+    try {
+      context->create_named_pipeline(entry.name.c_str(), entry.create());
+      ready = context->is_pipeline_available(entry.name.c_str());
+    } catch (std::exception& exc) {
+      OX_LOG_ERROR("Pipeline {} failed to compile: {}", entry.name, exc.what());
+      ready = false;
+    }
+  }
+
+  {
+    std::lock_guard lock(mutex);
+    entry.compile_ms = timer.get_elapsed_ms();
+    entry.created_lazily = entry.mode == Mode::Lazy;
+    entry.status = ready ? Status::Ready : Status::Failed;
+  }
+  status_changed.notify_all();
+
+  return ready ? Status::Ready : Status::Failed;
+}
+
+bool PipelineRegistry::is_circular(const Entry& entry) const {
+  std::lock_guard lock(mutex);
+
+  std::vector<const Entry*> stack = {&entry};
+  ankerl::unordered_dense::set<const Entry*> visited = {};
+  while (!stack.empty()) {
+    const auto* current = stack.back();
+    stack.pop_back();
+    for (const auto& dependency : current->dependencies) {
+      const auto it = entries.find(dependency);
+      if (it == entries.end())
+        continue;
+      const auto* dependency_entry = it->second.get();
+      if (dependency_entry == &entry)
+        return true;
+      if (visited.emplace(dependency_entry).second)
+        stack.emplace_back(dependency_entry);
+    }
+  }
+
+  return false;
+}
+
+void PipelineRegistry::wait_tasks() {
+  for (const auto& task : tasks)
+    scheduler->wait_task(task.get());
+  tasks.clear();
+}
+} // namespace ox
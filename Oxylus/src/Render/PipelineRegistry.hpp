@@ -0,0 +1,99 @@
+﻿#pragma once
+#include <ankerl/unordered_dense.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <vuk/runtime/vk/Pipeline.hpp>
+
+#include "Core/Types.hpp"
+#include "Thread/TaskScheduler.hpp"
+
+namespace vuk {
+class Runtime;
+}
+
+namespace ox {
+// Tracks creation of named vuk pipelines.
+//	Every pipeline has a status and a mode deciding when it gets created:
+//	FirstFrame pipelines are created in parallel and waited on during startup,
+//	Deferred ones are created in the background once `compile(Mode::Deferred)` is called (after the first frame),
+//	Lazy ones only when they are first required.
+//	`require()` makes sure a pipeline and its dependencies exist before use. Pipelines that nobody started
+//	compiling yet are created on the calling thread, so waiting from inside a task can't dead lock.
+class PipelineRegistry {
+public:
+  enum class Status : uint8 { Unknown, Pending, Compiling, Ready, Failed };
+  enum class Mode : uint8 { FirstFrame, Deferred, Lazy };
+
+  using CreateFunction = std::function<vuk::PipelineBaseCreateInfo()>;
+
+  struct Stats {
+    uint32 pipeline_count = 0;
+    uint32 pending = 0;
+    uint32 compiling = 0;
+    uint32 ready = 0;
+    uint32 failed = 0;
+    uint32 created_lazily = 0;
+    float startup_ms = 0.0f; // time spent blocking on FirstFrame pipelines
+    float compile_ms = 0.0f; // summed over all threads
+    float slowest_ms = 0.0f;
+    std::string slowest_pipeline = {};
+  };
+
+  PipelineRegistry() = default;
+  ~PipelineRegistry();
+
+  void init(vuk::Runtime* ctx, TaskScheduler* task_scheduler);
+  /// Waits for in flight compiles and forgets every pipeline, created vuk pipelines are kept.
+  void clear();
+
+  void add(const std::string& name, Mode mode, CreateFunction create, std::vector<std::string> dependencies = {});
+
+  /// Starts creating every pending pipeline of `mode` on the task scheduler.
+  void compile(Mode mode);
+  /// Blocks until every pipeline of `mode` is ready or failed.
+  void wait(Mode mode);
+
+  /// Creates the pipeline if needed and waits for it and its dependencies.
+  /// @return true if the pipeline can be used.
+  bool require(const std::string& name);
+  bool require(std::initializer_list<const char*> names);
+
+  Status get_status(const std::string& name) const;
+  bool is_ready(const std::string& name) const { return get_status(name) == Status::Ready; }
+
+  Stats get_stats() const;
+
+  static const char* to_string(Status status);
+
+private:
+  struct Entry {
+    std::string name = {};
+    Mode mode = Mode::FirstFrame;
+    CreateFunction create = {};
+    std::vector<std::string> dependencies = {};
+    std::atomic<Status> status = Status::Pending;
+    float compile_ms = 0.0f;
+    bool created_lazily = false;
+  };
+
+  vuk::Runtime* context = nullptr;
+  TaskScheduler* scheduler = nullptr;
+
+  mutable std::mutex mutex;
+  std::condition_variable status_changed;
+  ankerl::unordered_dense::map<std::string, Unique<Entry>> entries = {};
+  std::vector<Unique<TaskSet>> tasks = {};
+  std::atomic<uint64> startup_us = 0;
+
+  Entry* find(const std::string& name) const;
+  /// @return Final status of the entry, compiles it on this thread when nobody else is.
+  Status build(Entry& entry);
+  /// @return true if `entry` can be reached from its own dependencies.
+  bool is_circular(const Entry& entry) const;
+  void wait_tasks();
+};
+} // namespace ox
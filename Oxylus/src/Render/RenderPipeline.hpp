@@ -5,6 +5,7 @@
 #include "Event/Event.hpp"
 
 #include "Core/Base.hpp"
+#include "Render/RenderStatistics.hpp"
 #include "Scene/Components.hpp"
 
 namespace vuk {
@@ -37,6 +38,9 @@ public:
   virtual void submit_camera(Camera* camera) {}
   virtual void submit_sprite(const SpriteComponent& sprite) {}
 
+  /// Camera mesh LODs are selected for, nullptr until a camera is submitted.
+  virtual const MeshletHierarchy::LodView* get_lod_view() const { return nullptr; }
+
   virtual void detach_swapchain(vuk::Extent3D ext, Vec2 offset = {});
   virtual bool is_swapchain_attached() { return attach_swapchain; }
 
@@ -53,6 +57,8 @@ public:
   virtual vuk::Extent3D get_extent() { return _extent; }
   virtual Vec2 get_viewport_offset() { return viewport_offset; }
 
+  const RenderStatistics& get_statistics() const { return statistics; }
+
 protected:
   std::string _name = {};
   bool attach_swapchain = false;
@@ -62,5 +68,6 @@ protected:
   vuk::Allocator* _frame_allocator;
   vuk::Compiler* _compiler = nullptr;
   std::mutex setup_lock;
+  RenderStatistics statistics = {};
 };
 } // namespace ox
@@ -0,0 +1,107 @@
+﻿#pragma once
+#include <array>
+
+#include "Core/Types.hpp"
+
+namespace ox {
+/// Per frame counters filled by render pipelines, shown in the editor statistics panel.
+struct RenderStatistics {
+  struct Culling {
+    uint32 instances_tested = 0;
+    uint32 instances_accepted = 0;
+
+    uint32 occluders = 0;
+    uint32 occluder_triangles = 0;
+    uint32 instances_occluded = 0;
+    float occlusion_ms = 0.0f;
+
+    uint32 lod_meshlets_full_detail = 0; // meshlets the accepted instances have at full detail
+    uint32 lod_meshlets_selected = 0;    // meshlets in the LOD cut of the accepted instances
+  } culling;
+
+  static constexpr uint32 MAX_LODS = 8; // Mesh::MAX_LODS
+
+  struct Lods {
+    std::array<uint32, MAX_LODS> instances = {}; // accepted instances drawn with each LOD of their mesh's LOD chain
+    std::array<uint64, MAX_LODS> triangles = {};
+  } lods;
+
+  struct Sprites {
+    uint32 sprite_count = 0;
+    uint32 batch_count = 0;
+    float sort_ms = 0.0f;
+    uint32 atlas_pages = 0;
+    uint32 atlas_textures = 0;
+  } sprites;
+
+  struct Shadows {
+    uint32 tiles = 0;
+    uint32 tiles_rendered = 0;
+    uint32 tiles_cached = 0;
+    uint32 tiles_dropped = 0;
+    uint32 evictions = 0;
+    uint32 repacks = 0;
+    float atlas_usage = 0.0f;
+
+    uint32 views_rendered = 0; // cascades and cube faces
+    uint32 views_reused = 0;
+    std::array<uint32, 4> cascade_casters = {};
+    float caster_culling_ms = 0.0f;
+  } shadows;
+
+  struct Lights {
+    uint32 light_count = 0;
+    uint32 visible_lights = 0;
+    uint32 cluster_count = 0;
+    uint32 non_empty_clusters = 0;
+    uint32 max_lights_per_cluster = 0;
+    float average_lights_per_cluster = 0.0f;
+    float clustering_ms = 0.0f;
+  } lights;
+
+  struct Pipelines {
+    uint32 pipeline_count = 0;
+    uint32 ready = 0;
+    uint32 pending = 0; // including the ones being compiled
+    uint32 failed = 0;
+    uint32 created_lazily = 0;
+    float startup_ms = 0.0f;
+    float compile_ms = 0.0f;
+  } pipelines;
+
+  struct Buffer {
+    uint64 capacity = 0;
+    uint64 used = 0;
+    uint64 high_water = 0;
+    uint32 grows = 0;
+    uint32 shrinks = 0;
+  };
+
+  struct Buffers {
+    Buffer visible_meshlets = {};
+    Buffer instanced_indices = {};
+    Buffer debug_aabbs = {};
+    uint64 allocated_bytes = 0; // summed over every reallocation
+  } buffers;
+
+  struct Uploads {
+    uint64 capacity = 0;
+    uint64 used = 0; // frames in flight included
+    uint64 peak_used = 0;
+    uint64 frame_bytes = 0;
+    uint32 frame_allocations = 0;
+    uint32 fallbacks = 0; // uploads that didn't fit and went to the frame allocator
+    uint64 fallback_bytes = 0;
+    uint64 wraps = 0;
+  } uploads;
+
+  struct Debug {
+    uint32 lines = 0;
+    uint32 triangles = 0;
+    uint32 shapes = 0; // instanced boxes, spheres, capsules and arrows
+    uint32 dropped = 0; // over rr.debug_renderer_budget
+    uint32 mesh_instances = 0; // physics bodies drawn from cached geometry
+    uint32 mesh_draws = 0;
+  } debug;
+};
+} // namespace ox
@@ -11,17 +11,46 @@ inline AutoCVar_Int cvar_vsync("rr.vsync", "toggle vsync", 1);
 
 inline AutoCVar_Int cvar_shadows_size("rr.shadows_size", "cascaded shadow map size", 2048);
 inline AutoCVar_Int cvar_shadows_pcf("rr.shadows_pcf", "use pcf in cascaded shadows", 1);
+inline AutoCVar_Int cvar_shadow_atlas_size("rr.shadow_atlas_size", "shadow atlas size", 4096);
+inline AutoCVar_Int cvar_shadow_cache("rr.shadow_cache", "reuse shadow maps of lights whose casters are stationary", 1);
 
 inline AutoCVar_Int cvar_draw_grid("rr.draw_grid", "draw editor scene grid", 1);
 inline AutoCVar_Float cvar_draw_grid_distance("rr.grid_distance", "max grid distance", 20.f);
 inline AutoCVar_Int cvar_draw_bounding_boxes("rr.draw_bounding_boxes", "draw mesh bounding boxes", 0);
 inline AutoCVar_Int cvar_enable_physics_debug_renderer("rr.physics_debug_renderer", "enable physics debug renderer", 0);
 inline AutoCVar_Int cvar_enable_debug_renderer("rr.debug_renderer", "enable debug renderer", 1);
+inline AutoCVar_Int cvar_debug_renderer_budget("rr.debug_renderer_budget", "max debug lines, triangles and shapes per frame, 0 for unlimited", 1'000'000);
 inline AutoCVar_Int cvar_draw_meshlet_aabbs("rr.draw_meshlet_aabbs", "draw meshlet aabbs", 0);
+inline AutoCVar_Int cvar_cull_meshlet_cones("rr.cull_meshlet_cones", "cull meshlets facing away from the camera, breaks double sided materials", 0);
 inline AutoCVar_Int cvar_freeze_culling_frustum("rr.freeze_culling_frustum", "freeze culling frustum", 0);
 inline AutoCVar_Int cvar_draw_camera_frustum("rr.draw_camera_frustum", "draw camera frustum", 0);
+inline AutoCVar_Int cvar_cpu_frustum_culling("rr.cpu_frustum_culling", "cull mesh instances against the camera frustum on the cpu", 1);
+inline AutoCVar_Int cvar_occlusion_culling("rr.occlusion_culling", "cull mesh instances hidden behind large occluders on the cpu", 1);
+inline AutoCVar_Float cvar_occluder_min_coverage("rr.occluder_min_coverage", "screen coverage above which meshes are used as occluders", 0.1f);
+inline AutoCVar_Int cvar_max_occluders("rr.max_occluders", "max amount of occluders rasterized per frame", 32);
+inline AutoCVar_Int cvar_light_clustering("rr.light_clustering", "assign lights to froxels so shading only loops over nearby lights", 1);
+inline AutoCVar_Int cvar_sprite_atlas("rr.sprite_atlas", "pack sprite textures into shared atlases", 1);
+inline AutoCVar_Int cvar_upload_ring_size("rr.upload_ring_size", "size of the ring per frame uploads are sub-allocated from in MB", 64);
+inline AutoCVar_Int cvar_occlusion_dump_depth("rr.occlusion_dump_depth", "write the occlusion depth buffer to occlusion_depth.pgm", 0);
+inline AutoCVar_Int cvar_meshlet_lod("rr.meshlet_lod", "draw a cut through the meshlet hierarchy instead of full detail meshlets", 1);
+inline AutoCVar_Float cvar_meshlet_lod_error("rr.meshlet_lod_error", "max screen space simplification error of the meshlet LOD cut in pixels", 1.0f);
+inline AutoCVar_Int cvar_mesh_optimize("rr.mesh_optimize", "reorder imported meshes for vertex cache, overdraw and vertex fetch locality", 1);
+inline AutoCVar_Int cvar_mesh_optimize_report("rr.mesh_optimize_report", "log ACMR, ATVR, overdraw and overfetch of imported meshes", 0);
+inline AutoCVar_Int cvar_mesh_quantize("rr.mesh_quantize", "store imported vertices quantized where it stays within the rr.mesh_quantize_*_error bounds", 0);
+inline AutoCVar_Float cvar_mesh_quantize_position_error("rr.mesh_quantize_position_error", "max position error of quantized vertices relative to the primitive size", 0.0001f);
+inline AutoCVar_Float cvar_mesh_quantize_normal_error("rr.mesh_quantize_normal_error", "max normal error of quantized vertices in degrees", 2.0f);
+inline AutoCVar_Float cvar_mesh_quantize_uv_error("rr.mesh_quantize_uv_error", "max uv error of quantized vertices", 1.0f / 4096.0f);
+inline AutoCVar_Int cvar_mesh_lod_count("rr.mesh_lod_count", "simplified LODs generated at import in place of the meshlet hierarchy, 0 to build the hierarchy", 0);
+inline AutoCVar_Float cvar_mesh_lod_target_error("rr.mesh_lod_target_error", "relative simplification error of the first generated LOD, doubles with every following one", 0.01f);
+inline AutoCVar_Float cvar_mesh_lod_error("rr.mesh_lod_error", "max screen space simplification error of the selected mesh LOD in pixels", 1.0f);
+inline AutoCVar_Float cvar_mesh_lod_hysteresis("rr.mesh_lod_hysteresis", "relative error margin around rr.mesh_lod_error before a mesh switches its LOD", 0.25f);
+inline AutoCVar_Int cvar_mesh_lod_force("rr.mesh_lod_force", "draw this LOD of every mesh, -1 to select it by screen size", -1);
+inline AutoCVar_Int cvar_draw_mesh_lods("rr.draw_mesh_lods", "draw mesh bounding spheres colored by their selected LOD", 0);
+inline AutoCVar_Int cvar_mesh_cache("rr.mesh_cache", "load imported meshes from the binary mesh cache and write new imports to it", 1);
+inline AutoCVar_Int cvar_mesh_cache_compression("rr.mesh_cache_compression", "write vertices, indices and meshlets to the mesh cache with meshoptimizer's codecs", 1);
 
 inline AutoCVar_Int cvar_reload_render_pipeline("rr.reload_render_pipeline", "reload current scene's render pipeline", 0);
+inline AutoCVar_Int cvar_null_render_pipeline("rr.null_render_pipeline", "prepare frames without rendering them to measure the render side cpu cost, for new scenes", 0);
 
 inline AutoCVar_Int cvar_ssr_enable("pp.ssr", "use ssr", 1);
 inline AutoCVar_Int cvar_ssr_samples("pp.ssr_samples", "ssr samples", 30);
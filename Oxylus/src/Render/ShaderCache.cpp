@@ -0,0 +1,542 @@
+﻿#include "ShaderCache.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#ifdef OX_SHADER_CACHE_DXC
+  #ifdef _WIN32
+    #ifndef NOMINMAX
+      #define NOMINMAX
+    #endif
+    #include <Windows.h>
+  #endif
+  #include <dxc/dxcapi.h>
+#endif
+
+#include "Core/App.hpp"
+#include "Core/FileSystem.hpp"
+#include "Core/Project.hpp"
+#include "Thread/TaskScheduler.hpp"
+#include "Utils/Log.hpp"
+#include "Utils/Profiler.hpp"
+#include "Utils/Timer.hpp"
+
+namespace ox {
+namespace {
+constexpr uint32 CACHE_MAGIC = 0x4353584f; // OXSC
+
+struct CacheFileHeader {
+  uint32 magic = CACHE_MAGIC;
+  uint32 version = ShaderCache::CACHE_VERSION;
+  uint64 key = 0;
+  uint64 word_count = 0;
+};
+
+uint64 hash_combine(const uint64 seed, const uint64 value) { return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2)); }
+
+uint64 hash_string(const std::string_view str) { return ankerl::unordered_dense::detail::wyhash::hash(str.data(), str.size()); }
+
+int64 get_write_time(const std::filesystem::path& path) {
+  std::error_code ec;
+  const auto time = std::filesystem::last_write_time(path, ec);
+  return ec ? -1 : (int64)time.time_since_epoch().count();
+}
+
+std::string get_binary_path(const std::string& directory, const uint64 key) { return fmt::format("{}/{:016x}.spv", directory, key); }
+
+bool read_binary(const std::string& path, const uint64 key, std::vector<uint32>& spirv) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return false;
+
+  CacheFileHeader header = {};
+  if (!file.read((char*)&header, sizeof(header)))
+    return false;
+  if (header.magic != CACHE_MAGIC || header.version != ShaderCache::CACHE_VERSION || header.key != key || header.word_count == 0)
+    return false;
+
+  spirv.resize(header.word_count);
+  if (!file.read((char*)spirv.data(), (std::streamsize)(spirv.size() * sizeof(uint32)))) {
+    spirv.clear();
+    return false;
+  }
+
+  return true;
+}
+
+bool write_binary(const std::string& path, const uint64 key, const std::vector<uint32>& spirv) {
+  // write to a temporary first so a crash or a concurrent reader never sees a half written binary
+  const auto temp_path = fmt::format("{}.{}.tmp", path, std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+      return false;
+
+    const CacheFileHeader header = {.key = key, .word_count = spirv.size()};
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)spirv.data(), (std::streamsize)(spirv.size() * sizeof(uint32)));
+    if (!file.good())
+      return false;
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(temp_path, path, ec);
+  if (ec) {
+    std::filesystem::remove(temp_path, ec);
+    return false;
+  }
+
+  return true;
+}
+
+// Only plain `#include "file"` / `#include <file>` lines, conditional includes are hashed as well which at worst causes a miss.
+std::vector<std::string> parse_includes(const std::string& text) {
+  std::vector<std::string> includes = {};
+  std::istringstream stream(text);
+  std::string line;
+  while (std::getline(stream, line)) {
+    const auto first = line.find_first_not_of(" \t");
+    if (first == std::string::npos || line[first] != '#')
+      continue;
+    const auto directive = line.find_first_not_of(" \t", first + 1);
+    if (directive == std::string::npos || line.compare(directive, 7, "include") != 0)
+      continue;
+
+    const auto open = line.find_first_of("\"<", directive + 7);
+    if (open == std::string::npos)
+      continue;
+    const auto close = line.find_first_of(line[open] == '"' ? "\"" : ">", open + 1);
+    if (close == std::string::npos)
+      continue;
+
+    includes.emplace_back(line.substr(open + 1, close - open - 1));
+  }
+
+  return includes;
+}
+
+#ifdef OX_SHADER_CACHE_DXC
+struct DxcRelease {
+  void operator()(IUnknown* ptr) const {
+    if (ptr)
+      ptr->Release();
+  }
+};
+
+template <typename T>
+using DxcPtr = std::unique_ptr<T, DxcRelease>;
+
+const wchar_t* get_target_profile(const vuk::HlslShaderStage stage) {
+  switch (stage) {
+    case vuk::HlslShaderStage::eVertex       : return L"vs_6_7";
+    case vuk::HlslShaderStage::ePixel        : return L"ps_6_7";
+    case vuk::HlslShaderStage::eCompute      : return L"cs_6_7";
+    case vuk::HlslShaderStage::eGeometry     : return L"gs_6_7";
+    case vuk::HlslShaderStage::eMesh         : return L"ms_6_7";
+    case vuk::HlslShaderStage::eHull         : return L"hs_6_7";
+    case vuk::HlslShaderStage::eDomain       : return L"ds_6_7";
+    case vuk::HlslShaderStage::eAmplification: return L"as_6_7";
+    default                                  : return nullptr;
+  }
+}
+
+std::wstring to_wide(const std::string_view str) { return {str.begin(), str.end()}; }
+#endif
+
+// kept in sync with vuk's own hlsl compilation so cached and uncached shaders behave the same,
+// part of the cache key so changing them invalidates every entry
+constexpr const char* COMPILE_ARGUMENTS = "-spirv -fspv-target-env=vulkan1.3 -fvk-use-gl-layout -no-warnings";
+} // namespace
+
+void ShaderCache::init() {
+#ifdef OX_SHADER_CACHE_DXC
+  IDxcCompiler3* compiler = nullptr;
+  if (SUCCEEDED(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler)))) {
+    DxcPtr<IDxcCompiler3> compiler_ptr(compiler);
+    IDxcVersionInfo* version_info = nullptr;
+    if (SUCCEEDED(compiler->QueryInterface(IID_PPV_ARGS(&version_info)))) {
+      DxcPtr<IDxcVersionInfo> version_info_ptr(version_info);
+      UINT32 major = 0, minor = 0;
+      version_info->GetVersion(&major, &minor);
+      compiler_version = fmt::format("dxc {}.{}", major, minor);
+    }
+  }
+#endif
+
+  if (compiler_version.empty())
+    OX_LOG_WARN("ShaderCache: DXC isn't available, hlsl shaders will be compiled by vuk on every startup.");
+}
+
+void ShaderCache::deinit() {
+  std::lock_guard lock(mutex);
+  loaded.clear();
+  file_hashes.clear();
+}
+
+void ShaderCache::add_hlsl(vuk::PipelineBaseCreateInfo& pci, const Source& source) {
+  auto spirv = get_spirv(source);
+  if (!spirv.empty()) {
+    pci.add_spirv(std::move(spirv), fs::get_shader_path(source.path), source.entry_point);
+    return;
+  }
+
+  for (const auto& [name, value] : source.defines)
+    pci.define(name, value);
+  pci.add_hlsl(fs::read_shader_file(source.path), fs::get_shader_path(source.path), source.stage, source.entry_point);
+}
+
+std::vector<uint32> ShaderCache::get_spirv(const Source& source) {
+  OX_SCOPED_ZONE;
+
+  if (compiler_version.empty())
+    return {};
+
+  const Timer load_timer = {};
+
+  const uint64 key = get_key(source);
+  if (key == 0) {
+    failed += 1;
+    return {};
+  }
+
+  {
+    std::lock_guard lock(mutex);
+    if (const auto it = loaded.find(key); it != loaded.end()) {
+      hits += 1;
+      return it->second;
+    }
+  }
+
+  const auto directory = get_cache_directory();
+  const auto binary_path = get_binary_path(directory, key);
+
+  std::vector<uint32> spirv = {};
+  if (read_binary(binary_path, key, spirv)) {
+    hits += 1;
+    load_us += (uint64)(load_timer.get_elapsed_msd() * 1000.0);
+  } else {
+    misses += 1;
+
+    const Timer compile_timer = {};
+    std::string errors = {};
+    spirv = compile(source, errors);
+    compile_us += (uint64)(compile_timer.get_elapsed_msd() * 1000.0);
+
+    if (spirv.empty()) {
+      failed += 1;
+      OX_LOG_ERROR("ShaderCache: Failed to compile {} ({}): {}", source.path, source.entry_point, errors);
+      return {};
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec || !write_binary(binary_path, key, spirv))
+      OX_LOG_WARN("ShaderCache: Couldn't write {}", binary_path);
+  }
+
+  record(source);
+
+  std::lock_guard lock(mutex);
+  loaded.emplace(key, spirv);
+  return spirv;
+}
+
+uint32 ShaderCache::prewarm() {
+  OX_SCOPED_ZONE;
+
+  if (compiler_version.empty())
+    return 0;
+
+  const Timer timer = {};
+
+  std::vector<Source> sources = {};
+  {
+    std::lock_guard lock(mutex);
+    load_manifest(get_cache_directory());
+    sources.reserve(manifest.size());
+    for (const auto& [_, source] : manifest)
+      sources.emplace_back(source);
+  }
+
+  if (sources.empty())
+    return 0;
+
+  const uint32 misses_before = misses.load();
+
+  TaskSet task((uint32)sources.size(), [this, &sources](const TaskSetPartition range, uint32_t) {
+    for (uint32 i = range.start; i < range.end; i++)
+      get_spirv(sources[i]);
+  });
+  const auto* task_scheduler = App::get_system<TaskScheduler>();
+  task_scheduler->schedule_task(&task);
+  task_scheduler->wait_task(&task);
+
+  const uint32 compiled = misses.load() - misses_before;
+  prewarmed += compiled;
+
+  OX_LOG_INFO("ShaderCache: Prewarmed {} shaders, {} compiled in {} ms", sources.size(), compiled, timer.get_elapsed_ms());
+
+  return compiled;
+}
+
+void ShaderCache::clear() {
+  std::lock_guard lock(mutex);
+  loaded.clear();
+
+  std::error_code ec;
+  for (const auto& entry : std::filesystem::directory_iterator(get_cache_directory(), ec)) {
+    if (entry.path().extension() == ".spv")
+      std::filesystem::remove(entry.path(), ec);
+  }
+}
+
+void ShaderCache::reset_stats() {
+  hits = 0;
+  misses = 0;
+  failed = 0;
+  prewarmed = 0;
+  load_us = 0;
+  compile_us = 0;
+}
+
+ShaderCache::Stats ShaderCache::get_stats() const {
+  return {
+    .hits = hits.load(),
+    .misses = misses.load(),
+    .failed = failed.load(),
+    .prewarmed = prewarmed.load(),
+    .load_ms = (float)load_us.load() / 1000.0f,
+    .compile_ms = (float)compile_us.load() / 1000.0f,
+  };
+}
+
+void ShaderCache::log_stats() const {
+  const auto stats = get_stats();
+  if (stats.hits + stats.misses == 0)
+    return;
+
+  OX_LOG_INFO("ShaderCache: {} hits, {} misses, {} failed. Load: {:.2f} ms, Compile: {:.2f} ms",
+              stats.hits,
+              stats.misses,
+              stats.failed,
+              stats.load_ms,
+              stats.compile_ms);
+}
+
+std::string ShaderCache::get_cache_directory() {
+  const auto root = Project::get_active() ? Project::get_project_directory() : App::get()->get_specification().working_directory;
+  return fs::preferred_path((std::filesystem::path(root) / ".cache" / "shaders").string());
+}
+
+uint64 ShaderCache::get_key(const Source& source) {
+  OX_SCOPED_ZONE;
+
+  uint64 key = hash_string(compiler_version);
+  key = hash_combine(key, CACHE_VERSION);
+  key = hash_combine(key, hash_string(COMPILE_ARGUMENTS));
+  key = hash_combine(key, (uint64)source.stage);
+  key = hash_combine(key, hash_string(source.entry_point));
+  for (const auto& [name, value] : source.defines) {
+    key = hash_combine(key, hash_string(name));
+    key = hash_combine(key, hash_string(value));
+  }
+
+  // depth first over the include tree, every file is hashed once
+  const auto shader_root = std::filesystem::path(fs::get_shader_path(""));
+  std::vector<std::string> pending = {fs::get_shader_path(source.path)};
+  ankerl::unordered_dense::set<std::string> visited = {};
+  while (!pending.empty()) {
+    const auto path = std::move(pending.back());
+    pending.pop_back();
+    if (!visited.emplace(path).second)
+      continue;
+
+    uint64 file_hash = 0;
+    std::vector<std::string> includes = {};
+    if (!hash_file(path, file_hash, includes)) {
+      if (path == fs::get_shader_path(source.path)) {
+        OX_LOG_ERROR("ShaderCache: Shader file doesn't exist: {}", source.path);
+        return 0;
+      }
+      continue; // let the compiler report missing includes
+    }
+    key = hash_combine(key, file_hash);
+
+    const auto directory = std::filesystem::path(path).parent_path();
+    for (auto it = includes.rbegin(); it != includes.rend(); ++it) {
+      auto include_path = directory / *it;
+      if (!std::filesystem::exists(include_path))
+        include_path = shader_root / *it;
+      pending.emplace_back(include_path.lexically_normal().string());
+    }
+  }
+
+  return key == 0 ? 1 : key;
+}
+
+bool ShaderCache::hash_file(const std::string& path, uint64& hash, std::vector<std::string>& includes) {
+  const int64 write_time = get_write_time(path);
+  if (write_time < 0)
+    return false;
+
+  {
+    std::lock_guard lock(mutex);
+    if (const auto it = file_hashes.find(path); it != file_hashes.end() && it->second.write_time == write_time) {
+      hash = it->second.hash;
+      includes = it->second.includes;
+      return true;
+    }
+  }
+
+  const auto text = fs::read_file(path);
+  hash = hash_string(text);
+  includes = parse_includes(text);
+
+  std::lock_guard lock(mutex);
+  file_hashes[path] = {.write_time = write_time, .hash = hash, .includes = includes};
+  return true;
+}
+
+std::vector<uint32> ShaderCache::compile(const Source& source, std::string& errors) const {
+  OX_SCOPED_ZONE_N("ShaderCache::compile");
+
+#ifdef OX_SHADER_CACHE_DXC
+  const wchar_t* profile = get_target_profile(source.stage);
+  if (!profile) {
+    errors = "shader stage has to be explicit to be cached";
+    return {};
+  }
+
+  const auto path = fs::get_shader_path(source.path);
+  const auto text = fs::read_file(path);
+  if (text.empty()) {
+    errors = "empty or missing source";
+    return {};
+  }
+
+  IDxcUtils* utils_raw = nullptr;
+  IDxcCompiler3* compiler_raw = nullptr;
+  if (FAILED(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&utils_raw))) ||
+      FAILED(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler_raw)))) {
+    DxcPtr<IDxcUtils> release_utils(utils_raw);
+    errors = "couldn't create a DXC instance";
+    return {};
+  }
+  DxcPtr<IDxcUtils> utils(utils_raw);
+  DxcPtr<IDxcCompiler3> compiler(compiler_raw);
+
+  IDxcIncludeHandler* include_handler_raw = nullptr;
+  utils->CreateDefaultIncludeHandler(&include_handler_raw);
+  DxcPtr<IDxcIncludeHandler> include_handler(include_handler_raw);
+
+  std::vector<std::wstring> arguments = {to_wide(path), L"-E", to_wide(source.entry_point), L"-T", profile};
+  std::istringstream compile_arguments(COMPILE_ARGUMENTS);
+  for (std::string argument; compile_arguments >> argument;)
+    arguments.emplace_back(to_wide(argument));
+  arguments.emplace_back(L"-I");
+  arguments.emplace_back(to_wide(fs::get_shader_path("")));
+  for (const auto& [name, value] : source.defines) {
+    arguments.emplace_back(L"-D");
+    arguments.emplace_back(to_wide(value.empty() ? name : fmt::format("{}={}", name, value)));
+  }
+
+  std::vector<LPCWSTR> argument_ptrs = {};
+  argument_ptrs.reserve(arguments.size());
+  for (const auto& argument : arguments)
+    argument_ptrs.emplace_back(argument.c_str());
+
+  const DxcBuffer buffer = {.Ptr = text.data(), .Size = text.size(), .Encoding = DXC_CP_UTF8};
+  IDxcResult* result_raw = nullptr;
+  if (FAILED(compiler->Compile(&buffer, argument_ptrs.data(), (UINT32)argument_ptrs.size(), include_handler.get(), IID_PPV_ARGS(&result_raw)))) {
+    errors = "DXC compile call failed";
+    return {};
+  }
+  DxcPtr<IDxcResult> result(result_raw);
+
+  IDxcBlobUtf8* error_blob_raw = nullptr;
+  result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&error_blob_raw), nullptr);
+  DxcPtr<IDxcBlobUtf8> error_blob(error_blob_raw);
+
+  HRESULT status = S_OK;
+  result->GetStatus(&status);
+  if (FAILED(status)) {
+    if (error_blob && error_blob->GetStringLength() > 0)
+      errors = std::string(error_blob->GetStringPointer(), error_blob->GetStringLength());
+    return {};
+  }
+
+  IDxcBlob* object_raw = nullptr;
+  result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&object_raw), nullptr);
+  DxcPtr<IDxcBlob> object(object_raw);
+  if (!object || object->GetBufferSize() < sizeof(uint32)) {
+    errors = "no output";
+    return {};
+  }
+
+  std::vector<uint32> spirv(object->GetBufferSize() / sizeof(uint32));
+  std::memcpy(spirv.data(), object->GetBufferPointer(), spirv.size() * sizeof(uint32));
+  return spirv;
+#else
+  errors = "built without DXC";
+  return {};
+#endif
+}
+
+void ShaderCache::record(const Source& source) {
+  std::lock_guard lock(mutex);
+  load_manifest(get_cache_directory());
+  if (manifest.emplace(get_manifest_key(source), source).second)
+    save_manifest();
+}
+
+// one line per shader: path|stage|entry point|name=value;name=value
+void ShaderCache::load_manifest(const std::string& directory) {
+  if (manifest_directory == directory)
+    return;
+
+  manifest_directory = directory;
+  manifest.clear();
+
+  std::ifstream file(directory + "/manifest.txt");
+  std::string line;
+  while (std::getline(file, line)) {
+    std::vector<std::string> fields = {};
+    std::istringstream line_stream(line);
+    for (std::string field; std::getline(line_stream, field, '|');)
+      fields.emplace_back(field);
+    if (fields.size() < 3)
+      continue;
+
+    Source source = {.path = fields[0], .stage = (vuk::HlslShaderStage)std::atoi(fields[1].c_str()), .entry_point = fields[2]};
+    if (fields.size() > 3) {
+      std::istringstream define_stream(fields[3]);
+      for (std::string define; std::getline(define_stream, define, ';');) {
+        const auto equals = define.find('=');
+        source.defines.emplace_back(define.substr(0, equals), equals == std::string::npos ? std::string{} : define.substr(equals + 1));
+      }
+    }
+
+    manifest.emplace(get_manifest_key(source), std::move(source));
+  }
+}
+
+void ShaderCache::save_manifest() const {
+  std::error_code ec;
+  std::filesystem::create_directories(manifest_directory, ec);
+
+  std::ofstream file(manifest_directory + "/manifest.txt", std::ios::trunc);
+  for (const auto& [key, _] : manifest)
+    file << key << "\n";
+}
+
+std::string ShaderCache::get_manifest_key(const Source& source) {
+  std::string key = fmt::format("{}|{}|{}|", source.path, (int)source.stage, source.entry_point);
+  for (uint32 i = 0; i < source.defines.size(); i++)
+    key += fmt::format("{}{}={}", i == 0 ? "" : ";", source.defines[i].first, source.defines[i].second);
+  return key;
+}
+} // namespace ox
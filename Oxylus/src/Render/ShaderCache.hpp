@@ -0,0 +1,92 @@
+﻿#pragma once
+#include <ankerl/unordered_dense.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <vuk/runtime/vk/Pipeline.hpp>
+
+#include "Core/ESystem.hpp"
+#include "Core/Types.hpp"
+
+namespace ox {
+// Content addressed on-disk cache of compiled SPIR-V for hlsl shaders.
+//	Entries are keyed by the source, every (recursively) included file, the defines, entry point, stage and the compiler version,
+//	so any edit results in a new entry instead of a stale one. Cache lives in `<project>/.cache/shaders`.
+//	Every shader that goes through the cache is recorded in a manifest which `prewarm()` uses to compile the whole set up front.
+//	Without DXC available (or when a shader fails to compile) shaders are handed to vuk as hlsl like before.
+class ShaderCache : public ESystem {
+public:
+  static constexpr uint32 CACHE_VERSION = 1;
+
+  struct Source {
+    std::string path = {}; // relative to the shader directory
+    vuk::HlslShaderStage stage = vuk::HlslShaderStage::eInferred;
+    std::string entry_point = "main";
+    std::vector<std::pair<std::string, std::string>> defines = {};
+  };
+
+  struct Stats {
+    uint32 hits = 0;
+    uint32 misses = 0;
+    uint32 failed = 0;
+    uint32 prewarmed = 0;
+    float load_ms = 0.0f;    // reading and hashing sources, reading cached binaries
+    float compile_ms = 0.0f; // summed over all threads
+  };
+
+  ShaderCache() = default;
+
+  void init() override;
+  void deinit() override;
+
+  /// Adds the stage to `pci` as cached SPIR-V, compiling and storing it on a miss.
+  void add_hlsl(vuk::PipelineBaseCreateInfo& pci, const Source& source);
+  /// @return SPIR-V for `source`, empty if it couldn't be compiled.
+  std::vector<uint32> get_spirv(const Source& source);
+
+  /// Compiles every shader in the manifest that isn't in the cache yet, in parallel.
+  /// @return Amount of shaders that had to be compiled.
+  uint32 prewarm();
+  /// Removes every cached binary, the manifest is kept.
+  void clear();
+
+  void reset_stats();
+  Stats get_stats() const;
+  void log_stats() const;
+
+  const std::string& get_compiler_version() const { return compiler_version; }
+  static std::string get_cache_directory();
+
+private:
+  struct FileHash {
+    int64 write_time = 0;
+    uint64 hash = 0;
+    std::vector<std::string> includes = {};
+  };
+
+  std::string compiler_version = {};
+
+  mutable std::mutex mutex;
+  ankerl::unordered_dense::map<std::string, FileHash> file_hashes = {};
+  ankerl::unordered_dense::map<uint64, std::vector<uint32>> loaded = {};
+  ankerl::unordered_dense::map<std::string, Source> manifest = {};
+  std::string manifest_directory = {};
+
+  std::atomic<uint32> hits = 0;
+  std::atomic<uint32> misses = 0;
+  std::atomic<uint32> failed = 0;
+  std::atomic<uint32> prewarmed = 0;
+  std::atomic<uint64> load_us = 0;
+  std::atomic<uint64> compile_us = 0;
+
+  uint64 get_key(const Source& source);
+  bool hash_file(const std::string& path, uint64& hash, std::vector<std::string>& includes);
+  std::vector<uint32> compile(const Source& source, std::string& errors) const;
+
+  void record(const Source& source);
+  void load_manifest(const std::string& directory);
+  void save_manifest() const;
+  static std::string get_manifest_key(const Source& source);
+};
+} // namespace ox
@@ -0,0 +1,338 @@
+﻿#include "ShadowAtlas.hpp"
+
+#include <algorithm>
+
+#include "Utils/Log.hpp"
+
+namespace ox {
+static int floor_power2(const float value) {
+  int result = 1;
+  while ((float)(result * 2) <= value)
+    result *= 2;
+  return result;
+}
+
+ShadowAtlas::ShadowAtlas(const Config& config) { init(config); }
+
+void ShadowAtlas::init(const Config& config) {
+  this->config = config;
+  entries.clear();
+  tiles.clear();
+  stats = {};
+  packer = {};
+}
+
+void ShadowAtlas::invalidate() {
+  for (auto& [key, entry] : entries)
+    entry.has_content = false;
+}
+
+int ShadowAtlas::get_desired_resolution(const Request& request) const { return get_resolution(request, nullptr); }
+
+int ShadowAtlas::get_resolution(const Request& request, const Entry* entry) const {
+  const auto slice_count = std::max(request.slice_count, 1u);
+  const int max_resolution = floor_power2((float)std::min(config.max_resolution, config.atlas_size / (int)slice_count));
+
+  const bool keeps_size = entry && entry->resolution > 0 && entry->slice_count == slice_count;
+
+  if (request.fixed_resolution > 0) {
+    const int resolution = std::min((int)request.fixed_resolution, max_resolution);
+    return keeps_size && entry->shrunk && entry->allocated && entry->resolution <= resolution ? entry->resolution : resolution;
+  }
+
+  const float importance = std::clamp(request.screen_coverage * request.priority, 0.0f, 1.0f);
+  const float raw = (float)config.max_resolution * importance;
+  if (raw < (float)config.min_resolution * 0.5f)
+    return 0;
+
+  // keep the current size while it's still close enough to avoid reallocating every few frames
+  if (keeps_size) {
+    if (entry->shrunk && entry->allocated && (float)entry->resolution <= raw)
+      return entry->resolution;
+
+    const int low = floor_power2(raw * (1.0f - config.hysteresis));
+    const int high = floor_power2(raw * (1.0f + config.hysteresis));
+    if (entry->resolution >= low && entry->resolution <= high && entry->resolution <= max_resolution)
+      return entry->resolution;
+  }
+
+  return std::clamp(floor_power2(raw), std::min(config.min_resolution, max_resolution), max_resolution);
+}
+
+void ShadowAtlas::update(const std::span<const Request> requests) {
+  frame += 1;
+  const auto previous_repacks = stats.repacks;
+  const auto previous_evictions = stats.evictions;
+  stats = {};
+  stats.repacks = previous_repacks;
+  stats.evictions = previous_evictions;
+
+  tiles.assign(requests.size(), {});
+
+  std::vector<int> resolutions(requests.size());
+  std::vector<RectPacker::Rect> new_rects = {};
+  for (uint32_t i = 0; i < requests.size(); i++) {
+    const auto& request = requests[i];
+    const auto it = entries.find(request.key);
+    const Entry* entry = it != entries.end() ? &it->second : nullptr;
+
+    resolutions[i] = get_resolution(request, entry);
+    if (resolutions[i] == 0)
+      continue;
+
+    const auto slice_count = std::max(request.slice_count, 1u);
+    if (entry && entry->allocated && entry->resolution == resolutions[i] && entry->slice_count == slice_count)
+      continue;
+
+    RectPacker::Rect rect = {};
+    rect.id = (int)i;
+    rect.w = resolutions[i] * (int)slice_count;
+    rect.h = resolutions[i];
+    new_rects.emplace_back(rect);
+  }
+
+  if (!new_rects.empty()) {
+    // the space of resized or evicted tiles isn't reclaimed until the next repack
+    const bool packed = packer.width == config.atlas_size && packer.pack_more(new_rects.data(), (int)new_rects.size());
+    if (packed) {
+      for (const auto& rect : new_rects) {
+        const auto& request = requests[rect.id];
+        auto& entry = entries[request.key];
+        entry.x = rect.x;
+        entry.y = rect.y;
+        entry.resolution = resolutions[rect.id];
+        entry.slice_count = std::max(request.slice_count, 1u);
+        entry.has_content = false;
+        entry.allocated = true;
+        entry.shrunk = false;
+      }
+    } else {
+      repack(requests, resolutions);
+    }
+  }
+
+  for (uint32_t i = 0; i < requests.size(); i++) {
+    const auto& request = requests[i];
+    if (resolutions[i] == 0)
+      continue;
+
+    const auto it = entries.find(request.key);
+    if (it == entries.end() || !it->second.allocated || it->second.resolution != resolutions[i]) {
+      stats.tiles_dropped += 1;
+      continue;
+    }
+
+    auto& entry = it->second;
+    auto& tile = tiles[i];
+    tile.x = entry.x;
+    tile.y = entry.y;
+    tile.resolution = entry.resolution;
+    tile.slice_count = entry.slice_count;
+    tile.needs_render = !entry.has_content || !request.casters_static || entry.content_hash != request.content_hash;
+
+    entry.content_hash = request.content_hash;
+    entry.has_content = true;
+    entry.last_used = frame;
+    entry.importance = request.screen_coverage * request.priority;
+
+    stats.tiles += 1;
+    stats.tiles_rendered += tile.needs_render ? 1 : 0;
+    stats.tiles_cached += tile.needs_render ? 0 : 1;
+  }
+
+  std::vector<uint64_t> expired = {};
+  uint64_t used_area = 0;
+  for (const auto& [key, entry] : entries) {
+    if (!entry.allocated || frame - entry.last_used > config.retain_frames) {
+      expired.emplace_back(key);
+      continue;
+    }
+    if (entry.last_used != frame)
+      stats.retained += 1;
+    used_area += (uint64_t)entry.resolution * entry.slice_count * entry.resolution;
+  }
+  for (const auto key : expired)
+    entries.erase(key);
+  stats.evictions += (uint32_t)expired.size();
+
+  stats.used_area = (float)((double)used_area / ((double)config.atlas_size * config.atlas_size));
+}
+
+bool ShadowAtlas::repack(const std::span<const Request> requests, std::vector<int>& resolutions) {
+  stats.repacks += 1;
+
+  ankerl::unordered_dense::set<uint64_t> live_keys = {};
+  for (uint32_t i = 0; i < requests.size(); i++) {
+    if (resolutions[i] > 0)
+      live_keys.emplace(requests[i].key);
+  }
+
+  // tiles that aren't requested this frame are packed after the live ones, most recently used first
+  std::vector<uint64_t> retained = {};
+  for (const auto& [key, entry] : entries) {
+    if (entry.allocated && !live_keys.contains(key) && frame - entry.last_used <= config.retain_frames)
+      retained.emplace_back(key);
+  }
+  std::ranges::sort(retained, [this](const uint64_t a, const uint64_t b) { return entries[a].last_used > entries[b].last_used; });
+
+  std::vector<RectPacker::Rect> live_rects = {};
+  bool all_packed = false;
+  while (true) {
+    packer.init_fixed(config.atlas_size, config.atlas_size);
+
+    live_rects.clear();
+    for (uint32_t i = 0; i < requests.size(); i++) {
+      if (resolutions[i] == 0)
+        continue;
+      RectPacker::Rect rect = {};
+      rect.id = (int)i;
+      rect.w = resolutions[i] * (int)std::max(requests[i].slice_count, 1u);
+      rect.h = resolutions[i];
+      live_rects.emplace_back(rect);
+    }
+
+    all_packed = live_rects.empty() || packer.pack_more(live_rects.data(), (int)live_rects.size());
+    if (all_packed)
+      break;
+
+    // shrink the least important light that can still be shrunk and try again, fixed resolutions go last
+    int candidate = -1;
+    float candidate_importance = 0.0f;
+    for (uint32_t i = 0; i < requests.size(); i++) {
+      if (resolutions[i] <= config.min_resolution)
+        continue;
+      const float importance = requests[i].fixed_resolution > 0 ? 2.0f + (float)resolutions[i]
+                                                                 : requests[i].screen_coverage * requests[i].priority;
+      if (candidate == -1 || importance < candidate_importance) {
+        candidate = (int)i;
+        candidate_importance = importance;
+      }
+    }
+    if (candidate == -1)
+      break;
+    resolutions[candidate] /= 2;
+  }
+
+  // whatever didn't fit is dropped for this frame
+  for (const auto& rect : live_rects) {
+    if (!rect.was_packed) {
+      resolutions[rect.id] = 0;
+      continue;
+    }
+
+    const auto& request = requests[rect.id];
+    const auto slice_count = std::max(request.slice_count, 1u);
+    auto& entry = entries[request.key];
+    const bool unchanged = entry.allocated && entry.x == rect.x && entry.y == rect.y && entry.resolution == resolutions[rect.id] &&
+                           entry.slice_count == slice_count;
+    entry.x = rect.x;
+    entry.y = rect.y;
+    entry.resolution = resolutions[rect.id];
+    entry.slice_count = slice_count;
+    entry.has_content = entry.has_content && unchanged;
+    entry.allocated = true;
+    entry.shrunk = resolutions[rect.id] < get_resolution(request, nullptr);
+  }
+
+  // one at a time, packing them together would let stb_rect_pack reorder them by height
+  bool retained_fit = true;
+  for (const auto key : retained) {
+    auto& entry = entries[key];
+    RectPacker::Rect rect = {};
+    rect.w = entry.resolution * (int)entry.slice_count;
+    rect.h = entry.resolution;
+    retained_fit = retained_fit && packer.pack_more(&rect, 1);
+    if (!retained_fit) {
+      // evicted once the entries are cleaned up at the end of the update
+      entry.allocated = false;
+      continue;
+    }
+    entry.has_content = entry.has_content && entry.x == rect.x && entry.y == rect.y;
+    entry.x = rect.x;
+    entry.y = rect.y;
+  }
+
+  return all_packed;
+}
+
+bool ShadowAtlas::verify() {
+  const auto fail = [](const char* message) {
+    OX_LOG_ERROR("ShadowAtlas: {}", message);
+    return false;
+  };
+
+  const auto overlaps = [](const std::vector<Tile>& tiles, const int atlas_size) {
+    for (size_t a = 0; a < tiles.size(); a++) {
+      const auto& ta = tiles[a];
+      if (!ta.is_valid())
+        continue;
+      if (ta.x < 0 || ta.y < 0 || ta.x + ta.resolution * (int)ta.slice_count > atlas_size || ta.y + ta.resolution > atlas_size)
+        return true;
+      for (size_t b = a + 1; b < tiles.size(); b++) {
+        const auto& tb = tiles[b];
+        if (tb.is_valid() && ta.x < tb.x + tb.resolution * (int)tb.slice_count && tb.x < ta.x + ta.resolution * (int)ta.slice_count &&
+            ta.y < tb.y + tb.resolution && tb.y < ta.y + ta.resolution)
+          return true;
+      }
+    }
+    return false;
+  };
+
+  const auto make_request = [](const uint64_t key, const uint32_t resolution, const uint32_t slice_count = 1) {
+    return Request{.key = key, .slice_count = slice_count, .fixed_resolution = resolution, .content_hash = key, .casters_static = true};
+  };
+
+  // allocation: everything fits without overlapping, a cascaded light gets its slices side by side
+  ShadowAtlas atlas({.atlas_size = 1024, .max_resolution = 512, .min_resolution = 64});
+  std::vector<Request> requests = {make_request(1, 256, 4), make_request(2, 512), make_request(3, 128), make_request(4, 64)};
+  atlas.update(requests);
+  if (atlas.get_stats().tiles != 4 || overlaps(atlas.get_tiles(), 1024) || atlas.get_tiles()[0].slice_count != 4)
+    return fail("didn't allocate non overlapping tiles for requests that fit");
+
+  // caching: unchanged static lights are reused, a new hash or moving casters render again
+  atlas.update(requests);
+  if (atlas.get_stats().tiles_cached != 4)
+    return fail("unchanged tiles weren't reported as cached");
+  requests[1].content_hash += 1;
+  requests[2].casters_static = false;
+  atlas.update(requests);
+  if (!atlas.get_tiles()[1].needs_render || !atlas.get_tiles()[2].needs_render || atlas.get_tiles()[0].needs_render)
+    return fail("changed tiles weren't rendered again");
+
+  // coverage based resolutions keep their size within the hysteresis
+  ShadowAtlas coverage_atlas({.atlas_size = 1024, .max_resolution = 512, .min_resolution = 64});
+  Request coverage_request = {.key = 1, .screen_coverage = 0.5f, .casters_static = true};
+  coverage_atlas.update(std::span(&coverage_request, 1));
+  const int resolution = coverage_atlas.get_tiles()[0].resolution;
+  const uint32_t repacks = coverage_atlas.get_stats().repacks;
+  coverage_request.screen_coverage = 0.45f;
+  coverage_atlas.update(std::span(&coverage_request, 1));
+  if (coverage_atlas.get_tiles()[0].resolution != resolution || coverage_atlas.get_stats().repacks != repacks ||
+      coverage_atlas.get_tiles()[0].needs_render)
+    return fail("a small coverage change reallocated the tile");
+
+  // lru: four retained tiles fill the atlas, two new ones push out the two least recently used
+  ShadowAtlas lru_atlas({.atlas_size = 1024, .max_resolution = 512, .min_resolution = 64});
+  requests = {make_request(1, 512), make_request(2, 512), make_request(3, 512), make_request(4, 512)};
+  for (uint32_t used = 4; used > 0; used--)
+    lru_atlas.update(std::span(requests).last(used)); // 1 is last used first, 4 last
+  lru_atlas.update({});
+  requests = {make_request(5, 512), make_request(6, 512)};
+  lru_atlas.update(requests);
+  if (lru_atlas.get_stats().tiles != 2 || !lru_atlas.entries.contains(3) || !lru_atlas.entries.contains(4) || lru_atlas.entries.contains(1) ||
+      lru_atlas.entries.contains(2))
+    return fail("retained tiles weren't evicted least recently used first");
+
+  // overflow: more than fits, the least important light is shrunk until everything fits
+  ShadowAtlas overflow_atlas({.atlas_size = 1024, .max_resolution = 512, .min_resolution = 64});
+  requests = {};
+  for (uint64_t key = 1; key <= 5; key++)
+    requests.emplace_back(Request{.key = key, .screen_coverage = 1.0f, .priority = (float)key * 0.1f + 0.5f});
+  overflow_atlas.update(requests);
+  const auto& tiles = overflow_atlas.get_tiles();
+  if (overflow_atlas.get_stats().tiles != 5 || overlaps(tiles, 1024) || tiles[0].resolution >= tiles[4].resolution)
+    return fail("didn't shrink the least important light to fit everything");
+
+  return true;
+}
+}
@@ -0,0 +1,107 @@
+﻿#pragma once
+#include <ankerl/unordered_dense.h>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Utils/RectPacker.hpp"
+
+namespace ox {
+// Allocates shadow map tiles for lights inside a fixed size atlas.
+//	Tiles are sized by the light's screen coverage and priority, rounded to powers of two with some
+//	hysteresis so lights moving around don't cause a reallocation every frame.
+//	Allocations are kept in place between frames, new tiles are packed into the space that is left and the
+//	atlas is only repacked when that fails. Lights that stop requesting a tile keep it for `retain_frames`
+//	and are evicted least recently used first when space runs out: they're packed one by one from the most recently used
+//	after the live tiles and the first that doesn't fit is evicted together with every older one. If the live tiles don't fit either, the least
+//	important lights are shrunk and keep that size until the next repack.
+//	A tile whose light and casters didn't change since it was last rendered is reported as cached.
+//	Doesn't touch the GPU, the renderer is expected to render every tile that has `needs_render` set.
+class ShadowAtlas {
+public:
+  struct Config {
+    int atlas_size = 4096;
+    int max_resolution = 1024;
+    int min_resolution = 64;
+    uint32_t retain_frames = 120;
+    float hysteresis = 0.25f;
+  };
+
+  struct Request {
+    uint64_t key = 0;             // stable id of the light
+    uint32_t slice_count = 1;     // cascades or cube faces, laid out next to each other horizontally
+    uint32_t fixed_resolution = 0; // overrides the coverage based resolution when non zero
+    float screen_coverage = 1.0f; // 0-1
+    float priority = 1.0f;
+    uint64_t content_hash = 0;    // light and static caster state, a change invalidates the cached tile
+    bool casters_static = false;  // tiles with moving casters are rendered every frame
+  };
+
+  struct Tile {
+    int x = 0;
+    int y = 0;
+    int resolution = 0; // size of a single slice
+    uint32_t slice_count = 0;
+    bool needs_render = false;
+
+    bool is_valid() const { return resolution > 0; }
+  };
+
+  struct Stats {
+    uint32_t tiles = 0;
+    uint32_t tiles_rendered = 0;
+    uint32_t tiles_cached = 0;
+    uint32_t tiles_dropped = 0; // requests that didn't get a tile
+    uint32_t retained = 0;
+    uint32_t evictions = 0; // total since init
+    uint32_t repacks = 0;   // total since init
+    float used_area = 0.0f; // fraction of the atlas covered by tiles
+  };
+
+  ShadowAtlas() = default;
+  explicit ShadowAtlas(const Config& config);
+
+  void init(const Config& config);
+
+  // Allocates tiles for this frame's requests, tiles are returned in the same order by `get_tiles`.
+  void update(std::span<const Request> requests);
+
+  // Drops every cached tile, e.g. after the atlas texture was recreated.
+  void invalidate();
+
+  const std::vector<Tile>& get_tiles() const { return tiles; }
+  const Stats& get_stats() const { return stats; }
+  const Config& get_config() const { return config; }
+
+  // Resolution a request would get with no allocation to compare against, 0 if it's too small to be worth a tile.
+  int get_desired_resolution(const Request& request) const;
+
+  /// Runs a scripted sequence of frames against a small atlas and checks allocation, caching, LRU eviction and
+  /// the shrinking fallback. Logs and returns false on the first mismatch.
+  static bool verify();
+
+private:
+  struct Entry {
+    int x = 0;
+    int y = 0;
+    int resolution = 0;
+    uint32_t slice_count = 0;
+    uint64_t content_hash = 0;
+    uint64_t last_used = 0;
+    float importance = 0.0f;
+    bool has_content = false;
+    bool allocated = false;
+    bool shrunk = false; // got less than it asked for at the last repack
+  };
+
+  Config config = {};
+  RectPacker::State packer = {};
+  ankerl::unordered_dense::map<uint64_t, Entry> entries = {};
+  std::vector<Tile> tiles = {};
+  Stats stats = {};
+  uint64_t frame = 0;
+
+  int get_resolution(const Request& request, const Entry* entry) const;
+  bool repack(std::span<const Request> requests, std::vector<int>& resolutions);
+};
+}
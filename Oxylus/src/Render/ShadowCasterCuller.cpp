@@ -0,0 +1,139 @@
+﻿#include "ShadowCasterCuller.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#include "Thread/TaskScheduler.hpp"
+#include "Utils/Profiler.hpp"
+
+namespace ox {
+// below this many casters scheduling tasks costs more than it saves
+static constexpr uint32 MIN_PARALLEL_CASTERS = 1024;
+static constexpr uint64 CACHE_RETAIN_FRAMES = 60;
+
+void ShadowCasterCuller::set_casters(const std::span<const AABB> bounds) {
+  OX_SCOPED_ZONE;
+  using ankerl::unordered_dense::detail::wyhash::hash;
+
+  caster_bounds.assign(bounds.begin(), bounds.end());
+  caster_spheres.resize(bounds.size());
+  caster_hashes.resize(bounds.size());
+  for (uint32 i = 0; i < bounds.size(); i++) {
+    const auto& aabb = bounds[i];
+    caster_spheres[i] = Sphere(aabb.get_center(), glm::length(aabb.get_extents()) * 0.5f);
+    caster_hashes[i] = hash(&aabb, sizeof(AABB)) ^ hash((uint64)i + 1);
+  }
+}
+
+ShadowCasterCuller::Planes ShadowCasterCuller::get_planes(const Mat4& m) {
+  const float4 row0 = float4(m[0][0], m[1][0], m[2][0], m[3][0]);
+  const float4 row1 = float4(m[0][1], m[1][1], m[2][1], m[3][1]);
+  const float4 row2 = float4(m[0][2], m[1][2], m[2][2], m[3][2]);
+  const float4 row3 = float4(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+  // depth is 0..1, works for reversed-z as well
+  return {{row3 + row0, row3 - row0, row3 + row1, row3 - row1, row2, row3 - row2}};
+}
+
+bool ShadowCasterCuller::test(const View& view, const AABB& bounds) {
+  const Sphere sphere(bounds.get_center(), glm::length(bounds.get_extents()) * 0.5f);
+  return test(view, get_planes(view.view_projection), bounds, sphere);
+}
+
+bool ShadowCasterCuller::test(const View& view, const Planes& planes, const AABB& bounds, const Sphere& sphere) {
+  const float3 extrusion = view.extrusion;
+  const float extrusion_length2 = glm::dot(extrusion, extrusion);
+
+  if (view.bounds.radius > 0.0f) {
+    // distance from the view sphere to the caster sphere swept along the light direction
+    const float t = extrusion_length2 > 0.0f ? std::clamp(glm::dot(view.bounds.center - sphere.center, extrusion) / extrusion_length2, 0.0f, 1.0f)
+                                             : 0.0f;
+    const float3 closest = sphere.center + extrusion * t;
+    const float3 delta = view.bounds.center - closest;
+    const float radius = view.bounds.radius + sphere.radius;
+    if (glm::dot(delta, delta) > radius * radius)
+      return false;
+  }
+
+  // the swept box reaches furthest along a plane normal at one of its ends
+  const float3 center = bounds.get_center();
+  const float3 half_extents = bounds.get_extents() * 0.5f;
+  for (const auto& plane : planes.planes) {
+    const float3 normal = float3(plane);
+    const float distance = glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), half_extents) +
+                           std::max(0.0f, glm::dot(normal, extrusion));
+    if (distance < 0.0f)
+      return false;
+  }
+
+  return true;
+}
+
+void ShadowCasterCuller::cull(const uint64 light_key, std::span<const View> views, TaskScheduler* scheduler) {
+  OX_SCOPED_ZONE;
+  using ankerl::unordered_dense::detail::wyhash::hash;
+
+  if (views.size() > MAX_VIEWS)
+    views = views.first(MAX_VIEWS);
+
+  std::array<Planes, MAX_VIEWS> planes = {};
+  for (uint32 v = 0; v < views.size(); v++)
+    planes[v] = get_planes(views[v].view_projection);
+
+  const auto caster_count = (uint32)caster_bounds.size();
+  view_masks.assign(caster_count, 0);
+
+  const auto cull_range = [this, views, &planes](const uint32 start, const uint32 end) {
+    for (uint32 i = start; i < end; i++) {
+      uint32 mask = 0;
+      for (uint32 v = 0; v < views.size(); v++) {
+        if (test(views[v], planes[v], caster_bounds[i], caster_spheres[i]))
+          mask |= 1u << v;
+      }
+      view_masks[i] = mask;
+    }
+  };
+
+  if (scheduler && caster_count >= MIN_PARALLEL_CASTERS) {
+    TaskSet task(caster_count, [&cull_range](const TaskSetPartition range, uint32_t) { cull_range(range.start, range.end); });
+    scheduler->schedule_task(&task);
+    scheduler->wait_task(&task);
+  } else {
+    cull_range(0, caster_count);
+  }
+
+  // caster hashes are summed so the result doesn't depend on the order casters were tested in
+  view_results.assign(views.size(), {});
+  std::array<uint64, MAX_VIEWS> caster_sums = {};
+  for (uint32 i = 0; i < caster_count; i++) {
+    for (uint32 mask = view_masks[i]; mask != 0; mask &= mask - 1) {
+      const uint32 v = (uint32)std::countr_zero(mask);
+      view_results[v].caster_count += 1;
+      caster_sums[v] += caster_hashes[i];
+    }
+  }
+
+  auto& cached = cache[light_key];
+  const bool same_view_count = cached.view_count == views.size();
+  for (uint32 v = 0; v < views.size(); v++) {
+    auto& result = view_results[v];
+    result.hash = hash(&views[v].view_projection, sizeof(Mat4)) ^ hash(caster_sums[v]);
+    result.changed = !same_view_count || cached.last_used == 0 || cached.hashes[v] != result.hash;
+    cached.hashes[v] = result.hash;
+  }
+  cached.view_count = (uint32)views.size();
+  cached.last_used = frame + 1;
+}
+
+void ShadowCasterCuller::end_frame() {
+  frame += 1;
+
+  std::vector<uint64> expired = {};
+  for (const auto& [key, cached] : cache) {
+    if (frame - std::min(cached.last_used, frame) > CACHE_RETAIN_FRAMES)
+      expired.emplace_back(key);
+  }
+  for (const auto key : expired)
+    cache.erase(key);
+}
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+#include <ankerl/unordered_dense.h>
+#include <array>
+#include <span>
+#include <vector>
+
+#include "BoundingVolume.hpp"
+
+#include "Core/Types.hpp"
+
+namespace ox {
+class TaskScheduler;
+
+// Decides which shadow casters end up in which shadow view (cascade or cube face).
+//	Casters are first tested against the bounding sphere of a view and then against the planes of its
+//	view projection. Casters can be extruded along the light direction, so geometry between the light and a
+//	cascade that still throws a shadow into it is kept.
+//	Every view gets a hash of its matrix and caster set, views whose hash didn't change since the last
+//	frame don't need to be rendered again.
+//	Doesn't depend on any GPU state.
+class ShadowCasterCuller {
+public:
+  static constexpr uint32 MAX_VIEWS = 16;
+
+  struct View {
+    Mat4 view_projection = {};
+    Sphere bounds = {};      // skipped when the radius is 0
+    float3 extrusion = {};   // light direction times distance, casters are swept along it
+  };
+
+  struct ViewResult {
+    uint32 caster_count = 0;
+    uint64 hash = 0;
+    bool changed = true;
+  };
+
+  // Sets the world space bounds of this frame's casters.
+  void set_casters(std::span<const AABB> bounds);
+
+  // Culls every caster against the views of one light. Views are cached under the light's key.
+  void cull(uint64 light_key, std::span<const View> views, TaskScheduler* scheduler = nullptr);
+
+  // Drops cached views of lights that weren't culled for a while.
+  void end_frame();
+
+  // Bit n is set if the caster is in view n of the last `cull`.
+  uint32 get_view_mask(const uint32 caster) const { return view_masks[caster]; }
+  const std::vector<uint32>& get_view_masks() const { return view_masks; }
+  const std::vector<ViewResult>& get_view_results() const { return view_results; }
+  uint32 get_caster_count() const { return (uint32)caster_bounds.size(); }
+
+  static bool test(const View& view, const AABB& bounds);
+
+private:
+  struct CachedLight {
+    std::array<uint64, MAX_VIEWS> hashes = {};
+    uint32 view_count = 0;
+    uint64 last_used = 0;
+  };
+
+  struct Planes {
+    float4 planes[6] = {}; // inside if dot(xyz, p) + w >= 0
+  };
+
+  std::vector<AABB> caster_bounds = {};
+  std::vector<Sphere> caster_spheres = {};
+  std::vector<uint64> caster_hashes = {};
+  std::vector<uint32> view_masks = {};
+  std::vector<ViewResult> view_results = {};
+  ankerl::unordered_dense::map<uint64, CachedLight> cache = {};
+  uint64 frame = 0;
+
+  static Planes get_planes(const Mat4& view_projection);
+  static bool test(const View& view, const Planes& planes, const AABB& bounds, const Sphere& sphere);
+};
+}
@@ -0,0 +1,213 @@
+﻿#include "SpriteAtlas.hpp"
+
+#include <fmt/format.h>
+
+#include "Assets/AssetManager.hpp"
+#include "Assets/Texture.hpp"
+#include "Core/App.hpp"
+#include "Core/FileSystem.hpp"
+#include "Core/VFS.hpp"
+
+#include "Utils/Log.hpp"
+#include "Utils/Profiler.hpp"
+
+namespace ox {
+static uint32 atlas_counter = 0;
+
+void SpriteAtlas::add(const Shared<Texture>& texture) {
+  if (!texture)
+    return;
+
+  const auto& path = texture->get_path();
+  if (path.empty() || regions.contains(path) || rejected.contains(path) || queued.contains(path))
+    return;
+
+  // pages are plain rgba8
+  if (texture->as_attachment().format != vuk::Format::eR8G8B8A8Unorm) {
+    rejected.emplace(path);
+    return;
+  }
+
+  queued.emplace(path);
+  pending.emplace_back(path);
+}
+
+void SpriteAtlas::update() {
+  if (pending.empty())
+    return;
+
+  OX_SCOPED_ZONE;
+
+  std::vector<Image> images = {};
+  images.reserve(pending.size());
+
+  for (auto& path : pending) {
+    const auto extension = fs::get_file_extension(path);
+    if (extension == "ktx" || extension == "ktx2") {
+      rejected.emplace(path);
+      continue;
+    }
+
+    Image image = {.path = path};
+    if (!load_image(image) || (int)image.width + PADDING * 2 > PAGE_SIZE || (int)image.height + PADDING * 2 > PAGE_SIZE) {
+      delete[] image.pixels;
+      rejected.emplace(path);
+      continue;
+    }
+
+    images.emplace_back(image);
+  }
+
+  pending.clear();
+  queued.clear();
+
+  std::vector<RectPacker::Rect> rects = {};
+  rects.reserve(images.size());
+  for (int i = 0; i < (int)images.size(); i++) {
+    rects.emplace_back(RectPacker::Rect{
+      .id = i,
+      .w = (int)images[i].width + PADDING * 2,
+      .h = (int)images[i].height + PADDING * 2,
+    });
+  }
+
+  // try the space left in existing pages first, whatever is left over opens new pages
+  uint32 page_index = 0;
+  while (!rects.empty()) {
+    if (page_index == pages.size())
+      add_page();
+
+    auto& page = pages[page_index];
+    page.packer.pack_more(rects.data(), (int)rects.size());
+
+    for (const auto& rect : rects) {
+      if (!rect.was_packed)
+        continue;
+
+      const auto& image = images[rect.id];
+      restore_pixels(page);
+      blit(page, image, rect.x + PADDING, rect.y + PADDING);
+      page.placements.emplace_back(Placement{image.path, rect.x + PADDING, rect.y + PADDING, image.width, image.height});
+
+      regions[image.path] = Region{
+        .page = page_index,
+        .uv_scale = float2((float)image.width, (float)image.height) / (float)PAGE_SIZE,
+        .uv_offset = float2((float)(rect.x + PADDING), (float)(rect.y + PADDING)) / (float)PAGE_SIZE,
+      };
+      page.dirty = true;
+    }
+
+    std::erase_if(rects, [](const RectPacker::Rect& rect) { return rect.was_packed; });
+    page_index++;
+  }
+
+  for (auto& image : images)
+    delete[] image.pixels;
+
+  for (uint32 i = 0; i < (uint32)pages.size(); i++) {
+    if (pages[i].dirty)
+      upload(i);
+  }
+}
+
+void SpriteAtlas::clear() {
+  for (auto& page : pages)
+    AssetManager::release(page.texture_handle);
+
+  pages.clear();
+  regions.clear();
+  queued.clear();
+  rejected.clear();
+  pending.clear();
+}
+
+const SpriteAtlas::Region* SpriteAtlas::get_region(const Texture& texture) const {
+  const auto it = regions.find(texture.get_path());
+  if (it == regions.end() || !pages[it->second.page].texture)
+    return nullptr;
+
+  return &it->second;
+}
+
+uint32 SpriteAtlas::add_page() {
+  auto& page = pages.emplace_back();
+  page.packer.init_fixed(PAGE_SIZE, PAGE_SIZE);
+  page.pixels.resize((size_t)PAGE_SIZE * PAGE_SIZE * 4);
+  return (uint32)pages.size() - 1;
+}
+
+bool SpriteAtlas::load_image(Image& image) {
+  const auto physical_path = App::get_system<VFS>()->resolve_physical_dir(image.path);
+  image.pixels = Texture::load_stb_image(physical_path, &image.width, &image.height);
+  if (image.pixels && image.width > 0 && image.height > 0)
+    return true;
+
+  delete[] image.pixels;
+  image.pixels = nullptr;
+  return false;
+}
+
+void SpriteAtlas::restore_pixels(Page& page) const {
+  if (!page.pixels.empty())
+    return;
+
+  OX_SCOPED_ZONE;
+  page.pixels.resize((size_t)PAGE_SIZE * PAGE_SIZE * 4);
+  for (const auto& placement : page.placements) {
+    Image image = {.path = placement.path};
+    // the file changed size since it was packed, its region would overlap others
+    if (!load_image(image) || image.width != placement.width || image.height != placement.height) {
+      OX_LOG_WARN("SpriteAtlas: Couldn't reload {} for an atlas page, its region stays empty", placement.path);
+      delete[] image.pixels;
+      continue;
+    }
+
+    blit(page, image, placement.x, placement.y);
+    delete[] image.pixels;
+  }
+}
+
+void SpriteAtlas::blit(Page& page, const Image& image, const int x, const int y) const {
+  // the padding repeats the edge pixels so filtering never picks up a neighbour
+  for (int row = -PADDING; row < (int)image.height + PADDING; row++) {
+    const int src_row = std::clamp(row, 0, (int)image.height - 1);
+    for (int col = -PADDING; col < (int)image.width + PADDING; col++) {
+      const int src_col = std::clamp(col, 0, (int)image.width - 1);
+      const auto* src = image.pixels + ((size_t)src_row * image.width + src_col) * 4;
+      auto* dst = page.pixels.data() + ((size_t)(y + row) * PAGE_SIZE + (x + col)) * 4;
+      std::memcpy(dst, src, 4);
+    }
+  }
+}
+
+void SpriteAtlas::upload(const uint32 page_index) {
+  OX_SCOPED_ZONE;
+  auto& page = pages[page_index];
+
+  // a new asset per version, the old one is freed once the frames using it are retired
+  AssetManager::release(page.texture_handle);
+
+  page.asset_name = fmt::format("sprite_atlas_{}_page_{}", atlas_counter++, page_index);
+  page.texture_handle = AssetManager::acquire_texture_asset(page.asset_name,
+                                                            TextureLoadInfo{
+                                                              .preset = Preset::eRTT2DUnmipped,
+                                                              .extent = {(uint32)PAGE_SIZE, (uint32)PAGE_SIZE, 1},
+                                                              .format = vuk::Format::eR8G8B8A8Unorm,
+                                                              .data = page.pixels.data(),
+                                                            });
+  page.texture = AssetManager::get(page.texture_handle);
+  if (page.texture) {
+    page.texture->set_name(page.asset_name);
+  } else {
+    OX_LOG_ERROR("Couldn't create sprite atlas page {}, using a white texture instead", page_index);
+    page.texture = Texture::get_white_texture();
+  }
+  page.dirty = false;
+
+  // the texture has its own copy, 16 MB per page aren't kept around for a page that may never change again
+  page.pixels.clear();
+  page.pixels.shrink_to_fit();
+
+  OX_LOG_INFO("Uploaded sprite atlas page {} ({} textures packed in total)", page_index, regions.size());
+}
+} // namespace ox
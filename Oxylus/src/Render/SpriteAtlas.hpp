@@ -0,0 +1,83 @@
+﻿#pragma once
+#include <ankerl/unordered_dense.h>
+#include <string>
+#include <vector>
+
+#include "Assets/AssetManager.hpp"
+#include "Core/Base.hpp"
+#include "Core/Types.hpp"
+#include "Utils/RectPacker.hpp"
+
+namespace ox {
+class Texture;
+
+// Packs sprite textures into shared atlas pages so sprites with different textures sample the same image.
+//	Textures are queued with `add` and packed on the next `update`. New textures are packed into the space
+//	left in existing pages, only the pages that changed are uploaded again.
+//	Pixels are read back from the texture's source file, textures without one (or KTX) are left as is.
+//	Pages don't keep their pixels after the upload, a page that gets more textures later reads its sources again.
+class SpriteAtlas {
+public:
+  static constexpr int PAGE_SIZE = 2048;
+  static constexpr int PADDING = 2;
+
+  struct Region {
+    uint32 page = 0;
+    float2 uv_scale = {};
+    float2 uv_offset = {};
+  };
+
+  ~SpriteAtlas() { clear(); }
+
+  void add(const Shared<Texture>& texture);
+  void update();
+  void clear();
+
+  // Returns nullptr if the texture isn't packed into a page.
+  const Region* get_region(const Texture& texture) const;
+  const Shared<Texture>& get_page_texture(const uint32 page) const { return pages[page].texture; }
+
+  uint32 get_page_count() const { return (uint32)pages.size(); }
+  uint32 get_texture_count() const { return (uint32)regions.size(); }
+
+private:
+  // where a source image was blitted to, to rebuild a page's pixels
+  struct Placement {
+    std::string path = {};
+    int x = 0;
+    int y = 0;
+    uint32 width = 0;
+    uint32 height = 0;
+  };
+
+  struct Page {
+    RectPacker::State packer = {};
+    std::vector<Placement> placements = {};
+    std::vector<uint8> pixels = {}; // only between packing and the upload
+    AssetHandle<Texture> texture_handle = {}; // holds the page's reference
+    Shared<Texture> texture = nullptr;
+    std::string asset_name = {};
+    bool dirty = false;
+  };
+
+  struct Image {
+    std::string path = {};
+    uint8* pixels = nullptr;
+    uint32 width = 0;
+    uint32 height = 0;
+  };
+
+  std::vector<Page> pages = {};
+  ankerl::unordered_dense::map<std::string, Region> regions = {};
+  ankerl::unordered_dense::set<std::string> queued = {};
+  ankerl::unordered_dense::set<std::string> rejected = {};
+  std::vector<std::string> pending = {};
+
+  uint32 add_page();
+  static bool load_image(Image& image);
+  /// Loads the page's images again if its pixels were released after the last upload.
+  void restore_pixels(Page& page) const;
+  void blit(Page& page, const Image& image, int x, int y) const;
+  void upload(uint32 page_index);
+};
+} // namespace ox
@@ -0,0 +1,77 @@
+﻿#include "GrowableBuffer.hpp"
+
+#include <algorithm>
+
+#include "Utils/Profiler.hpp"
+
+namespace ox {
+void GrowableBuffer::init(const Config& config_) {
+  config = config_;
+  stats = {};
+  idle_high_water = 0;
+  buffer = {};
+  retired.clear();
+  reallocated = false;
+}
+
+uint64 GrowableBuffer::align(const uint64 size) const {
+  const auto alignment = std::max<uint64>(config.alignment, 1);
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+uint64 GrowableBuffer::request(const uint64 size) {
+  stats.used = size;
+  stats.high_water = std::max(stats.high_water, size);
+
+  if (size > stats.capacity || stats.capacity == 0) {
+    stats.grows += 1;
+    stats.idle_frames = 0;
+    return align(std::max(config.min_capacity, (uint64)((double)size * config.growth_factor)));
+  }
+
+  if ((double)size > (double)stats.capacity * config.shrink_threshold) {
+    stats.idle_frames = 0;
+    return 0;
+  }
+
+  // only shrink to what the idle frames actually needed, not to this frame's request alone
+  idle_high_water = stats.idle_frames == 0 ? size : std::max(idle_high_water, size);
+  stats.idle_frames += 1;
+  if (stats.idle_frames < config.shrink_after_frames)
+    return 0;
+
+  const uint64 capacity = align(std::max(config.min_capacity, (uint64)((double)idle_high_water * config.growth_factor)));
+  stats.idle_frames = 0;
+  if (capacity >= stats.capacity)
+    return 0;
+
+  stats.shrinks += 1;
+  return capacity;
+}
+
+bool GrowableBuffer::ensure(vuk::Allocator& allocator, const uint64 size, const uint64 frame) {
+  OX_SCOPED_ZONE;
+
+  while (!retired.empty() && frame >= retired.front().frame + config.retire_latency)
+    retired.pop_front();
+
+  const uint64 capacity = request(size);
+  reallocated = capacity != 0;
+  if (!reallocated)
+    return false;
+
+  if (buffer)
+    retired.emplace_back(RetiredBuffer{std::move(buffer), frame});
+
+  buffer = *vuk::allocate_buffer(allocator, {.mem_usage = config.mem_usage, .size = capacity, .alignment = config.alignment});
+  stats.capacity = capacity;
+  stats.high_water = size;
+  stats.allocated_bytes += capacity;
+
+  return true;
+}
+
+vuk::Value<vuk::Buffer> GrowableBuffer::acquire(const vuk::Name name, const vuk::Access last_access) const {
+  return vuk::acquire_buf(name, *buffer, reallocated ? vuk::eNone : last_access);
+}
+} // namespace ox
@@ -0,0 +1,72 @@
+﻿#pragma once
+#include <deque>
+#include <vuk/Value.hpp>
+#include <vuk/vsl/Core.hpp>
+
+#include "Core/Types.hpp"
+
+namespace ox {
+// A buffer that persists across frames and is only reallocated when the requested size doesn't fit anymore.
+//	Grows to the requested size plus `growth_factor` headroom and shrinks back once the usage stayed below
+//	`shrink_threshold` of the capacity for `shrink_after_frames` frames in a row.
+//	Replaced buffers are kept alive for `retire_latency` frames, since frames in flight may still use them.
+//	Contents are undefined after a reallocation.
+class GrowableBuffer {
+public:
+  struct Config {
+    vuk::MemoryUsage mem_usage = vuk::MemoryUsage::eGPUonly;
+    uint64 min_capacity = 256;
+    uint64 alignment = 256;
+    float growth_factor = 1.5f;
+    float shrink_threshold = 0.25f;
+    uint32 shrink_after_frames = 300;
+    uint32 retire_latency = 3;
+  };
+
+  struct Stats {
+    uint64 capacity = 0;
+    uint64 used = 0;
+    uint64 high_water = 0; // largest request since the last reallocation
+    uint32 grows = 0;
+    uint32 shrinks = 0;
+    uint32 idle_frames = 0; // frames the usage stayed under the shrink threshold
+    uint64 allocated_bytes = 0; // summed over every reallocation
+  };
+
+  GrowableBuffer() = default;
+  explicit GrowableBuffer(const Config& config_) : config(config_) {}
+
+  void init(const Config& config_);
+
+  /// Applies the growth/shrink policy for a request of `size` bytes without allocating anything.
+  /// @return the capacity the buffer has to be reallocated with, 0 if the current one can be kept.
+  uint64 request(uint64 size);
+
+  /// Makes sure at least `size` bytes fit in the buffer.
+  /// @return true if the buffer was reallocated.
+  bool ensure(vuk::Allocator& allocator, uint64 size, uint64 frame);
+
+  /// Hands the buffer to the render graph. `last_access` is how the previous frame left it,
+  /// it is ignored right after a reallocation.
+  vuk::Value<vuk::Buffer> acquire(vuk::Name name, vuk::Access last_access) const;
+
+  const vuk::Buffer& get_buffer() const { return *buffer; }
+  bool is_valid() const { return buffer && buffer->size > 0; }
+  const Stats& get_stats() const { return stats; }
+
+private:
+  struct RetiredBuffer {
+    vuk::Unique<vuk::Buffer> buffer;
+    uint64 frame = 0;
+  };
+
+  Config config = {};
+  Stats stats = {};
+  vuk::Unique<vuk::Buffer> buffer = {};
+  std::deque<RetiredBuffer> retired = {};
+  uint64 idle_high_water = 0;
+  bool reallocated = false;
+
+  uint64 align(uint64 size) const;
+};
+} // namespace ox
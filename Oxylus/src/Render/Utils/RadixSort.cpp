@@ -0,0 +1,60 @@
+﻿#include "RadixSort.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ox {
+void RadixSort::sort(std::span<uint64_t> keys, std::span<uint32_t> values, std::vector<uint64_t>& keys_scratch, std::vector<uint32_t>& values_scratch) {
+  const size_t count = keys.size();
+  if (count < 2)
+    return;
+
+  keys_scratch.resize(count);
+  values_scratch.resize(count);
+
+  constexpr uint32_t PASS_COUNT = sizeof(uint64_t);
+
+  // build every histogram up front with a single read of the keys
+  uint32_t histograms[PASS_COUNT][256] = {};
+  for (const uint64_t key : keys) {
+    for (uint32_t pass = 0; pass < PASS_COUNT; pass++)
+      histograms[pass][(key >> (pass * 8)) & 0xFF] += 1;
+  }
+
+  uint64_t* src_keys = keys.data();
+  uint32_t* src_values = values.data();
+  uint64_t* dst_keys = keys_scratch.data();
+  uint32_t* dst_values = values_scratch.data();
+
+  for (uint32_t pass = 0; pass < PASS_COUNT; pass++) {
+    auto& histogram = histograms[pass];
+    const uint32_t shift = pass * 8;
+
+    // every key has the same digit, nothing would move
+    if (histogram[(src_keys[0] >> shift) & 0xFF] == count)
+      continue;
+
+    uint32_t offset = 0;
+    for (auto& bucket : histogram) {
+      const uint32_t bucket_count = bucket;
+      bucket = offset;
+      offset += bucket_count;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      const uint32_t destination = histogram[(src_keys[i] >> shift) & 0xFF]++;
+      dst_keys[destination] = src_keys[i];
+      dst_values[destination] = src_values[i];
+    }
+
+    std::swap(src_keys, dst_keys);
+    std::swap(src_values, dst_values);
+  }
+
+  // odd amount of passes left the result in the scratch buffers
+  if (src_keys != keys.data()) {
+    std::memcpy(keys.data(), src_keys, count * sizeof(uint64_t));
+    std::memcpy(values.data(), src_values, count * sizeof(uint32_t));
+  }
+}
+}
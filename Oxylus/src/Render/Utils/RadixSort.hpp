@@ -0,0 +1,18 @@
+﻿#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ox {
+class RadixSort {
+public:
+  // LSD radix sort of 64 bit keys with their 32 bit payloads, 8 bits per pass.
+  //	Sorts ascending and is stable. Passes where every key has the same digit are skipped,
+  //	so keys that only use a few of their bits sort in fewer passes.
+  //	The scratch vectors are grown as needed and can be reused between calls to avoid allocations.
+  static void sort(std::span<uint64_t> keys,
+                   std::span<uint32_t> values,
+                   std::vector<uint64_t>& keys_scratch,
+                   std::vector<uint32_t>& values_scratch);
+};
+}
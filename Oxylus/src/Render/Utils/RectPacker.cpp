@@ -33,4 +33,15 @@ bool RectPacker::State::pack(const int max_width) {
   height = 0;
   return false;
 }
+
+void RectPacker::State::init_fixed(const int fixed_width, const int fixed_height) {
+  width = fixed_width;
+  height = fixed_height;
+  nodes.resize(fixed_width);
+  stbrp_init_target(&context, width, height, nodes.data(), int(nodes.size()));
+}
+
+bool RectPacker::State::pack_more(Rect* new_rects, const int count) {
+  return stbrp_pack_rects(&context, new_rects, count) != 0;
+}
 }
@@ -30,6 +30,14 @@ public:
     //	max_width : if the packing is unsuccessful above this, it will result in a failure
     //	returns true for success, false for failure
     bool pack(int max_width);
+
+    // Initializes a fixed size target that can be packed into multiple times with `pack_more`
+    void init_fixed(int fixed_width, int fixed_height);
+
+    // Packs the given rects into the space left in a fixed target
+    //	Rects that didn't fit have was_packed set to 0 and can be tried on another target
+    //	returns true if every rect was packed
+    bool pack_more(Rect* new_rects, int count);
   };
 };
 }
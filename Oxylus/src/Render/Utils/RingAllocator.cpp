@@ -0,0 +1,153 @@
+﻿#include "RingAllocator.hpp"
+
+#include <algorithm>
+
+#include "Utils/Log.hpp"
+
+namespace ox {
+RingAllocator::RingAllocator(const uint64_t capacity) { init(capacity); }
+
+void RingAllocator::init(const uint64_t capacity) {
+  head = 0;
+  tail = 0;
+  frame_used = 0;
+  regions.clear();
+  stats = {};
+  stats.capacity = capacity;
+}
+
+void RingAllocator::begin_frame(const uint64_t frame_) {
+  frame = frame_;
+  frame_used = 0;
+  stats.frame_bytes = 0;
+  stats.frame_allocations = 0;
+  stats.frame_failed = 0;
+  stats.frame_failed_bytes = 0;
+}
+
+void RingAllocator::end_frame() {
+  if (frame_used == 0)
+    return;
+
+  regions.emplace_back(Region{frame, head, frame_used});
+  frame_used = 0;
+}
+
+RingAllocator::Allocation RingAllocator::allocate(const uint64_t size, const uint64_t alignment) {
+  const auto fail = [this, size] {
+    stats.frame_failed += 1;
+    stats.frame_failed_bytes += size;
+    return Allocation{};
+  };
+
+  // head == tail is ambiguous, used tells a full ring from an empty one
+  if (size == 0 || size > stats.capacity || stats.used >= stats.capacity)
+    return fail();
+
+  // nothing is live, start over from the beginning so the whole ring is available
+  if (stats.used == 0)
+    head = tail = 0;
+
+  const uint64_t mask = std::max<uint64_t>(alignment, 1) - 1;
+  uint64_t offset = (head + mask) & ~mask;
+  uint64_t consumed = 0;
+
+  if (head >= tail) {
+    if (offset + size <= stats.capacity) {
+      consumed = offset + size - head;
+    } else if (size <= tail || stats.used == 0) {
+      // skip the rest of the ring and continue at the start
+      offset = 0;
+      consumed = stats.capacity - head + size;
+      stats.wraps += 1;
+    } else {
+      return fail();
+    }
+  } else {
+    if (offset + size > tail)
+      return fail();
+    consumed = offset + size - head;
+  }
+
+  head = offset + size;
+  frame_used += consumed;
+  stats.used += consumed;
+  stats.peak_used = std::max(stats.peak_used, stats.used);
+  stats.frame_bytes += size;
+  stats.frame_allocations += 1;
+
+  return Allocation{offset, size};
+}
+
+void RingAllocator::retire(const uint64_t completed_frame) {
+  while (!regions.empty() && regions.front().frame <= completed_frame) {
+    const auto& region = regions.front();
+    tail = region.end;
+    stats.used -= region.size;
+    regions.pop_front();
+  }
+}
+
+bool RingAllocator::verify() {
+  const auto fail = [](const char* message) {
+    OX_LOG_ERROR("RingAllocator: {}", message);
+    return false;
+  };
+
+  RingAllocator ring(1024);
+
+  // alignment: padding up to the alignment is consumed as well
+  ring.begin_frame(0);
+  if (ring.allocate(10, 1).offset != 0 || ring.allocate(16, 64).offset != 64 || ring.get_stats().used != 80)
+    return fail("allocations weren't aligned");
+
+  // overflow: what doesn't fit is refused and counted, the upload ring falls back to the frame allocator then
+  if (ring.allocate(1000, 1).is_valid() || ring.get_stats().frame_failed != 1 || ring.get_stats().frame_failed_bytes != 1000)
+    return fail("an allocation larger than the free space wasn't refused");
+  ring.end_frame();
+
+  ring.begin_frame(1);
+  if (ring.allocate(512, 256).offset != 256 || ring.get_stats().used != 768)
+    return fail("an aligned allocation after a frame wasn't placed after it");
+  ring.end_frame();
+
+  // wrap: the tail of the ring is skipped once the live regions leave room at the start
+  ring.begin_frame(2);
+  if (ring.allocate(300, 1).is_valid())
+    return fail("wrapped over a region that is still in flight");
+  ring.retire(0);
+  if (ring.get_live_region_count() != 1 || ring.get_stats().used != 688 || ring.allocate(300, 1).is_valid())
+    return fail("retiring a frame didn't free exactly its region");
+  if (ring.allocate(200, 1).offset != 768 || ring.allocate(64, 1).offset != 0 || ring.get_stats().wraps != 1 || ring.get_stats().used != 1008)
+    return fail("didn't wrap to the start of the ring");
+  if (ring.allocate(16, 1).offset != 64 || ring.get_stats().used != 1024 || ring.allocate(1, 1).is_valid())
+    return fail("didn't fill the ring up to the oldest live region");
+  ring.end_frame();
+
+  // retirement: once every frame is done the whole ring is available again
+  ring.retire(1);
+  if (ring.get_stats().used != 336)
+    return fail("retiring a wrapped frame freed the wrong amount");
+  ring.retire(2);
+  ring.begin_frame(3);
+  if (ring.get_live_region_count() != 0 || ring.get_stats().used != 0 || ring.allocate(1024, 256).offset != 0)
+    return fail("an empty ring didn't start over from the beginning");
+  ring.end_frame();
+  ring.retire(3);
+
+  // steady state: three frames in flight, like UploadRing, never run out
+  for (uint64_t frame = 4; frame < 128; frame++) {
+    ring.retire(frame - 3);
+    ring.begin_frame(frame);
+    for (uint32_t i = 0; i < 3; i++) {
+      if (!ring.allocate(40 + (frame * 7 + i * 13) % 24, 16).is_valid())
+        return fail("ran out of space with only the frames in flight live");
+    }
+    ring.end_frame();
+    if (ring.get_live_region_count() > 3)
+      return fail("regions of retired frames were kept");
+  }
+
+  return true;
+}
+} // namespace ox
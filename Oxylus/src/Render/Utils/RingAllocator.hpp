@@ -0,0 +1,68 @@
+﻿#pragma once
+#include <cstdint>
+#include <deque>
+
+namespace ox {
+// Sub-allocates a fixed size ring (e.g. a persistently mapped upload buffer) frame by frame.
+//	Allocations made between `begin_frame()` and `end_frame()` form a region tagged with the frame,
+//	`retire()` gives back the regions of frames the GPU is done with.
+//	Doesn't touch any memory itself, it only hands out offsets.
+class RingAllocator {
+public:
+  static constexpr uint64_t INVALID_OFFSET = UINT64_MAX;
+
+  struct Allocation {
+    uint64_t offset = INVALID_OFFSET;
+    uint64_t size = 0;
+
+    bool is_valid() const { return offset != INVALID_OFFSET; }
+  };
+
+  struct Stats {
+    uint64_t capacity = 0;
+    uint64_t used = 0; // including alignment padding and the space skipped when wrapping
+    uint64_t peak_used = 0;
+    uint64_t frame_bytes = 0;
+    uint32_t frame_allocations = 0;
+    uint32_t frame_failed = 0;
+    uint64_t frame_failed_bytes = 0;
+    uint64_t wraps = 0;
+  };
+
+  RingAllocator() = default;
+  explicit RingAllocator(uint64_t capacity);
+
+  void init(uint64_t capacity);
+
+  void begin_frame(uint64_t frame);
+  void end_frame();
+
+  // `alignment` has to be a power of two. Returns an invalid allocation if the live regions leave no room.
+  Allocation allocate(uint64_t size, uint64_t alignment);
+
+  // Frees the regions of every frame up to and including `completed_frame`.
+  void retire(uint64_t completed_frame);
+
+  uint64_t get_capacity() const { return stats.capacity; }
+  uint32_t get_live_region_count() const { return (uint32_t)regions.size(); }
+  const Stats& get_stats() const { return stats; }
+
+  /// Runs alignment, wrapping, retirement and overflow against known offsets, no device involved.
+  /// @return false on the first mismatch, which is logged.
+  static bool verify();
+
+private:
+  struct Region {
+    uint64_t frame;
+    uint64_t end;
+    uint64_t size;
+  };
+
+  uint64_t head = 0;
+  uint64_t tail = 0;
+  uint64_t frame = 0;
+  uint64_t frame_used = 0;
+  Stats stats = {};
+  std::deque<Region> regions = {};
+};
+} // namespace ox
@@ -0,0 +1,60 @@
+﻿#include "SlotAllocator.hpp"
+
+namespace ox {
+SlotAllocator::SlotAllocator(const uint32_t capacity, const uint32_t retire_latency) {
+  init(capacity, retire_latency);
+}
+
+void SlotAllocator::init(const uint32_t capacity_, const uint32_t retire_latency_) {
+  capacity = capacity_;
+  retire_latency = retire_latency_;
+  allocated_count = 0;
+  generations.clear();
+  alive.clear();
+  free_list.clear();
+  pending.clear();
+}
+
+SlotAllocator::Handle SlotAllocator::allocate() {
+  uint32_t index = INVALID_INDEX;
+
+  if (!free_list.empty()) {
+    index = free_list.back();
+    free_list.pop_back();
+  } else if (generations.size() < capacity) {
+    index = (uint32_t)generations.size();
+    generations.emplace_back(0);
+    alive.emplace_back(false);
+  } else {
+    return {};
+  }
+
+  alive[index] = true;
+  allocated_count += 1;
+
+  return {index, generations[index]};
+}
+
+void SlotAllocator::release(const Handle& handle, const uint64_t frame) {
+  if (!is_alive(handle))
+    return;
+
+  alive[handle.index] = false;
+  generations[handle.index] += 1;
+  allocated_count -= 1;
+
+  pending.emplace_back(PendingSlot{handle.index, frame});
+}
+
+void SlotAllocator::retire(const uint64_t frame) {
+  // pending slots are pushed in frame order, so only the front needs checking
+  while (!pending.empty() && pending.front().frame + retire_latency <= frame) {
+    free_list.emplace_back(pending.front().index);
+    pending.pop_front();
+  }
+}
+
+bool SlotAllocator::is_alive(const Handle& handle) const {
+  return handle.index < generations.size() && alive[handle.index] && generations[handle.index] == handle.generation;
+}
+}
@@ -0,0 +1,60 @@
+﻿#pragma once
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace ox {
+// Hands out indices into a fixed size array (e.g. a bindless descriptor binding).
+//	Every slot carries a generation which is bumped when the slot is released,
+//	so handles that outlived their slot can be detected.
+//	Released slots are not reused until `retire_latency` frames have passed,
+//	since frames that are still in flight may reference the old descriptor.
+class SlotAllocator {
+public:
+  static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+  struct Handle {
+    uint32_t index = INVALID_INDEX;
+    uint32_t generation = 0;
+
+    bool is_valid() const { return index != INVALID_INDEX; }
+  };
+
+  SlotAllocator() = default;
+  SlotAllocator(uint32_t capacity, uint32_t retire_latency);
+
+  void init(uint32_t capacity, uint32_t retire_latency);
+
+  // Returns an invalid handle if every slot is either in use or waiting to be retired.
+  Handle allocate();
+
+  // Marks the slot as released at the given frame. Stale handles are ignored.
+  void release(const Handle& handle, uint64_t frame);
+
+  // Moves slots that were released at least `retire_latency` frames ago to the free list.
+  void retire(uint64_t frame);
+
+  // True if the handle refers to the current generation of an allocated slot.
+  bool is_alive(const Handle& handle) const;
+
+  uint32_t get_capacity() const { return capacity; }
+  uint32_t get_allocated_count() const { return allocated_count; }
+  uint32_t get_pending_count() const { return (uint32_t)pending.size(); }
+  uint32_t get_high_water_mark() const { return (uint32_t)generations.size(); }
+
+private:
+  struct PendingSlot {
+    uint32_t index;
+    uint64_t frame;
+  };
+
+  uint32_t capacity = 0;
+  uint32_t retire_latency = 0;
+  uint32_t allocated_count = 0;
+
+  std::vector<uint32_t> generations = {};
+  std::vector<bool> alive = {};
+  std::vector<uint32_t> free_list = {};
+  std::deque<PendingSlot> pending = {};
+};
+}
@@ -0,0 +1,53 @@
+﻿#include "UploadRing.hpp"
+
+#include <cstring>
+
+#include "VukCommon.hpp"
+#include "Utils/Profiler.hpp"
+
+namespace ox {
+void UploadRing::init(vuk::Allocator& allocator, const uint64 capacity, const uint32 frame_latency_) {
+  OX_SCOPED_ZONE;
+
+  // frames in flight may still read from the old ring
+  if (buffer)
+    retired.emplace_back(RetiredBuffer{std::move(buffer), current_frame});
+
+  frame_latency = frame_latency_;
+  buffer = vuk::allocate_cpu_buffer(allocator, capacity, DEFAULT_ALIGNMENT);
+  ring.init(capacity);
+}
+
+void UploadRing::begin_frame(const uint64 frame) {
+  current_frame = frame;
+
+  if (frame >= frame_latency)
+    ring.retire(frame - frame_latency);
+
+  while (!retired.empty() && frame >= retired.front().frame + frame_latency)
+    retired.pop_front();
+
+  ring.begin_frame(frame);
+}
+
+void UploadRing::end_frame() { ring.end_frame(); }
+
+vuk::Buffer UploadRing::upload(vuk::Allocator& fallback_allocator, const void* data, const uint64 size, const uint64 alignment) {
+  // buffers can't be empty, shaders indexing into them are guarded by their counts
+  const uint64 allocation_size = std::max<uint64>(size, 4);
+
+  const auto allocation = buffer ? ring.allocate(allocation_size, alignment) : RingAllocator::Allocation{};
+  vuk::Buffer result = {};
+  if (allocation.is_valid()) {
+    result = buffer->subrange(allocation.offset, allocation.size);
+  } else {
+    // frame allocations are recycled together with the frame, the handle doesn't have to be kept
+    result = *vuk::allocate_cpu_buffer(fallback_allocator, allocation_size, alignment);
+  }
+
+  if (size > 0)
+    std::memcpy(result.mapped_ptr, data, size);
+
+  return result;
+}
+} // namespace ox
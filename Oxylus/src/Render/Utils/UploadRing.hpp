@@ -0,0 +1,52 @@
+﻿#pragma once
+#include <deque>
+#include <span>
+#include <vuk/Value.hpp>
+#include <vuk/vsl/Core.hpp>
+
+#include "RingAllocator.hpp"
+#include "Core/Types.hpp"
+
+namespace ox {
+// Persistently mapped CPU->GPU buffer that per frame uploads are sub-allocated from.
+//	A frame's region is reused once `frame_latency` frames have passed, vuk waits on that frame's fence
+//	before it starts recording into its resources again.
+//	Uploads that don't fit fall back to a buffer from the given (frame) allocator.
+class UploadRing {
+public:
+  // covers minStorageBufferOffsetAlignment and minUniformBufferOffsetAlignment on every device
+  static constexpr uint64 DEFAULT_ALIGNMENT = 256;
+
+  using Stats = RingAllocator::Stats;
+
+  UploadRing() = default;
+
+  void init(vuk::Allocator& allocator, uint64 capacity, uint32 frame_latency);
+
+  void begin_frame(uint64 frame);
+  void end_frame();
+
+  /// Copies `size` bytes into the ring, the returned buffer is only valid for this frame.
+  vuk::Buffer upload(vuk::Allocator& fallback_allocator, const void* data, uint64 size, uint64 alignment = DEFAULT_ALIGNMENT);
+
+  template <typename T>
+  vuk::Buffer upload(vuk::Allocator& fallback_allocator, std::span<T> data, uint64 alignment = DEFAULT_ALIGNMENT) {
+    return upload(fallback_allocator, data.data(), data.size_bytes(), alignment);
+  }
+
+  uint64 get_capacity() const { return ring.get_capacity(); }
+  const Stats& get_stats() const { return ring.get_stats(); }
+
+private:
+  struct RetiredBuffer {
+    vuk::Unique<vuk::Buffer> buffer;
+    uint64 frame = 0;
+  };
+
+  RingAllocator ring = {};
+  vuk::Unique<vuk::Buffer> buffer = {};
+  std::deque<RetiredBuffer> retired = {};
+  uint32 frame_latency = 3;
+  uint64 current_frame = 0;
+};
+} // namespace ox
@@ -0,0 +1,168 @@
+#include "VertexQuantizer.hpp"
+
+#include <algorithm>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "Utils/Log.hpp"
+#include "Utils/OxMath.hpp"
+#include "Utils/Profiler.hpp"
+
+namespace ox {
+namespace {
+uint16 to_unorm16(const float value, const float min, const float scale) {
+  const float normalized = scale > 0.0f ? (value - min) / scale : 0.0f;
+  return (uint16)std::round(std::clamp(normalized, 0.0f, 1.0f) * 65535.0f);
+}
+
+float from_unorm16(const uint16 value, const float min, const float scale) { return min + (float)value / 65535.0f * scale; }
+
+float3 decode_normal(const uint32 normal) { return math::oct_to_float32x3(glm::unpackSnorm2x16(normal)); }
+} // namespace
+
+VertexQuantization VertexQuantizer::get_quantization(const std::span<const Vertex> vertices) {
+  float3 position_min = float3(std::numeric_limits<float>::max());
+  float3 position_max = float3(std::numeric_limits<float>::lowest());
+  float2 uv_min = float2(std::numeric_limits<float>::max());
+  float2 uv_max = float2(std::numeric_limits<float>::lowest());
+  for (const auto& vertex : vertices) {
+    position_min = glm::min(position_min, vertex.position);
+    position_max = glm::max(position_max, vertex.position);
+    uv_min = glm::min(uv_min, vertex.uv);
+    uv_max = glm::max(uv_max, vertex.uv);
+  }
+
+  if (vertices.empty())
+    return {};
+
+  return {
+    .position_min = position_min,
+    .position_scale = position_max - position_min,
+    .uv_min = uv_min,
+    .uv_scale = uv_max - uv_min,
+  };
+}
+
+QuantizedVertex VertexQuantizer::encode(const Vertex& vertex, const VertexQuantization& quantization) {
+  const auto& [position_min, position_scale, uv_min, uv_scale] = quantization;
+  return {
+    .position = {to_unorm16(vertex.position.x, position_min.x, position_scale.x),
+                 to_unorm16(vertex.position.y, position_min.y, position_scale.y),
+                 to_unorm16(vertex.position.z, position_min.z, position_scale.z)},
+    .normal = glm::packSnorm2x8(glm::unpackSnorm2x16(vertex.normal)),
+    .uv = {to_unorm16(vertex.uv.x, uv_min.x, uv_scale.x), to_unorm16(vertex.uv.y, uv_min.y, uv_scale.y)},
+  };
+}
+
+Vertex VertexQuantizer::decode(const QuantizedVertex& vertex, const VertexQuantization& quantization) {
+  const auto& [position_min, position_scale, uv_min, uv_scale] = quantization;
+  return {
+    .position = float3(from_unorm16(vertex.position[0], position_min.x, position_scale.x),
+                       from_unorm16(vertex.position[1], position_min.y, position_scale.y),
+                       from_unorm16(vertex.position[2], position_min.z, position_scale.z)),
+    .normal = glm::packSnorm2x16(glm::unpackSnorm2x8(vertex.normal)),
+    .uv = float2(from_unorm16(vertex.uv[0], uv_min.x, uv_scale.x), from_unorm16(vertex.uv[1], uv_min.y, uv_scale.y)),
+  };
+}
+
+bool VertexQuantizer::quantize(const std::span<const Vertex> vertices,
+                               const ErrorBounds& bounds,
+                               std::vector<QuantizedVertex>& quantized,
+                               VertexQuantization& quantization,
+                               ErrorBounds& error) {
+  OX_SCOPED_ZONE;
+
+  quantization = get_quantization(vertices);
+  const float extent = std::max(glm::compMax(quantization.position_scale), std::numeric_limits<float>::min());
+
+  // decoded exactly like the shaders do, so the measured error is the one that ends up on screen
+  error = {};
+  quantized.resize(vertices.size());
+  for (size_t i = 0; i < vertices.size(); i++) {
+    const auto& vertex = vertices[i];
+    quantized[i] = encode(vertex, quantization);
+    const auto decoded = decode(quantized[i], quantization);
+
+    const float cos_angle = std::clamp(glm::dot(decode_normal(vertex.normal), decode_normal(decoded.normal)), -1.0f, 1.0f);
+    error.position = std::max(error.position, glm::distance(vertex.position, decoded.position) / extent);
+    error.normal = std::max(error.normal, glm::degrees(std::acos(cos_angle)));
+    error.uv = std::max(error.uv, glm::compMax(glm::abs(vertex.uv - decoded.uv)));
+  }
+
+  if (error.position > bounds.position || error.normal > bounds.normal || error.uv > bounds.uv) {
+    quantized.clear();
+    return false;
+  }
+
+  return true;
+}
+
+bool VertexQuantizer::verify() {
+  OX_SCOPED_ZONE;
+
+  const auto fail = [](const char* message) {
+    OX_LOG_ERROR("VertexQuantizer: {}", message);
+    return false;
+  };
+
+  // normals over the whole sphere, a stretched position box with a flat z axis and uvs that tile
+  constexpr uint32 VERTEX_COUNT = 1024;
+  const float golden_angle = glm::pi<float>() * (3.0f - std::sqrt(5.0f));
+  std::vector<Vertex> vertices(VERTEX_COUNT);
+  for (uint32 i = 0; i < VERTEX_COUNT; i++) {
+    const float t = ((float)i + 0.5f) / (float)VERTEX_COUNT;
+    const float z = 1.0f - 2.0f * t;
+    const float r = std::sqrt(1.0f - z * z);
+    const float3 normal = float3(r * std::cos(golden_angle * (float)i), r * std::sin(golden_angle * (float)i), z);
+    vertices[i] = {
+      .position = float3(-3.0f + 8.0f * glm::fract(t * 7.31f), 10.0f + 0.5f * std::sin(t * 40.0f), 2.0f),
+      .normal = glm::packSnorm2x16(math::float32x3_to_oct(normal)),
+      .uv = float2(4.0f * glm::fract(t * 3.7f), t),
+    };
+  }
+
+  const ErrorBounds bounds = {.position = 0.0001f, .normal = 2.0f, .uv = 1.0f / 4096.0f};
+  std::vector<QuantizedVertex> quantized = {};
+  VertexQuantization quantization = {};
+  ErrorBounds error = {};
+  if (!quantize(vertices, bounds, quantized, quantization, error) || quantized.size() != vertices.size())
+    return fail("the fixture wasn't quantized within the default error bounds");
+
+  // rounding to the nearest step is off by at most half a step per axis, octahedral snorm8 by about a degree
+  const float half_step = 0.5f / 65535.0f;
+  const float extent = glm::compMax(quantization.position_scale);
+  ErrorBounds measured = {};
+  for (uint32 i = 0; i < VERTEX_COUNT; i++) {
+    const auto& vertex = vertices[i];
+    const auto decoded = decode(quantized[i], quantization);
+    const float3 position_error = glm::abs(vertex.position - decoded.position);
+    const float2 uv_error = glm::abs(vertex.uv - decoded.uv);
+    if (glm::any(glm::greaterThan(position_error, quantization.position_scale * half_step * 1.01f + 1e-6f)))
+      return fail("a decoded position is more than half a step off");
+    if (position_error.z != 0.0f)
+      return fail("a flat axis didn't decode exactly");
+    if (glm::any(glm::greaterThan(uv_error, quantization.uv_scale * half_step * 1.01f + 1e-6f)))
+      return fail("a decoded uv is more than half a step off");
+
+    const float cos_angle = std::clamp(glm::dot(decode_normal(vertex.normal), decode_normal(decoded.normal)), -1.0f, 1.0f);
+    const float normal_error = glm::degrees(std::acos(cos_angle));
+    if (normal_error > 1.0f)
+      return fail("a decoded normal is more than a degree off");
+
+    measured.position = std::max(measured.position, glm::length(position_error) / extent);
+    measured.normal = std::max(measured.normal, normal_error);
+    measured.uv = std::max(measured.uv, glm::compMax(uv_error));
+  }
+
+  if (std::abs(measured.position - error.position) > 1e-6f || std::abs(measured.normal - error.normal) > 1e-3f ||
+      std::abs(measured.uv - error.uv) > 1e-6f)
+    return fail("the reported error doesn't match the round trip");
+
+  // bounds tighter than a step reject the primitive and leave nothing behind
+  if (quantize(vertices, {.position = half_step * 0.1f, .normal = bounds.normal, .uv = bounds.uv}, quantized, quantization, error) ||
+      !quantized.empty())
+    return fail("a primitive outside of the error bounds was quantized");
+
+  return true;
+}
+} // namespace ox
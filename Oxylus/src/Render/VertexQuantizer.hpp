@@ -0,0 +1,39 @@
+#pragma once
+#include <span>
+#include <vector>
+
+#include "MeshVertex.hpp"
+
+namespace ox {
+// Encodes the vertices of a primitive into `QuantizedVertex`, halving their size.
+//	Positions are stored as 16 bit unorm relative to the bounds of the primitive, UVs as 16 bit unorm relative to its UV bounds
+//	and normals as 8 bit snorm octahedral. A primitive is only quantized when decoding every vertex again stays within
+//	the error bounds, otherwise it keeps the full precision `Vertex` layout.
+class VertexQuantizer {
+public:
+  // max error per vertex
+  struct ErrorBounds {
+    float position = 0.0f; // relative to the largest extent of the primitive
+    float normal = 0.0f;   // in degrees
+    float uv = 0.0f;       // in uv units
+  };
+
+  /// @return Ranges the vertices are quantized to.
+  static VertexQuantization get_quantization(std::span<const Vertex> vertices);
+
+  static QuantizedVertex encode(const Vertex& vertex, const VertexQuantization& quantization);
+  static Vertex decode(const QuantizedVertex& vertex, const VertexQuantization& quantization);
+
+  /// Encodes `vertices` and decodes them again to measure the error, `error` receives the largest one seen.
+  /// @return false if any vertex is outside of `bounds`, `quantized` is left empty then.
+  static bool quantize(std::span<const Vertex> vertices,
+                       const ErrorBounds& bounds,
+                       std::vector<QuantizedVertex>& quantized,
+                       VertexQuantization& quantization,
+                       ErrorBounds& error);
+
+  /// Round trips a synthetic primitive and checks every decoded vertex against the error the encoding can introduce.
+  /// @return false on the first mismatch, which is logged.
+  static bool verify();
+};
+} // namespace ox
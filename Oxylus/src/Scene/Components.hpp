@@ -92,6 +92,7 @@ struct MeshComponent {
   Shared<Mesh> mesh_base = nullptr;
   bool cast_shadows = true;
   bool stationary = false;
+  bool occluder = false; // always rasterized into the software occlusion buffer, if its materials are opaque
 
   // non-serialized data
   uint32_t mesh_id = Asset::INVALID_ID;
@@ -99,7 +100,8 @@ struct MeshComponent {
   Mat4 transform = Mat4{1};
   std::vector<entt::entity> child_entities = {}; // filled at load
   std::vector<Mat4> child_transforms = {};       // filled at submit
-  AABB aabb = {};
+  AABB aabb = {};                                // world bounds of every instance, updated at submit
+  uint32 lod_index = 0;                          // LOD of the mesh's LOD chain drawn this frame, selected at submit
   bool dirty = false;
 
   MeshComponent() = default;
@@ -224,7 +226,9 @@ struct LightComponent {
   Vec3 position = {};
   Vec3 rotation = {};
   Vec3 direction = {};
+  uint64 id = 0; // entity, used to keep the shadow atlas tile between frames
   RectPacker::Rect shadow_rect = {};
+  bool shadow_cached = false; // shadow_rect still holds last frame's shadow map
 };
 
 struct PostProcessProbe {
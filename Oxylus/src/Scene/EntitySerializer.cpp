@@ -80,7 +80,7 @@ void EntitySerializer::serialize_entity(toml::array* entities, Scene* scene, Ent
   if (scene->registry.all_of<MeshComponent>(entity)) {
     const auto& mrc = scene->registry.get<MeshComponent>(entity);
 
-    const auto table = toml::table{{"mesh_path", mrc.mesh_base->get_path()}, TBL_FIELD(mrc, stationary), TBL_FIELD(mrc, cast_shadows)};
+    const auto table = toml::table{{"mesh_path", mrc.mesh_base->get_path()}, TBL_FIELD(mrc, stationary), TBL_FIELD(mrc, cast_shadows), TBL_FIELD(mrc, occluder)};
 
     entities->push_back(toml::table{{"mesh_component", table}});
   }
@@ -363,6 +363,8 @@ UUID EntitySerializer::deserialize_entity(toml::array* entity_arr, Scene* scene,
       auto& mc = reg.emplace<MeshComponent>(deserialized_entity, mesh);
       GET_BOOL(mesh_node, mc, cast_shadows);
       GET_BOOL(mesh_node, mc, stationary);
+      if (mesh_node->as_table()->contains("occluder"))
+        GET_BOOL(mesh_node, mc, occluder);
     } else if (const auto light_node = ent.as_table()->get("light_component")) {
       auto& lc = reg.emplace<LightComponent>(deserialized_entity);
       lc.type = (LightComponent::LightType)GET_UINT322(light_node, "type");
@@ -618,36 +618,31 @@ void Scene::create_rigidbody(entt::entity entity, const TransformComponent& tran
     // TODO: We should only get the vertices and indices for this particular MeshComponent using MeshComponent::node_index
 
     const auto& mesh_component = registry.get<MeshComponent>(entity);
-    auto vertices = mesh_component.mesh_base->_vertices;
-    const auto& indices = mesh_component.mesh_base->_indices;
-
-    // scale vertices
+    const auto& mesh = *mesh_component.mesh_base;
     const auto world_transform = eutil::get_world_transform(this, entity);
-    for (auto& vert : vertices) {
-      Vec4 scaled_pos = world_transform * Vec4(vert.position, 1.0);
-      vert.position = Vec3(scaled_pos);
-    }
-
-    const uint32_t vertex_count = (uint32_t)vertices.size();
-    const uint32_t index_count = (uint32_t)indices.size();
-    const uint32_t triangle_count = vertex_count / 3;
 
+    // full detail meshlets of every node, positions are decoded for quantized meshes which don't keep `_vertices`
     JPH::VertexList vertex_list;
-    vertex_list.resize(vertex_count);
-    for (uint32_t i = 0; i < vertex_count; ++i)
-      vertex_list[i] = JPH::Float3(vertices[i].position.x, vertices[i].position.y, vertices[i].position.z);
-
     JPH::IndexedTriangleList indexedTriangleList;
-    indexedTriangleList.resize(index_count * 2);
-
-    for (uint32_t i = 0; i < triangle_count; ++i) {
-      indexedTriangleList[i * 2 + 0].mIdx[0] = indices[i * 3 + 0];
-      indexedTriangleList[i * 2 + 0].mIdx[1] = indices[i * 3 + 1];
-      indexedTriangleList[i * 2 + 0].mIdx[2] = indices[i * 3 + 2];
+    for (const auto& node : mesh.nodes) {
+      for (const auto& instance : node.meshlet_indices) {
+        const auto& meshlet = mesh._meshlets[instance.meshletId];
+        const auto first_vertex = (uint32_t)vertex_list.size();
+        for (uint32_t i = 0; i < meshlet.index_count; ++i) {
+          // scale vertices
+          const Vec4 scaled_pos = world_transform * Vec4(mesh.get_vertex_position(meshlet, mesh._indices[meshlet.index_offset + i]), 1.0);
+          vertex_list.emplace_back(scaled_pos.x, scaled_pos.y, scaled_pos.z);
+        }
 
-      indexedTriangleList[i * 2 + 1].mIdx[2] = indices[i * 3 + 0];
-      indexedTriangleList[i * 2 + 1].mIdx[1] = indices[i * 3 + 1];
-      indexedTriangleList[i * 2 + 1].mIdx[0] = indices[i * 3 + 2];
+        for (uint32_t i = 0; i < meshlet.primitive_count; ++i) {
+          const auto* primitive = &mesh._primitives[meshlet.primitive_offset + i * 3];
+          const uint32_t i0 = first_vertex + primitive[0];
+          const uint32_t i1 = first_vertex + primitive[1];
+          const uint32_t i2 = first_vertex + primitive[2];
+          indexedTriangleList.emplace_back(i0, i1, i2);
+          indexedTriangleList.emplace_back(i2, i1, i0);
+        }
+      }
     }
 
     JPH::PhysicsMaterialList material_list = {};
@@ -726,9 +721,8 @@ void Scene::create_character_controller(const TransformComponent& transform, Cha
 }
 
 void Scene::handle_future_mesh_load_event(const FutureMeshLoadEvent& event) {
-  const auto task_scheduler = App::get_system<TaskScheduler>();
+  // the task is already running, this is called on the main thread once it's done
   event.task->on_complete([this](const Shared<Mesh>& mesh) { this->load_mesh(mesh); });
-  task_scheduler->schedule_task(event.task);
 }
 
 void Scene::on_runtime_update(const Timestep& delta_time) {
@@ -4,6 +4,6 @@
 namespace ox {
 struct FutureMeshLoadEvent {
   std::string name = {};
-  AssetTask<Mesh>* task = nullptr;
+  Shared<AssetTask<Mesh>> task = nullptr;
 };
 }
@@ -12,21 +12,56 @@
 
 #include "Render/DebugRenderer.hpp"
 #include "Render/DefaultRenderPipeline.hpp"
+#include "Render/NullRenderPipeline.hpp"
 #include "Render/Renderer.hpp"
 #include "Render/Vulkan/VkContext.hpp"
 #include "Scene/Components.hpp"
+#include "Thread/TaskScheduler.hpp"
 #include "Utils/Profiler.hpp"
 
 namespace ox {
 void SceneRenderer::init(EventDispatcher& dispatcher) {
   OX_SCOPED_ZONE;
-  if (!_render_pipeline)
-    _render_pipeline = create_shared<DefaultRenderPipeline>("DefaultRenderPipeline");
+  if (!_render_pipeline) {
+    if (RendererCVar::cvar_null_render_pipeline.get() || App::get()->get_command_line_args().contains("null-render-pipeline"))
+      _render_pipeline = create_shared<NullRenderPipeline>("NullRenderPipeline");
+    else
+      _render_pipeline = create_shared<DefaultRenderPipeline>("DefaultRenderPipeline");
+  }
   Renderer::renderer_context.render_pipeline = _render_pipeline;
   _render_pipeline->init(*App::get_vkcontext().superframe_allocator);
   _render_pipeline->on_dispatcher_events(dispatcher);
 }
 
+// same order the render pipeline instances the nodes in, only nodes with meshlets are instanced
+static AABB get_mesh_bounds(const MeshComponent& mc) {
+  AABB bounds(float3(std::numeric_limits<float>::max()), float3(std::numeric_limits<float>::lowest()));
+  for (int node_index = 0; const auto& node : mc.mesh_base->nodes) {
+    if (node.meshlet_indices.empty())
+      continue;
+    if (node_index > (int)mc.child_transforms.size())
+      break;
+    bounds.merge(node.aabb.get_transformed(node_index == 0 ? mc.transform : mc.child_transforms[node_index - 1]));
+    node_index++;
+  }
+  return bounds;
+}
+
+static uint32 select_mesh_lod(const MeshComponent& mc, const MeshletHierarchy::LodView* lod_view) {
+  const uint32 lod_count = mc.mesh_base->get_lod_count();
+  if (const int forced_lod = RendererCVar::cvar_mesh_lod_force.get(); forced_lod >= 0)
+    return std::min((uint32)forced_lod, lod_count - 1);
+  if (!lod_view || lod_count == 1 || mc.aabb.min.x > mc.aabb.max.x)
+    return 0;
+
+  return mc.mesh_base->select_lod(mc.lod_index,
+                                  mc.aabb.get_center(),
+                                  glm::length(mc.aabb.get_extents()) * 0.5f,
+                                  MeshletHierarchy::get_max_scale(mc.transform),
+                                  *lod_view,
+                                  std::clamp(RendererCVar::cvar_mesh_lod_hysteresis.get(), 0.0f, 1.0f));
+}
+
 void SceneRenderer::update(const Timestep& delta_time) const {
   OX_SCOPED_ZONE;
 
@@ -41,13 +76,25 @@ void SceneRenderer::update(const Timestep& delta_time) const {
       if (!mesh_component.stationary || mesh_component.dirty) {
         const auto world_transform = eutil::get_world_transform(_scene, entity);
         mesh_component.transform = world_transform;
+        mesh_component.child_transforms.clear();
         for (auto& e : mesh_component.child_entities) {
           mesh_component.child_transforms.emplace_back(eutil::get_world_transform(_scene, e));
         }
 
+        mesh_component.aabb = get_mesh_bounds(mesh_component);
         mesh_component.dirty = false;
       }
 
+      mesh_component.lod_index = select_mesh_lod(mesh_component, _render_pipeline->get_lod_view());
+      if (RendererCVar::cvar_draw_mesh_lods.get() && mesh_component.aabb.min.x <= mesh_component.aabb.max.x) {
+        constexpr float4 LOD_COLORS[] = {
+          {1, 1, 1, 1}, {0, 1, 0, 1}, {0, 1, 1, 1}, {0, 0, 1, 1}, {1, 0, 1, 1}, {1, 0, 0, 1}, {1, 0.5f, 0, 1}, {1, 1, 0, 1}};
+        static_assert(std::size(LOD_COLORS) == Mesh::MAX_LODS);
+        DebugRenderer::draw_sphere(glm::length(mesh_component.aabb.get_extents()) * 0.5f,
+                                   mesh_component.aabb.get_center(),
+                                   LOD_COLORS[mesh_component.lod_index]);
+      }
+
       _render_pipeline->submit_mesh_component(mesh_component);
     }
   }
@@ -164,17 +211,24 @@ void SceneRenderer::update(const Timestep& delta_time) const {
       lc.position = tc.position;
       lc.rotation = tc.rotation;
       lc.direction = normalize(math::transform_normal(Vec4(0, 1, 0, 0), toMat4(glm::quat(tc.rotation))));
+      lc.id = (uint64)entt::to_integral(e);
 
       _render_pipeline->submit_light(lc);
     }
   }
 
-  // TODO: (very outdated, currently not working)
   // Particle system
-  const auto particle_system_view = _scene->registry.view<TransformComponent, ParticleSystemComponent>();
-  for (auto&& [e, tc, psc] : particle_system_view.each()) {
-    psc.system->on_update((float)App::get_timestep(), tc.position);
-    psc.system->on_render();
+  {
+    OX_SCOPED_ZONE_N("Particle systems");
+    std::vector<ParticleSystem*> particle_systems = {};
+    std::vector<Vec3> particle_positions = {};
+    const auto particle_system_view = _scene->registry.view<TransformComponent, ParticleSystemComponent>();
+    for (auto&& [e, tc, psc] : particle_system_view.each()) {
+      particle_systems.emplace_back(psc.system.get());
+      particle_positions.emplace_back(tc.position);
+    }
+
+    ParticleSystem::update_systems(particle_systems, particle_positions, (float)App::get_timestep(), App::get_system<TaskScheduler>());
   }
 }
 } // namespace ox
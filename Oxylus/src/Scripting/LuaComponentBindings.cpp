@@ -41,7 +41,7 @@ void LuaBindings::bind_mesh_component(const Shared<sol::state>& state) {
   material.set_function("new", [](const std::string& name) -> Shared<PBRMaterial> { return create_shared<PBRMaterial>(name); });
 
 #define MC MeshComponent
-  REGISTER_COMPONENT(state, MC, FIELD(MC, mesh_base), FIELD(MC, stationary), FIELD(MC, cast_shadows), FIELD(MC, materials), FIELD(MC, aabb));
+  REGISTER_COMPONENT(state, MC, FIELD(MC, mesh_base), FIELD(MC, stationary), FIELD(MC, cast_shadows), FIELD(MC, occluder), FIELD(MC, materials), FIELD(MC, aabb));
 }
 
 void LuaBindings::bind_camera_component(const Shared<sol::state>& state) {
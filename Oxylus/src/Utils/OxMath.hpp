@@ -39,6 +39,16 @@ inline float2 float32x3_to_oct(float3 v) {
   return (v.z <= 0.0f) ? ((1.0f - glm::abs(float2{p.y, p.x})) * sign_not_zero(p)) : p;
 }
 
+inline float3 oct_to_float32x3(float2 e) {
+  float3 v = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+  if (v.z < 0.0f) {
+    const float2 xy = (1.0f - glm::abs(float2{v.y, v.x})) * sign_not_zero(float2{v.x, v.y});
+    v.x = xy.x;
+    v.y = xy.y;
+  }
+  return glm::normalize(v);
+}
+
 constexpr uint32_t previous_power2(uint32_t x) {
   uint32_t v = 1;
   while ((v << 1) < x) {
@@ -0,0 +1,9 @@
+﻿#pragma once
+
+// SSE2 is baseline on every x64 target we ship, other platforms fall back to scalar paths.
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OX_SIMD_SSE 1
+#include <emmintrin.h>
+#else
+#define OX_SIMD_SSE 0
+#endif
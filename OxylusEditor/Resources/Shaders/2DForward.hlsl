@@ -13,8 +13,8 @@ struct VOutput {
 
 struct VertexInput {
   PackedFloat4x4 transform : TRANSFORM;
-  uint32 material_id16_ypos16 : MAT_INDEX;
-  uint32 flags16_distance16 : FLAGS;
+  uint32 material_id : MAT_INDEX;
+  uint32 flags : FLAGS;
 };
 
 static float3 positions[6] =
@@ -24,10 +24,10 @@ static float2 uvs[6] = {float2(0.0, 1.0), float2(1.0, 1.0), float2(1.0, 0.0), fl
 VOutput VSmain(VertexInput input, uint vertex_id : SV_VertexID) {
   VOutput output = (VOutput)0;
 
-  const uint32 flags = unpack_u32_low(input.flags16_distance16);
+  const uint32 flags = input.flags;
   output.flags = flags;
 
-  const uint32 material_index = unpack_u32_low(input.material_id16_ypos16);
+  const uint32 material_index = input.material_id;
   SpriteMaterial material = get_sprite_material(material_index);
 
   float4x4 unpacked_transform = transpose(input.transform.unpack());
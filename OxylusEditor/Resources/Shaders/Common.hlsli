@@ -78,6 +78,21 @@ struct Vertex {
   PackedFloat2 uv : UV;
 };
 
+// Quantized layout of Vertex, decode with get_vertex(meshlet, index)
+struct QuantizedVertex {
+  uint32 position_xy;       // unorm2_x16, relative to the VertexQuantization of the meshlet
+  uint32 position_z_normal; // low: unorm16 position z, high: octahedral normal as snorm2_x8
+  uint32 uv;                // unorm2_x16, relative to the VertexQuantization of the meshlet
+};
+
+// value = min + unorm * scale
+struct VertexQuantization {
+  PackedFloat3 position_min;
+  PackedFloat3 position_scale;
+  PackedFloat2 uv_min;
+  PackedFloat2 uv_scale;
+};
+
 struct VertexOutput {
 #ifdef USE_POSITION
   float4 position : SV_POSITION;
@@ -252,6 +267,8 @@ struct SceneData {
     int metallic_roughness_ao_image_index;
     int transforms_buffer_index;
     int sprite_materials_buffer_index;
+    int light_clusters_buffer_index;
+    int cluster_lights_buffer_index;
   } indices_;
 
   // TODO: use flags
@@ -270,6 +287,17 @@ struct SceneData {
     PackedFloat2 chromatic_aberration; // x: enable, y: amount
     PackedFloat2 sharpen;              // x: enable, y: amount
   } post_processing_data;
+
+  struct LightClusters {
+    uint32 grid_size_x;
+    uint32 grid_size_y;
+    uint32 grid_size_z;
+    float depth_scale; // slice = log(view depth) * depth_scale - depth_bias
+    float depth_bias;
+    int enabled;
+  } light_clusters;
+
+  int cull_meshlet_cones;
 };
 
 struct Meshlet {
@@ -280,6 +308,12 @@ struct Meshlet {
   uint32 primitive_count;
   PackedFloat3 aabb_min;
   PackedFloat3 aabb_max;
+  PackedFloat3 center; // bounding sphere
+  float radius;
+  PackedFloat3 cone_apex;
+  PackedFloat3 cone_axis;
+  float cone_cutoff; // every triangle faces away when dot(normalize(cone_apex - camera), cone_axis) >= cone_cutoff
+  uint32 vertex_quantization; // ~0u for full precision vertices, vertex_offset points to QuantizedVertex data otherwise
 };
 
 struct MeshletInstance {
@@ -397,6 +431,19 @@ float2 unpack_snorm2_x16(const uint packed) {
   signextended.y = (int)(packed & 0xFFFF0000) >> 16;
   return max(float2(signextended) / 32767.0f, -1.0f);
 }
+float2 unpack_snorm2_x8(const uint packed) {
+  int2 signextended;
+  signextended.x = (int)(packed << 24) >> 24;
+  signextended.y = (int)(packed << 16) >> 24;
+  return max(float2(signextended) / 127.0f, -1.0f);
+}
+uint pack_snorm2_x16(const float2 v) {
+  const int2 rounded = int2(round(clamp(v, -1.0f, 1.0f) * 32767.0f));
+  return (uint(rounded.x) & 0xFFFF) | (uint(rounded.y) << 16);
+}
+float4 unpack_unorm4_x8(const uint packed) {
+  return float4(packed & 0xFF, (packed >> 8) & 0xFF, (packed >> 16) & 0xFF, packed >> 24) / 255.0f;
+}
 
 uint unpack_u32_low(uint packed) { return packed & 0xFFFF; }
 uint unpack_u32_high(uint packed) { return (packed >> 16) & 0xFFFF; }
@@ -169,6 +169,34 @@ bool cull_meshlet_frustum(const uint meshlet_instance_id) {
   return true;
 }
 
+// every triangle of the meshlet faces away from the camera, cones are computed at import
+bool cull_meshlet_cone(const uint meshlet_instance_id) {
+  const MeshletInstance meshlet_instance = get_meshlet_instance(meshlet_instance_id);
+  const Meshlet meshlet = get_meshlet(meshlet_instance.meshlet_id);
+  if (meshlet.cone_cutoff >= 1.0) {
+    return false;
+  }
+
+  const float4x4 transform = get_transform(meshlet_instance.instance_id);
+
+  // the cone only keeps its shape under uniform scale, mirrored or stretched instances are never cone culled
+  const float3x3 basis = (float3x3)transform;
+  const float3 scale_sq = float3(dot(basis._m00_m10_m20, basis._m00_m10_m20),
+                                 dot(basis._m01_m11_m21, basis._m01_m11_m21),
+                                 dot(basis._m02_m12_m22, basis._m02_m12_m22));
+  const float max_scale_sq = max(scale_sq.x, max(scale_sq.y, scale_sq.z));
+  const float min_scale_sq = min(scale_sq.x, min(scale_sq.y, scale_sq.z));
+  if (min_scale_sq < max_scale_sq * 0.99 || determinant(basis) <= 0.0) {
+    return false;
+  }
+
+  const float3 apex = mul(transform, float4(meshlet.cone_apex.unpack(), 1.0)).xyz;
+  const float3 axis = normalize(mul(basis, meshlet.cone_axis.unpack()));
+  const float3 camera_position = get_camera(0).position.xyz;
+
+  return dot(normalize(apex - camera_position), axis) >= meshlet.cone_cutoff;
+}
+
 [numthreads(128, 1, 1)] void main(uint3 threadID
                                   : SV_DispatchThreadID) {
   const uint meshlet_instance_id = threadID.x;
@@ -179,6 +207,10 @@ bool cull_meshlet_frustum(const uint meshlet_instance_id) {
     return;
   }
 
+  if (get_scene().cull_meshlet_cones && cull_meshlet_cone(meshlet_instance_id)) {
+    return;
+  }
+
   if (cull_meshlet_frustum(meshlet_instance_id)) {
     GetMeshletUvBoundsParams params;
     params.meshlet_instance_id = meshlet_instance_id;
@@ -67,7 +67,6 @@ bool cull_triangle(Meshlet meshlet, uint localId) {
   const uint primitiveId = localId * 3;
 
   // TODO: SoA vertices
-  const uint vertexOffset = meshlet.vertex_offset;
   const uint indexOffset = meshlet.index_offset;
   const uint primitiveOffset = meshlet.primitive_offset;
   const uint primitive0 = uint(get_primitive(primitiveOffset + primitiveId + 0));
@@ -76,9 +75,9 @@ bool cull_triangle(Meshlet meshlet, uint localId) {
   const uint index0 = get_index(indexOffset + primitive0);
   const uint index1 = get_index(indexOffset + primitive1);
   const uint index2 = get_index(indexOffset + primitive2);
-  Vertex vertex0 = get_vertex(vertexOffset + index0);
-  Vertex vertex1 = get_vertex(vertexOffset + index1);
-  Vertex vertex2 = get_vertex(vertexOffset + index2);
+  Vertex vertex0 = get_vertex(meshlet, index0);
+  Vertex vertex1 = get_vertex(meshlet, index1);
+  Vertex vertex2 = get_vertex(meshlet, index2);
   const float3 position0 = vertex0.position.unpack();
   const float3 position1 = vertex1.position.unpack();
   const float3 position2 = vertex2.position.unpack();
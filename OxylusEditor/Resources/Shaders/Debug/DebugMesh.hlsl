@@ -0,0 +1,27 @@
+#include "../Globals.hlsli"
+
+struct VertexInput {
+  float3 position : POSITION;
+  uint32 vertex_color : NORMAL; // unorm4x8
+  float2 uv : TEXCOORD;
+  PackedFloat4x4 transform : TRANSFORM;
+  uint32 instance_color : COLOR; // unorm4x8
+};
+
+struct VOut {
+  float4 position : SV_POSITION;
+  float4 color : COLOR;
+};
+
+VOut VSmain(VertexInput input) {
+  VOut vout;
+
+  const float4x4 transform = transpose(input.transform.unpack());
+  const float4 world_pos = mul(transform, float4(input.position, 1.0));
+  vout.position = mul(get_camera(0).projection_view, float4(world_pos.xyz, 1.0));
+  vout.color = unpack_unorm4_x8(input.vertex_color) * unpack_unorm4_x8(input.instance_color);
+
+  return vout;
+}
+
+float4 PSmain(VOut vin) : SV_TARGET0 { return vin.color; }
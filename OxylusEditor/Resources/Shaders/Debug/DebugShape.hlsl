@@ -0,0 +1,30 @@
+#include "../Globals.hlsli"
+
+struct VertexInput {
+  float4 unit_position : POSITION; // xyz scaled by size, w by length along local Y
+  float4 rotation : ROTATION;
+  float3 position : TRANSLATION;
+  float3 size : SIZE;
+  float length : LENGTH;
+  uint32 color : COLOR;
+};
+
+struct VOut {
+  float4 position : SV_POSITION;
+  float4 color : COLOR;
+};
+
+float3 rotate_by_quat(float4 q, float3 v) { return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v); }
+
+VOut VSmain(VertexInput input) {
+  VOut vout;
+
+  const float3 local_pos = input.unit_position.xyz * input.size + float3(0.0, input.unit_position.w * input.length, 0.0);
+  const float3 world_pos = rotate_by_quat(input.rotation, local_pos) + input.position;
+  vout.position = mul(get_camera(0).projection_view, float4(world_pos, 1.0));
+  vout.color = unpack_unorm4_x8(input.color);
+
+  return vout;
+}
+
+float4 PSmain(VOut vin) : SV_TARGET0 { return vin.color; }
@@ -93,19 +93,36 @@ SpriteMaterial get_sprite_material(uint32 material_index) {
 
 Light get_light(uint32 lightIndex) { return Buffers[get_scene().indices_.lights_buffer_index].Load<Light>(lightIndex * sizeof(Light)); }
 
+// x: offset into the cluster light list, y: light count
+uint2 get_light_cluster(uint32 cluster_index) { return Buffers[get_scene().indices_.light_clusters_buffer_index].Load2(cluster_index * 8); }
+uint32 get_cluster_light_index(uint32 index) { return Buffers[get_scene().indices_.cluster_lights_buffer_index].Load(index * 4); }
+
+uint32 get_light_cluster_index(float2 pixel_position, float view_depth) {
+  const SceneData scene = get_scene();
+  const uint3 grid = uint3(scene.light_clusters.grid_size_x, scene.light_clusters.grid_size_y, scene.light_clusters.grid_size_z);
+  const uint2 tile = min(uint2(pixel_position * scene.screen_size_rcp.unpack() * float2(grid.xy)), grid.xy - 1);
+  const float slice = log(max(view_depth, 1e-4f)) * scene.light_clusters.depth_scale - scene.light_clusters.depth_bias;
+  const uint z = (uint)clamp(slice, 0.0f, float(grid.z - 1));
+  return (z * grid.y + tile.y) * grid.x + tile.x;
+}
+
+// lights without a range come after the grid
+uint32 get_global_light_cluster_index() {
+  const SceneData scene = get_scene();
+  return scene.light_clusters.grid_size_x * scene.light_clusters.grid_size_y * scene.light_clusters.grid_size_z;
+}
+
 DebugAabb get_debug_aabb(uint32 index) { return BuffersRW[0].Load<DebugAabb>(sizeof(DrawIndirectCommand) + sizeof(DebugAabb) * index); }
 
 bool try_push_debug_aabb(DebugAabb aabb) {
   uint index = 0;
   BuffersRW[0].InterlockedAdd(sizeof(uint32), 1, index);
 
-#if TODO
-  // Check if buffer is full
-  if (index >= debugAabbBuffer.aabbs.length()) {
-    atomicAdd(debugAabbBuffer.drawCommand.instanceCount, -1);
+  // the buffer holds one aabb per meshlet instance, up to MAX_AABB_COUNT
+  if (index >= MAX_AABB_COUNT) {
+    BuffersRW[0].InterlockedAdd(sizeof(uint32), 0xFFFFFFFF);
     return false;
   }
-#endif
 
   BuffersRW[0].Store(sizeof(DrawIndirectCommand) + sizeof(DebugAabb) * index, aabb);
   return true;
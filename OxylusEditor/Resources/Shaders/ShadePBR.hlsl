@@ -457,20 +457,34 @@ inline void light_spot(Light light, Surface surface, inout Lighting lighting) {
   }
 }
 
+inline void shade_light(in Light light, inout Surface surface, inout Lighting lighting) {
+  switch (light.get_type()) {
+    case DIRECTIONAL_LIGHT: {
+      light_directional(light, surface, lighting);
+    } break;
+    case POINT_LIGHT: {
+      light_point(light, surface, lighting);
+    } break;
+    case SPOT_LIGHT: {
+      light_spot(light, surface, lighting);
+    } break;
+  }
+}
+
 inline void forward_lighting(inout Surface surface, inout Lighting lighting) {
-  for (int i = 0; i < get_scene().num_lights; i++) {
-    Light light = get_light(i);
-
-    switch (light.get_type()) {
-      case DIRECTIONAL_LIGHT: {
-        light_directional(light, surface, lighting);
-      } break;
-      case POINT_LIGHT: {
-        light_point(light, surface, lighting);
-      } break;
-      case SPOT_LIGHT: {
-        light_spot(light, surface, lighting);
-      } break;
+  if (get_scene().light_clusters.enabled == 0) {
+    for (int i = 0; i < get_scene().num_lights; i++) {
+      shade_light(get_light(i), surface, lighting);
+    }
+    return;
+  }
+
+  const float view_depth = -mul(get_camera().view, float4(surface.P, 1.0f)).z;
+  const uint2 clusters[2] = {get_light_cluster(get_light_cluster_index(surface.PixelPosition, view_depth)),
+                             get_light_cluster(get_global_light_cluster_index())};
+  for (uint c = 0; c < 2; c++) {
+    for (uint i = 0; i < clusters[c].y; i++) {
+      shade_light(get_light(get_cluster_light_index(clusters[c].x + i)), surface, lighting);
     }
   }
 }
@@ -21,13 +21,12 @@ VOut VSmain(uint vertex_index : SV_VertexID) {
   const uint meshlet_id = meshlet_instance.meshlet_id;
 
   const Meshlet meshlet = get_meshlet(meshlet_id);
-  const uint vertexOffset = meshlet.vertex_offset;
   const uint indexOffset = meshlet.index_offset;
   const uint primitiveOffset = meshlet.primitive_offset;
 
   const uint primitive = uint(get_primitive(primitiveOffset + primitiveId));
   const uint index = get_index(indexOffset + primitive);
-  Vertex vertex = get_vertex(vertexOffset + index);
+  Vertex vertex = get_vertex(meshlet, index);
   const float3 position = vertex.position.unpack();
   const float2 uv = vertex.uv.unpack();
   const float4x4 transform = get_transform(instance_id);
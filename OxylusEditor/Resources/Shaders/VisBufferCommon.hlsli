@@ -24,6 +24,8 @@ struct DispatchParams {
 #define PRIMITIVES_BUFFER_INDEX 3
 #define TRANSFORMS_BUFFER_INDEX 4
 #define MESHLET_INSTANCE_BUFFERS_INDEX 5
+#define QUANTIZED_VERTEX_BUFFER_INDEX 6
+#define VERTEX_QUANTIZATION_BUFFER_INDEX 7
 
 #define VISIBLE_MESHLETS_BUFFER_INDEX 0
 #define CULL_TRIANGLES_DISPATCH_PARAMS_BUFFERS_INDEX 1
@@ -35,6 +37,22 @@ MeshletInstance get_meshlet_instance(uint32 index) {
   return buffers[MESHLET_INSTANCE_BUFFERS_INDEX].Load<MeshletInstance>(index * sizeof(MeshletInstance));
 }
 Vertex get_vertex(uint32 index) { return buffers[VERTEX_BUFFER_INDEX].Load<Vertex>(index * sizeof(Vertex)); }
+// `index` is relative to the meshlet's vertex_offset, quantized vertices are decoded to the full precision layout
+Vertex get_vertex(const Meshlet meshlet, uint32 index) {
+  if (meshlet.vertex_quantization == ~0u)
+    return get_vertex(meshlet.vertex_offset + index);
+
+  const QuantizedVertex quantized = buffers[QUANTIZED_VERTEX_BUFFER_INDEX].Load<QuantizedVertex>((meshlet.vertex_offset + index) * sizeof(QuantizedVertex));
+  const VertexQuantization quantization =
+    buffers[VERTEX_QUANTIZATION_BUFFER_INDEX].Load<VertexQuantization>(meshlet.vertex_quantization * sizeof(VertexQuantization));
+
+  const float3 position_unorm = float3(unpack_unorm2_x16(quantized.position_xy), u16n_to_f32(quantized.position_z_normal & 0xFFFF));
+  Vertex vertex;
+  vertex.position.pack(quantization.position_min.unpack() + position_unorm * quantization.position_scale.unpack());
+  vertex.normal = pack_snorm2_x16(unpack_snorm2_x8(quantized.position_z_normal >> 16));
+  vertex.uv.pack(quantization.uv_min.unpack() + unpack_unorm2_x16(quantized.uv) * quantization.uv_scale.unpack());
+  return vertex;
+}
 uint32 get_primitive(uint32 index) { return buffers[PRIMITIVES_BUFFER_INDEX].Load<uint32>(index * sizeof(uint32)); }
 uint32 get_index(uint32 index) { return buffers[INDEX_BUFFER_INDEX].Load<uint32>(index * sizeof(uint32)); }
 
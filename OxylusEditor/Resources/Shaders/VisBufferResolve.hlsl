@@ -87,22 +87,22 @@ uint3 visbuffer_load_index_ids(const Meshlet meshlet, in uint primitiveId) {
   return uint3(get_index(indexOffset + primitiveIds[0]), get_index(indexOffset + primitiveIds[1]), get_index(indexOffset + primitiveIds[2]));
 }
 
-void visbuffer_load_position(uint3 indexIds, uint vertexOffset, out float3 positions[3]) {
-  positions[0] = get_vertex(vertexOffset + indexIds.x).position.unpack();
-  positions[1] = get_vertex(vertexOffset + indexIds.y).position.unpack();
-  positions[2] = get_vertex(vertexOffset + indexIds.z).position.unpack();
+void visbuffer_load_position(uint3 indexIds, const Meshlet meshlet, out float3 positions[3]) {
+  positions[0] = get_vertex(meshlet, indexIds.x).position.unpack();
+  positions[1] = get_vertex(meshlet, indexIds.y).position.unpack();
+  positions[2] = get_vertex(meshlet, indexIds.z).position.unpack();
 }
 
-void visbuffer_load_uv(uint3 indexIds, uint vertexOffset, out float2 uvs[3]) {
-  uvs[0] = get_vertex(vertexOffset + indexIds.x).uv.unpack();
-  uvs[1] = get_vertex(vertexOffset + indexIds.y).uv.unpack();
-  uvs[2] = get_vertex(vertexOffset + indexIds.z).uv.unpack();
+void visbuffer_load_uv(uint3 indexIds, const Meshlet meshlet, out float2 uvs[3]) {
+  uvs[0] = get_vertex(meshlet, indexIds.x).uv.unpack();
+  uvs[1] = get_vertex(meshlet, indexIds.y).uv.unpack();
+  uvs[2] = get_vertex(meshlet, indexIds.z).uv.unpack();
 }
 
-void visbuffer_load_normal(uint3 indexIds, uint vertexOffset, out float3 normals[3]) {
-  normals[0] = oct_to_vec3(unpack_snorm2_x16(get_vertex(vertexOffset + indexIds.x).normal));
-  normals[1] = oct_to_vec3(unpack_snorm2_x16(get_vertex(vertexOffset + indexIds.y).normal));
-  normals[2] = oct_to_vec3(unpack_snorm2_x16(get_vertex(vertexOffset + indexIds.z).normal));
+void visbuffer_load_normal(uint3 indexIds, const Meshlet meshlet, out float3 normals[3]) {
+  normals[0] = oct_to_vec3(unpack_snorm2_x16(get_vertex(meshlet, indexIds.x).normal));
+  normals[1] = oct_to_vec3(unpack_snorm2_x16(get_vertex(meshlet, indexIds.y).normal));
+  normals[2] = oct_to_vec3(unpack_snorm2_x16(get_vertex(meshlet, indexIds.z).normal));
 }
 
 UvGradient make_uv_gradient(const PartialDerivatives derivatives, const float2 uvs[3]) {
@@ -191,11 +191,11 @@ POut PSmain(VOut input, float4 pixelPosition : SV_Position) {
 
   uint3 index_ids = visbuffer_load_index_ids(meshlet, primitiveId);
   float3 raw_position[3];
-  visbuffer_load_position(index_ids, meshlet.vertex_offset, raw_position);
+  visbuffer_load_position(index_ids, meshlet, raw_position);
   float2 raw_uv[3];
-  visbuffer_load_uv(index_ids, meshlet.vertex_offset, raw_uv);
+  visbuffer_load_uv(index_ids, meshlet, raw_uv);
   float3 raw_normal[3];
-  visbuffer_load_normal(index_ids, meshlet.vertex_offset, raw_normal);
+  visbuffer_load_normal(index_ids, meshlet, raw_normal);
   const float4 world_position[3] = {mul(transform, float4(raw_position[0], 1.0)),
                                     mul(transform, float4(raw_position[1], 1.0)),
                                     mul(transform, float4(raw_position[2], 1.0))};
@@ -20,6 +20,8 @@
 #include "Panels/RendererSettingsPanel.hpp"
 #include "Panels/SceneHierarchyPanel.hpp"
 #include "Panels/StatisticsPanel.hpp"
+#include "Render/Mesh.hpp"
+#include "Render/MeshCodec.hpp"
 #include "Render/Window.hpp"
 
 #include "Scene/SceneRenderer.hpp"
@@ -32,6 +34,7 @@
 
 #include "Scene/SceneSerializer.hpp"
 
+#include "Thread/TaskScheduler.hpp"
 #include "Thread/ThreadManager.hpp"
 
 #include "Utils/CVars.hpp"
@@ -88,6 +91,17 @@ void EditorLayer::on_attach(EventDispatcher& dispatcher) {
       OX_LOG_ERROR("Project argument missing a path!");
     }
   }
+
+  // logs encode/decode throughput of a mesh and exits
+  if (auto benchmark_arg = App::get()->get_command_line_args().get_index("mesh-codec-benchmark")) {
+    if (auto next_arg = App::get()->get_command_line_args().get(benchmark_arg.value() + 1)) {
+      if (const auto mesh = AssetManager::get_mesh_asset(next_arg->arg_str))
+        MeshCodec::benchmark(*mesh, 20, App::get_system<TaskScheduler>());
+    } else {
+      OX_LOG_ERROR("Mesh codec benchmark argument missing a path!");
+    }
+    App::get()->close();
+  }
 }
 
 void EditorLayer::on_detach() { editor_config.save_config(); }
@@ -450,7 +464,7 @@ void EditorLayer::render_load_indicators() {
     ImGui::End();
   }
 
-  std::erase_if(mesh_load_indicators, [](const FutureMeshLoadEvent& e) { return e.task->GetIsComplete(); });
+  std::erase_if(mesh_load_indicators, [](const FutureMeshLoadEvent& e) { return e.task->is_ready(); });
 }
 
 Shared<Scene> EditorLayer::get_active_scene() { return active_scene; }
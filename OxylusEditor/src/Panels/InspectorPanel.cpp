@@ -9,6 +9,7 @@
 #include "Assets/AssetManager.hpp"
 #include "Assets/TilemapSerializer.hpp"
 
+#include "Core/App.hpp"
 #include "Core/Systems/SystemManager.hpp"
 #include "Scene/Components.hpp"
 #include "Utils/ColorUtils.hpp"
@@ -17,12 +18,15 @@
 #include "EditorLayer.hpp"
 #include "EditorTheme.hpp"
 #include "Scene/Entity.hpp"
+#include "Thread/TaskScheduler.hpp"
 #include "UI/OxUI.hpp"
 #include "Utils/FileDialogs.hpp"
 #include "Utils/StringUtils.hpp"
 
 #include "Scene/SceneRenderer.hpp"
 
+#include "Render/MeshCodec.hpp"
+
 namespace ox {
 static bool s_rename_entity = false;
 
@@ -301,8 +305,77 @@ void InspectorPanel::draw_components(Entity entity) {
     ui::text("Mesh asset id:", fmt::format("{}", component.mesh_id).c_str());
     ui::property("Cast shadows", &component.cast_shadows);
     ui::property("Stationary", &component.stationary);
+    ui::property("Occluder", &component.occluder);
     ui::end_properties();
 
+    const auto& import_stats = component.mesh_base->import_stats;
+    if (const auto& source = import_stats.source; source.triangles != 0) {
+      const auto& optimized = import_stats.optimized;
+      ImGui::SeparatorText("Geometry");
+      const bool has_optimized = optimized.triangles != 0;
+      const auto format_stat = [has_optimized](const float before, const float after) {
+        return has_optimized ? fmt::format("{:.3f} -> {:.3f}", before, after) : fmt::format("{:.3f}", before);
+      };
+      ui::begin_properties();
+      ui::text("ACMR:", format_stat(source.get_acmr(), optimized.get_acmr()).c_str());
+      ui::text("ATVR:", format_stat(source.get_atvr(), optimized.get_atvr()).c_str());
+      ui::text("Overdraw:", format_stat(source.get_overdraw(), optimized.get_overdraw()).c_str());
+      ui::text("Overfetch:", format_stat(source.get_overfetch(), optimized.get_overfetch()).c_str());
+      ui::end_properties();
+    }
+
+    if (import_stats.vertex_bytes_full != 0) {
+      ImGui::SeparatorText("Vertex memory");
+      const auto& error = import_stats.quantization_error;
+      ui::begin_properties();
+      ui::text("Quantized primitives:", fmt::format("{} / {}", import_stats.quantized_primitives, import_stats.primitives).c_str());
+      ui::text("Vertices:",
+               fmt::format("{:.2f} KiB -> {:.2f} KiB ({:.1f}%)",
+                           (float)import_stats.vertex_bytes_full / 1024.0f,
+                           (float)import_stats.vertex_bytes / 1024.0f,
+                           100.0f * (float)import_stats.vertex_bytes / (float)import_stats.vertex_bytes_full)
+                 .c_str());
+      if (import_stats.quantized_primitives != 0)
+        ui::text("Max error:", fmt::format("pos {:.6f}, normal {:.3f} deg, uv {:.6f}", error.position, error.normal, error.uv).c_str());
+      ui::end_properties();
+    }
+
+    if (const auto& t = component.mesh_base->import_timings; t.total > 0.0f) {
+      ImGui::SeparatorText("Import timings");
+      const auto format_ms = [](const float ms) { return fmt::format("{:.2f} ms", ms); };
+      ui::begin_properties();
+      if (t.cache_read > 0.0f) {
+        ui::text("Cache read:", format_ms(t.cache_read).c_str());
+      } else {
+        ui::text("Parse:", format_ms(t.parse).c_str());
+        ui::text("Decode buffers:", format_ms(t.decode_buffers).c_str());
+        ui::text("Decode images (summed):", format_ms(t.decode_images).c_str());
+        ui::text("Upload images (summed):", format_ms(t.upload_images).c_str());
+        ui::text("Materials:", format_ms(t.materials).c_str());
+        ui::text("Convert (summed):", format_ms(t.convert).c_str());
+        ui::text("Optimize (summed):", format_ms(t.optimize).c_str());
+        ui::text("Meshlets (summed):", format_ms(t.meshlets).c_str());
+        ui::text("Emit:", format_ms(t.emit).c_str());
+        ui::text("Nodes:", format_ms(t.nodes).c_str());
+        ui::text("Cache write:", format_ms(t.cache_write).c_str());
+      }
+      ui::text("Total:", format_ms(t.total).c_str());
+      ui::end_properties();
+    }
+
+    if (ui::button("Run Codec Benchmark", {}, "Encodes the geometry of this mesh with meshoptimizer's codecs, decodes it 20 times and logs the timings."))
+      MeshCodec::benchmark(*component.mesh_base, 20, App::get_system<TaskScheduler>());
+
+    if (const auto& lods = component.mesh_base->_lods; lods.size() > 1) {
+      ImGui::SeparatorText("LODs");
+      ui::begin_properties();
+      for (uint32 i = 0; i < (uint32)lods.size(); i++) {
+        const auto label = fmt::format("{}LOD {}:", i == component.lod_index ? "> " : "", i);
+        ui::text(label.c_str(), fmt::format("{} triangles, error {:.4f}", lods[i].triangle_count, lods[i].error).c_str());
+      }
+      ui::end_properties();
+    }
+
     ImGui::SeparatorText("Materials");
 
     const float filter_cursor_pos_x = ImGui::GetCursorPosX();
@@ -914,8 +987,16 @@ void InspectorPanel::draw_components(Entity entity) {
     ui::property("Simulation Speed", &props.simulation_speed);
     ui::property("Play On Awake", &props.play_on_awake);
     ui::property("Max Particles", &props.max_particles);
+    ui::property("Deterministic", &props.deterministic, "Fixed time steps with a seeded random stream.");
+    ImGui::BeginDisabled(!props.deterministic);
+    ui::property("Seed", &props.seed);
+    ui::property("Fixed Time Step", &props.fixed_time_step, 0.001f, 0.1f, 0.001f);
+    ImGui::EndDisabled();
     ui::end_properties();
 
+    if (ui::button("Run Benchmark", {}, "Simulates 1M particles over 8 emitters for 100 frames and logs the timings."))
+      ParticleSystem::benchmark(1'000'000, 8, 100, App::get_system<TaskScheduler>());
+
     ImGui::Separator();
 
     ui::begin_properties();
@@ -8,6 +8,7 @@
 #include "Render/Vulkan/VkContext.hpp"
 #include "UI/OxUI.hpp"
 #include "Render/RendererConfig.hpp"
+#include "Render/ShaderCache.hpp"
 
 namespace ox {
 RendererSettingsPanel::RendererSettingsPanel() : EditorPanel("Renderer Settings", ICON_MDI_GPU, true) {}
@@ -36,10 +37,20 @@ void RendererSettingsPanel::on_imgui_render() {
     ImGui::Separator();
     if (ui::icon_button(ICON_MDI_RELOAD, "Reload render pipeline"))
       RendererCVar::cvar_reload_render_pipeline.toggle();
+    ImGui::SameLine();
+    if (ui::icon_button(ICON_MDI_FIRE, "Prewarm shader cache"))
+      App::get_system<ShaderCache>()->prewarm();
     ImGui::SeparatorText("Debug");
     if (ui::begin_properties(ui::default_properties_flags, true, 0.3f)) {
       ui::property("Draw AABBs", (bool*)RendererCVar::cvar_draw_bounding_boxes.get_ptr());
       ui::property("Draw meshlet AABBs", (bool*)RendererCVar::cvar_draw_meshlet_aabbs.get_ptr());
+      ui::property("CPU frustum culling", (bool*)RendererCVar::cvar_cpu_frustum_culling.get_ptr());
+      ui::property("CPU occlusion culling", (bool*)RendererCVar::cvar_occlusion_culling.get_ptr());
+      ui::property<float>("Occluder min coverage", RendererCVar::cvar_occluder_min_coverage.get_ptr(), 0, 1);
+      ui::property<int>("Max occluders", RendererCVar::cvar_max_occluders.get_ptr(), 0, 256);
+      ui::property("Sprite atlas", (bool*)RendererCVar::cvar_sprite_atlas.get_ptr());
+      ui::property("Shadow cache", (bool*)RendererCVar::cvar_shadow_cache.get_ptr());
+      ui::property("Light clustering", (bool*)RendererCVar::cvar_light_clustering.get_ptr());
       ui::property("Physics renderer", (bool*)RendererCVar::cvar_enable_physics_debug_renderer.get_ptr());
       ui::end_properties();
     }
@@ -3,6 +3,10 @@
 #include <icons/IconsMaterialDesignIcons.h>
 #include <imgui.h>
 
+#include "Core/App.hpp"
+#include "Render/Renderer.hpp"
+#include "Render/ShaderCache.hpp"
+
 namespace ox {
 StatisticsPanel::StatisticsPanel() : EditorPanel("Statistics", ICON_MDI_CLIPBOARD_TEXT, false) {}
 
@@ -75,5 +79,93 @@ void StatisticsPanel::renderer_tab() {
   ImGui::Text("FPS: %lf", static_cast<double>(avg));
   const double fps = (1.0 / static_cast<double>(avg)) * 1000.0;
   ImGui::Text("Frame time (ms): %lf", fps);
+
+  const auto& rp = Renderer::renderer_context.render_pipeline;
+  if (!rp)
+    return;
+
+  const auto& stats = rp->get_statistics();
+  ImGui::SeparatorText("Culling");
+  ImGui::Text("Instances tested: %u", stats.culling.instances_tested);
+  ImGui::Text("Instances accepted: %u", stats.culling.instances_accepted);
+  ImGui::Text("Occluders: %u (%u triangles)", stats.culling.occluders, stats.culling.occluder_triangles);
+  ImGui::Text("Instances occluded: %u", stats.culling.instances_occluded);
+  ImGui::Text("Occlusion culling (ms): %.3f", stats.culling.occlusion_ms);
+  ImGui::Text("LOD meshlets: %u (%u at full detail)", stats.culling.lod_meshlets_selected, stats.culling.lod_meshlets_full_detail);
+  if (ImGui::Button("Dump occlusion depth"))
+    RendererCVar::cvar_occlusion_dump_depth.toggle();
+
+  ImGui::SeparatorText("Mesh LODs");
+  for (uint32 i = 0; i < RenderStatistics::MAX_LODS; i++) {
+    if (stats.lods.instances[i] != 0)
+      ImGui::Text("LOD %u: %u instances, %llu triangles", i, stats.lods.instances[i], (unsigned long long)stats.lods.triangles[i]);
+  }
+  if (ImGui::Button("Show selected LODs"))
+    RendererCVar::cvar_draw_mesh_lods.toggle();
+
+  ImGui::SeparatorText("2D");
+  ImGui::Text("Sprites: %u", stats.sprites.sprite_count);
+  ImGui::Text("Batches: %u", stats.sprites.batch_count);
+  ImGui::Text("Sort (ms): %.3f", stats.sprites.sort_ms);
+  ImGui::Text("Atlas pages: %u (%u textures)", stats.sprites.atlas_pages, stats.sprites.atlas_textures);
+
+  ImGui::SeparatorText("Lights");
+  ImGui::Text("Lights: %u (%u visible)", stats.lights.light_count, stats.lights.visible_lights);
+  ImGui::Text("Clusters: %u / %u", stats.lights.non_empty_clusters, stats.lights.cluster_count);
+  ImGui::Text("Lights per cluster: %.2f avg, %u max", stats.lights.average_lights_per_cluster, stats.lights.max_lights_per_cluster);
+  ImGui::Text("Clustering (ms): %.3f", stats.lights.clustering_ms);
+
+  ImGui::SeparatorText("Shadows");
+  ImGui::Text("Tiles: %u (%u rendered, %u cached)", stats.shadows.tiles, stats.shadows.tiles_rendered, stats.shadows.tiles_cached);
+  ImGui::Text("Dropped: %u", stats.shadows.tiles_dropped);
+  ImGui::Text("Evictions: %u Repacks: %u", stats.shadows.evictions, stats.shadows.repacks);
+  ImGui::Text("Atlas usage: %.1f%%", stats.shadows.atlas_usage * 100.0f);
+  ImGui::Text("Views: %u rendered, %u reused", stats.shadows.views_rendered, stats.shadows.views_reused);
+  const auto& cascade_casters = stats.shadows.cascade_casters;
+  ImGui::Text("Cascade casters: %u %u %u %u", cascade_casters[0], cascade_casters[1], cascade_casters[2], cascade_casters[3]);
+  ImGui::Text("Caster culling (ms): %.3f", stats.shadows.caster_culling_ms);
+
+  ImGui::SeparatorText("Pipelines");
+  ImGui::Text("Ready: %u / %u", stats.pipelines.ready, stats.pipelines.pipeline_count);
+  ImGui::Text("Pending: %u Failed: %u Lazy: %u", stats.pipelines.pending, stats.pipelines.failed, stats.pipelines.created_lazily);
+  ImGui::Text("Startup (ms): %.3f Compile (ms): %.3f", stats.pipelines.startup_ms, stats.pipelines.compile_ms);
+
+  ImGui::SeparatorText("GPU buffers");
+  const auto buffer_text = [](const char* name, const RenderStatistics::Buffer& buffer) {
+    constexpr float kb = 1.0f / 1024.0f;
+    ImGui::Text("%s: %.1f / %.1f KB (peak %.1f KB), %u grows, %u shrinks",
+                name,
+                (float)buffer.used * kb,
+                (float)buffer.capacity * kb,
+                (float)buffer.high_water * kb,
+                buffer.grows,
+                buffer.shrinks);
+  };
+  buffer_text("Visible meshlets", stats.buffers.visible_meshlets);
+  buffer_text("Instanced indices", stats.buffers.instanced_indices);
+  buffer_text("Debug AABBs", stats.buffers.debug_aabbs);
+  ImGui::Text("Allocated (KB): %.1f", (float)stats.buffers.allocated_bytes / 1024.0f);
+
+  ImGui::SeparatorText("Uploads");
+  ImGui::Text("Frame: %.1f KB in %u uploads", (float)stats.uploads.frame_bytes / 1024.0f, stats.uploads.frame_allocations);
+  ImGui::Text("Ring: %.1f / %.1f MB (peak %.1f MB)",
+              (float)stats.uploads.used / (1024.0f * 1024.0f),
+              (float)stats.uploads.capacity / (1024.0f * 1024.0f),
+              (float)stats.uploads.peak_used / (1024.0f * 1024.0f));
+  ImGui::Text("Wraps: %llu", (unsigned long long)stats.uploads.wraps);
+  ImGui::Text("Fallbacks: %u (%.1f KB)", stats.uploads.fallbacks, (float)stats.uploads.fallback_bytes / 1024.0f);
+
+  ImGui::SeparatorText("Debug renderer");
+  ImGui::Text("Lines: %u Triangles: %u Shapes: %u", stats.debug.lines, stats.debug.triangles, stats.debug.shapes);
+  ImGui::Text("Dropped: %u", stats.debug.dropped);
+  ImGui::Text("Physics: %u instances in %u draws", stats.debug.mesh_instances, stats.debug.mesh_draws);
+
+  const auto* shader_cache = App::get_system<ShaderCache>();
+  const auto shader_stats = shader_cache->get_stats();
+  ImGui::SeparatorText("Shader cache");
+  ImGui::Text("Compiler: %s", shader_cache->get_compiler_version().empty() ? "unavailable" : shader_cache->get_compiler_version().c_str());
+  ImGui::Text("Hits: %u Misses: %u Failed: %u", shader_stats.hits, shader_stats.misses, shader_stats.failed);
+  ImGui::Text("Prewarmed: %u", shader_stats.prewarmed);
+  ImGui::Text("Load (ms): %.3f Compile (ms): %.3f", shader_stats.load_ms, shader_stats.compile_ms);
 }
 } // namespace ox